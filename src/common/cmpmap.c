@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cmpmap.h"
+#include "mfu.h"
+
+/* default size of an arena block for key strings */
+#define CMPMAP_BLOCK_SIZE (1024 * 1024)
+
+/* FNV-1a hash of key, the items on a rank have already been
+ * selected by a Jenkins hash of their name, so use a different
+ * function here to spread them over the table */
+static uint64_t cmpmap_hash(const char* key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char* ptr = (const unsigned char*) key;
+    while (*ptr != '\0') {
+        hash ^= (uint64_t) *ptr;
+        hash *= 1099511628211ULL;
+        ptr++;
+    }
+    return hash;
+}
+
+/* copy key into arena, allocating a new block if needed */
+static const char* cmpmap_key_copy(cmpmap* map, const char* key)
+{
+    size_t len = strlen(key) + 1;
+
+    cmpmap_block* block = map->blocks;
+    if (block == NULL || block->size - block->used < len) {
+        /* allocate a new block big enough for this key */
+        size_t size = CMPMAP_BLOCK_SIZE;
+        if (size < len) {
+            size = len;
+        }
+        block = (cmpmap_block*) MFU_MALLOC(sizeof(cmpmap_block) + size);
+        block->next = map->blocks;
+        block->size = size;
+        block->used = 0;
+        block->data = (char*)(block + 1);
+        map->blocks = block;
+    }
+
+    char* copy = block->data + block->used;
+    memcpy(copy, key, len);
+    block->used += len;
+    return copy;
+}
+
+/* insert entry index into table, assumes there is a free slot */
+static void cmpmap_slot_insert(cmpmap* map, uint64_t entry_index)
+{
+    uint64_t mask = map->slot_count - 1;
+    uint64_t slot = map->entries[entry_index].hash & mask;
+    while (map->slots[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    map->slots[slot] = entry_index + 1;
+}
+
+/* resize table to given number of slots, a power of two,
+ * and reinsert all entries */
+static void cmpmap_rehash(cmpmap* map, uint64_t slot_count)
+{
+    mfu_free(&map->slots);
+    map->slot_count = slot_count;
+    map->slots = (uint64_t*) MFU_MALLOC(slot_count * sizeof(uint64_t));
+    memset(map->slots, 0, slot_count * sizeof(uint64_t));
+
+    uint64_t i;
+    for (i = 0; i < map->size; i++) {
+        cmpmap_slot_insert(map, i);
+    }
+}
+
+cmpmap* cmpmap_new(int states, char init_state, uint64_t count)
+{
+    if (states > CMPMAP_MAX_STATES) {
+        MFU_ABORT(1, "Too many states for compare map: %d", states);
+    }
+
+    cmpmap* map = (cmpmap*) MFU_MALLOC(sizeof(cmpmap));
+    map->size       = 0;
+    map->capacity   = 0;
+    map->entries    = NULL;
+    map->slots      = NULL;
+    map->slot_count = 0;
+    map->blocks     = NULL;
+    map->states     = states;
+    map->init_state = init_state;
+    map->sorted     = 0;
+    map->last       = 0;
+
+    /* allocate entries and a table at most half full */
+    if (count > 0) {
+        map->capacity = count;
+        map->entries = (cmpmap_entry*) MFU_MALLOC(count * sizeof(cmpmap_entry));
+    }
+    uint64_t slot_count = 16;
+    while (slot_count < 2 * count) {
+        slot_count *= 2;
+    }
+    cmpmap_rehash(map, slot_count);
+
+    return map;
+}
+
+cmpmap* cmpmap_new_sorted(int states, char init_state, uint64_t count)
+{
+    /* create a map without a table */
+    cmpmap* map = cmpmap_new(states, init_state, count);
+    mfu_free(&map->slots);
+    map->slot_count = 0;
+    map->sorted = 1;
+    return map;
+}
+
+static int cmpmap_entry_cmp(const void* a, const void* b)
+{
+    const cmpmap_entry* x = (const cmpmap_entry*) a;
+    const cmpmap_entry* y = (const cmpmap_entry*) b;
+    return strcmp(x->key, y->key);
+}
+
+void cmpmap_sort(cmpmap* map)
+{
+    if (map->sorted && map->size > 0) {
+        qsort(map->entries, (size_t) map->size, sizeof(cmpmap_entry), cmpmap_entry_cmp);
+    }
+    map->last = 0;
+}
+
+void cmpmap_delete(cmpmap** pmap)
+{
+    if (pmap == NULL || *pmap == NULL) {
+        return;
+    }
+    cmpmap* map = *pmap;
+
+    cmpmap_block* block = map->blocks;
+    while (block != NULL) {
+        cmpmap_block* next = block->next;
+        mfu_free(&block);
+        block = next;
+    }
+
+    mfu_free(&map->slots);
+    mfu_free(&map->entries);
+    mfu_free(pmap);
+}
+
+uint64_t cmpmap_size(const cmpmap* map)
+{
+    if (map == NULL) {
+        return 0;
+    }
+    return map->size;
+}
+
+/* return slot holding key, or the empty slot where it would go */
+static uint64_t cmpmap_find(const cmpmap* map, const char* key, uint64_t hash)
+{
+    uint64_t mask = map->slot_count - 1;
+    uint64_t slot = hash & mask;
+    while (map->slots[slot] != 0) {
+        const cmpmap_entry* entry = &map->entries[map->slots[slot] - 1];
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* append entry to array, growing it if needed */
+static cmpmap_entry* cmpmap_append(cmpmap* map, const char* key, uint64_t hash)
+{
+    if (map->size == map->capacity) {
+        uint64_t capacity = (map->capacity > 0) ? map->capacity * 2 : 64;
+        cmpmap_entry* entries = (cmpmap_entry*) MFU_MALLOC(capacity * sizeof(cmpmap_entry));
+        if (map->size > 0) {
+            memcpy(entries, map->entries, map->size * sizeof(cmpmap_entry));
+        }
+        mfu_free(&map->entries);
+        map->entries  = entries;
+        map->capacity = capacity;
+    }
+
+    cmpmap_entry* entry = &map->entries[map->size];
+    entry->key  = cmpmap_key_copy(map, key);
+    entry->hash = hash;
+    map->size++;
+    return entry;
+}
+
+cmpmap_entry* cmpmap_set(cmpmap* map, const char* key, uint64_t index)
+{
+    cmpmap_entry* entry;
+    if (map->sorted) {
+        /* keys are unique, so just append, the entries
+         * are put in order by cmpmap_sort */
+        entry = cmpmap_append(map, key, 0);
+        entry->index = index;
+        memset(entry->states, map->init_state, sizeof(entry->states));
+        return entry;
+    }
+
+    uint64_t hash = cmpmap_hash(key);
+    uint64_t slot = cmpmap_find(map, key, hash);
+
+    if (map->slots[slot] != 0) {
+        /* key exists, reset its value */
+        entry = &map->entries[map->slots[slot] - 1];
+    }
+    else {
+        /* add new entry */
+        entry = cmpmap_append(map, key, hash);
+        map->slots[slot] = map->size;
+
+        /* keep table at most half full */
+        if (map->size * 2 > map->slot_count) {
+            cmpmap_rehash(map, map->slot_count * 2);
+        }
+    }
+
+    entry->index = index;
+    memset(entry->states, map->init_state, sizeof(entry->states));
+
+    return entry;
+}
+
+/* record entry as the last one found and return it,
+ * the cache does not change the contents of the map */
+static cmpmap_entry* cmpmap_found(const cmpmap* map, uint64_t entry_index)
+{
+    ((cmpmap*)map)->last = entry_index + 1;
+    return &map->entries[entry_index];
+}
+
+cmpmap_entry* cmpmap_get(const cmpmap* map, const char* key)
+{
+    /* callers tend to update several fields of one key in a row */
+    if (map->last != 0 && strcmp(map->entries[map->last - 1].key, key) == 0) {
+        return &map->entries[map->last - 1];
+    }
+
+    if (map->sorted) {
+        /* binary search sorted entries */
+        uint64_t low  = 0;
+        uint64_t high = map->size;
+        while (low < high) {
+            uint64_t mid = low + (high - low) / 2;
+            int cmp = strcmp(map->entries[mid].key, key);
+            if (cmp == 0) {
+                return cmpmap_found(map, mid);
+            }
+            if (cmp < 0) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return NULL;
+    }
+
+    uint64_t hash = cmpmap_hash(key);
+    uint64_t slot = cmpmap_find(map, key, hash);
+    if (map->slots[slot] == 0) {
+        return NULL;
+    }
+    return cmpmap_found(map, map->slots[slot] - 1);
+}
+
+cmpmap_entry* cmpmap_match(const cmpmap* map, const char* key, uint64_t* cursor)
+{
+    if (! map->sorted) {
+        return cmpmap_get(map, key);
+    }
+
+    /* advance past entries that come before key */
+    uint64_t i = *cursor;
+    while (i < map->size && strcmp(map->entries[i].key, key) < 0) {
+        i++;
+    }
+    *cursor = i;
+
+    if (i < map->size && strcmp(map->entries[i].key, key) == 0) {
+        return cmpmap_found(map, i);
+    }
+    return NULL;
+}
+
+const cmpmap_entry* cmpmap_entry_first(const cmpmap* map)
+{
+    if (map == NULL || map->size == 0) {
+        return NULL;
+    }
+    return &map->entries[0];
+}
+
+const cmpmap_entry* cmpmap_entry_next(const cmpmap* map, const cmpmap_entry* entry)
+{
+    const cmpmap_entry* next = entry + 1;
+    if (next >= map->entries + map->size) {
+        return NULL;
+    }
+    return next;
+}
@@ -0,0 +1,109 @@
+#ifndef CMPMAP_H
+#define CMPMAP_H
+
+/* Maps a relative path to the index of the item in its file list
+ * and a small array of per-field comparison states, as used by dcmp
+ * and dsync.  Keys are copied into a few large arena blocks, entries
+ * are fixed-size structs kept in insertion order, and lookups go
+ * through an open-addressing hash table, so there is no allocation
+ * per item and no string encoding of the value.
+ *
+ * A map can instead be created sorted, in which case it has no hash
+ * table.  Entries are sorted by key once all have been added, lookups
+ * use a binary search, and a caller that looks up keys in increasing
+ * order can pass a cursor to match two maps in a single merge pass. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* max number of state bytes held by each entry */
+#define CMPMAP_MAX_STATES (16)
+
+/* Even though the structures are defined here,
+ * consider these types to be opaque and only
+ * use functions in this file to modify them. */
+
+/* an entry in the map */
+typedef struct cmpmap_entry_struct {
+  const char* key;                 /* pointer to key string in arena */
+  uint64_t hash;                   /* hash of key string */
+  uint64_t index;                  /* index of item in its list */
+  char states[CMPMAP_MAX_STATES];  /* comparison state of each field */
+} cmpmap_entry;
+
+/* a block of memory holding key strings */
+typedef struct cmpmap_block_struct {
+  struct cmpmap_block_struct* next; /* next block in list */
+  size_t size;                      /* bytes available in data */
+  size_t used;                      /* bytes used in data */
+  char* data;                       /* start of key strings */
+} cmpmap_block;
+
+/* structure to track a map */
+typedef struct cmpmap_struct {
+  cmpmap_entry* entries; /* entries in insertion order */
+  uint64_t size;         /* number of entries */
+  uint64_t capacity;     /* number of entries allocated */
+  uint64_t* slots;       /* hash table, entry index + 1, 0 if empty */
+  uint64_t slot_count;   /* number of slots, a power of two */
+  cmpmap_block* blocks;  /* list of arena blocks, newest first */
+  int sorted;            /* whether map uses sorted entries rather than hash table */
+  uint64_t last;         /* entry index + 1 of last key found, 0 if none */
+  int states;            /* number of state bytes in use */
+  char init_state;       /* initial value of each state byte */
+} cmpmap;
+
+/* allocates a new map with given number of states per entry,
+ * each set to init_state when an entry is created,
+ * count is a hint of the number of entries to be added */
+cmpmap* cmpmap_new(int states, char init_state, uint64_t count);
+
+/* allocates a new sorted map, keys added to it must be unique,
+ * and cmpmap_sort must be called after adding all keys and before
+ * looking any up */
+cmpmap* cmpmap_new_sorted(int states, char init_state, uint64_t count);
+
+/* sort entries of a sorted map by key */
+void cmpmap_sort(cmpmap* map);
+
+/* frees a map */
+void cmpmap_delete(cmpmap** map);
+
+/* return number of entries in map */
+uint64_t cmpmap_size(const cmpmap* map);
+
+/* insert key with index and initial states, if key exists its index
+ * is replaced and its states are reset, returns pointer to entry,
+ * which is valid until the next insert */
+cmpmap_entry* cmpmap_set(cmpmap* map, const char* key, uint64_t index);
+
+/* returns pointer to entry for key if found, NULL otherwise,
+ * which is valid until the next insert, repeated lookups of the
+ * same key only compare it against the previous result */
+cmpmap_entry* cmpmap_get(const cmpmap* map, const char* key);
+
+/* like cmpmap_get, but for a sorted map, cursor tracks the position
+ * of the last match, so that looking up keys in increasing order,
+ * starting with a cursor of 0, walks the map just once */
+cmpmap_entry* cmpmap_match(const cmpmap* map, const char* key, uint64_t* cursor);
+
+/* return first entry in insertion order (key order for a sorted map),
+ * NULL if map is empty */
+const cmpmap_entry* cmpmap_entry_first(const cmpmap* map);
+
+/* return entry following given entry, NULL if it is the last */
+const cmpmap_entry* cmpmap_entry_next(const cmpmap* map, const cmpmap_entry* entry);
+
+#define cmpmap_foreach(cmpmap, entry)       \
+  for ((entry) = cmpmap_entry_first(cmpmap); \
+    (entry) != NULL;                         \
+    (entry) = cmpmap_entry_next(cmpmap, entry))
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CMPMAP_H */
@@ -120,7 +120,7 @@ static size_t list_elem_pack2_size(int detail, uint64_t chars, const elem_t* ele
 {
     size_t size;
     if (detail) {
-        size = 2 * 4 + chars + 0 * 4 + 10 * 8;
+        size = 2 * 4 + chars + 0 * 4 + 13 * 8;
     }
     else {
         size = 2 * 4 + chars + 1 * 4;
@@ -158,6 +158,9 @@ static size_t list_elem_pack2(void* buf, int detail, uint64_t chars, const elem_
         mfu_pack_uint64(&ptr, elem->ctime);
         mfu_pack_uint64(&ptr, elem->ctime_nsec);
         mfu_pack_uint64(&ptr, elem->size);
+        mfu_pack_uint64(&ptr, elem->dev);
+        mfu_pack_uint64(&ptr, elem->ino);
+        mfu_pack_uint64(&ptr, elem->nlink);
     }
     else {
         /* just have the file type */
@@ -207,6 +210,9 @@ static size_t list_elem_unpack2(const void* buf, elem_t* elem)
         mfu_unpack_uint64(&ptr, &elem->ctime);
         mfu_unpack_uint64(&ptr, &elem->ctime_nsec);
         mfu_unpack_uint64(&ptr, &elem->size);
+        mfu_unpack_uint64(&ptr, &elem->dev);
+        mfu_unpack_uint64(&ptr, &elem->ino);
+        mfu_unpack_uint64(&ptr, &elem->nlink);
 
         /* use mode to set file type */
         elem->type = mfu_flist_mode_to_filetype((mode_t)elem->mode);
@@ -216,6 +222,11 @@ static size_t list_elem_unpack2(const void* buf, elem_t* elem)
         uint32_t type;
         mfu_unpack_uint32(&ptr, &type);
         elem->type = (mfu_filetype) type;
+
+        /* no inode to match against other names */
+        elem->dev   = 0;
+        elem->ino   = 0;
+        elem->nlink = 0;
     }
 
     size_t bytes = (size_t)(ptr - start);
@@ -282,6 +293,9 @@ static void list_insert_copy(flist_t* flist, elem_t* src)
     elem->ctime      = src->ctime;
     elem->ctime_nsec = src->ctime_nsec;
     elem->size       = src->size;
+    elem->dev        = src->dev;
+    elem->ino        = src->ino;
+    elem->nlink      = src->nlink;
 
     /* append element to tail of linked list */
     mfu_flist_insert_elem(flist, elem);
@@ -326,10 +340,18 @@ void mfu_flist_insert_stat(flist_t* flist, const char* fpath, mode_t mode, const
 
         elem->size  = (uint64_t) sb->st_size;
 
+        /* record inode so hard links to the same file can be found */
+        elem->dev   = (uint64_t) sb->st_dev;
+        elem->ino   = (uint64_t) sb->st_ino;
+        elem->nlink = (uint64_t) sb->st_nlink;
+
         /* TODO: link to user and group names? */
     }
     else {
         elem->detail = 0;
+        elem->dev    = 0;
+        elem->ino    = 0;
+        elem->nlink  = 0;
     }
 
     /* append element to tail of linked list */
@@ -915,6 +937,39 @@ uint64_t mfu_flist_file_get_size(mfu_flist bflist, uint64_t idx)
     return ret;
 }
 
+uint64_t mfu_flist_file_get_dev(mfu_flist bflist, uint64_t idx)
+{
+    uint64_t ret = (uint64_t) - 1;
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL && flist->detail) {
+        ret = elem->dev;
+    }
+    return ret;
+}
+
+uint64_t mfu_flist_file_get_ino(mfu_flist bflist, uint64_t idx)
+{
+    uint64_t ret = (uint64_t) - 1;
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL && flist->detail) {
+        ret = elem->ino;
+    }
+    return ret;
+}
+
+uint64_t mfu_flist_file_get_nlink(mfu_flist bflist, uint64_t idx)
+{
+    uint64_t ret = (uint64_t) - 1;
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL && flist->detail) {
+        ret = elem->nlink;
+    }
+    return ret;
+}
+
 const char* mfu_flist_file_get_username(mfu_flist bflist, uint64_t idx)
 {
     const char* ret = NULL;
@@ -1220,6 +1275,34 @@ size_t mfu_flist_file_pack(void* buf, mfu_flist bflist, uint64_t idx)
     return 0;
 }
 
+/* number of bytes to pack item with its name field trimmed to the
+ * length of its own name rather than the longest name in the list */
+size_t mfu_flist_file_pack_compact_size(mfu_flist bflist, uint64_t idx)
+{
+    /* convert handle to flist_t */
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL) {
+        uint64_t chars = (uint64_t) strlen(elem->file) + 1;
+        size_t size = list_elem_pack2_size(flist->detail, chars, elem);
+        return size;
+    }
+    return 0;
+}
+
+size_t mfu_flist_file_pack_compact(void* buf, mfu_flist bflist, uint64_t idx)
+{
+    /* convert handle to flist_t */
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL) {
+        uint64_t chars = (uint64_t) strlen(elem->file) + 1;
+        size_t size = list_elem_pack2(buf, flist->detail, chars, elem);
+        return size;
+    }
+    return 0;
+}
+
 size_t mfu_flist_file_unpack(const void* buf, mfu_flist bflist)
 {
     /* convert handle to flist_t */
@@ -1254,6 +1337,9 @@ uint64_t mfu_flist_file_create(mfu_flist bflist)
     elem->ctime      = 0;
     elem->ctime_nsec = 0;
     elem->size       = 0;
+    elem->dev        = 0;
+    elem->ino        = 0;
+    elem->nlink      = 0;
 
     /* append element to tail of linked list */
     mfu_flist_insert_elem(flist, elem);
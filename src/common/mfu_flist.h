@@ -65,6 +65,28 @@ extern "C" {
 /* default buffer size to read/write data to file system */
 #define FD_BLOCK_SIZE (1*1024*1024)
 
+/* default number of blocks to keep in flight during a copy,
+ * 2 keeps one read outstanding while the previous block is written */
+#define FD_IO_DEPTH (2)
+
+/* number of chunks per rank to aim for when sizing chunks
+ * of large files with an adaptive chunk size */
+#define FD_CHUNKS_PER_RANK (4)
+
+/* number of bytes of a file to place on each stripe when choosing
+ * a layout for a large destination file from its size */
+#define FD_LAYOUT_STRIPE_BYTES (1024ULL*1024ULL*1024ULL)
+
+/* Lustre stripe sizes are multiples of this many bytes */
+#define FD_LAYOUT_STRIPE_ALIGN (64ULL*1024ULL)
+
+/* largest stripe count Lustre allows on a file */
+#define FD_LAYOUT_MAX_STRIPES (2000)
+
+/* alignment of file offsets and sizes for O_DIRECT when the
+ * file system does not report its own */
+#define FD_DIO_ALIGN (4096)
+
 /*
  * FIXME: Is this description correct?
  *
@@ -269,6 +291,17 @@ void mfu_flist_read_cache(
     mfu_flist flist
 );
 
+/* read file list of items under path from a cache file written by
+ * walking path, for tools that use the cache in place of a walk,
+ * the cache must record stat details of each item, and every item
+ * must be path itself or fall under it, returns 0 on success and
+ * -1 on error */
+int mfu_flist_read_cache_under(
+    const char* name,
+    const char* path,
+    mfu_flist flist
+);
+
 /* write file list to file */
 void mfu_flist_write_cache(
     const char* name,
@@ -308,6 +341,15 @@ size_t mfu_flist_file_pack_size(mfu_flist flist);
 /* pack specified file into buf, return number of bytes used */
 size_t mfu_flist_file_pack(void* buf, mfu_flist flist, uint64_t index);
 
+/* get number of bytes to pack specified file, sized to the length
+ * of its own name rather than the longest name in the list */
+size_t mfu_flist_file_pack_compact_size(mfu_flist flist, uint64_t index);
+
+/* pack specified file into buf using only as many bytes for its name
+ * as it needs, return number of bytes used, mfu_flist_file_unpack
+ * reads both this and the fixed-size format */
+size_t mfu_flist_file_pack_compact(void* buf, mfu_flist flist, uint64_t index);
+
 /* unpack file from buf and insert into list, return number of bytes read */
 size_t mfu_flist_file_unpack(const void* buf, mfu_flist flist);
 
@@ -379,6 +421,9 @@ uint64_t mfu_flist_file_get_mtime_nsec(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_ctime(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_ctime_nsec(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_size(mfu_flist flist, uint64_t index);
+uint64_t mfu_flist_file_get_dev(mfu_flist flist, uint64_t index);
+uint64_t mfu_flist_file_get_ino(mfu_flist flist, uint64_t index);
+uint64_t mfu_flist_file_get_nlink(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_perm(mfu_flist flist, uint64_t index);
 #if DCOPY_USE_XATTRS
 void *mfu_flist_file_get_acl(mfu_flist bflist, uint64_t idx, ssize_t *acl_size, char *type);
@@ -429,6 +474,35 @@ mfu_flist mfu_flist_spread(mfu_flist flist);
  *   char fields[] = "size,-name"; */
 int mfu_flist_sort(const char* fields, mfu_flist* flist);
 
+/* return in topk a new list of the first count items of flist as they
+ * would be ordered by mfu_flist_sort on a single numeric field, one of
+ *   uid,gid,atime,mtime,ctime,size
+ * without sorting the full list, items are placed in order on rank 0,
+ * for example to get the 1000 largest files
+ *   mfu_flist_topk(flist, "-size", 1000, &topk); */
+int mfu_flist_topk(mfu_flist flist, const char* field, uint64_t count, mfu_flist* topk);
+
+/* estimate values of a numeric field at n quantiles in [0,1] to within
+ * 1% and return them in values on all ranks, the 0 and 1 quantiles
+ * are the exact min and max values */
+int mfu_flist_quantiles(mfu_flist flist, const char* field, int n, const double* quantiles, uint64_t* values);
+
+/* print the first count items of flist as ordered by field */
+void mfu_flist_print_topk(mfu_flist flist, const char* field, uint64_t count);
+
+/* returns 1 if field names a numeric field accepted by mfu_flist_topk
+ * and mfu_flist_quantiles, optionally preceded by '-', 0 otherwise */
+int mfu_flist_numeric_field_valid(const char* field);
+
+/* parse a "<field>:<N>" argument for mfu_flist_topk, on success sets
+ * field to a newly allocated copy of the numeric field name, which the
+ * caller frees with mfu_free, and count to N, which must be positive,
+ * returns MFU_SUCCESS or MFU_FAILURE */
+int mfu_flist_parse_topk(const char* str, char** field, uint64_t* count);
+
+/* print min, max, and estimated percentiles of field */
+void mfu_flist_print_quantiles(mfu_flist flist, const char* field);
+
 /****************************************
  * Functions to create / remove data on file system based on input list
  ****************************************/
@@ -517,8 +591,14 @@ void mfu_flist_chmod(
  * to match source if needed, returns 0 on success -1 on error */
 int mfu_flist_file_sync_meta(mfu_flist src_list, uint64_t src_index, mfu_flist dst_list, uint64_t dst_index);
 
+/* set atime and mtime of dest_path to those of the given item,
+ * returns 0 on success -1 on error */
+int mfu_flist_file_copy_timestamps(mfu_flist flist, uint64_t idx, const char* dest_path);
+
 /* TODO: integrate this into the file list proper, or otherwise move it to another file */
-/* element structure in linked list returned by mfu_file_chunk_list_alloc */
+/* element structure in list returned by mfu_file_chunk_list_alloc,
+ * elements are stored in order in a single array, so head[i] is the
+ * i-th element, and they are also linked through next */
 typedef struct mfu_file_chunk_struct {
   const char* name;        /* full path to file name */
   uint64_t offset;         /* starting byte offset in file */
@@ -530,11 +610,21 @@ typedef struct mfu_file_chunk_struct {
 } mfu_file_chunk;
 
 /* given a file list and a chunk size, split files at chunk boundaries and evenly
- * spread chunks to processes, returns a linked list of file sections each process
- * is responsbile for */
+ * spread chunks to processes, returns a list of file sections each process
+ * is responsbile for, consecutive chunks of a file are spread to ranks
+ * on the same node when possible, and they share one name string */
 mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size);
 
-/* free the linked list allocated with mfu_file_chunk_list_alloc */
+/* like mfu_file_chunk_list_alloc, but picks a chunk size for each file based
+ * on its size and the number of ranks, rounded up to a multiple of
+ * min_chunk_size and limited to max_chunk_size, a fixed size is used when
+ * max_chunk_size is not larger than min_chunk_size */
+mfu_file_chunk* mfu_file_chunk_list_alloc_adaptive(mfu_flist list, uint64_t min_chunk_size, uint64_t max_chunk_size);
+
+/* return chunk size mfu_file_chunk_list_alloc_adaptive uses for a file of given size */
+uint64_t mfu_file_chunk_size(uint64_t file_size, uint64_t min_chunk_size, uint64_t max_chunk_size);
+
+/* free the list allocated with mfu_file_chunk_list_alloc */
 void mfu_file_chunk_list_free(mfu_file_chunk** phead);
 
 /* return number of items in chunk list */
@@ -551,6 +641,145 @@ void mfu_file_chunk_list_lor(
     int* results                /* OUT - array of output, storing logical OR across all chunks for each item in flist */
 );
 
+/* given arrays of owner rank and owner index of chunks whose flag is set,
+ * set results[index] to 1 on the process owning each item,
+ * used instead of mfu_file_chunk_list_lor when chunks are processed
+ * in an order that does not follow the chunk list */
+void mfu_file_chunk_lor_owners(
+    uint64_t count,                /* IN  - number of entries in owner arrays */
+    const uint64_t* owner_ranks,   /* IN  - rank_of_owner of each chunk with flag set */
+    const uint64_t* owner_indices, /* IN  - index_of_owner of each chunk with flag set */
+    int* results                   /* OUT - set to 1 for each item in flist named in arrays */
+);
+
+/* given chunk lists of source and destination files generated from
+ * lists holding the same file sizes in the same order, compare each
+ * source section with the same section of its destination file and
+ * set vals[i] to 0 if the section is the same and 1 if it differs,
+ * unless overwriting, processes periodically exchange the files they
+ * found to differ so that none reads further into those files,
+ * returns 0 on success and -1 if this process hit an error reading,
+ * must be called by all processes */
+int mfu_file_chunk_list_compare(
+    const mfu_file_chunk* src_head, /* IN  - chunk list of source files */
+    const mfu_file_chunk* dst_head, /* IN  - chunk list of destination files */
+    uint64_t chunk_size,            /* IN  - number of bytes to compare between checks for files known to differ */
+    size_t bufsize,                 /* IN  - size of I/O buffer to be used during compare */
+    int overwrite,                  /* IN  - whether to replace dest with source contents (1) or not (0) */
+    int* vals,                      /* OUT - flag for each element in chunk list, 1 if section differs */
+    uint64_t* count_bytes_read,     /* OUT - number of bytes read (src + dest) */
+    uint64_t* count_bytes_written,  /* OUT - number of bytes written to dest */
+    mfu_progress* prg               /* IN  - progress message structure */
+);
+
+/* checksum of a section of a file */
+typedef struct {
+  uint64_t rank_of_owner;  /* MPI rank acting as the owner of this file */
+  uint64_t index_of_owner; /* index value of file in original flist on its owner rank */
+  uint64_t offset;         /* starting byte offset of section in file */
+  uint64_t length;         /* number of bytes covered by checksum */
+  mfu_crc128 crc;          /* checksum of bytes in section */
+} mfu_file_chunk_crc;
+
+/* given checksums of sections of files in flist, possibly computed
+ * on other processes, send each to the process owning the file and
+ * combine them in offset order, sets valid[index] to 1 and crcs[index]
+ * to the checksum of the whole file for each item in flist whose
+ * sections cover the file exactly, and sets valid[index] to 0 otherwise */
+void mfu_file_chunk_crc_combine(
+    mfu_flist list,                     /* IN  - input flist */
+    uint64_t count,                     /* IN  - number of sections */
+    const mfu_file_chunk_crc* sections, /* IN  - checksums of sections */
+    mfu_crc128* crcs,                   /* OUT - checksum for each item in flist */
+    int* valid                          /* OUT - whether checksum is set for each item in flist */
+);
+
+/* compute 128-bit checksum of each regular file in flist, reads are
+ * split at chunk boundaries and spread evenly over processes, sets
+ * valid[index] to 0 for files that could not be fully read,
+ * returns 0 on success and -1 on error */
+int mfu_flist_checksum(
+    mfu_flist list,      /* IN  - input flist */
+    uint64_t chunk_size, /* IN  - size of sections to split files into */
+    size_t buf_size,     /* IN  - size of buffer to read data with */
+    mfu_crc128* crcs,    /* OUT - checksum for each item in flist */
+    int* valid           /* OUT - whether checksum is set for each item in flist */
+);
+
+/* like mfu_flist_checksum, and also sets chunk_crcs[index] to an array
+ * with the checksum of each chunk_size section of the file, in offset
+ * order, for each valid item, which the caller frees with mfu_free,
+ * an empty file has a single empty section, NULL for other items */
+int mfu_flist_checksum_chunks(
+    mfu_flist list,        /* IN  - input flist */
+    uint64_t chunk_size,   /* IN  - size of sections to split files into */
+    size_t buf_size,       /* IN  - size of buffer to read data with */
+    mfu_crc128* crcs,      /* OUT - checksum for each item in flist */
+    int* valid,            /* OUT - whether checksum is set for each item in flist */
+    mfu_crc128** chunk_crcs /* OUT - checksums of sections for each item in flist */
+);
+
+/* entry in a checksum manifest, which records one line per file
+ * as "<checksum in 32 hex digits> <size in bytes> <path>", a manifest
+ * that also records checksums of chunks starts with a
+ * "#chunk_size <bytes>" line, and lists the mtime of the file as
+ * "<secs>.<nsecs>" followed by the checksums of its chunks
+ * comma-separated in hex before the path on each line */
+typedef struct {
+  char* name;             /* path to file */
+  uint64_t size;          /* size of file in bytes */
+  uint64_t mtime;         /* mtime seconds, 0 if not recorded */
+  uint64_t mtime_nsec;    /* mtime nanoseconds */
+  mfu_crc128 crc;         /* 128-bit checksum of file contents */
+  uint64_t chunks;        /* number of chunk checksums, 0 if none */
+  mfu_crc128* chunk_crcs; /* 128-bit checksum of each chunk */
+} mfu_manifest_entry;
+
+/* append a copy of name, size, and crc to an array of entries holding
+ * count entries and space for max, growing the array as needed */
+void mfu_manifest_add(mfu_manifest_entry** pentries, uint64_t* count,
+    uint64_t* max, const char* name, uint64_t size, mfu_crc128 crc);
+
+/* like mfu_manifest_add, and also records the mtime of the file
+ * and copies the checksums of chunks */
+void mfu_manifest_add_chunks(mfu_manifest_entry** pentries, uint64_t* count,
+    uint64_t* max, const char* name, uint64_t size, uint64_t mtime,
+    uint64_t mtime_nsec, mfu_crc128 crc, uint64_t chunks, const mfu_crc128* chunk_crcs);
+
+/* collectively write entries from all processes to manifest file,
+ * returns 0 on success and -1 on error */
+int mfu_manifest_write(const char* file, uint64_t count, const mfu_manifest_entry* entries);
+
+/* like mfu_manifest_write, and also records the chunk size, mtimes, and
+ * checksums of chunks, returns 0 on success and -1 on error */
+int mfu_manifest_write_chunks(const char* file, uint64_t chunk_size,
+    uint64_t count, const mfu_manifest_entry* entries);
+
+/* collectively read manifest file, each process gets a portion of its
+ * entries, returns 0 on success and -1 on error */
+int mfu_manifest_read(const char* file, uint64_t* count, mfu_manifest_entry** entries);
+
+/* like mfu_manifest_read, and also returns the chunk size recorded in
+ * the manifest, which is 0 if it has no checksums of chunks */
+int mfu_manifest_read_chunks(const char* file, uint64_t* chunk_size,
+    uint64_t* count, mfu_manifest_entry** entries);
+
+/* return rank to which a manifest entry with given name is sent */
+typedef int (*mfu_manifest_rank_fn)(const char* name, int ranks, const void* args);
+
+/* send each manifest entry to the rank returned by rank_fn for its name,
+ * frees the input entries and returns the entries received */
+void mfu_manifest_spread(uint64_t* count, mfu_manifest_entry** entries,
+    mfu_manifest_rank_fn rank_fn, const void* args);
+
+/* free array of manifest entries */
+void mfu_manifest_free(uint64_t count, mfu_manifest_entry** pentries);
+
+/* read manifest file and compare checksums and sizes it records
+ * against the files it names, reports files that differ,
+ * returns 0 if all files match and -1 otherwise */
+int mfu_manifest_verify(const char* file, uint64_t chunk_size, size_t buf_size);
+
 #endif /* MFU_FLIST_H */
 
 /* enable C++ codes to include this header directly */
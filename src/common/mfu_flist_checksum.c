@@ -0,0 +1,1132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "mpi.h"
+#include "mfu.h"
+
+/****************************************
+ * Functions to checksum files in a list
+ ***************************************/
+
+/* number of uint64_t values used to send a section to its owner */
+#define CHUNK_CRC_PACK_COUNT (5)
+
+/* sort sections by index of file in owner list, then by offset */
+static int chunk_crc_compare(const void* a, const void* b)
+{
+    const mfu_file_chunk_crc* x = (const mfu_file_chunk_crc*) a;
+    const mfu_file_chunk_crc* y = (const mfu_file_chunk_crc*) b;
+    if (x->index_of_owner != y->index_of_owner) {
+        return (x->index_of_owner < y->index_of_owner) ? -1 : 1;
+    }
+    if (x->offset != y->offset) {
+        return (x->offset < y->offset) ? -1 : 1;
+    }
+    return 0;
+}
+
+/* combine sections as described for mfu_file_chunk_crc_combine,
+ * and if chunk_crcs is not NULL, set chunk_crcs[index] to an array
+ * of the checksums of the sections of each valid file in offset order */
+static void chunk_crc_combine(
+    mfu_flist list,
+    uint64_t count,
+    const mfu_file_chunk_crc* sections,
+    mfu_crc128* crcs,
+    int* valid,
+    mfu_crc128** chunk_crcs)
+{
+    /* get number of ranks */
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* allocate arrays for alltoall -- one for sending, and one for receiving */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+
+    /* count number of values we'll send to each owner */
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
+    }
+    uint64_t idx;
+    for (idx = 0; idx < count; idx++) {
+        int owner = (int) sections[idx].rank_of_owner;
+        sendcounts[owner] += CHUNK_CRC_PACK_COUNT;
+    }
+
+    /* compute send buffer displacements */
+    senddisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        senddisps[i] = senddisps[i - 1] + sendcounts[i - 1];
+    }
+
+    /* pack sections into send buffer, grouped by owner */
+    uint64_t* sendbuf = (uint64_t*) MFU_MALLOC(count * CHUNK_CRC_PACK_COUNT * sizeof(uint64_t));
+    int* offsets = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        offsets[i] = senddisps[i];
+    }
+    for (idx = 0; idx < count; idx++) {
+        const mfu_file_chunk_crc* s = &sections[idx];
+        int owner = (int) s->rank_of_owner;
+        uint64_t* ptr = &sendbuf[offsets[owner]];
+        ptr[0] = s->index_of_owner;
+        ptr[1] = s->offset;
+        ptr[2] = s->length;
+        ptr[3] = s->crc.hi;
+        ptr[4] = s->crc.lo;
+        offsets[owner] += CHUNK_CRC_PACK_COUNT;
+    }
+
+    /* alltoall to let every process know a count of how much it will be receiving */
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    /* calculate total incoming items and displacements for alltoallv */
+    int recv_total = recvcounts[0];
+    recvdisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        recv_total += recvcounts[i];
+        recvdisps[i] = recvdisps[i - 1] + recvcounts[i - 1];
+    }
+
+    /* allocate buffer to recv sections */
+    uint64_t* recvbuf = (uint64_t*) MFU_MALLOC((uint64_t)recv_total * sizeof(uint64_t));
+
+    /* send sections to the ranks that own the files */
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_UINT64_T,
+        recvbuf, recvcounts, recvdisps, MPI_UINT64_T, MPI_COMM_WORLD
+    );
+
+    /* unpack sections and order them by file and offset */
+    uint64_t recv_count = (uint64_t)recv_total / CHUNK_CRC_PACK_COUNT;
+    mfu_file_chunk_crc* recvd = (mfu_file_chunk_crc*) MFU_MALLOC(recv_count * sizeof(mfu_file_chunk_crc));
+    for (idx = 0; idx < recv_count; idx++) {
+        const uint64_t* ptr = &recvbuf[idx * CHUNK_CRC_PACK_COUNT];
+        recvd[idx].rank_of_owner  = 0;
+        recvd[idx].index_of_owner = ptr[0];
+        recvd[idx].offset         = ptr[1];
+        recvd[idx].length         = ptr[2];
+        recvd[idx].crc.hi         = ptr[3];
+        recvd[idx].crc.lo         = ptr[4];
+    }
+    qsort(recvd, (size_t)recv_count, sizeof(mfu_file_chunk_crc), chunk_crc_compare);
+
+    /* assume no file has a checksum */
+    uint64_t size = mfu_flist_size(list);
+    mfu_crc128 zero = {0, 0};
+    for (idx = 0; idx < size; idx++) {
+        crcs[idx]  = zero;
+        valid[idx] = 0;
+        if (chunk_crcs != NULL) {
+            chunk_crcs[idx] = NULL;
+        }
+    }
+
+    /* combine the sections of each file in order, the result is only
+     * valid if the sections cover the file from start to end without
+     * gaps or overlaps */
+    uint64_t start = 0;
+    while (start < recv_count) {
+        uint64_t file_index = recvd[start].index_of_owner;
+
+        int ok = 1;
+        mfu_crc128 crc = zero;
+        uint64_t expected = 0;
+        uint64_t end = start;
+        while (end < recv_count && recvd[end].index_of_owner == file_index) {
+            if (recvd[end].offset != expected) {
+                ok = 0;
+            }
+            crc = mfu_crc128_combine(crc, recvd[end].crc, recvd[end].length);
+            expected += recvd[end].length;
+            end++;
+        }
+
+        if (file_index < size) {
+            uint64_t file_size = mfu_flist_file_get_size(list, file_index);
+            if (ok && expected == file_size) {
+                crcs[file_index]  = crc;
+                valid[file_index] = 1;
+
+                /* record checksum of each section */
+                if (chunk_crcs != NULL && end > start) {
+                    mfu_crc128* chunks = (mfu_crc128*) MFU_MALLOC((end - start) * sizeof(mfu_crc128));
+                    uint64_t j;
+                    for (j = start; j < end; j++) {
+                        chunks[j - start] = recvd[j].crc;
+                    }
+                    chunk_crcs[file_index] = chunks;
+                }
+            }
+        }
+
+        start = end;
+    }
+
+    mfu_free(&recvd);
+    mfu_free(&recvbuf);
+    mfu_free(&sendbuf);
+    mfu_free(&offsets);
+
+    mfu_free(&sendcounts);
+    mfu_free(&recvcounts);
+    mfu_free(&recvdisps);
+    mfu_free(&senddisps);
+
+    return;
+}
+
+void mfu_file_chunk_crc_combine(
+    mfu_flist list,
+    uint64_t count,
+    const mfu_file_chunk_crc* sections,
+    mfu_crc128* crcs,
+    int* valid)
+{
+    chunk_crc_combine(list, count, sections, crcs, valid, NULL);
+}
+
+/* compute checksum of a section of a file, reading it in pieces of
+ * buf_size bytes, returns the number of bytes read in bytes,
+ * returns 0 on success and -1 on error */
+static int checksum_section(const char* name, int fd, uint64_t offset,
+    uint64_t length, char* buf, size_t buf_size, mfu_crc128* crc, uint64_t* bytes)
+{
+    mfu_crc128 zero = {0, 0};
+    *crc   = zero;
+    *bytes = 0;
+
+    while (*bytes < length) {
+        size_t count = buf_size;
+        if (length - *bytes < (uint64_t) count) {
+            count = (size_t)(length - *bytes);
+        }
+
+        ssize_t nread = mfu_pread(name, fd, buf, count, (off_t)(offset + *bytes));
+        if (nread < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' (errno=%d %s)",
+                name, errno, strerror(errno));
+            return -1;
+        }
+        if (nread == 0) {
+            /* file is shorter than expected */
+            break;
+        }
+
+        *crc = mfu_crc128_update(*crc, buf, (size_t)nread);
+        *bytes += (uint64_t) nread;
+    }
+
+    return 0;
+}
+
+/* checksum files in list as described for mfu_flist_checksum,
+ * sections are split at multiples of chunk_size, so that when chunk_crcs
+ * is not NULL, each entry records the checksum of one chunk */
+static int flist_checksum(
+    mfu_flist list,
+    uint64_t chunk_size,
+    size_t buf_size,
+    mfu_crc128* crcs,
+    int* valid,
+    mfu_crc128** chunk_crcs)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* split files into sections that are spread evenly over processes */
+    mfu_file_chunk* head = mfu_file_chunk_list_alloc(list, chunk_size);
+
+    /* allocate a buffer to read data */
+    char* buf = (char*) MFU_MALLOC(buf_size);
+
+    /* an element in the chunk list may cover several consecutive
+     * chunks of a file, count the chunks we'll checksum, an empty
+     * file still gets one empty section */
+    uint64_t sections_count = 0;
+    const mfu_file_chunk* p;
+    for (p = head; p != NULL; p = p->next) {
+        uint64_t chunks = (p->length + chunk_size - 1) / chunk_size;
+        sections_count += (chunks > 0) ? chunks : 1;
+    }
+
+    /* checksum each chunk of our sections */
+    mfu_file_chunk_crc* sections = (mfu_file_chunk_crc*) MFU_MALLOC(sections_count * sizeof(mfu_file_chunk_crc));
+    uint64_t num = 0;
+    for (p = head; p != NULL; p = p->next) {
+        int fd = mfu_open(p->name, O_RDONLY);
+        if (fd < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
+                p->name, errno, strerror(errno));
+            rc = -1;
+            continue;
+        }
+
+        uint64_t done = 0;
+        do {
+            uint64_t length = p->length - done;
+            if (length > chunk_size) {
+                length = chunk_size;
+            }
+
+            mfu_crc128 crc;
+            uint64_t bytes;
+            if (checksum_section(p->name, fd, p->offset + done, length,
+                buf, buf_size, &crc, &bytes) != 0)
+            {
+                rc = -1;
+                break;
+            }
+
+            /* record number of bytes actually read, so a file that
+             * ends early does not cover its full size */
+            mfu_file_chunk_crc* s = &sections[num];
+            s->rank_of_owner  = p->rank_of_owner;
+            s->index_of_owner = p->index_of_owner;
+            s->offset         = p->offset + done;
+            s->length         = bytes;
+            s->crc            = crc;
+            num++;
+
+            if (bytes < length) {
+                break;
+            }
+            done += length;
+        } while (done < p->length);
+
+        mfu_close(p->name, fd);
+    }
+
+    /* send checksums of sections to owners and combine them */
+    chunk_crc_combine(list, num, sections, crcs, valid, chunk_crcs);
+
+    mfu_free(&sections);
+    mfu_free(&buf);
+    mfu_file_chunk_list_free(&head);
+
+    /* determine whether any process hit an error */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all_rc;
+}
+
+int mfu_flist_checksum(
+    mfu_flist list,
+    uint64_t chunk_size,
+    size_t buf_size,
+    mfu_crc128* crcs,
+    int* valid)
+{
+    return flist_checksum(list, chunk_size, buf_size, crcs, valid, NULL);
+}
+
+int mfu_flist_checksum_chunks(
+    mfu_flist list,
+    uint64_t chunk_size,
+    size_t buf_size,
+    mfu_crc128* crcs,
+    int* valid,
+    mfu_crc128** chunk_crcs)
+{
+    return flist_checksum(list, chunk_size, buf_size, crcs, valid, chunk_crcs);
+}
+
+/****************************************
+ * Functions to read and write manifests
+ ***************************************/
+
+/* first line of a manifest that records chunk checksums */
+#define MANIFEST_CHUNK_HEADER "#chunk_size"
+
+/* append formatted text at offset in buffer, buffer may be NULL
+ * to just compute the length, returns number of bytes needed */
+static size_t manifest_printf(char* buffer, size_t bufsize, size_t offset, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len;
+    if (buffer != NULL) {
+        len = vsnprintf(buffer + offset, bufsize - offset, format, args);
+    } else {
+        len = vsnprintf(NULL, 0, format, args);
+    }
+    va_end(args);
+    return (size_t) len;
+}
+
+/* returns 1 if name must be escaped to fit on one line, 0 otherwise */
+static int manifest_needs_escape(const char* name)
+{
+    return (strpbrk(name, "\\\n") != NULL);
+}
+
+/* append name at offset in buffer, with backslash written as "\\"
+ * and newline as "\n" if escape is set, buffer may be NULL to just
+ * compute the length, returns number of bytes needed */
+static size_t manifest_format_name(char* buffer, size_t bufsize, size_t offset,
+    const char* name, int escape)
+{
+    size_t len = 0;
+    const char* ptr;
+    for (ptr = name; *ptr != '\0'; ptr++) {
+        char c[2];
+        size_t n = 1;
+        c[0] = *ptr;
+        if (escape && (*ptr == '\\' || *ptr == '\n')) {
+            c[0] = '\\';
+            c[1] = (*ptr == '\n') ? 'n' : '\\';
+            n = 2;
+        }
+        if (buffer != NULL && offset + len + n < bufsize) {
+            memcpy(buffer + offset + len, c, n);
+        }
+        len += n;
+    }
+    if (buffer != NULL && offset + len < bufsize) {
+        buffer[offset + len] = '\0';
+    }
+    return len;
+}
+
+/* undo escapes written by manifest_format_name in place,
+ * returns 0 on success and -1 if name holds an invalid escape */
+static int manifest_unescape_name(char* name)
+{
+    char* src = name;
+    char* dst = name;
+    while (*src != '\0') {
+        if (*src == '\\') {
+            src++;
+            if (*src == 'n') {
+                *dst = '\n';
+            } else if (*src == '\\') {
+                *dst = '\\';
+            } else {
+                return -1;
+            }
+        } else {
+            *dst = *src;
+        }
+        src++;
+        dst++;
+    }
+    *dst = '\0';
+    return 0;
+}
+
+/* format an entry as a line of text in buffer, returns number
+ * of bytes needed not including the terminating NUL, the mtime and
+ * checksums of chunks are listed before the name when with_chunks is set,
+ * a name holding a newline or backslash is escaped, and its line
+ * starts with a backslash, as sha256sum does */
+static size_t manifest_format(const mfu_manifest_entry* entry, int with_chunks, char* buffer, size_t bufsize)
+{
+    int escape = manifest_needs_escape(entry->name);
+    size_t len = manifest_printf(buffer, bufsize, 0, "%s%016" PRIx64 "%016" PRIx64 " %" PRIu64 " ",
+        escape ? "\\" : "", entry->crc.hi, entry->crc.lo, entry->size);
+
+    if (with_chunks) {
+        len += manifest_printf(buffer, bufsize, len, "%" PRIu64 ".%09" PRIu64 " ",
+            entry->mtime, entry->mtime_nsec);
+        if (entry->chunks == 0) {
+            len += manifest_printf(buffer, bufsize, len, "- ");
+        }
+        uint64_t i;
+        for (i = 0; i < entry->chunks; i++) {
+            const char* sep = (i + 1 < entry->chunks) ? "," : " ";
+            len += manifest_printf(buffer, bufsize, len, "%016" PRIx64 "%016" PRIx64 "%s",
+                entry->chunk_crcs[i].hi, entry->chunk_crcs[i].lo, sep);
+        }
+    }
+
+    len += manifest_format_name(buffer, bufsize, len, entry->name, escape);
+    len += manifest_printf(buffer, bufsize, len, "\n");
+    return len;
+}
+
+/* write manifest as described for mfu_manifest_write_chunks */
+static int manifest_write(
+    const char* file,
+    uint64_t chunk_size,
+    uint64_t count,
+    const mfu_manifest_entry* entries)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get our rank and size of the communicator */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* rank 0 starts the file with the chunk size if we have one */
+    int with_chunks = (chunk_size > 0);
+    char header[64];
+    size_t header_len = 0;
+    if (with_chunks && rank == 0) {
+        header_len = (size_t) snprintf(header, sizeof(header), "%s %" PRIu64 "\n",
+            MANIFEST_CHUNK_HEADER, chunk_size);
+    }
+
+    /* compute size of buffer needed to hold all entries */
+    size_t bufsize = header_len;
+    uint64_t idx;
+    for (idx = 0; idx < count; idx++) {
+        bufsize += manifest_format(&entries[idx], with_chunks, NULL, 0) + 1;
+    }
+
+    /* format entries in buffer */
+    char* buf = (char*) MFU_MALLOC(bufsize + 1);
+    size_t total = 0;
+    if (header_len > 0) {
+        memcpy(buf, header, header_len);
+        total += header_len;
+    }
+    for (idx = 0; idx < count; idx++) {
+        total += manifest_format(&entries[idx], with_chunks, buf + total, bufsize + 1 - total);
+    }
+
+    /* if we block things up into 128MB chunks, how many iterations
+     * to write everything? */
+    uint64_t maxwrite = 128 * 1024 * 1024;
+    uint64_t iters = (uint64_t)total / maxwrite;
+    if (iters * maxwrite < (uint64_t)total) {
+        iters++;
+    }
+
+    /* get max iterations across all procs */
+    uint64_t all_iters;
+    MPI_Allreduce(&iters, &all_iters, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+    /* open file */
+    MPI_Status status;
+    MPI_File fh;
+    char datarep[] = "native";
+    int amode = MPI_MODE_WRONLY | MPI_MODE_CREATE;
+    int mpirc = MPI_File_open(MPI_COMM_WORLD, (char*)file, amode, MPI_INFO_NULL, &fh);
+    if (mpirc != MPI_SUCCESS) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open manifest `%s'", file);
+        }
+        mfu_free(&buf);
+        return -1;
+    }
+
+    /* truncate file to 0 bytes */
+    MPI_File_set_size(fh, 0);
+
+    /* set file view to be sequence of bytes */
+    MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, datarep, MPI_INFO_NULL);
+
+    /* compute byte offset to write our entries */
+    uint64_t offset = 0;
+    uint64_t bytes = (uint64_t) total;
+    MPI_Exscan(&bytes, &offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        offset = 0;
+    }
+    MPI_Offset write_offset = (MPI_Offset)offset;
+
+    char* ptr = buf;
+    uint64_t written = 0;
+    while (all_iters > 0) {
+        /* compute count we'll write in this iteration */
+        uint64_t remaining = (uint64_t)total - written;
+        int write_count = (int) maxwrite;
+        if (remaining < maxwrite) {
+            write_count = (int) remaining;
+        }
+
+        /* collective write of manifest data */
+        mpirc = MPI_File_write_at_all(fh, write_offset, ptr, write_count, MPI_BYTE, &status);
+        if (mpirc != MPI_SUCCESS) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to write manifest `%s'", file);
+            rc = -1;
+        }
+
+        write_offset += (MPI_Offset) write_count;
+        ptr += write_count;
+        written += (uint64_t) write_count;
+        all_iters--;
+    }
+
+    /* close file */
+    MPI_File_close(&fh);
+
+    mfu_free(&buf);
+
+    /* determine whether any process hit an error */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all_rc;
+}
+
+int mfu_manifest_write(
+    const char* file,
+    uint64_t count,
+    const mfu_manifest_entry* entries)
+{
+    return manifest_write(file, 0, count, entries);
+}
+
+int mfu_manifest_write_chunks(
+    const char* file,
+    uint64_t chunk_size,
+    uint64_t count,
+    const mfu_manifest_entry* entries)
+{
+    return manifest_write(file, chunk_size, count, entries);
+}
+
+void mfu_manifest_add(mfu_manifest_entry** pentries, uint64_t* count,
+    uint64_t* max, const char* name, uint64_t size, mfu_crc128 crc)
+{
+    mfu_manifest_add_chunks(pentries, count, max, name, size, 0, 0, crc, 0, NULL);
+}
+
+void mfu_manifest_add_chunks(mfu_manifest_entry** pentries, uint64_t* count,
+    uint64_t* max, const char* name, uint64_t size, uint64_t mtime,
+    uint64_t mtime_nsec, mfu_crc128 crc, uint64_t chunks, const mfu_crc128* chunk_crcs)
+{
+    if (*count == *max) {
+        uint64_t new_max = (*max > 0) ? *max * 2 : 1024;
+        mfu_manifest_entry* entries = (mfu_manifest_entry*) MFU_MALLOC(new_max * sizeof(mfu_manifest_entry));
+        if (*count > 0) {
+            memcpy(entries, *pentries, *count * sizeof(mfu_manifest_entry));
+        }
+        mfu_free(pentries);
+        *pentries = entries;
+        *max = new_max;
+    }
+
+    mfu_manifest_entry* e = &(*pentries)[*count];
+    e->name       = MFU_STRDUP(name);
+    e->size       = size;
+    e->mtime      = mtime;
+    e->mtime_nsec = mtime_nsec;
+    e->crc        = crc;
+    e->chunks     = chunks;
+    e->chunk_crcs = NULL;
+    if (chunks > 0) {
+        e->chunk_crcs = (mfu_crc128*) MFU_MALLOC(chunks * sizeof(mfu_crc128));
+        memcpy(e->chunk_crcs, chunk_crcs, chunks * sizeof(mfu_crc128));
+    }
+    (*count)++;
+}
+
+/* parse the 32 hex digits of a checksum at the start of str,
+ * returns 0 on success, -1 on error */
+static int manifest_parse_crc(const char* str, mfu_crc128* crc)
+{
+    if (strspn(str, "0123456789abcdefABCDEF") != 32) {
+        return -1;
+    }
+
+    char hex[17];
+    memcpy(hex, str, 16);
+    hex[16] = '\0';
+    crc->hi = (uint64_t) strtoull(hex, NULL, 16);
+    memcpy(hex, str + 16, 16);
+    crc->lo = (uint64_t) strtoull(hex, NULL, 16);
+    return 0;
+}
+
+/* parse a comma-separated list of checksums at the start of str,
+ * which ends with a space, "-" stands for an empty list, returns
+ * number of characters consumed including the space, 0 on error */
+static int manifest_parse_chunks(const char* str, uint64_t* chunks, mfu_crc128** chunk_crcs)
+{
+    *chunks     = 0;
+    *chunk_crcs = NULL;
+
+    if (strncmp(str, "- ", 2) == 0) {
+        return 2;
+    }
+
+    /* count entries */
+    const char* end = strchr(str, ' ');
+    if (end == NULL || end == str) {
+        return 0;
+    }
+    uint64_t n = 1;
+    const char* ptr;
+    for (ptr = str; ptr < end; ptr++) {
+        if (*ptr == ',') {
+            n++;
+        }
+    }
+
+    mfu_crc128* crcs = (mfu_crc128*) MFU_MALLOC(n * sizeof(mfu_crc128));
+    uint64_t i = 0;
+    ptr = str;
+    while (i < n) {
+        if (manifest_parse_crc(ptr, &crcs[i]) != 0 ||
+            (ptr[32] != ',' && ptr[32] != ' '))
+        {
+            mfu_free(&crcs);
+            return 0;
+        }
+        i++;
+        ptr += 33;
+    }
+
+    *chunks     = n;
+    *chunk_crcs = crcs;
+    return (int)(end - str) + 1;
+}
+
+/* read manifest as described for mfu_manifest_read_chunks */
+static int manifest_read(
+    const char* file,
+    uint64_t* chunk_size,
+    uint64_t* count,
+    mfu_manifest_entry** entries)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get our rank and size of the communicator */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    *count   = 0;
+    *entries = NULL;
+    uint64_t max = 0;
+
+    /* get size of manifest, and the chunk size from its header if any */
+    uint64_t vals[3] = {0, 0, 0};
+    if (rank == 0) {
+        struct stat st;
+        if (stat(file, &st) == 0) {
+            vals[0] = 1;
+            vals[1] = (uint64_t) st.st_size;
+
+            FILE* fp = fopen(file, "r");
+            if (fp != NULL) {
+                unsigned long long size;
+                if (fscanf(fp, MANIFEST_CHUNK_HEADER " %llu", &size) == 1) {
+                    vals[2] = (uint64_t) size;
+                }
+                fclose(fp);
+            }
+        } else {
+            MFU_LOG(MFU_LOG_ERR, "Failed to stat manifest `%s' (errno=%d %s)",
+                file, errno, strerror(errno));
+        }
+    }
+    MPI_Bcast(vals, 3, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    if (! vals[0]) {
+        return -1;
+    }
+    uint64_t file_size = vals[1];
+    *chunk_size = vals[2];
+    int with_chunks = (vals[2] > 0);
+
+    /* each process reads the lines that start in its portion of the file */
+    uint64_t start = file_size / (uint64_t)ranks * (uint64_t)rank;
+    uint64_t end   = file_size / (uint64_t)ranks * (uint64_t)(rank + 1);
+    if (rank == ranks - 1) {
+        end = file_size;
+    }
+
+    FILE* fp = fopen(file, "r");
+    if (fp == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open manifest `%s' (errno=%d %s)",
+            file, errno, strerror(errno));
+        rc = -1;
+    }
+
+    if (fp != NULL && start < end) {
+        /* find start of the first line in our portion, a line starts
+         * at our first byte if the byte before it ends a line */
+        uint64_t pos = start;
+        if (start > 0) {
+            fseeko(fp, (off_t)(start - 1), SEEK_SET);
+            int c;
+            pos = start - 1;
+            while ((c = fgetc(fp)) != EOF) {
+                pos++;
+                if (c == '\n') {
+                    break;
+                }
+            }
+        }
+
+        /* parse lines until we pass the end of our portion */
+        char* line = NULL;
+        size_t linesize = 0;
+        while (pos < end) {
+            ssize_t len = getline(&line, &linesize, fp);
+            if (len <= 0) {
+                break;
+            }
+            pos += (uint64_t) len;
+
+            /* strip newline */
+            if (line[len - 1] == '\n') {
+                line[len - 1] = '\0';
+            }
+
+            /* skip header */
+            if (line[0] == '#') {
+                continue;
+            }
+
+            /* a line starting with a backslash has an escaped name */
+            int escaped = (line[0] == '\\');
+
+            mfu_crc128 crc;
+            unsigned long long size;
+            int name_start = 0;
+            if (manifest_parse_crc(line + escaped, &crc) != 0 ||
+                line[escaped + 32] != ' ' ||
+                sscanf(line + escaped + 32, " %llu %n", &size, &name_start) != 1 ||
+                line[escaped + 32 + name_start] == '\0')
+            {
+                MFU_LOG(MFU_LOG_ERR, "Invalid line in manifest `%s': `%s'",
+                    file, line);
+                rc = -1;
+                continue;
+            }
+            name_start += escaped + 32;
+
+            /* parse mtime and checksums of chunks that precede the name */
+            unsigned long long mtime = 0;
+            unsigned long long mtime_nsec = 0;
+            uint64_t chunks = 0;
+            mfu_crc128* chunk_crcs = NULL;
+            if (with_chunks) {
+                int mtime_len = 0;
+                if (sscanf(line + name_start, "%llu.%llu %n", &mtime, &mtime_nsec, &mtime_len) != 2 ||
+                    mtime_len == 0)
+                {
+                    MFU_LOG(MFU_LOG_ERR, "Invalid line in manifest `%s': `%s'",
+                        file, line);
+                    rc = -1;
+                    continue;
+                }
+                name_start += mtime_len;
+
+                int chunks_len = manifest_parse_chunks(line + name_start, &chunks, &chunk_crcs);
+                if (chunks_len == 0 || line[name_start + chunks_len] == '\0') {
+                    MFU_LOG(MFU_LOG_ERR, "Invalid line in manifest `%s': `%s'",
+                        file, line);
+                    rc = -1;
+                    mfu_free(&chunk_crcs);
+                    continue;
+                }
+                name_start += chunks_len;
+            }
+
+            if (escaped && manifest_unescape_name(line + name_start) != 0) {
+                MFU_LOG(MFU_LOG_ERR, "Invalid line in manifest `%s': `%s'",
+                    file, line);
+                rc = -1;
+                mfu_free(&chunk_crcs);
+                continue;
+            }
+
+            mfu_manifest_add_chunks(entries, count, &max, line + name_start,
+                (uint64_t)size, (uint64_t)mtime, (uint64_t)mtime_nsec,
+                crc, chunks, chunk_crcs);
+            mfu_free(&chunk_crcs);
+        }
+        free(line);
+    }
+
+    if (fp != NULL) {
+        fclose(fp);
+    }
+
+    /* determine whether any process hit an error */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all_rc;
+}
+
+int mfu_manifest_read(
+    const char* file,
+    uint64_t* count,
+    mfu_manifest_entry** entries)
+{
+    uint64_t chunk_size;
+    return manifest_read(file, &chunk_size, count, entries);
+}
+
+int mfu_manifest_read_chunks(
+    const char* file,
+    uint64_t* chunk_size,
+    uint64_t* count,
+    mfu_manifest_entry** entries)
+{
+    return manifest_read(file, chunk_size, count, entries);
+}
+
+void mfu_manifest_spread(
+    uint64_t* pcount,
+    mfu_manifest_entry** pentries,
+    mfu_manifest_rank_fn rank_fn,
+    const void* args)
+{
+    /* get number of ranks */
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    uint64_t count = *pcount;
+    mfu_manifest_entry* entries = *pentries;
+
+    /* allocate arrays for alltoall -- one for sending, and one for receiving */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* dests      = (int*) MFU_MALLOC(count * sizeof(int));
+
+    /* count bytes we'll send to each rank, each entry is packed
+     * as its size, mtime, checksum, number of chunks, their checksums,
+     * and its name */
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
+    }
+    uint64_t idx;
+    for (idx = 0; idx < count; idx++) {
+        const mfu_manifest_entry* e = &entries[idx];
+        dests[idx] = rank_fn(e->name, ranks, args);
+        sendcounts[dests[idx]] += (int)((6 + 2 * e->chunks) * 8 + strlen(e->name) + 1);
+    }
+
+    /* compute send buffer displacements */
+    senddisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        senddisps[i] = senddisps[i - 1] + sendcounts[i - 1];
+    }
+    size_t sendbytes = (size_t)senddisps[ranks - 1] + (size_t)sendcounts[ranks - 1];
+
+    /* pack entries into send buffer, grouped by destination */
+    char* sendbuf = (char*) MFU_MALLOC(sendbytes);
+    char** ptrs = (char**) MFU_MALLOC((size_t)ranks * sizeof(char*));
+    for (i = 0; i < ranks; i++) {
+        ptrs[i] = sendbuf + senddisps[i];
+    }
+    for (idx = 0; idx < count; idx++) {
+        const mfu_manifest_entry* e = &entries[idx];
+        char** pptr = &ptrs[dests[idx]];
+        mfu_pack_uint64(pptr, e->size);
+        mfu_pack_uint64(pptr, e->mtime);
+        mfu_pack_uint64(pptr, e->mtime_nsec);
+        mfu_pack_uint64(pptr, e->crc.hi);
+        mfu_pack_uint64(pptr, e->crc.lo);
+        mfu_pack_uint64(pptr, e->chunks);
+        uint64_t j;
+        for (j = 0; j < e->chunks; j++) {
+            mfu_pack_uint64(pptr, e->chunk_crcs[j].hi);
+            mfu_pack_uint64(pptr, e->chunk_crcs[j].lo);
+        }
+        size_t len = strlen(e->name) + 1;
+        memcpy(*pptr, e->name, len);
+        *pptr += len;
+    }
+
+    /* alltoall to let every process know a count of how much it will be receiving */
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    /* calculate total incoming bytes and displacements for alltoallv */
+    int recv_total = recvcounts[0];
+    recvdisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        recv_total += recvcounts[i];
+        recvdisps[i] = recvdisps[i - 1] + recvcounts[i - 1];
+    }
+
+    /* send entries to the ranks responsible for them */
+    char* recvbuf = (char*) MFU_MALLOC((size_t)recv_total);
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_BYTE,
+        recvbuf, recvcounts, recvdisps, MPI_BYTE, MPI_COMM_WORLD
+    );
+
+    /* done with the entries we had */
+    mfu_manifest_free(count, pentries);
+
+    /* unpack entries we received */
+    uint64_t new_count = 0;
+    uint64_t max = 0;
+    mfu_manifest_entry* new_entries = NULL;
+    mfu_crc128* chunk_crcs = NULL;
+    uint64_t chunk_max = 0;
+    const char* ptr = recvbuf;
+    const char* end = recvbuf + recv_total;
+    while (ptr < end) {
+        uint64_t size, mtime, mtime_nsec, chunks;
+        mfu_crc128 crc;
+        mfu_unpack_uint64(&ptr, &size);
+        mfu_unpack_uint64(&ptr, &mtime);
+        mfu_unpack_uint64(&ptr, &mtime_nsec);
+        mfu_unpack_uint64(&ptr, &crc.hi);
+        mfu_unpack_uint64(&ptr, &crc.lo);
+        mfu_unpack_uint64(&ptr, &chunks);
+        if (chunks > chunk_max) {
+            mfu_free(&chunk_crcs);
+            chunk_crcs = (mfu_crc128*) MFU_MALLOC(chunks * sizeof(mfu_crc128));
+            chunk_max = chunks;
+        }
+        uint64_t j;
+        for (j = 0; j < chunks; j++) {
+            mfu_unpack_uint64(&ptr, &chunk_crcs[j].hi);
+            mfu_unpack_uint64(&ptr, &chunk_crcs[j].lo);
+        }
+        const char* name = ptr;
+        ptr += strlen(name) + 1;
+
+        mfu_manifest_add_chunks(&new_entries, &new_count, &max, name,
+            size, mtime, mtime_nsec, crc, chunks, chunk_crcs);
+    }
+
+    *pcount   = new_count;
+    *pentries = new_entries;
+
+    mfu_free(&chunk_crcs);
+    mfu_free(&recvbuf);
+    mfu_free(&ptrs);
+    mfu_free(&sendbuf);
+    mfu_free(&dests);
+    mfu_free(&senddisps);
+    mfu_free(&recvdisps);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
+}
+
+void mfu_manifest_free(uint64_t count, mfu_manifest_entry** pentries)
+{
+    if (*pentries == NULL) {
+        return;
+    }
+
+    uint64_t idx;
+    for (idx = 0; idx < count; idx++) {
+        mfu_free(&(*pentries)[idx].name);
+        mfu_free(&(*pentries)[idx].chunk_crcs);
+    }
+    mfu_free(pentries);
+}
+
+int mfu_manifest_verify(
+    const char* file,
+    uint64_t chunk_size,
+    size_t buf_size)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Verifying files against manifest: %s", file);
+    }
+
+    /* start timer */
+    double start_verify = MPI_Wtime();
+
+    /* read entries from manifest */
+    uint64_t count;
+    mfu_manifest_entry* entries;
+    if (mfu_manifest_read(file, &count, &entries) != 0) {
+        mfu_manifest_free(count, &entries);
+        return -1;
+    }
+
+    /* build a list of files to checksum, files that are missing or
+     * whose size differs from the manifest are reported directly */
+    uint64_t mismatched = 0;
+    uint64_t* map = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+    mfu_flist list = mfu_flist_new();
+    mfu_flist_set_detail(list, 1);
+    uint64_t idx;
+    for (idx = 0; idx < count; idx++) {
+        const mfu_manifest_entry* e = &entries[idx];
+
+        struct stat st;
+        if (mfu_lstat(e->name, &st) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to stat `%s' (errno=%d %s)",
+                e->name, errno, strerror(errno));
+            mismatched++;
+            continue;
+        }
+        if (! S_ISREG(st.st_mode) || (uint64_t)st.st_size != e->size) {
+            MFU_LOG(MFU_LOG_ERR, "Size mismatch `%s' (expected %" PRIu64 " bytes, found %" PRIu64 ")",
+                e->name, e->size, (uint64_t)st.st_size);
+            mismatched++;
+            continue;
+        }
+
+        uint64_t list_idx = mfu_flist_file_create(list);
+        mfu_flist_file_set_name(list, list_idx, e->name);
+        mfu_flist_file_set_type(list, list_idx, MFU_TYPE_FILE);
+        mfu_flist_file_set_detail(list, list_idx, 1);
+        mfu_flist_file_set_size(list, list_idx, e->size);
+        map[list_idx] = idx;
+    }
+    mfu_flist_summarize(list);
+
+    /* compute checksums of files in our list */
+    uint64_t size = mfu_flist_size(list);
+    mfu_crc128* crcs = (mfu_crc128*) MFU_MALLOC(size * sizeof(mfu_crc128));
+    int* valid       = (int*)        MFU_MALLOC(size * sizeof(int));
+    if (mfu_flist_checksum(list, chunk_size, buf_size, crcs, valid) != 0) {
+        rc = -1;
+    }
+
+    /* compare against checksums in manifest */
+    for (idx = 0; idx < size; idx++) {
+        const mfu_manifest_entry* e = &entries[map[idx]];
+        if (! valid[idx] || ! mfu_crc128_equal(crcs[idx], e->crc)) {
+            MFU_LOG(MFU_LOG_ERR, "Checksum mismatch `%s'", e->name);
+            mismatched++;
+        }
+    }
+
+    /* count files checked and mismatched across processes */
+    uint64_t vals[2], all_vals[2];
+    vals[0] = count;
+    vals[1] = mismatched;
+    MPI_Allreduce(vals, all_vals, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    /* stop timer */
+    double end_verify = MPI_Wtime();
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Verified %" PRIu64 " files in %.3lf secs, %" PRIu64 " mismatched",
+            all_vals[0], end_verify - start_verify, all_vals[1]);
+    }
+    if (all_vals[1] > 0) {
+        rc = -1;
+    }
+
+    mfu_free(&valid);
+    mfu_free(&crcs);
+    mfu_flist_free(&list);
+    mfu_free(&map);
+    mfu_manifest_free(count, &entries);
+
+    /* determine whether any process hit an error */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all_rc;
+}
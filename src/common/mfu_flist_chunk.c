@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <string.h>
@@ -12,9 +13,63 @@
  * Functions to divide flist into linked list of file sections
  ***************************************/
 
-/* given a file offset, the rank of the last process to hold an
+/* build a list of ranks ordered by node, ranks on the same node
+ * are listed together in order of their rank, and nodes are ordered
+ * by their lowest rank, chunks are assigned to consecutive entries in
+ * this list, so the consecutive chunks of a file go to ranks on the same
+ * node when possible, this is the identity when ranks are already
+ * placed on nodes in blocks, returns array of ranks to be freed */
+static int* chunk_rank_order(void)
+{
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* identify our node by the lowest rank that shares it */
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    int leader;
+    MPI_Allreduce(&rank, &leader, 1, MPI_INT, MPI_MIN, node_comm);
+    MPI_Comm_free(&node_comm);
+
+    /* gather node of every rank */
+    int* leaders = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    MPI_Allgather(&leader, 1, MPI_INT, leaders, 1, MPI_INT, MPI_COMM_WORLD);
+
+    /* count ranks on each node, indexed by node leader,
+     * and compute position of the first rank of each node */
+    int* starts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int i;
+    for (i = 0; i < ranks; i++) {
+        starts[i] = 0;
+    }
+    for (i = 0; i < ranks; i++) {
+        starts[leaders[i]]++;
+    }
+    int total = 0;
+    for (i = 0; i < ranks; i++) {
+        int count = starts[i];
+        starts[i] = total;
+        total += count;
+    }
+
+    /* place each rank after the ranks before it on its node */
+    int* order = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        order[starts[leaders[i]]] = i;
+        starts[leaders[i]]++;
+    }
+
+    mfu_free(&starts);
+    mfu_free(&leaders);
+
+    return order;
+}
+
+/* given a file offset, the slot of the last process to hold an
  * extra chunk, and the number of chunks per rank, compute
- * and return the rank of the chunk at the given offset */
+ * and return the slot of the chunk at the given offset,
+ * which is mapped to a rank with chunk_rank_order */
 static int map_chunk_to_rank(uint64_t offset, uint64_t cutoff, uint64_t chunks_per_rank)
 {
     /* total number of chunks held by ranks below cutoff */
@@ -32,10 +87,61 @@ static int map_chunk_to_rank(uint64_t offset, uint64_t cutoff, uint64_t chunks_p
     return rank;
 }
 
+/* compute chunk size to use for a file of the given size, aims for
+ * FD_CHUNKS_PER_RANK chunks per rank so that very large files are not
+ * split into an excessive number of work units, rounds up to a multiple
+ * of the minimum chunk size so chunks stay aligned to it, and limits
+ * the result to the range [min_chunk_size, max_chunk_size] */
+static uint64_t chunk_size_for_file(uint64_t file_size, int ranks,
+    uint64_t min_chunk_size, uint64_t max_chunk_size)
+{
+    /* nothing to adapt if range is a single value */
+    if (max_chunk_size <= min_chunk_size) {
+        return min_chunk_size;
+    }
+
+    /* spread file over a fixed number of chunks per rank */
+    uint64_t target_chunks = (uint64_t) ranks * FD_CHUNKS_PER_RANK;
+    uint64_t chunk_size = file_size / target_chunks;
+    if (chunk_size * target_chunks < file_size) {
+        chunk_size++;
+    }
+
+    /* round up to a multiple of the minimum chunk size */
+    uint64_t units = chunk_size / min_chunk_size;
+    if (units * min_chunk_size < chunk_size || units == 0) {
+        units++;
+    }
+    chunk_size = units * min_chunk_size;
+
+    /* limit to the largest multiple of the minimum chunk size
+     * that does not exceed the maximum chunk size */
+    uint64_t max_size = (max_chunk_size / min_chunk_size) * min_chunk_size;
+    if (chunk_size > max_size) {
+        chunk_size = max_size;
+    }
+
+    return chunk_size;
+}
+
+uint64_t mfu_file_chunk_size(uint64_t file_size,
+    uint64_t min_chunk_size, uint64_t max_chunk_size)
+{
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    return chunk_size_for_file(file_size, ranks, min_chunk_size, max_chunk_size);
+}
+
+mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
+{
+    return mfu_file_chunk_list_alloc_adaptive(list, chunk_size, chunk_size);
+}
+
 /* This is a long routine, but the idea is simple.  All tasks sum up
  * the number of file chunks they have, and those are then evenly
  * distributed amongst the processes.  */
-mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
+mfu_file_chunk* mfu_file_chunk_list_alloc_adaptive(mfu_flist list,
+    uint64_t min_chunk_size, uint64_t max_chunk_size)
 {
     /* get our rank and number of ranks */
     int rank, ranks;
@@ -55,6 +161,10 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
             /* get size of file */
             uint64_t file_size = mfu_flist_file_get_size(list, idx);
 
+            /* determine chunk size to use for this file */
+            uint64_t chunk_size = chunk_size_for_file(file_size, ranks,
+                min_chunk_size, max_chunk_size);
+
             /* compute number of chunks to copy for this file */
             uint64_t chunks = file_size / chunk_size;
             if (chunks * chunk_size < file_size || file_size == 0) {
@@ -86,6 +196,10 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
     uint64_t coverage = chunks_per_rank * (uint64_t) ranks;
     uint64_t cutoff = total - coverage;
 
+    /* chunks are assigned to slots in order, and slots to ranks
+     * by node, so that neighboring chunks share a node */
+    int* order = chunk_rank_order();
+
     /* TODO: replace this with DSDE */
 
     /* allocate an array of integers to use in alltoall,
@@ -116,7 +230,7 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
 
         /* set flag for each process we'll send data to */
         for (i = first_send_rank; i <= last_send_rank; i++) {
-            sendlist[i] = 1;
+            sendlist[order[i]] = 1;
         }
 
         /* compute total number of destinations we'll send to */
@@ -152,6 +266,10 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
             /* get size of file */
             uint64_t file_size = mfu_flist_file_get_size(list, idx);
 
+            /* determine chunk size to use for this file */
+            uint64_t chunk_size = chunk_size_for_file(file_size, ranks,
+                min_chunk_size, max_chunk_size);
+
             /* compute number of chunks to copy for this file */
             uint64_t chunks = file_size / chunk_size;
             if (chunks * chunk_size < file_size || file_size == 0) {
@@ -286,7 +404,7 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
     /* post isend to send sizes */
     for (i = 0; i < send_ranks; i++) {
         int req_id = recv_ranks + i;
-        int send_rank = first_send_rank + i;
+        int send_rank = order[first_send_rank + i];
         MPI_Isend(&send_counts[i], 1, MPI_INT, send_rank, 0, MPI_COMM_WORLD, &request[req_id]);
     }
 
@@ -340,7 +458,7 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
     /* post isend to send outgoing data */
     for (i = 0; i < send_ranks; i++) {
         int req_id = recv_ranks + i;
-        int send_rank = first_send_rank + i;
+        int send_rank = order[first_send_rank + i];
         int send_count = send_counts[i];
         MPI_Isend(sendbufs[i], send_count, MPI_BYTE, send_rank, 0, MPI_COMM_WORLD, &request[req_id]);
     }
@@ -348,16 +466,39 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
     /* waitall */
     MPI_Waitall(msgs, request, status);
 
-    mfu_file_chunk* head = NULL;
-    mfu_file_chunk* tail = NULL;
+    /* we receive from senders in rank order, and senders hold
+     * chunks in rank order, so our chunks arrive in file order */
 
-    /* iterate over all received data */
+    /* count chunks we received */
+    uint64_t elems = 0;
     const char* packptr = recvbuf;
     char* recvbuf_end = recvbuf + recvbuf_size;
+    while (packptr < recvbuf_end) {
+        packptr += strlen(packptr) + 1 + 5 * 8;
+        elems++;
+    }
+
+    /* store all chunks in a single array followed by their file names,
+     * consecutive chunks of the same file share a single name string,
+     * the names take no more space than they did in the receive buffer,
+     * elements are linked in order so the array can also be walked
+     * as a list, and the whole list is freed with a single call */
+    mfu_file_chunk* head = NULL;
+    if (elems > 0) {
+        size_t array_size = (size_t)elems * sizeof(mfu_file_chunk);
+        head = (mfu_file_chunk*) MFU_MALLOC(array_size + recvbuf_size);
+    }
+    char* names = (char*)head + elems * sizeof(mfu_file_chunk);
+
+    /* iterate over all received data */
+    const char* prev_name = NULL;
+    uint64_t elem_id = 0;
+    packptr = recvbuf;
     while (packptr < recvbuf_end) {
         /* unpack file name */
         const char* name = packptr;
-        packptr += strlen(name) + 1;
+        size_t name_size = strlen(name) + 1;
+        packptr += name_size;
 
         /* unpack chunk offset, count, and file size */
         uint64_t offset, length, file_size, rank_of_owner, index_of_owner;
@@ -367,57 +508,62 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
         mfu_unpack_uint64(&packptr, &rank_of_owner);
         mfu_unpack_uint64(&packptr, &index_of_owner);
 
-        /* allocate memory for new struct and set next pointer to null */
-        mfu_file_chunk* p = malloc(sizeof(mfu_file_chunk));
-        p->next = NULL;
+        /* copy the name unless it matches the previous chunk */
+        if (prev_name == NULL || strcmp(prev_name, name) != 0) {
+            memcpy(names, name, name_size);
+            prev_name = names;
+            names += name_size;
+        }
 
         /* set the fields of the struct */
-        p->name = strdup(name);
+        mfu_file_chunk* p = &head[elem_id];
+        p->name = prev_name;
         p->offset = offset;
         p->length = length;
         p->file_size = file_size;
         p->rank_of_owner = rank_of_owner;
         p->index_of_owner = index_of_owner;
+        p->next = (elem_id + 1 < elems) ? &head[elem_id + 1] : NULL;
 
-        /* if the tail is not null then point the tail at the latest struct */
-        if (tail != NULL) {
-            tail->next = p;
-        }
-        
-        /* if head is not pointing at anything then this struct is head of list */
-        if (head == NULL) {
-            head = p;
-        }
+        elem_id++;
+    }
 
-        /* have tail point at the current/last struct */
-        tail = p;
+    /* free the elements we sent */
+    for (i = 0; i < send_ranks; i++) {
+        mfu_file_chunk* elem = heads[i];
+        while (elem != NULL) {
+            mfu_file_chunk* next = elem->next;
+            mfu_free(&elem);
+            elem = next;
+        }
+        mfu_free(&sendbufs[i]);
     }
 
+    mfu_free(&recvbuf);
+    mfu_free(&send_counts);
+    mfu_free(&recv_counts);
+    mfu_free(&request);
+    mfu_free(&status);
+    mfu_free(&recvranklist);
+    mfu_free(&sendbufs);
+    mfu_free(&bytes);
+    mfu_free(&counts);
+    mfu_free(&tails);
+    mfu_free(&heads);
+    mfu_free(&order);
+    mfu_free(&recvlist);
+    mfu_free(&sendlist);
+
     return head;
 }
 
-/* free the linked list of structs (copy elem's) */
+/* free the chunk list, which is a single allocation */
 void mfu_file_chunk_list_free(mfu_file_chunk** phead)
 {
     /* check whether we were given a pointer */
     if (phead != NULL) {
-        /* free the linked list of structs (mfu_file_chunk) */
-        mfu_file_chunk* tmp;
-        mfu_file_chunk* current = *phead;
-        while (current != NULL) {
-            /* get pointer to current element and advance current */
-            tmp = current;
-            current = current->next;
-
-            /* free the name string we had strdup'd */
-            mfu_free(&tmp->name);
-
-            /* free the element */
-            mfu_free(&tmp);
-        }
-
-        /* set caller's pointer to NULL to indicate it's freed */
-        *phead = NULL;
+        /* names are stored in the same block as the elements */
+        mfu_free(phead);
     }
 
     return;
@@ -436,52 +582,59 @@ uint64_t mfu_file_chunk_list_size(const mfu_file_chunk* p)
 /* given an flist, a file chunk list generated from that flist,
  * and an input array of flags with one element per chunk,
  * execute a LOR per item in the flist, and return the result
- * to the process owning that item in the flist */
+ * to the process owning that item in the flist, chunks of a file may
+ * be held by ranks in any order, so rather than scanning across chunks
+ * we send the owner the index of each file with a flag set */
 void mfu_file_chunk_list_lor(mfu_flist list, const mfu_file_chunk* head, const int* vals, int* results)
 {
-    /* get the largest filename */
-    uint64_t max_name = mfu_flist_file_max_name(list);
-
-    /* if list is empty, we can't do much */
-    if (max_name == 0) {
-        return;
+    /* every regular file has at least one chunk,
+     * so start with the flag clear for each of them */
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(list, idx) == MFU_TYPE_FILE) {
+            results[idx] = 0;
+        }
     }
 
     /* get a count of how many items are the chunk list */
     uint64_t list_count = mfu_file_chunk_list_size(head);
 
-    /* keys are the filename, so only bytes that belong to 
-     * the same file will be compared via a flag in the segmented scan */
-    char* keys = (char*) MFU_MALLOC(list_count * max_name);
-
-    /* ltr pointer for the output of the left-to-right-segmented scan */
-    int* ltr = (int*) MFU_MALLOC(list_count * sizeof(int));
-
-    /* copy file names into comparison buffer for segmented scan */
+    /* collect owners of chunks whose flag is set */
+    uint64_t* owner_ranks   = (uint64_t*) MFU_MALLOC(list_count * sizeof(uint64_t));
+    uint64_t* owner_indices = (uint64_t*) MFU_MALLOC(list_count * sizeof(uint64_t));
+    uint64_t count = 0;
     uint64_t i;
     const mfu_file_chunk* p = head;
     for (i = 0; i < list_count; i++) {
-        char* name = keys + max_name * i;
-        strncpy(name, p->name, max_name);
+        if (vals[i]) {
+            owner_ranks[count]   = p->rank_of_owner;
+            owner_indices[count] = p->index_of_owner;
+            count++;
+        }
         p = p->next;
     }
 
-    /* create type and comparison operation for file names for the segmented scan */
-    MPI_Datatype keytype = MPI_DATATYPE_NULL;
-    DTCMP_Op keyop = DTCMP_OP_NULL;
-    DTCMP_Str_create_ascend((int)max_name, &keytype, &keyop);
+    /* set flags on owners */
+    mfu_file_chunk_lor_owners(count, owner_ranks, owner_indices, results);
 
-    /* execute segmented scan of comparison flags across file names */
-    DTCMP_Segmented_scanv_ltr(
-        (int)list_count, keys, keytype, keyop,
-        vals, ltr, MPI_INT, MPI_LOR,
-        DTCMP_FLAG_NONE, MPI_COMM_WORLD
-    );
-    
-    /* we're done with the MPI type and operation, free them */
-    MPI_Type_free(&keytype);
-    DTCMP_Op_free(&keyop);
+    mfu_free(&owner_indices);
+    mfu_free(&owner_ranks);
 
+    return;
+}
+
+/* given arrays of owner rank and owner index for a set of chunks
+ * whose flag is set, send each flag to the process owning the
+ * corresponding item and set its entry in results to 1,
+ * unlike mfu_file_chunk_list_lor, this does not depend on the
+ * order in which chunks were processed */
+void mfu_file_chunk_lor_owners(
+    uint64_t count,
+    const uint64_t* owner_ranks,
+    const uint64_t* owner_indices,
+    int* results)
+{
     /* get number of ranks */
     int ranks;
     MPI_Comm_size(MPI_COMM_WORLD, &ranks);
@@ -492,93 +645,310 @@ void mfu_file_chunk_list_lor(mfu_flist list, const mfu_file_chunk* head, const i
     int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
     int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
 
-    /* allocate space for send buffer, we'll send an index value and comparison
-     * flag, both as uint64_t */
-    size_t sendbytes = list_count * 2 * sizeof(uint64_t); 
-    uint64_t* sendbuf = (uint64_t*) MFU_MALLOC(sendbytes);
-
-    /* initialize sendcounts array */
-    for (int idx = 0; idx < ranks; idx++) {
-        sendcounts[idx] = 0;
+    /* count number of indices we'll send to each owner */
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
     }
-
-    /* Iterate over the list of files. For each file a process needs to report on,
-     * we increment the counter correspoinding to the "owner" of the file. After
-     * going through all files, we then have a count of the number of files we 
-     * will report for each rank */
-    int disp = 0;
-    p = head;
-    for (i = 0; i < list_count; i++) {
-        /* if we have the last byte of the file, we need to send scan result to owner */
-        if (p->offset + p->length >= p->file_size) {
-            /* increment count of items that will be sent to owner */
-            int owner = (int) p->rank_of_owner;
-            sendcounts[owner] += 2;
-
-            /* copy index and flag value to send buffer */
-            uint64_t file_index = p->index_of_owner;
-            uint64_t flag       = (uint64_t) ltr[i];
-            sendbuf[disp    ]   = file_index;
-            sendbuf[disp + 1]   = flag;
-            
-            /* advance to next value in buffer */
-            disp += 2;
-        }
-
-        /* advance to next chunk */
-        p = p->next;
+    uint64_t idx;
+    for (idx = 0; idx < count; idx++) {
+        int owner = (int) owner_ranks[idx];
+        sendcounts[owner]++;
     }
 
     /* compute send buffer displacements */
     senddisps[0] = 0;
-    for (i = 1; i < (uint64_t)ranks; i++) {
+    for (i = 1; i < ranks; i++) {
         senddisps[i] = senddisps[i - 1] + sendcounts[i - 1];
     }
 
+    /* pack indices into send buffer, grouped by owner */
+    uint64_t* sendbuf = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+    int* offsets = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        offsets[i] = senddisps[i];
+    }
+    for (idx = 0; idx < count; idx++) {
+        int owner = (int) owner_ranks[idx];
+        sendbuf[offsets[owner]] = owner_indices[idx];
+        offsets[owner]++;
+    }
+
     /* alltoall to let every process know a count of how much it will be receiving */
     MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
 
-    /* calculate total incoming bytes and displacements for alltoallv */
+    /* calculate total incoming items and displacements for alltoallv */
     int recv_total = recvcounts[0];
     recvdisps[0] = 0;
-    for (i = 1; i < (uint64_t)ranks; i++) {
+    for (i = 1; i < ranks; i++) {
         recv_total += recvcounts[i];
         recvdisps[i] = recvdisps[i - 1] + recvcounts[i - 1];
     }
 
-    /* allocate buffer to recv bytes into based on recvounts */
+    /* allocate buffer to recv indices */
     uint64_t* recvbuf = (uint64_t*) MFU_MALLOC((uint64_t)recv_total * sizeof(uint64_t));
 
-    /* send the bytes to the correct rank that owns the file */
+    /* send indices to the ranks that own the files */
     MPI_Alltoallv(
         sendbuf, sendcounts, senddisps, MPI_UINT64_T,
         recvbuf, recvcounts, recvdisps, MPI_UINT64_T, MPI_COMM_WORLD
     );
 
-    /* unpack contents of recv buffer & store results in strmap */
-    disp = 0;
-    while (disp < recv_total) {
-        /* local store of idx & flag values for each file */
-        uint64_t idx  = recvbuf[disp];
-        uint64_t flag = recvbuf[disp + 1];
-
-        /* set value in output array for corresponding item */
-        results[idx] = (int)flag;
-
-        /* go to next id & flag */
-        disp += 2;
+    /* set flag for each item we received */
+    for (i = 0; i < recv_total; i++) {
+        uint64_t file_index = recvbuf[i];
+        results[file_index] = 1;
     }
 
     mfu_free(&recvbuf);
     mfu_free(&sendbuf);
+    mfu_free(&offsets);
 
     mfu_free(&sendcounts);
     mfu_free(&recvcounts);
     mfu_free(&recvdisps);
     mfu_free(&senddisps);
 
-    mfu_free(&keys);
-    mfu_free(&ltr);
-
     return;
 }
+
+/****************************************
+ * Functions to compare file sections listed in chunk lists
+ ***************************************/
+
+/* number of chunks each process compares between exchanges
+ * of the files it has found to differ */
+#define MFU_COMPARE_ROUND_CHUNKS (64)
+
+/* files found to differ by any process during a compare, each file
+ * is named by the rank and index of its owner in the compare list */
+typedef struct {
+    uint64_t* ids;        /* sorted (rank, index) pairs known to differ */
+    uint64_t count;       /* number of pairs in ids */
+    uint64_t* found;      /* pairs found locally since last exchange */
+    uint64_t found_count; /* number of pairs in found */
+} mfu_differ_set;
+
+/* order (rank, index) pairs */
+static int mfu_differ_cmp(const void* a, const void* b)
+{
+    const uint64_t* x = (const uint64_t*) a;
+    const uint64_t* y = (const uint64_t*) b;
+    if (x[0] != y[0]) {
+        return (x[0] < y[0]) ? -1 : 1;
+    }
+    if (x[1] != y[1]) {
+        return (x[1] < y[1]) ? -1 : 1;
+    }
+    return 0;
+}
+
+static void mfu_differ_init(mfu_differ_set* set)
+{
+    set->ids         = NULL;
+    set->count       = 0;
+    set->found       = (uint64_t*) MFU_MALLOC(2 * MFU_COMPARE_ROUND_CHUNKS * sizeof(uint64_t));
+    set->found_count = 0;
+}
+
+static void mfu_differ_free(mfu_differ_set* set)
+{
+    mfu_free(&set->ids);
+    mfu_free(&set->found);
+    set->count       = 0;
+    set->found_count = 0;
+}
+
+/* return 1 if the file owning this chunk is known to differ */
+static int mfu_differ_test(const mfu_differ_set* set, const mfu_file_chunk* p)
+{
+    if (set->count == 0) {
+        return 0;
+    }
+    uint64_t key[2];
+    key[0] = (uint64_t) p->rank_of_owner;
+    key[1] = p->index_of_owner;
+    void* hit = bsearch(key, set->ids, (size_t)set->count,
+        2 * sizeof(uint64_t), mfu_differ_cmp);
+    return (hit != NULL);
+}
+
+/* record that the file owning this chunk differs, a process compares
+ * at most MFU_COMPARE_ROUND_CHUNKS chunks between exchanges */
+static void mfu_differ_add(mfu_differ_set* set, const mfu_file_chunk* p)
+{
+    uint64_t n = set->found_count;
+    set->found[2 * n + 0] = (uint64_t) p->rank_of_owner;
+    set->found[2 * n + 1] = p->index_of_owner;
+    set->found_count++;
+}
+
+/* gather the files each process found to differ since the last
+ * exchange, so that every process can skip the chunks it holds
+ * of those files, must be called by all processes */
+static void mfu_differ_exchange(mfu_differ_set* set)
+{
+    int i;
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* gather number of values each process contributes */
+    int sendcount = (int) (2 * set->found_count);
+    int* recvcounts = (int*) MFU_MALLOC(ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC(ranks * sizeof(int));
+    MPI_Allgather(&sendcount, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    int total = 0;
+    for (i = 0; i < ranks; i++) {
+        recvdisps[i] = total;
+        total += recvcounts[i];
+    }
+
+    /* nothing to merge if no process found a new file */
+    if (total == 0) {
+        mfu_free(&recvdisps);
+        mfu_free(&recvcounts);
+        return;
+    }
+
+    /* append new pairs after the ones we already know */
+    uint64_t count = set->count + (uint64_t)total / 2;
+    uint64_t* ids = (uint64_t*) MFU_MALLOC(2 * count * sizeof(uint64_t));
+    if (set->count > 0) {
+        memcpy(ids, set->ids, 2 * set->count * sizeof(uint64_t));
+    }
+    MPI_Allgatherv(set->found, sendcount, MPI_UINT64_T,
+        ids + 2 * set->count, recvcounts, recvdisps, MPI_UINT64_T, MPI_COMM_WORLD);
+
+    /* sort and drop duplicates for lookups */
+    qsort(ids, (size_t)count, 2 * sizeof(uint64_t), mfu_differ_cmp);
+    uint64_t j;
+    uint64_t unique = 0;
+    for (j = 0; j < count; j++) {
+        if (unique > 0 && mfu_differ_cmp(&ids[2 * j], &ids[2 * (unique - 1)]) == 0) {
+            continue;
+        }
+        ids[2 * unique + 0] = ids[2 * j + 0];
+        ids[2 * unique + 1] = ids[2 * j + 1];
+        unique++;
+    }
+
+    mfu_free(&set->ids);
+    set->ids         = ids;
+    set->count       = unique;
+    set->found_count = 0;
+
+    mfu_free(&recvdisps);
+    mfu_free(&recvcounts);
+}
+
+/* compare each section in the source chunk list with the same section
+ * of the destination file, setting vals[i] to 0 if the section is the
+ * same and 1 if it differs, unless overwriting, sections are compared
+ * chunk_size bytes at a time and every MFU_COMPARE_ROUND_CHUNKS chunks processes
+ * exchange the files they found to differ, so that no process reads
+ * further into a file that any process knows differs, returns 0 on
+ * success and -1 on read error, must be called by all processes */
+int mfu_file_chunk_list_compare(
+    const mfu_file_chunk* src_head,
+    const mfu_file_chunk* dst_head,
+    uint64_t chunk_size,
+    size_t bufsize,
+    int overwrite,
+    int* vals,
+    uint64_t* count_bytes_read,
+    uint64_t* count_bytes_written,
+    mfu_progress* prg)
+{
+    int rc = 0;
+
+    /* get a count of how many items are the chunk list */
+    uint64_t list_count = mfu_file_chunk_list_size(src_head);
+
+    /* when overwriting, compare each section in one pass */
+    uint64_t step         = UINT64_MAX;
+    uint64_t rounds       = 1;
+    uint64_t round_chunks = UINT64_MAX;
+    if (! overwrite) {
+        /* count chunks we will compare to agree on number of rounds,
+         * an empty file still takes one compare */
+        step = chunk_size;
+        uint64_t chunks = 0;
+        const mfu_file_chunk* p;
+        for (p = src_head; p != NULL; p = p->next) {
+            uint64_t n = (p->length + step - 1) / step;
+            chunks += (n > 0) ? n : 1;
+        }
+        uint64_t my_rounds = (chunks + MFU_COMPARE_ROUND_CHUNKS - 1) / MFU_COMPARE_ROUND_CHUNKS;
+        MPI_Allreduce(&my_rounds, &rounds, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+        round_chunks = MFU_COMPARE_ROUND_CHUNKS;
+    }
+
+    mfu_differ_set differ;
+    mfu_differ_init(&differ);
+
+    uint64_t i = 0;
+    const mfu_file_chunk* src_p = src_head;
+    const mfu_file_chunk* dst_p = dst_head;
+    uint64_t pos = (src_p != NULL) ? src_p->offset : 0;
+    uint64_t round;
+    for (round = 0; round < rounds; round++) {
+        uint64_t done = 0;
+        while (i < list_count && done < round_chunks) {
+            /* once one chunk of a file differs the whole file does,
+             * so skip sections of files found to differ */
+            int compare_rc = 1;
+            if (! mfu_differ_test(&differ, src_p)) {
+                /* compare the next chunk of this section */
+                uint64_t end = src_p->offset + src_p->length;
+                uint64_t length = end - pos;
+                if (length > step) {
+                    length = step;
+                }
+                compare_rc = mfu_compare_contents(src_p->name, dst_p->name, (off_t)pos, (off_t)length,
+                        bufsize, overwrite, count_bytes_read, count_bytes_written, prg);
+                if (compare_rc == -1) {
+                    /* we hit an error while reading */
+                    rc = -1;
+                    MFU_LOG(MFU_LOG_ERR,
+                      "Failed to open, lseek, or read %s and/or %s. Assuming contents are different.",
+                         src_p->name, dst_p->name);
+
+                    /* set flag to consider files to be different,
+                     * could actually be the same, but we'll draw attention to them this way */
+                    compare_rc = 1;
+                }
+                done++;
+
+                /* move to the next chunk if this one matched */
+                pos += length;
+                if (compare_rc == 0 && pos < end) {
+                    continue;
+                }
+
+                /* let other processes know this file differs */
+                if (compare_rc != 0 && ! overwrite) {
+                    mfu_differ_add(&differ, src_p);
+                }
+            }
+
+            /* record results of comparison and move to next section */
+            vals[i] = compare_rc;
+            i++;
+            src_p = src_p->next;
+            dst_p = dst_p->next;
+            if (src_p != NULL) {
+                pos = src_p->offset;
+            }
+        }
+
+        /* share files found to differ in this round */
+        if (! overwrite) {
+            mfu_differ_exchange(&differ);
+        }
+    }
+
+    mfu_differ_free(&differ);
+
+    return rc;
+}
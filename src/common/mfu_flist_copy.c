@@ -36,7 +36,9 @@
 #include <sys/param.h>
 
 #include <linux/fs.h>
-#include <linux/fiemap.h>
+
+/* POSIX asynchronous I/O to overlap reads and writes */
+#include <aio.h>
 
 /* define PRI64 */
 #include <inttypes.h>
@@ -81,6 +83,25 @@ typedef struct {
     int   fd;   /* file descriptor */
 } mfu_copy_file_cache_t;
 
+/* tracks a read of one block issued ahead of the block
+ * currently being written during a copy */
+typedef struct {
+    struct aiocb cb; /* control block for asynchronous read */
+    int     active;  /* whether a read was submitted with aio_read and not yet completed */
+    ssize_t nread;   /* bytes read when read had to be done synchronously */
+    off_t   pos;     /* offset in source file of this block */
+    size_t  size;    /* number of bytes requested */
+} mfu_copy_aio_slot_t;
+
+/* growable list of (owner rank, owner index) pairs identifying
+ * items in the file list on the process that owns them */
+typedef struct {
+    uint64_t  count;   /* number of entries */
+    uint64_t  max;     /* capacity of arrays */
+    uint64_t* ranks;   /* owner rank of each entry */
+    uint64_t* indices; /* owner index of each entry */
+} mfu_copy_owner_list_t;
+
 /****************************************
  * Define globals
  ***************************************/
@@ -88,53 +109,26 @@ typedef struct {
 /** Where we should keep statistics related to this file copy. */
 static mfu_copy_stats_t mfu_copy_stats;
 
-/** Cache most recent open file descriptor to avoid opening / closing the same file */
-static mfu_copy_file_cache_t mfu_copy_src_cache;
-static mfu_copy_file_cache_t mfu_copy_dst_cache;
+/** Limits on bytes copied and on metadata operations per second across all ranks */
+static mfu_throttle mfu_copy_bw_throttle;
+static mfu_throttle mfu_copy_ops_throttle;
 
+/* opens file for reading or writing through the open file cache, so
+ * chunks of files we recently worked on reuse their descriptors,
+ * takes the grouplock on each descriptor we newly open */
 static int mfu_copy_open_file(const char* file, int read_flag,
-        mfu_copy_file_cache_t* cache, mfu_copy_opts_t* mfu_copy_opts)
+        mfu_copy_opts_t* mfu_copy_opts)
 {
-    int newfd = -1;
-
-    /* see if we have a cached file descriptor */
-    char* name = cache->name;
-    if (name != NULL) {
-        /* we have a cached file descriptor */
-        int fd = cache->fd;
-        if (strcmp(name, file) == 0 && cache->read == read_flag) {
-            /* the file we're trying to open matches name and read/write mode,
-             * so just return the cached descriptor */
-            return fd;
-        } else {
-            /* the file we're trying to open is different,
-             * close the old file and delete the name */
-            mfu_close(name, fd);
-            mfu_free(&cache->name);
-        }
+    int flags = read_flag ? O_RDONLY : (O_WRONLY | O_CREAT);
+    if (mfu_copy_opts->synchronous) {
+        flags |= O_DIRECT;
     }
 
-    /* open the new file */
-    if (read_flag) {
-        int flags = O_RDONLY;
-        if (mfu_copy_opts->synchronous) {
-            flags |= O_DIRECT;
-        }
-        newfd = mfu_open(file, flags);
-    } else {
-        int flags = O_WRONLY | O_CREAT;
-        if (mfu_copy_opts->synchronous) {
-            flags |= O_DIRECT;
-        }
-        newfd = mfu_open(file, flags, DCOPY_DEF_PERMS_FILE);
-    }
+    int opened;
+    int newfd = mfu_fd_cache_open(file, flags, DCOPY_DEF_PERMS_FILE, &opened);
 
-    /* cache the file descriptor */
-    if (newfd != -1) {
-        cache->name = MFU_STRDUP(file);
-        cache->fd   = newfd;
-        cache->read = read_flag;
 #ifdef LUSTRE_SUPPORT
+    if (newfd != -1 && opened) {
         /* Zero is an invalid ID for grouplock. */
         if (mfu_copy_opts->grouplock_id != 0) {
             errno = 0;
@@ -149,8 +143,8 @@ static int mfu_copy_open_file(const char* file, int read_flag,
                     file, newfd);
             }
         }
-#endif
     }
+#endif
 
     return newfd;
 }
@@ -520,6 +514,34 @@ static int mfu_copy_close_file(mfu_copy_file_cache_t* cache)
     return rc;
 }
 
+/* returns 1 if item is a regular file small enough to be copied whole
+ * by the process that owns it in the list, 0 otherwise, such files are
+ * created, copied, and have their metadata set in mfu_copy_small_files */
+static int mfu_copy_is_small_file(mfu_flist list, uint64_t idx,
+        const mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* small file path is disabled if threshold is 0,
+     * and we leave sparse and O_DIRECT copies to the chunked path */
+    if (mfu_copy_opts->small_file_size == 0 ||
+        mfu_copy_opts->sparse ||
+        mfu_copy_opts->synchronous)
+    {
+        return 0;
+    }
+
+    /* only regular files at or below the threshold qualify */
+    mfu_filetype type = mfu_flist_file_get_type(list, idx);
+    if (type != MFU_TYPE_FILE) {
+        return 0;
+    }
+    uint64_t size = mfu_flist_file_get_size(list, idx);
+    if (size > mfu_copy_opts->small_file_size) {
+        return 0;
+    }
+
+    return 1;
+}
+
 /* progress message to print while setting file metadata */
 static void meta_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
 {
@@ -650,6 +672,7 @@ static int mfu_copy_set_metadata(int levels, int minlevel, mfu_flist* lists,
 
             /* update number of items we have completed for progress messages */
             mfu_progress_update(&total_count, meta_prog);
+            mfu_throttle_consume(&mfu_copy_ops_throttle, 1, meta_prog);
         }
 
         /* wait for all procs to finish before we start
@@ -683,6 +706,43 @@ static int mfu_copy_set_metadata(int levels, int minlevel, mfu_flist* lists,
     return rc;
 }
 
+/* set timestamps on files whose ownership and permissions were set
+ * while they were copied, this runs after data has been synced so that
+ * flushing data does not change them, files do not have other items
+ * beneath them, so their order does not matter */
+static int mfu_copy_set_timestamps(mfu_flist list,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        /* get destination name of item */
+        const char* name = mfu_flist_file_get_name(list, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, mfu_copy_opts);
+        if (dest == NULL) {
+            continue;
+        }
+
+        if (mfu_copy_timestamps(list, idx, dest) < 0) {
+            rc = -1;
+        }
+        mfu_throttle_consume(&mfu_copy_ops_throttle, 1, NULL);
+
+        mfu_free(&dest);
+    }
+
+    /* determine whether any process failed */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+    return all_rc;
+}
+
 /* iterate through list of files and set ownership, timestamps,
  * and permissions starting from deepest level and working upwards,
  * we go in this direction in case updating a file updates its
@@ -749,6 +809,7 @@ static int mfu_copy_set_metadata_dirs(int levels, int minlevel, mfu_flist* lists
 
             /* update our running total */
             total_count++;
+            mfu_throttle_consume(&mfu_copy_ops_throttle, 1, NULL);
 
             if(mfu_copy_opts->preserve) {
                 tmp_rc = mfu_copy_ownership(list, idx, dest);
@@ -809,6 +870,17 @@ static int mfu_copy_set_metadata_dirs(int levels, int minlevel, mfu_flist* lists
     return rc;
 }
 
+/* returns length of parent directory portion of path,
+ * or 0 if path has no slash */
+static size_t mfu_copy_parent_len(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    if (slash == NULL) {
+        return 0;
+    }
+    return (size_t)(slash - path);
+}
+
 /* creates dir in destpath for specified item, identifies source path
  * that contains source dir, computes relative path to dir under source path,
  * and creates dir at same relative path under destpath, copies xattrs
@@ -855,6 +927,7 @@ static int mfu_create_directory(mfu_flist list, uint64_t idx,
 
     /* create the destination directory */
     MFU_LOG(MFU_LOG_DBG, "Creating directory `%s'", dest_path);
+    mfu_throttle_consume(&mfu_copy_ops_throttle, 1, NULL);
     int mkdir_rc = mfu_mkdir(dest_path, DCOPY_DEF_PERMS_DIR);
     if(mkdir_rc < 0) {
         if(errno == EEXIST) {
@@ -891,9 +964,140 @@ static int mfu_create_directory(mfu_flist list, uint64_t idx,
     return rc;
 }
 
-/* create directories, we work from shallowest level to the deepest
- * with a barrier in between levels, so that we don't try to create
- * a child directory until the parent exists,
+/* tag for messages that announce a directory has been created */
+#define MFU_COPY_DIR_TAG (1)
+
+/* map function for mfu_flist_remap, sends each directory to the
+ * process that owns its parent path so that a directory waits on the
+ * same process that will be told when its parent has been created */
+static int mfu_copy_map_parent(mfu_flist flist, uint64_t idx, int ranks, const void* args)
+{
+    const char* name = mfu_flist_file_get_name(flist, idx);
+    size_t len = mfu_copy_parent_len(name);
+    uint32_t hash = mfu_hash_jenkins(name, len);
+    return (int) (hash % (uint32_t) ranks);
+}
+
+/* list used by compare functions when sorting directories */
+static mfu_flist mfu_copy_dir_list;
+
+/* orders list indices by the parent directory of each item */
+static int mfu_copy_dir_parent_compare(const void* a, const void* b)
+{
+    const char* name_a = mfu_flist_file_get_name(mfu_copy_dir_list, *(const uint64_t*)a);
+    const char* name_b = mfu_flist_file_get_name(mfu_copy_dir_list, *(const uint64_t*)b);
+    size_t len_a = mfu_copy_parent_len(name_a);
+    size_t len_b = mfu_copy_parent_len(name_b);
+    size_t len = (len_a < len_b) ? len_a : len_b;
+    int cmp = memcmp(name_a, name_b, len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (len_a != len_b) {
+        return (len_a < len_b) ? -1 : 1;
+    }
+    return 0;
+}
+
+/* orders list indices by the full name of each item */
+static int mfu_copy_dir_name_compare(const void* a, const void* b)
+{
+    const char* name_a = mfu_flist_file_get_name(mfu_copy_dir_list, *(const uint64_t*)a);
+    const char* name_b = mfu_flist_file_get_name(mfu_copy_dir_list, *(const uint64_t*)b);
+    return strcmp(name_a, name_b);
+}
+
+/* find item with given name in indices sorted by mfu_copy_dir_name_compare,
+ * returns position in indices or -1 if not found */
+static int64_t mfu_copy_dir_find_name(const uint64_t* indices, uint64_t count, const char* name)
+{
+    uint64_t low = 0;
+    uint64_t high = count;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        const char* mid_name = mfu_flist_file_get_name(mfu_copy_dir_list, indices[mid]);
+        int cmp = strcmp(name, mid_name);
+        if (cmp == 0) {
+            return (int64_t) mid;
+        } else if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return -1;
+}
+
+/* group of local directories that share the same parent path */
+typedef struct {
+    const char* parent; /* pointer to parent path in name of first child */
+    size_t len;         /* length of parent path */
+    uint64_t start;     /* position of first child in sorted index array */
+    uint64_t count;     /* number of children */
+} mfu_copy_dir_group_t;
+
+/* find group with given parent path in groups sorted by parent,
+ * returns group index or -1 if not found */
+static int64_t mfu_copy_dir_find_group(const mfu_copy_dir_group_t* groups, uint64_t count,
+        const char* parent, size_t len)
+{
+    uint64_t low = 0;
+    uint64_t high = count;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        const mfu_copy_dir_group_t* g = &groups[mid];
+        size_t minlen = (len < g->len) ? len : g->len;
+        int cmp = memcmp(parent, g->parent, minlen);
+        if (cmp == 0 && len != g->len) {
+            cmp = (len < g->len) ? -1 : 1;
+        }
+        if (cmp == 0) {
+            return (int64_t) mid;
+        } else if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return -1;
+}
+
+/* send notification that the directory named by path (first len
+ * bytes) is ready to hold children to the process that owns it */
+static void mfu_copy_dir_notify(const char* path, size_t len, int ranks,
+        MPI_Comm comm, MPI_Request** reqs, char*** bufs, uint64_t* count, uint64_t* max)
+{
+    /* grow our arrays of outstanding sends if needed */
+    if (*count == *max) {
+        uint64_t newmax = (*max > 0) ? *max * 2 : 64;
+        MPI_Request* newreqs = (MPI_Request*) MFU_MALLOC(newmax * sizeof(MPI_Request));
+        char** newbufs = (char**) MFU_MALLOC(newmax * sizeof(char*));
+        if (*count > 0) {
+            memcpy(newreqs, *reqs, *count * sizeof(MPI_Request));
+            memcpy(newbufs, *bufs, *count * sizeof(char*));
+        }
+        mfu_free(reqs);
+        mfu_free(bufs);
+        *reqs = newreqs;
+        *bufs = newbufs;
+        *max  = newmax;
+    }
+
+    /* copy path into a buffer that lives until the send completes */
+    char* buf = (char*) MFU_MALLOC(len + 1);
+    memcpy(buf, path, len);
+    buf[len] = '\0';
+
+    /* send to the process that holds children of this path */
+    int dest = (int) (mfu_hash_jenkins(path, len) % (uint32_t) ranks);
+    MPI_Isend(buf, (int)(len + 1), MPI_CHAR, dest, MFU_COPY_DIR_TAG, comm, &(*reqs)[*count]);
+    (*bufs)[*count] = buf;
+    (*count)++;
+}
+
+/* create directories, each directory is sent to the process that owns
+ * its parent path and it is created as soon as that process hears that
+ * the parent exists, this avoids a barrier after each level of the tree,
  * returns 0 on success and -1 on failure */
 static int mfu_create_directories(int levels, int minlevel, mfu_flist* lists,
         int numpaths, const mfu_param_path* paths,
@@ -906,8 +1110,9 @@ static int mfu_create_directories(int levels, int minlevel, mfu_flist* lists,
     int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
 
     /* get current rank */
-    int rank;
+    int rank, ranks;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
     /* indicate to user what phase we're in */
     if (rank == 0) {
@@ -919,64 +1124,236 @@ static int mfu_create_directories(int levels, int minlevel, mfu_flist* lists,
     double total_start = MPI_Wtime();
     uint64_t total_count = 0;
 
-    /* work from shallowest level to deepest level */
+    /* gather directories from all levels into a single list */
+    mfu_flist dirs = (levels > 0) ? mfu_flist_subset(lists[0]) : mfu_flist_new();
     int level;
     for (level = 0; level < levels; level++) {
-        /* time how long this takes */
-        double start = MPI_Wtime();
-
-        /* get list of items for this level */
         mfu_flist list = lists[level];
-
-        /* create each directory we have at this level */
         uint64_t idx;
         uint64_t size = mfu_flist_size(list);
-        uint64_t count = 0;
         for (idx = 0; idx < size; idx++) {
-            /* check whether we have a directory */
             mfu_filetype type = mfu_flist_file_get_type(list, idx);
             if (type == MFU_TYPE_DIR) {
-                /* create the directory */
-                int tmp_rc = mfu_create_directory(list, idx, numpaths,
-                        paths, destpath, mfu_copy_opts);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
+                mfu_flist_file_copy(list, idx, dirs);
+            }
+        }
+    }
+    mfu_flist_summarize(dirs);
 
-                count++;
+    /* move each directory to the process owning its parent path */
+    mfu_flist list = mfu_flist_remap(dirs, mfu_copy_map_parent, NULL);
+    mfu_flist_free(&dirs);
+    mfu_copy_dir_list = list;
+
+    /* sort our directories by parent, and separately by name */
+    uint64_t i;
+    uint64_t size = mfu_flist_size(list);
+    uint64_t* by_parent = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t* by_name   = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    for (i = 0; i < size; i++) {
+        by_parent[i] = i;
+        by_name[i]   = i;
+    }
+    qsort(by_parent, (size_t)size, sizeof(uint64_t), mfu_copy_dir_parent_compare);
+    qsort(by_name,   (size_t)size, sizeof(uint64_t), mfu_copy_dir_name_compare);
+
+    /* identify groups of directories that share a parent */
+    mfu_copy_dir_group_t* groups = (mfu_copy_dir_group_t*) MFU_MALLOC(size * sizeof(mfu_copy_dir_group_t));
+    uint64_t ngroups = 0;
+    for (i = 0; i < size; i++) {
+        const char* name = mfu_flist_file_get_name(list, by_parent[i]);
+        size_t len = mfu_copy_parent_len(name);
+        if (ngroups > 0) {
+            mfu_copy_dir_group_t* g = &groups[ngroups - 1];
+            if (g->len == len && memcmp(g->parent, name, len) == 0) {
+                g->count++;
+                continue;
             }
         }
+        groups[ngroups].parent = name;
+        groups[ngroups].len    = len;
+        groups[ngroups].start  = i;
+        groups[ngroups].count  = 1;
+        ngroups++;
+    }
 
-        /* add items to our running total */
-        total_count += count;
+    /* ask to be told when each parent is ready, a parent in the list
+     * is held by the process owning its own parent path, so send the
+     * parent path to that process, packed as NUL-terminated strings */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* dests      = (int*) MFU_MALLOC(ngroups * sizeof(int));
+    int r;
+    for (r = 0; r < ranks; r++) {
+        sendcounts[r] = 0;
+    }
+    for (i = 0; i < ngroups; i++) {
+        mfu_copy_dir_group_t* g = &groups[i];
+        size_t plen = 0;
+        const char* slash = memrchr(g->parent, '/', g->len);
+        if (slash != NULL) {
+            plen = (size_t)(slash - g->parent);
+        }
+        dests[i] = (int) (mfu_hash_jenkins(g->parent, plen) % (uint32_t) ranks);
+        sendcounts[dests[i]] += (int)(g->len + 1);
+    }
 
-        /* wait for all procs to finish before we start
-         * creating directories at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
+    int sendbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        senddisps[r] = sendbytes;
+        sendbytes += sendcounts[r];
+    }
 
-        /* stop our timer */
-        double end = MPI_Wtime();
+    char* sendbuf = (char*) MFU_MALLOC((size_t)sendbytes);
+    int* offsets  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (r = 0; r < ranks; r++) {
+        offsets[r] = senddisps[r];
+    }
+    for (i = 0; i < ngroups; i++) {
+        mfu_copy_dir_group_t* g = &groups[i];
+        char* ptr = sendbuf + offsets[dests[i]];
+        memcpy(ptr, g->parent, g->len);
+        ptr[g->len] = '\0';
+        offsets[dests[i]] += (int)(g->len + 1);
+    }
 
-         /* print statistics */
-        if (verbose) {
-            uint64_t min, max, sum;
-            MPI_Allreduce(&count, &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-            double rate = 0.0;
-            double secs = end - start;
-            if (secs > 0.0) {
-              rate = (double)sum / secs;
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    int recvbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        recvdisps[r] = recvbytes;
+        recvbytes += recvcounts[r];
+    }
+    char* recvbuf = (char*) MFU_MALLOC((size_t)recvbytes);
+
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_CHAR,
+        recvbuf, recvcounts, recvdisps, MPI_CHAR, MPI_COMM_WORLD
+    );
+
+    /* use a separate communicator for notifications so they
+     * can't be confused with other messages */
+    MPI_Comm comm;
+    MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+
+    /* track outstanding notification sends */
+    MPI_Request* reqs = NULL;
+    char** bufs = NULL;
+    uint64_t nreqs = 0;
+    uint64_t maxreqs = 0;
+
+    /* mark directories that others wait on, and notify right away
+     * for any requested parent that is not in the list at all,
+     * since it must already exist */
+    int* notify = (int*) MFU_MALLOC(size * sizeof(int));
+    for (i = 0; i < size; i++) {
+        notify[i] = 0;
+    }
+    const char* ptr = recvbuf;
+    while (ptr < recvbuf + recvbytes) {
+        size_t len = strlen(ptr);
+        int64_t pos = mfu_copy_dir_find_name(by_name, size, ptr);
+        if (pos >= 0) {
+            notify[by_name[pos]] = 1;
+        } else {
+            mfu_copy_dir_notify(ptr, len, ranks, comm, &reqs, &bufs, &nreqs, &maxreqs);
+        }
+        ptr += len + 1;
+    }
+
+    /* stack of directories whose parent exists */
+    uint64_t* ready = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t nready = 0;
+
+    /* create directories as parents become ready, we expect one
+     * notification for each group of children we hold */
+    uint64_t created  = 0;
+    uint64_t received = 0;
+    size_t maxlen = 0;
+    char* msg = NULL;
+    while (created < size || received < ngroups) {
+        /* create any directories that are ready */
+        while (nready > 0) {
+            nready--;
+            uint64_t idx = ready[nready];
+
+            /* create the directory */
+            int tmp_rc = mfu_create_directory(list, idx, numpaths,
+                    paths, destpath, mfu_copy_opts);
+            if (tmp_rc < 0) {
+                rc = -1;
             }
-            if (rank == 0) {
-                MFU_LOG(MFU_LOG_INFO, "  level=%d min=%lu max=%lu sum=%lu rate=%f/sec secs=%f",
-                  (minlevel + level), (unsigned long)min, (unsigned long)max, (unsigned long)sum, rate, secs
-                );
+            created++;
+
+            /* let the process holding its children know,
+             * even on failure so that they report their own errors */
+            if (notify[idx]) {
+                const char* name = mfu_flist_file_get_name(list, idx);
+                mfu_copy_dir_notify(name, strlen(name), ranks, comm, &reqs, &bufs, &nreqs, &maxreqs);
+            }
+        }
+
+        /* wait for word that another parent is ready */
+        if (received < ngroups) {
+            MPI_Status status;
+            MPI_Probe(MPI_ANY_SOURCE, MFU_COPY_DIR_TAG, comm, &status);
+
+            int count;
+            MPI_Get_count(&status, MPI_CHAR, &count);
+            if ((size_t)count > maxlen) {
+                mfu_free(&msg);
+                maxlen = (size_t)count;
+                msg = (char*) MFU_MALLOC(maxlen);
+            }
+            MPI_Recv(msg, count, MPI_CHAR, status.MPI_SOURCE, MFU_COPY_DIR_TAG, comm, MPI_STATUS_IGNORE);
+            received++;
+
+            /* queue up all of our directories that wait on this parent */
+            int64_t g = mfu_copy_dir_find_group(groups, ngroups, msg, strlen(msg));
+            if (g >= 0) {
+                uint64_t j;
+                for (j = 0; j < groups[g].count; j++) {
+                    ready[nready] = by_parent[groups[g].start + j];
+                    nready++;
+                }
             }
         }
     }
 
-    /* stop timer and report total count */
+    /* wait for our notifications to be delivered */
+    if (nreqs > 0) {
+        MPI_Waitall((int)nreqs, reqs, MPI_STATUSES_IGNORE);
+    }
+    for (i = 0; i < nreqs; i++) {
+        mfu_free(&bufs[i]);
+    }
+    mfu_free(&reqs);
+    mfu_free(&bufs);
+    MPI_Comm_free(&comm);
+
+    /* add items to our running total */
+    total_count += created;
+
+    mfu_free(&msg);
+    mfu_free(&ready);
+    mfu_free(&notify);
+    mfu_free(&recvbuf);
+    mfu_free(&sendbuf);
+    mfu_free(&offsets);
+    mfu_free(&dests);
+    mfu_free(&sendcounts);
+    mfu_free(&senddisps);
+    mfu_free(&recvcounts);
+    mfu_free(&recvdisps);
+    mfu_free(&groups);
+    mfu_free(&by_name);
+    mfu_free(&by_parent);
+    mfu_flist_free(&list);
+
+    /* stop timer and report total count, this barrier also ensures
+     * all directories exist before we start creating files */
     MPI_Barrier(MPI_COMM_WORLD);
     double total_end = MPI_Wtime();
 
@@ -1069,6 +1446,83 @@ static int mfu_create_link(mfu_flist list, uint64_t idx,
     return rc;
 }
 
+/* reserve space for the data of a large destination file up front,
+ * so that chunks written by different processes land in extents
+ * allocated together rather than extending the file piece by piece,
+ * for sparse copies only the size is set so holes are kept, returns
+ * 0 on success or if the file system can't preallocate, -1 on error */
+static int mfu_copy_prealloc(const char* dest, uint64_t size,
+        mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    if (mfu_copy_opts->sparse) {
+        /* set the size without allocating blocks */
+        if (mfu_truncate(dest, (off_t)size) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to set size of destination file: `%s' (errno=%d %s)",
+                dest, errno, strerror(errno));
+            rc = -1;
+        }
+        return rc;
+    }
+
+    int fd = mfu_open(dest, O_WRONLY);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open destination file: `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        return -1;
+    }
+
+    /* allocate blocks for the full file and set its size,
+     * existing data is kept, so this is safe when resuming */
+    if (fallocate(fd, 0, 0, (off_t)size) != 0) {
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            /* file system can't preallocate, just write the data */
+            MFU_LOG(MFU_LOG_DBG, "Preallocation not supported for `%s'", dest);
+        } else {
+            MFU_LOG(MFU_LOG_ERR, "Failed to preallocate destination file: `%s' (errno=%d %s)",
+                dest, errno, strerror(errno));
+            rc = -1;
+        }
+    }
+
+    mfu_close(dest, fd);
+
+    return rc;
+}
+
+#ifdef LUSTRE_SUPPORT
+/* number of stripes a new file may use, found from the first file we
+ * create with a layout, 0 until then */
+static int mfu_copy_layout_stripes = 0;
+
+/* returns the largest stripe count to give a new file at path, which is
+ * the number of OSTs in its file system up to the Lustre limit */
+static int mfu_copy_layout_max_stripes(const char* path)
+{
+    if (mfu_copy_layout_stripes == 0) {
+        /* ask about the parent directory, which already exists */
+        size_t len = mfu_copy_parent_len(path);
+        char* dir;
+        if (len > 0) {
+            dir = MFU_STRDUP(path);
+            dir[len] = '\0';
+        } else {
+            dir = MFU_STRDUP((path[0] == '/') ? "/" : ".");
+        }
+        int osts = mfu_stripe_ost_count(dir);
+        mfu_free(&dir);
+
+        mfu_copy_layout_stripes = FD_LAYOUT_MAX_STRIPES;
+        if (osts > 0 && osts < FD_LAYOUT_MAX_STRIPES) {
+            mfu_copy_layout_stripes = osts;
+        }
+    }
+    return mfu_copy_layout_stripes;
+}
+#endif
+
 /* creates inode in destpath for specified file, identifies source path
  * that contains source file, computes relative path to file under source path,
  * and creates file at same relative path under destpath, copies xattrs
@@ -1093,6 +1547,11 @@ static int mfu_create_file(mfu_flist list, uint64_t idx,
         return 0;
     }
 
+    /* determine whether to reserve space for this file */
+    uint64_t file_size = mfu_flist_file_get_size(list, idx);
+    int prealloc = (mfu_copy_opts->prealloc_size > 0 &&
+                    file_size >= mfu_copy_opts->prealloc_size);
+
     /* since file systems like Lustre require xattrs to be set before file is opened,
      * we first create it with mknod and then set xattrs */
 
@@ -1101,13 +1560,58 @@ static int mfu_create_file(mfu_flist list, uint64_t idx,
      * see makedev() to create valid dev */
     dev_t dev;
     memset(&dev, 0, sizeof(dev_t));
-    int mknod_rc = mfu_mknod(dest_path, DCOPY_DEF_PERMS_FILE | S_IFREG, dev);
+    int mknod_rc = -1;
+    int created = 0;
+#ifdef LUSTRE_SUPPORT
+    struct stat layout_st;
+    if (prealloc && mfu_copy_opts->layout && mfu_lstat(dest_path, &layout_st) != 0) {
+        /* create a new large file with one stripe per FD_LAYOUT_STRIPE_BYTES
+         * of data, but no more than the file system has OSTs */
+        uint64_t stripes = (file_size + FD_LAYOUT_STRIPE_BYTES - 1) / FD_LAYOUT_STRIPE_BYTES;
+        uint64_t max_stripes = (uint64_t) mfu_copy_layout_max_stripes(dest_path);
+        if (stripes > max_stripes) {
+            stripes = max_stripes;
+        }
+
+        /* use stripes the size of this file's chunks so that each chunk
+         * is written to a single object, lustre needs a multiple of 64KiB
+         * below 4GiB */
+        uint64_t stripe_size = mfu_file_chunk_size(file_size,
+                mfu_copy_opts->chunk_size, mfu_copy_opts->chunk_size_max);
+        uint64_t max_stripe_size = 4ULL * 1024ULL * 1024ULL * 1024ULL - FD_LAYOUT_STRIPE_ALIGN;
+        if (stripe_size > max_stripe_size) {
+            stripe_size = max_stripe_size;
+        }
+        stripe_size = stripe_size / FD_LAYOUT_STRIPE_ALIGN * FD_LAYOUT_STRIPE_ALIGN;
+        if (stripe_size == 0) {
+            stripe_size = FD_LAYOUT_STRIPE_ALIGN;
+        }
+
+        if (mfu_stripe_try_set(dest_path, stripe_size, (int)stripes) == 0) {
+            mknod_rc = 0;
+            created  = 1;
+        } else if (errno != EEXIST) {
+            /* fall back to the default layout of the directory */
+            MFU_LOG(MFU_LOG_WARN, "Failed to create `%s' with %" PRIu64 " stripes of %" PRIu64 " bytes, using default layout (errno=%d %s)",
+                    dest_path, stripes, stripe_size, errno, strerror(errno));
+        }
+    }
+#endif
+    if (! created) {
+        mknod_rc = mfu_mknod(dest_path, DCOPY_DEF_PERMS_FILE | S_IFREG, dev);
+    }
     if(mknod_rc < 0) {
         if(errno == EEXIST) {
-            /* destination already exists, no big deal, but print warning */
-            MFU_LOG(MFU_LOG_WARN,
-                    "Original file exists, skip the creation: `%s' (errno=%d %s)",
-                    dest_path, errno, strerror(errno));
+            /* destination already exists, no big deal, but print warning,
+             * unless we are resuming, where most files are expected to exist */
+            if (mfu_copy_opts->resume) {
+                MFU_LOG(MFU_LOG_DBG,
+                        "Original file exists, skip the creation: `%s'", dest_path);
+            } else {
+                MFU_LOG(MFU_LOG_WARN,
+                        "Original file exists, skip the creation: `%s' (errno=%d %s)",
+                        dest_path, errno, strerror(errno));
+            }
         } else {
             /* failed to create inode, that's a problem */
             MFU_LOG(MFU_LOG_ERR, "File `%s' mknod() failed (errno=%d %s)",
@@ -1130,8 +1634,10 @@ static int mfu_create_file(mfu_flist list, uint64_t idx,
 
     /* Truncate destination files to 0 bytes when sparse file is enabled,
      * this is because we will not overwrite sections corresponding to holes
-     * and we need those to be set to 0 */
-    if (mfu_copy_opts->sparse) {
+     * and we need those to be set to 0, when resuming, the files no journal
+     * record covers were truncated when the journal was opened, and the
+     * others keep the data an earlier run copied into them */
+    if (mfu_copy_opts->sparse && ! mfu_copy_opts->resume) {
         /* truncate destination file to 0 bytes */
         struct stat st;
         int status = mfu_lstat(dest_path, &st);
@@ -1155,6 +1661,15 @@ static int mfu_create_file(mfu_flist list, uint64_t idx,
         }
     }
 
+    /* reserve space for large files before processes start
+     * writing chunks to them */
+    if (prealloc) {
+        int tmp_rc = mfu_copy_prealloc(dest_path, file_size, mfu_copy_opts);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+
     /* free destination path */
     mfu_free(&dest_path);
 
@@ -1280,8 +1795,11 @@ static int mfu_create_files(int levels, int minlevel, mfu_flist* lists,
             /* get type of item */
             mfu_filetype type = mfu_flist_file_get_type(list, idx);
 
-            /* process files and links */
-            if (type == MFU_TYPE_FILE) {
+            /* process files and links, small files are created
+             * when their data is copied */
+            if (type == MFU_TYPE_FILE && mfu_copy_is_small_file(list, idx, mfu_copy_opts)) {
+                /* nothing to do here */
+            } else if (type == MFU_TYPE_FILE) {
                 /* create inode and copy xattr for regular file */
                 int tmp_rc = mfu_create_file(list, idx, numpaths,
                         paths, destpath, mfu_copy_opts);
@@ -1290,6 +1808,7 @@ static int mfu_create_files(int levels, int minlevel, mfu_flist* lists,
                 }
                 count++;
                 total_count++;
+                mfu_throttle_consume(&mfu_copy_ops_throttle, 1, create_prog);
             } else if (type == MFU_TYPE_LINK) {
                 /* create symlink */
                 int tmp_rc = mfu_create_link(list, idx, numpaths,
@@ -1299,6 +1818,7 @@ static int mfu_create_files(int levels, int minlevel, mfu_flist* lists,
                 }
                 count++;
                 total_count++;
+                mfu_throttle_consume(&mfu_copy_ops_throttle, 1, create_prog);
             }
 
             /* update number of files we have created for progress messages */
@@ -1464,33 +1984,430 @@ static int mfu_create_hardlinks(int levels, int minlevel, mfu_flist* lists,
     return rc;
 }
 
-/* hold state for copy progress messages */
-static mfu_progress* copy_prog;
-
-/* tracks number of bytes copied by this process */
-static uint64_t copy_count;
+/****************************************
+ * Copy files with several hard links once
+ ***************************************/
 
-/* progress message to print while copying data */
-static void copy_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
+/* name of a regular file with more than one hard link, gathered
+ * on the process responsible for its inode */
+typedef struct {
+    uint64_t dev;      /* device holding inode */
+    uint64_t ino;      /* inode number */
+    uint64_t rank;     /* rank holding item in its list */
+    uint64_t index;    /* index of item in list on that rank */
+    const char* name;  /* source path of item */
+} mfu_copy_inode_name_t;
+
+/* sort names by inode, then by name */
+static int mfu_copy_inode_name_compare(const void* a, const void* b)
 {
-#if 0
-    /* compute percentage of items removed */
-    double percent = 0.0;
-    if (remove_count_total > 0) {
-        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
+    const mfu_copy_inode_name_t* x = (const mfu_copy_inode_name_t*) a;
+    const mfu_copy_inode_name_t* y = (const mfu_copy_inode_name_t*) b;
+    if (x->dev != y->dev) {
+        return (x->dev < y->dev) ? -1 : 1;
     }
-#endif
+    if (x->ino != y->ino) {
+        return (x->ino < y->ino) ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
 
-    /* compute average delete rate */
-    double rate = 0.0;
-    if (secs > 0) {
-        rate = (double)vals[0] / secs;
+/* given a list of items to copy, find regular files that are hard
+ * links to the same inode, names are sent to a process chosen by
+ * hashing the inode, which picks the first name in sort order to
+ * copy data to and tells the owners of the other names which source
+ * name they link to, returns items to copy in copy_list and the other
+ * names in link_list, with the source name each item in link_list
+ * should link to at the same index in link_targets */
+static void mfu_copy_split_hardlinks(mfu_flist list, mfu_flist* copy_list,
+        mfu_flist* link_list, char*** link_targets)
+{
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets    = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int r;
+    for (r = 0; r < ranks; r++) {
+        sendcounts[r] = 0;
     }
 
-#if 0
-    /* compute estimated time remaining */
-    double secs_remaining = -1.0;
-    if (rate > 0.0) {
+    /* pick a process for each file with more than one link by
+     * hashing its inode, each is packed as its device, inode,
+     * and index in our list followed by its name */
+    uint64_t size = mfu_flist_size(list);
+    int* dests = (int*) MFU_MALLOC(size * sizeof(int));
+    uint64_t unknown = 0;
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        dests[idx] = -1;
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        uint64_t nlink = mfu_flist_file_get_nlink(list, idx);
+        if (type == MFU_TYPE_FILE && nlink == 0) {
+            /* list has no inode data for this file */
+            unknown++;
+        }
+        if (type != MFU_TYPE_FILE || nlink < 2 || nlink == (uint64_t)-1) {
+            continue;
+        }
+
+        uint64_t key[2];
+        key[0] = mfu_flist_file_get_dev(list, idx);
+        key[1] = mfu_flist_file_get_ino(list, idx);
+        dests[idx] = (int) (mfu_hash_jenkins((const char*)key, sizeof(key)) % (uint32_t) ranks);
+
+        const char* name = mfu_flist_file_get_name(list, idx);
+        sendcounts[dests[idx]] += (int)(3 * 8 + strlen(name) + 1);
+    }
+
+    /* files read from an old cache have no link count,
+     * so any hard links among them are copied in full */
+    uint64_t all_unknown;
+    MPI_Allreduce(&unknown, &all_unknown, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0 && all_unknown > 0) {
+        MFU_LOG(MFU_LOG_WARN, "No link count for %" PRIu64 " files, "
+            "copying each of them as a separate file", all_unknown);
+    }
+
+    int sendbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        senddisps[r] = sendbytes;
+        offsets[r]   = sendbytes;
+        sendbytes += sendcounts[r];
+    }
+
+    char* sendbuf = (char*) MFU_MALLOC((size_t)sendbytes);
+    for (idx = 0; idx < size; idx++) {
+        if (dests[idx] < 0) {
+            continue;
+        }
+        char* ptr = sendbuf + offsets[dests[idx]];
+        mfu_pack_uint64(&ptr, mfu_flist_file_get_dev(list, idx));
+        mfu_pack_uint64(&ptr, mfu_flist_file_get_ino(list, idx));
+        mfu_pack_uint64(&ptr, idx);
+        const char* name = mfu_flist_file_get_name(list, idx);
+        strcpy(ptr, name);
+        ptr += strlen(name) + 1;
+        offsets[dests[idx]] = (int)(ptr - sendbuf);
+    }
+
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    int recvbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        recvdisps[r] = recvbytes;
+        recvbytes += recvcounts[r];
+    }
+    char* recvbuf = (char*) MFU_MALLOC((size_t)recvbytes);
+
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_CHAR,
+        recvbuf, recvcounts, recvdisps, MPI_CHAR, MPI_COMM_WORLD
+    );
+
+    /* unpack names, each takes at least 3 * 8 + 1 bytes */
+    uint64_t max_names = (uint64_t)recvbytes / (3 * 8 + 1);
+    mfu_copy_inode_name_t* names = (mfu_copy_inode_name_t*) MFU_MALLOC(max_names * sizeof(mfu_copy_inode_name_t));
+    uint64_t count = 0;
+    for (r = 0; r < ranks; r++) {
+        const char* ptr = recvbuf + recvdisps[r];
+        const char* end = ptr + recvcounts[r];
+        while (ptr < end) {
+            mfu_copy_inode_name_t* n = &names[count];
+            mfu_unpack_uint64(&ptr, &n->dev);
+            mfu_unpack_uint64(&ptr, &n->ino);
+            mfu_unpack_uint64(&ptr, &n->index);
+            n->rank = (uint64_t) r;
+            n->name = ptr;
+            ptr += strlen(ptr) + 1;
+            count++;
+        }
+    }
+
+    /* group names by inode */
+    qsort(names, (size_t)count, sizeof(mfu_copy_inode_name_t), mfu_copy_inode_name_compare);
+
+    /* the first name of each inode gets a copy of the data, tell
+     * the owner of each other name which name to link to, and count
+     * inodes that have more than one name in the list */
+    for (r = 0; r < ranks; r++) {
+        sendcounts[r] = 0;
+    }
+    uint64_t i;
+    uint64_t inodes = 0;
+    const mfu_copy_inode_name_t* first = NULL;
+    for (i = 0; i < count; i++) {
+        const mfu_copy_inode_name_t* n = &names[i];
+        if (first == NULL || first->dev != n->dev || first->ino != n->ino) {
+            first = n;
+            continue;
+        }
+        if (n == first + 1) {
+            inodes++;
+        }
+        sendcounts[n->rank] += (int)(8 + strlen(first->name) + 1);
+    }
+
+    mfu_free(&sendbuf);
+    sendbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        senddisps[r] = sendbytes;
+        offsets[r]   = sendbytes;
+        sendbytes += sendcounts[r];
+    }
+    sendbuf = (char*) MFU_MALLOC((size_t)sendbytes);
+
+    first = NULL;
+    for (i = 0; i < count; i++) {
+        const mfu_copy_inode_name_t* n = &names[i];
+        if (first == NULL || first->dev != n->dev || first->ino != n->ino) {
+            first = n;
+            continue;
+        }
+        char* ptr = sendbuf + offsets[n->rank];
+        mfu_pack_uint64(&ptr, n->index);
+        strcpy(ptr, first->name);
+        ptr += strlen(first->name) + 1;
+        offsets[n->rank] = (int)(ptr - sendbuf);
+    }
+
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    mfu_free(&recvbuf);
+    recvbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        recvdisps[r] = recvbytes;
+        recvbytes += recvcounts[r];
+    }
+    recvbuf = (char*) MFU_MALLOC((size_t)recvbytes);
+
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_CHAR,
+        recvbuf, recvcounts, recvdisps, MPI_CHAR, MPI_COMM_WORLD
+    );
+
+    /* record the name each of our items links to */
+    char** targets = (char**) MFU_MALLOC(size * sizeof(char*));
+    for (idx = 0; idx < size; idx++) {
+        targets[idx] = NULL;
+    }
+    uint64_t links = 0;
+    const char* ptr = recvbuf;
+    const char* end = recvbuf + recvbytes;
+    while (ptr < end) {
+        uint64_t index;
+        mfu_unpack_uint64(&ptr, &index);
+        targets[index] = MFU_STRDUP(ptr);
+        ptr += strlen(ptr) + 1;
+        links++;
+    }
+
+    /* split list into items to copy and names to link */
+    *copy_list = mfu_flist_subset(list);
+    *link_list = mfu_flist_subset(list);
+    *link_targets = (char**) MFU_MALLOC(links * sizeof(char*));
+    uint64_t link_idx = 0;
+    for (idx = 0; idx < size; idx++) {
+        if (targets[idx] == NULL) {
+            mfu_flist_file_copy(list, idx, *copy_list);
+        } else {
+            mfu_flist_file_copy(list, idx, *link_list);
+            (*link_targets)[link_idx] = targets[idx];
+            link_idx++;
+        }
+    }
+    mfu_flist_summarize(*copy_list);
+    mfu_flist_summarize(*link_list);
+
+    /* report number of inodes whose data is copied once,
+     * and number of other names that will be linked to them */
+    uint64_t all_inodes;
+    MPI_Allreduce(&inodes, &all_inodes, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    uint64_t all_links = mfu_flist_global_size(*link_list);
+    if (rank == 0 && all_links > 0) {
+        MFU_LOG(MFU_LOG_INFO, "Copying data of %" PRIu64 " hard linked files once, "
+            "linking %" PRIu64 " other names to them", all_inodes, all_links);
+    }
+
+    mfu_free(&targets);
+    mfu_free(&names);
+    mfu_free(&recvbuf);
+    mfu_free(&sendbuf);
+    mfu_free(&dests);
+    mfu_free(&offsets);
+    mfu_free(&recvdisps);
+    mfu_free(&recvcounts);
+    mfu_free(&senddisps);
+    mfu_free(&sendcounts);
+}
+
+/* create each item in link_list as a hard link to the destination of
+ * the source name at the same index in link_targets, the destination
+ * of each target must already exist, replaces any file that already
+ * exists in place of a link, returns 0 on success and -1 on error */
+static int mfu_copy_link_names(mfu_flist link_list, char** link_targets,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* indicate to user what phase we're in */
+    uint64_t all_links = mfu_flist_global_size(link_list);
+    if (rank == 0 && all_links > 0) {
+        MFU_LOG(MFU_LOG_INFO, "Linking files.");
+    }
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(link_list);
+    for (idx = 0; idx < size; idx++) {
+        /* get destination name of this item and the item it links to */
+        const char* name = mfu_flist_file_get_name(link_list, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, mfu_copy_opts);
+        char* target = mfu_param_path_copy_dest(link_targets[idx], numpaths,
+                paths, destpath, mfu_copy_opts);
+        if (dest == NULL || target == NULL) {
+            /* No need to copy it */
+            mfu_free(&dest);
+            mfu_free(&target);
+            continue;
+        }
+
+        /* create link, replacing an existing file if needed */
+        int link_rc = mfu_hardlink(target, dest);
+        if (link_rc != 0 && errno == EEXIST) {
+            if (mfu_unlink(dest) == 0) {
+                link_rc = mfu_hardlink(target, dest);
+            }
+        }
+        if (link_rc != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to create hardlink `%s' --> `%s' (errno=%d %s)",
+                dest, target, errno, strerror(errno));
+            rc = -1;
+        } else {
+            /* increment our file count by one */
+            mfu_copy_stats.total_files++;
+        }
+
+        mfu_throttle_consume(&mfu_copy_ops_throttle, 1, NULL);
+
+        mfu_free(&target);
+        mfu_free(&dest);
+    }
+
+    /* wait for all links to be created */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    return rc;
+}
+
+/* hold state for copy progress messages */
+static mfu_progress* copy_prog;
+
+/* tracks number of bytes copied by this process */
+static uint64_t copy_count;
+
+/* when writing a manifest, checksum of the data copied by the current
+ * call to mfu_copy_file and the number of bytes it covers */
+static int copy_crc_enabled;
+static mfu_crc128 copy_crc;
+static uint64_t copy_crc_bytes;
+
+/* checksums of sections this process copied, combined per file
+ * once all sections are copied */
+static mfu_file_chunk_crc* copy_crc_sections;
+static uint64_t copy_crc_sections_count;
+static uint64_t copy_crc_sections_max;
+
+/* manifest entries for files this process owns */
+static mfu_manifest_entry* copy_manifest;
+static uint64_t copy_manifest_count;
+static uint64_t copy_manifest_max;
+
+/* start a new running checksum */
+static void copy_crc_reset(void)
+{
+    copy_crc.hi    = 0;
+    copy_crc.lo    = 0;
+    copy_crc_bytes = 0;
+}
+
+/* add data that was just copied to running checksum */
+static void copy_crc_update(const void* buf, size_t bytes)
+{
+    if (copy_crc_enabled) {
+        copy_crc = mfu_crc128_update(copy_crc, buf, bytes);
+        copy_crc_bytes += (uint64_t) bytes;
+    }
+}
+
+/* add a hole of zeros that was skipped while copying to running checksum */
+static void copy_crc_zeros(uint64_t bytes)
+{
+    if (copy_crc_enabled) {
+        copy_crc = mfu_crc128_zeros(copy_crc, bytes);
+        copy_crc_bytes += bytes;
+    }
+}
+
+/* record checksum of section of a file copied by last call to mfu_copy_file */
+static void copy_crc_add_section(uint64_t rank_of_owner, uint64_t index_of_owner, uint64_t offset)
+{
+    if (! copy_crc_enabled) {
+        return;
+    }
+
+    /* grow array if needed */
+    if (copy_crc_sections_count == copy_crc_sections_max) {
+        uint64_t new_max = (copy_crc_sections_max > 0) ? copy_crc_sections_max * 2 : 1024;
+        mfu_file_chunk_crc* sections = (mfu_file_chunk_crc*) MFU_MALLOC(new_max * sizeof(mfu_file_chunk_crc));
+        if (copy_crc_sections_count > 0) {
+            memcpy(sections, copy_crc_sections, copy_crc_sections_count * sizeof(mfu_file_chunk_crc));
+        }
+        mfu_free(&copy_crc_sections);
+        copy_crc_sections = sections;
+        copy_crc_sections_max = new_max;
+    }
+
+    mfu_file_chunk_crc* s = &copy_crc_sections[copy_crc_sections_count];
+    s->rank_of_owner  = rank_of_owner;
+    s->index_of_owner = index_of_owner;
+    s->offset         = offset;
+    s->length         = copy_crc_bytes;
+    s->crc            = copy_crc;
+    copy_crc_sections_count++;
+}
+
+/* progress message to print while copying data */
+static void copy_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
+{
+#if 0
+    /* compute percentage of items removed */
+    double percent = 0.0;
+    if (remove_count_total > 0) {
+        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
+    }
+#endif
+
+    /* compute average delete rate */
+    double rate = 0.0;
+    if (secs > 0) {
+        rate = (double)vals[0] / secs;
+    }
+
+#if 0
+    /* compute estimated time remaining */
+    double secs_remaining = -1.0;
+    if (rate > 0.0) {
         secs_remaining = (double)(remove_count_total - vals[0]) / rate;
     }
 #endif
@@ -1515,40 +2432,62 @@ static void copy_progress_fn(const uint64_t* vals, int count, int complete, int
 }
 
 /* return 1 if entire buffer is 0, return 0 if any byte is not 0,
- * we avoid writing NULL blocks when supporting sparse files */
+ * we avoid writing NULL blocks when supporting sparse files,
+ * the bulk of the buffer is checked a word at a time, OR-ing several
+ * words per iteration so the compiler can vectorize the loop */
 static int mfu_is_all_null(const char* buf, uint64_t buf_size)
 {
-    uint64_t i;
-    for (i = 0; i < buf_size; i++) {
+    /* check bytes up to the first word boundary */
+    uint64_t i = 0;
+    while (i < buf_size && ((uintptr_t)(buf + i) % sizeof(uint64_t)) != 0) {
         if (buf[i] != 0) {
             return 0;
         }
+        i++;
     }
-    return 1;
-}
 
-/* when using sparse files, we need to write the last byte if the
- * hole is adjacent to EOF, so we need to detect whether we're at
- * the end of the file */
-static int mfu_is_eof(const char* file, int fd)
-{
-    /* read one byte from fd to determine whether this is EOF.
-     * This is not efficient, but it is the only reliable way */
-    char buf[1];
-    ssize_t num_of_bytes_read = mfu_read(file, fd, buf, 1);
+    /* check aligned words, 8 at a time */
+    const uint64_t* words = (const uint64_t*)(buf + i);
+    uint64_t nwords = (buf_size - i) / sizeof(uint64_t);
+    uint64_t w = 0;
+    while (w + 8 <= nwords) {
+        uint64_t bits = words[w + 0] | words[w + 1] | words[w + 2] | words[w + 3] |
+                        words[w + 4] | words[w + 5] | words[w + 6] | words[w + 7];
+        if (bits != 0) {
+            return 0;
+        }
+        w += 8;
+    }
+    while (w < nwords) {
+        if (words[w] != 0) {
+            return 0;
+        }
+        w++;
+    }
 
-    /* return if we detect EOF */
-    if(! num_of_bytes_read) {
-        return 1;
+    /* check any bytes remaining after the last full word */
+    for (i += nwords * sizeof(uint64_t); i < buf_size; i++) {
+        if (buf[i] != 0) {
+            return 0;
+        }
     }
+    return 1;
+}
 
-    /* otherwise, we're not at EOF yet, seek back one byte */
-    if(mfu_lseek(file, fd, -1, SEEK_CUR) == (off_t)-1) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in path `%s' (errno=%d %s)",
-                  file, errno, strerror(errno));
-        return -1;
+/* page cache hints for the source and destination of the chunk
+ * being copied, active when mfu_io_cache_window is set */
+static int copy_hints = 0;
+static mfu_cache_hint copy_src_hint;
+static mfu_cache_hint copy_dst_hint;
+
+/* advance page cache hints once all bytes of the chunk before pos
+ * have been copied */
+static void copy_hint_advance(off_t pos)
+{
+    if (copy_hints) {
+        mfu_cache_hint_advance(&copy_src_hint, pos);
+        mfu_cache_hint_advance(&copy_dst_hint, pos);
     }
-    return 0;
 }
 
 static int mfu_copy_file_normal(
@@ -1561,9 +2500,6 @@ static int mfu_copy_file_normal(
     uint64_t file_size,
     mfu_copy_opts_t* mfu_copy_opts)
 {
-    /* hint that we'll read from file sequentially */
-//    posix_fadvise(in_fd, offset, chunk_size, POSIX_FADV_SEQUENTIAL);
-
     /* seek to offset in source file */
     if(mfu_lseek(src, in_fd, offset, SEEK_SET) == (off_t)-1) {
         MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
@@ -1600,24 +2536,11 @@ static int mfu_copy_file_normal(
             break;
         }
 
+        /* add data to checksum while it is in cache */
+        copy_crc_update(buf, (size_t) num_of_bytes_read);
+
         /* compute number of bytes to write */
         size_t bytes_to_write = (size_t) num_of_bytes_read;
-        if(mfu_copy_opts->synchronous) {
-            /* O_DIRECT requires particular write sizes,
-             * ok to write beyond end of file so long as
-             * we truncate in cleanup step */
-            size_t remainder = buf_size - (size_t) num_of_bytes_read;
-            if(remainder > 0) {
-                /* zero out the end of the buffer for security,
-                 * don't want to leave data from another file at end of
-                 * current file if we fail before truncating */
-                char* bufzero = ((char*)buf + num_of_bytes_read);
-                memset(bufzero, 0, remainder);
-            }
-
-            /* assumes buf_size is magic size for O_DIRECT */
-            bytes_to_write = buf_size;
-        }
 
         /* Write data to destination file.
          * Do nothing for a hole in the middle of a file,
@@ -1626,14 +2549,9 @@ static int mfu_copy_file_normal(
          * if the hole is next to EOF. */
         ssize_t num_of_bytes_written = (ssize_t)bytes_to_write;
         if (mfu_copy_opts->sparse && mfu_is_all_null(buf, bytes_to_write)) {
-            /* TODO: isn't there a better way to know if we're at EOF,
-             * e.g., by using file size? */
-            /* determine whether we're at the end of the file */
-            int end_of_file = mfu_is_eof(src, in_fd);
-            if (end_of_file < 0) {
-                /* hit an error while looking for EOF */
-                return -1;
-            }
+            /* determine whether this block ends the file from its size */
+            uint64_t block_end = offset + (uint64_t)total_bytes + (uint64_t)num_of_bytes_read;
+            int end_of_file = (block_end >= file_size);
 
             /* if we're at the end of the file, write out a byte,
              * otherwise just seek out destination file pointer
@@ -1683,6 +2601,10 @@ static int mfu_copy_file_normal(
         /* update number of bytes we have copied for progress messages */
         copy_count += (uint64_t) num_of_bytes_read;
         mfu_progress_update(&copy_count, copy_prog);
+        mfu_throttle_consume(&mfu_copy_bw_throttle, (uint64_t) num_of_bytes_read, copy_prog);
+
+        /* read ahead and drop pages we're done with */
+        copy_hint_advance((off_t)(offset + total_bytes));
     }
 
     /* Increment the global counter. */
@@ -1721,7 +2643,113 @@ static int mfu_copy_file_normal(
     return 0;
 }
 
-static int mfu_copy_file_fiemap(
+/* return buffer associated with given slot in read-ahead pipeline,
+ * slot 0 is block_buf1 and remaining slots are carved from block_buf2 */
+static char* mfu_copy_aio_buf(mfu_copy_opts_t* mfu_copy_opts, int slot)
+{
+    if (slot == 0) {
+        return mfu_copy_opts->block_buf1;
+    }
+    return mfu_copy_opts->block_buf2 + (size_t)(slot - 1) * mfu_copy_opts->block_size;
+}
+
+/* start read of size bytes at pos from source file into buf,
+ * if the request cannot be queued, read the data immediately */
+static void mfu_copy_aio_issue(
+    const char* src,
+    int in_fd,
+    mfu_copy_aio_slot_t* slot,
+    char* buf,
+    off_t pos,
+    size_t size)
+{
+    /* record details of this read */
+    slot->pos   = pos;
+    slot->size  = size;
+    slot->nread = 0;
+
+    /* define asynchronous read request */
+    memset(&slot->cb, 0, sizeof(struct aiocb));
+    slot->cb.aio_fildes = in_fd;
+    slot->cb.aio_buf    = buf;
+    slot->cb.aio_nbytes = size;
+    slot->cb.aio_offset = pos;
+    slot->cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+    /* submit the read */
+    errno = 0;
+    if (aio_read(&slot->cb) == 0) {
+        slot->active = 1;
+        return;
+    }
+
+    /* failed to queue request (e.g., EAGAIN), fall back to blocking read */
+    slot->active = 0;
+    slot->nread  = mfu_pread(src, in_fd, buf, size, pos);
+}
+
+/* wait for read in given slot to finish, returns number of bytes read,
+ * which is only less than the requested size at EOF, or -1 on error */
+static ssize_t mfu_copy_aio_complete(const char* src, int in_fd, mfu_copy_aio_slot_t* slot)
+{
+    /* nothing to wait on if we read the data synchronously */
+    if (! slot->active) {
+        return slot->nread;
+    }
+
+    /* wait for our request to complete */
+    const struct aiocb* list[1];
+    list[0] = &slot->cb;
+    int err;
+    while ((err = aio_error(&slot->cb)) == EINPROGRESS) {
+        aio_suspend(list, 1, NULL);
+    }
+    ssize_t nread = aio_return(&slot->cb);
+    slot->active = 0;
+
+    /* check whether the read failed */
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+
+    /* an asynchronous read may return fewer bytes than requested
+     * before EOF, read the rest with a blocking read */
+    if (nread >= 0 && (size_t)nread < slot->size) {
+        char* buf = (char*) slot->cb.aio_buf;
+        ssize_t rest = mfu_pread(src, in_fd, buf + nread,
+            slot->size - (size_t)nread, slot->pos + (off_t)nread);
+        nread += rest;
+    }
+
+    return nread;
+}
+
+/* cancel and wait on any reads still in flight,
+ * we must do this before their buffers or file can be reused */
+static void mfu_copy_aio_drain(int in_fd, mfu_copy_aio_slot_t* slots, int depth)
+{
+    int i;
+    for (i = 0; i < depth; i++) {
+        mfu_copy_aio_slot_t* slot = &slots[i];
+        if (slot->active) {
+            aio_cancel(in_fd, &slot->cb);
+            const struct aiocb* list[1];
+            list[0] = &slot->cb;
+            while (aio_error(&slot->cb) == EINPROGRESS) {
+                aio_suspend(list, 1, NULL);
+            }
+            aio_return(&slot->cb);
+            slot->active = 0;
+        }
+    }
+}
+
+/* copies a chunk like mfu_copy_file_normal, but keeps up to
+ * (io_depth - 1) reads of the following blocks in flight while
+ * the current block is written, so that reading from the source
+ * overlaps with writing to the destination */
+static int mfu_copy_file_async(
     const char* src,
     const char* dest,
     const int in_fd,
@@ -1729,222 +2757,2111 @@ static int mfu_copy_file_fiemap(
     uint64_t offset,
     uint64_t length,
     uint64_t file_size,
-    bool* normal_copy_required,
     mfu_copy_opts_t* mfu_copy_opts)
 {
-    *normal_copy_required = true;
-    if (mfu_copy_opts->synchronous) {
-        goto fail_normal_copy;
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* seek to offset in destination file,
+     * source file is read with explicit offsets */
+    if(mfu_lseek(dest, out_fd, offset, SEEK_SET) == (off_t)-1) {
+        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        return -1;
     }
 
-    size_t last_ext_start = offset;
-    size_t last_ext_len = 0;
+    /* get buffer size and number of buffers in our pipeline */
+    size_t buf_size = mfu_copy_opts->block_size;
+    int depth = (int) mfu_copy_opts->io_depth;
 
-    struct fiemap *fiemap = (struct fiemap*)malloc(sizeof(struct fiemap));
-    if (fiemap == NULL) {
-        MFU_LOG(MFU_LOG_ERR, "Out of memory allocating fiemap");
-        goto fail_normal_copy;
+    /* compute number of blocks in this chunk */
+    uint64_t blocks = length / (uint64_t) buf_size;
+    if (blocks * (uint64_t) buf_size < length) {
+        blocks++;
     }
-    memset(fiemap, 0, sizeof(struct fiemap));
 
-    fiemap->fm_start  = offset;
-    fiemap->fm_length = length;
-    fiemap->fm_flags  = FIEMAP_FLAG_SYNC;
-    fiemap->fm_extent_count   = 0;
-    fiemap->fm_mapped_extents = 0;
+    /* allocate a read slot for each buffer */
+    mfu_copy_aio_slot_t* slots = (mfu_copy_aio_slot_t*) MFU_MALLOC((size_t)depth * sizeof(mfu_copy_aio_slot_t));
+    int i;
+    for (i = 0; i < depth; i++) {
+        slots[i].active = 0;
+    }
 
-    struct stat sb;
-    if (fstat(in_fd, &sb) < 0) {
-        goto fail_normal_copy;
+    /* fill the pipeline by starting reads on the first blocks */
+    uint64_t next_read = 0;
+    while (next_read < blocks && next_read < (uint64_t) depth) {
+        uint64_t block_offset = next_read * (uint64_t) buf_size;
+        size_t bytes = (size_t) MIN((uint64_t) buf_size, length - block_offset);
+        int slot_id = (int) next_read;
+        mfu_copy_aio_issue(src, in_fd, &slots[slot_id], mfu_copy_aio_buf(mfu_copy_opts, slot_id),
+            (off_t)(offset + block_offset), bytes);
+        next_read++;
     }
 
-    if (ioctl(in_fd, FS_IOC_FIEMAP, fiemap) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "fiemap ioctl() failed for src `%s'", src);
-        goto fail_normal_copy;
+    /* write blocks in order as their reads complete */
+    size_t total_bytes = 0;
+    uint64_t next_write;
+    for (next_write = 0; next_write < blocks; next_write++) {
+        /* get slot and buffer holding this block */
+        int slot_id = (int) (next_write % (uint64_t) depth);
+        mfu_copy_aio_slot_t* slot = &slots[slot_id];
+        char* buf = mfu_copy_aio_buf(mfu_copy_opts, slot_id);
+
+        /* wait for data to arrive */
+        ssize_t num_of_bytes_read = mfu_copy_aio_complete(src, in_fd, slot);
+        if (num_of_bytes_read < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Read error when copying from `%s' to `%s' (errno=%d %s)",
+                src, dest, errno, strerror(errno));
+            rc = -1;
+            break;
+        }
+
+        /* check for EOF */
+        if (! num_of_bytes_read) {
+            break;
+        }
+
+        /* add data to checksum while it is in cache */
+        copy_crc_update(buf, (size_t) num_of_bytes_read);
+
+        /* compute number of bytes to write */
+        size_t bytes_to_write = (size_t) num_of_bytes_read;
+
+        /* write bytes to destination file */
+        ssize_t num_of_bytes_written = mfu_write(dest, out_fd, buf, bytes_to_write);
+
+        /* check for an error */
+        if(num_of_bytes_written < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
+                src, dest, errno, strerror(errno));
+            rc = -1;
+            break;
+        }
+
+        /* check that we wrote the same number of bytes that we read */
+        if((size_t)num_of_bytes_written != bytes_to_write) {
+            MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
+                src, dest);
+            rc = -1;
+            break;
+        }
+
+        /* add bytes to our total (use bytes read,
+         * which may be less than number written) */
+        total_bytes += (size_t) num_of_bytes_read;
+
+        /* update number of bytes we have copied for progress messages */
+        copy_count += (uint64_t) num_of_bytes_read;
+        mfu_progress_update(&copy_count, copy_prog);
+        mfu_throttle_consume(&mfu_copy_bw_throttle, (uint64_t) num_of_bytes_read, copy_prog);
+
+        /* read ahead and drop pages we're done with */
+        copy_hint_advance((off_t)(offset + total_bytes));
+
+        /* source file ended early, nothing more to read */
+        if ((size_t) num_of_bytes_read < slot->size) {
+            break;
+        }
+
+        /* reuse this buffer to read the next block we don't have in flight */
+        if (next_read < blocks) {
+            uint64_t block_offset = next_read * (uint64_t) buf_size;
+            size_t bytes = (size_t) MIN((uint64_t) buf_size, length - block_offset);
+            mfu_copy_aio_issue(src, in_fd, slot, buf, (off_t)(offset + block_offset), bytes);
+            next_read++;
+        }
     }
 
-    size_t extents_size = sizeof(struct fiemap_extent) * (fiemap->fm_mapped_extents);
+    /* wait on any reads still outstanding */
+    mfu_copy_aio_drain(in_fd, slots, depth);
+    mfu_free(&slots);
 
-    if ((fiemap = (struct fiemap*)realloc(fiemap,sizeof(struct fiemap) +
-                                  extents_size)) == NULL)
-    {
-        MFU_LOG(MFU_LOG_ERR, "Out of memory reallocating fiemap");
-        goto fail_normal_copy;
+    /* bail out if we hit an error */
+    if (rc != 0) {
+        return rc;
+    }
+
+    /* Increment the global counter. */
+    mfu_copy_stats.total_size += (int64_t) total_bytes;
+    mfu_copy_stats.total_bytes_copied += (int64_t) total_bytes;
+
+    /* if we wrote the last chunk, truncate the file */
+    off_t last_written = offset + length;
+    off_t file_size_offt = (off_t) file_size;
+    if (last_written >= file_size_offt || file_size == 0) {
+        /* Use ftruncate() here rather than truncate(), because grouplock
+         * of Lustre would cause block to truncate() since the fd is different
+         * from the out_fd. */
+        if(mfu_ftruncate(out_fd, file_size_offt) < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                dest, errno, strerror(errno));
+            return -1;
+       }
+    }
+
+    /* we don't bother closing the file because our cache does it for us */
+
+    return 0;
+}
+
+/* copies a chunk of a file for a sparse copy, uses SEEK_DATA and
+ * SEEK_HOLE to find the regions of the chunk that hold data in the
+ * source and copies only those, skipping blocks of zeros within them,
+ * holes are left unwritten since the destination was truncated to 0
+ * bytes when it was created, and the process writing the end of the
+ * file extends the destination to the full file size in case it ends
+ * in a hole, sets normal_copy_required and returns -1 if the file
+ * system does not support SEEK_DATA, returns 0 on success and -1 on error */
+static int mfu_copy_file_sparse(
+    const char* src,
+    const char* dest,
+    const int in_fd,
+    const int out_fd,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    bool* normal_copy_required,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    *normal_copy_required = false;
+
+    /* get buffer */
+    size_t buf_size = mfu_copy_opts->block_size;
+    char* buf = (char*) mfu_copy_opts->block_buf1;
+
+    /* walk the data regions that overlap this chunk */
+    uint64_t total_written = 0;
+    uint64_t last_byte = offset + length;
+    uint64_t pos = offset;
+    while (pos < last_byte) {
+        /* find start of next data region */
+        off_t data = lseek(in_fd, (off_t)pos, SEEK_DATA);
+        if (data == (off_t)-1) {
+            if (errno == ENXIO) {
+                /* no data between pos and EOF, rest of chunk is a hole */
+                break;
+            }
+            if (pos == offset && (errno == EINVAL || errno == EOPNOTSUPP)) {
+                /* file system does not support SEEK_DATA,
+                 * fall back to detecting zero blocks */
+                *normal_copy_required = true;
+                return -1;
+            }
+            MFU_LOG(MFU_LOG_ERR, "Couldn't seek to data in source path `%s' (errno=%d %s)",
+                src, errno, strerror(errno));
+            return -1;
+        }
+        if ((uint64_t)data >= last_byte) {
+            /* next data region starts beyond this chunk */
+            break;
+        }
+
+        /* find end of this data region */
+        off_t hole = lseek(in_fd, data, SEEK_HOLE);
+        if (hole == (off_t)-1) {
+            MFU_LOG(MFU_LOG_ERR, "Couldn't seek to hole in source path `%s' (errno=%d %s)",
+                src, errno, strerror(errno));
+            return -1;
+        }
+        uint64_t data_end = MIN((uint64_t)hole, last_byte);
+
+        /* include hole before this data region in checksum */
+        copy_crc_zeros((uint64_t)data - pos);
+
+        /* copy data region, a block at a time */
+        uint64_t cur = (uint64_t)data;
+        while (cur < data_end) {
+            size_t bytes = (size_t) MIN((uint64_t)buf_size, data_end - cur);
+            ssize_t num_read = mfu_pread(src, in_fd, buf, bytes, (off_t)cur);
+            if (num_read < 0) {
+                MFU_LOG(MFU_LOG_ERR, "Read error when copying from `%s' to `%s' (errno=%d %s)",
+                    src, dest, errno, strerror(errno));
+                return -1;
+            }
+            if (num_read == 0) {
+                /* source file was truncated underneath us,
+                 * the rest of the destination chunk reads as zeros */
+                copy_crc_zeros(last_byte - cur);
+                data_end = last_byte;
+                break;
+            }
+
+            /* add data to checksum while it is in cache */
+            copy_crc_update(buf, (size_t)num_read);
+
+            /* data regions may still contain blocks of zeros,
+             * skip writing those as well */
+            if (! mfu_is_all_null(buf, (uint64_t)num_read)) {
+                ssize_t num_written = mfu_pwrite(dest, out_fd, buf, (size_t)num_read, (off_t)cur);
+                if (num_written < 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
+                        src, dest, errno, strerror(errno));
+                    return -1;
+                }
+                if (num_written != num_read) {
+                    MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
+                        src, dest);
+                    return -1;
+                }
+                total_written += (uint64_t)num_written;
+            }
+
+            cur += (uint64_t)num_read;
+        }
+
+        pos = data_end;
+    }
+
+    /* include hole at end of chunk in checksum */
+    copy_crc_zeros(last_byte - pos);
+
+    /* update number of bytes we have copied for progress messages,
+     * holes count as copied */
+    copy_count += length;
+    mfu_progress_update(&copy_count, copy_prog);
+    mfu_throttle_consume(&mfu_copy_bw_throttle, total_written, copy_prog);
+
+    /* Increment the global counter. */
+    mfu_copy_stats.total_size += (int64_t) length;
+    mfu_copy_stats.total_bytes_copied += (int64_t) total_written;
+
+    /* if we have the last chunk, set the file to its full size,
+     * since a hole at the end of the file is never written */
+    off_t file_size_offt = (off_t) file_size;
+    if ((off_t)last_byte >= file_size_offt || file_size == 0) {
+        /* Use ftruncate() here rather than truncate(), because grouplock
+         * of Lustre would cause block to truncate() since the fd is different
+         * from the out_fd. */
+        if (mfu_ftruncate(out_fd, file_size_offt) < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                dest, errno, strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* returns the alignment of file offsets and sizes that direct I/O
+ * requires on fd, as reported by statx when the kernel supports it */
+static size_t mfu_copy_dio_align(int fd)
+{
+    size_t align = FD_DIO_ALIGN;
+#ifdef STATX_DIOALIGN
+    struct statx stx;
+    if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 &&
+        (stx.stx_mask & STATX_DIOALIGN) && stx.stx_dio_offset_align > 0)
+    {
+        align = (size_t) stx.stx_dio_offset_align;
+    }
+#endif
+    return align;
+}
+
+/* turns O_DIRECT on or off for an open file,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_set_direct(const char* file, int fd, int direct)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to get file status flags: `%s' (errno=%d %s)",
+            file, errno, strerror(errno));
+        return -1;
+    }
+
+    int newflags = direct ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+    if (newflags != flags && fcntl(fd, F_SETFL, newflags) < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to set file status flags: `%s' (errno=%d %s)",
+            file, errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* copies bytes in the range [pos, stop) from source to destination
+ * a block at a time, when align is nonzero the files are open with
+ * O_DIRECT and pos and stop are multiples of align, a short read that
+ * leaves an unaligned block is written without O_DIRECT, blocks of
+ * zeros are skipped for sparse copies, sets eof if the source ends
+ * before stop, adds the number of bytes copied and written to copied
+ * and written, returns 0 on success and -1 on error */
+static int mfu_copy_direct_range(
+    const char* src,
+    const char* dest,
+    const int in_fd,
+    const int out_fd,
+    uint64_t pos,
+    uint64_t stop,
+    size_t align,
+    int* eof,
+    uint64_t* copied,
+    uint64_t* written,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    size_t buf_size = mfu_copy_opts->block_size;
+    char* buf = (char*) mfu_copy_opts->block_buf1;
+
+    while (pos < stop) {
+        size_t bytes = (size_t) MIN((uint64_t)buf_size, stop - pos);
+        ssize_t num_read = mfu_pread(src, in_fd, buf, bytes, (off_t)pos);
+        if (num_read < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Read error when copying from `%s' to `%s' (errno=%d %s)",
+                src, dest, errno, strerror(errno));
+            return -1;
+        }
+        if (num_read == 0) {
+            *eof = 1;
+            return 0;
+        }
+
+        /* add data to checksum while it is in cache */
+        copy_crc_update(buf, (size_t)num_read);
+
+        /* skip writing blocks of zeros for sparse copies */
+        if (! mfu_copy_opts->sparse || ! mfu_is_all_null(buf, (uint64_t)num_read)) {
+            /* O_DIRECT can't write a partial block left by a short read */
+            int unaligned = (align > 0 && (size_t)num_read % align != 0);
+            if (unaligned && mfu_copy_set_direct(dest, out_fd, 0) != 0) {
+                return -1;
+            }
+
+            ssize_t num_written = mfu_pwrite(dest, out_fd, buf, (size_t)num_read, (off_t)pos);
+            if (num_written < 0) {
+                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
+                    src, dest, errno, strerror(errno));
+                return -1;
+            }
+            if (num_written != num_read) {
+                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
+                    src, dest);
+                return -1;
+            }
+
+            if (unaligned && mfu_copy_set_direct(dest, out_fd, 1) != 0) {
+                return -1;
+            }
+            *written += (uint64_t)num_written;
+        }
+
+        pos += (uint64_t)num_read;
+        *copied += (uint64_t)num_read;
+
+        /* update number of bytes we have copied for progress messages */
+        copy_count += (uint64_t)num_read;
+        mfu_progress_update(&copy_count, copy_prog);
+        mfu_throttle_consume(&mfu_copy_bw_throttle, (uint64_t)num_read, copy_prog);
+
+        /* source file ended early */
+        if ((size_t)num_read < bytes) {
+            *eof = 1;
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+/* copies a chunk of a file with O_DIRECT, only data up to the end of
+ * the file is copied, the part of the chunk whose offsets are aligned
+ * for direct I/O is copied with O_DIRECT and any unaligned head or
+ * tail is copied through the page cache, for sparse copies SEEK_DATA
+ * is used to skip holes in the aligned part, and blocks of zeros are
+ * not written, returns 0 on success and -1 on error */
+static int mfu_copy_file_direct(
+    const char* src,
+    const char* dest,
+    const int in_fd,
+    const int out_fd,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* don't copy past the end of the file */
+    uint64_t end = offset + length;
+    if (end > file_size) {
+        end = file_size;
+    }
+
+    /* use the stricter alignment of the two files */
+    size_t align = mfu_copy_dio_align(in_fd);
+    size_t out_align = mfu_copy_dio_align(out_fd);
+    if (out_align > align) {
+        align = out_align;
+    }
+
+    /* find the part of the chunk we can copy with O_DIRECT, our buffer
+     * is aligned to 1MB, but its size must be a multiple of align */
+    uint64_t body_start = (offset + align - 1) / align * align;
+    uint64_t body_end   = end / align * align;
+    if (body_start >= body_end || mfu_copy_opts->block_size % align != 0) {
+        body_start = end;
+        body_end   = end;
+    }
+
+    int rc = 0;
+    int eof = 0;
+    uint64_t copied  = 0;
+    uint64_t written = 0;
+
+    /* copy unaligned head of the chunk through the page cache */
+    if (offset < body_start) {
+        if (mfu_copy_set_direct(src, in_fd, 0) != 0 ||
+            mfu_copy_set_direct(dest, out_fd, 0) != 0 ||
+            mfu_copy_direct_range(src, dest, in_fd, out_fd, offset, body_start,
+                0, &eof, &copied, &written, mfu_copy_opts) != 0 ||
+            mfu_copy_set_direct(src, in_fd, 1) != 0 ||
+            mfu_copy_set_direct(dest, out_fd, 1) != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* copy aligned body with O_DIRECT, one data region at a time */
+    uint64_t pos = body_start;
+    while (! eof && pos < body_end) {
+        uint64_t data = pos;
+        uint64_t data_end = body_end;
+        if (mfu_copy_opts->sparse) {
+            /* find next data region, treat the rest of the body
+             * as data if the file system does not support SEEK_DATA */
+            off_t next = lseek(in_fd, (off_t)pos, SEEK_DATA);
+            if (next == (off_t)-1 && errno == ENXIO) {
+                data = body_end;
+            } else if (next != (off_t)-1) {
+                off_t hole = lseek(in_fd, next, SEEK_HOLE);
+                data = MIN((uint64_t)next / align * align, body_end);
+                if (data < pos) {
+                    data = pos;
+                }
+                if (hole != (off_t)-1) {
+                    data_end = MIN(((uint64_t)hole + align - 1) / align * align, body_end);
+                }
+            }
+        }
+
+        /* include any hole we skipped in checksum and progress */
+        copy_crc_zeros(data - pos);
+        copy_count += data - pos;
+        copied     += data - pos;
+
+        if (mfu_copy_direct_range(src, dest, in_fd, out_fd, data, data_end,
+                align, &eof, &copied, &written, mfu_copy_opts) != 0)
+        {
+            return -1;
+        }
+        pos = data_end;
+    }
+
+    /* copy unaligned tail of the chunk through the page cache */
+    if (! eof && body_end < end) {
+        uint64_t tail = MAX(body_end, offset);
+        if (mfu_copy_set_direct(src, in_fd, 0) != 0 ||
+            mfu_copy_set_direct(dest, out_fd, 0) != 0)
+        {
+            return -1;
+        }
+        rc = mfu_copy_direct_range(src, dest, in_fd, out_fd, tail, end,
+                0, &eof, &copied, &written, mfu_copy_opts);
+        if (mfu_copy_set_direct(src, in_fd, 1) != 0 ||
+            mfu_copy_set_direct(dest, out_fd, 1) != 0)
+        {
+            rc = -1;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    /* source file was truncated underneath us,
+     * the rest of the destination chunk reads as zeros */
+    if (copied < end - offset) {
+        copy_crc_zeros(end - offset - copied);
+    }
+
+    /* Increment the global counter. */
+    mfu_copy_stats.total_size += (int64_t) (end - offset);
+    mfu_copy_stats.total_bytes_copied += (int64_t) written;
+
+    /* if we have the last chunk, set the file to its full size,
+     * which also extends it over a hole at the end of the file */
+    off_t file_size_offt = (off_t) file_size;
+    if ((off_t)(offset + length) >= file_size_offt || file_size == 0) {
+        /* Use ftruncate() here rather than truncate(), because grouplock
+         * of Lustre would cause block to truncate() since the fd is different
+         * from the out_fd. */
+        if (mfu_ftruncate(out_fd, file_size_offt) < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                dest, errno, strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* append an entry to a list of owner rank and index pairs */
+static void mfu_copy_owner_list_add(mfu_copy_owner_list_t* list,
+        uint64_t rank_of_owner, uint64_t index_of_owner)
+{
+    /* grow our arrays if needed */
+    if (list->count == list->max) {
+        uint64_t newmax = (list->max > 0) ? list->max * 2 : 64;
+        uint64_t* ranks   = (uint64_t*) MFU_MALLOC(newmax * sizeof(uint64_t));
+        uint64_t* indices = (uint64_t*) MFU_MALLOC(newmax * sizeof(uint64_t));
+        if (list->count > 0) {
+            memcpy(ranks,   list->ranks,   list->count * sizeof(uint64_t));
+            memcpy(indices, list->indices, list->count * sizeof(uint64_t));
+        }
+        mfu_free(&list->ranks);
+        mfu_free(&list->indices);
+        list->ranks   = ranks;
+        list->indices = indices;
+        list->max     = newmax;
+    }
+
+    list->ranks[list->count]   = rank_of_owner;
+    list->indices[list->count] = index_of_owner;
+    list->count++;
+}
+
+/* free memory held by a list of owner rank and index pairs */
+static void mfu_copy_owner_list_free(mfu_copy_owner_list_t* list)
+{
+    mfu_free(&list->ranks);
+    mfu_free(&list->indices);
+    list->count = 0;
+    list->max   = 0;
+}
+
+/* returns 1 if metadata can be set on the destination file descriptor
+ * by the process that copied the whole file, 0 otherwise */
+static int mfu_copy_meta_on_fd(const mfu_copy_opts_t* mfu_copy_opts)
+{
+#ifdef GPFS_SUPPORT
+    /* GPFS ACLs are copied by path from the source item,
+     * so leave those files to mfu_copy_set_metadata */
+    if (mfu_copy_opts->preserve) {
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+/* set ownership and permissions on an open destination file from the
+ * attributes recorded for its source in the list, and copy its ACLs
+ * if preserving, timestamps are left for mfu_copy_set_timestamps after
+ * data has been synced, extended attributes were set when the file was
+ * created, returns 0 on success and -1 on error */
+static int mfu_copy_set_metadata_fd(mfu_flist list, uint64_t idx,
+        const char* dest, int out_fd, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    if (mfu_copy_opts->preserve) {
+        uid_t uid = (uid_t) mfu_flist_file_get_uid(list, idx);
+        gid_t gid = (gid_t) mfu_flist_file_get_gid(list, idx);
+        if (fchown(out_fd, uid, gid) != 0) {
+            /* as in mfu_copy_ownership, the user running dcp may not
+             * be able to change the owner, don't report EPERM */
+            if (errno != EPERM) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to change ownership on `%s' fchown() (errno=%d %s)",
+                    dest, errno, strerror(errno));
+                rc = -1;
+            }
+        }
+    }
+
+    /* set permissions after ownership, since changing the owner
+     * may clear setuid and setgid bits */
+    mode_t mode = (mode_t) mfu_flist_file_get_mode(list, idx);
+    if (fchmod(out_fd, mode & 07777) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' fchmod() (errno=%d %s)",
+            dest, errno, strerror(errno));
+        rc = -1;
+    }
+
+    if (mfu_copy_opts->preserve) {
+        if (mfu_copy_acls(list, idx, dest) < 0) {
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
+
+/****************************************
+ * Journal completed chunks for resume
+ ***************************************/
+
+/* Each process appends a record to its own file in the journal
+ * directory for each chunk it copies.  Records are held in memory
+ * until a checkpoint, which flushes the data they describe to disk
+ * and then writes, flushes, and syncs the records, so the journal
+ * never names data that is not on disk.  A record holds the size and
+ * modification time the source had when it was copied, the offset and
+ * length of the chunk, and the source path, prefixed by its length so
+ * names may hold any byte:
+ *
+ *   <size> <mtime> <mtime_nsec> <offset> <length> <namelen> <name>\n
+ *
+ * When resuming, records are sent to the process selected by a hash
+ * of the source path, along with the current size and modification
+ * time of each source file in the list.  That process merges the
+ * records of unchanged files into ranges of completed bytes, which
+ * are then used to skip chunks that were copied by an earlier run. */
+
+#define MFU_COPY_JOURNAL_PREFIX "dcp."
+#define MFU_COPY_JOURNAL_SUFFIX ".journal"
+
+/* kinds of entries exchanged when resuming */
+#define MFU_COPY_JOURNAL_FILE  (0) /* current attributes of a source file */
+#define MFU_COPY_JOURNAL_CHUNK (1) /* chunk recorded in a journal */
+#define MFU_COPY_JOURNAL_QUERY (2) /* chunk we want to know whether to skip */
+#define MFU_COPY_JOURNAL_STARTED (3) /* file we want to know whether any chunk was recorded */
+
+/* seconds between checkpoints of the journal while copying */
+#define MFU_COPY_JOURNAL_INTERVAL (30.0)
+
+/* journal file this process appends to, NULL if not journaling */
+static FILE* mfu_copy_journal;
+
+/* records not yet written to the journal, and time of last checkpoint */
+static char* mfu_copy_journal_pending;
+static size_t mfu_copy_journal_pending_len;
+static size_t mfu_copy_journal_pending_max;
+static double mfu_copy_journal_last;
+
+typedef struct {
+    uint64_t kind;       /* one of the MFU_COPY_JOURNAL values above */
+    uint64_t size;       /* size of source file */
+    uint64_t mtime;      /* modification time of source file */
+    uint64_t mtime_nsec; /* nanoseconds of modification time */
+    uint64_t offset;     /* starting byte offset of chunk */
+    uint64_t length;     /* length of chunk in bytes */
+    const char* name;    /* full path to source file */
+} mfu_copy_journal_entry_t;
+
+/* completed range of bytes in a source file */
+typedef struct {
+    const char* name; /* full path to source file */
+    uint64_t start;   /* offset of first completed byte */
+    uint64_t end;     /* offset one past the last completed byte */
+} mfu_copy_journal_range_t;
+
+/* ranges held by this process when resuming sorted by name and then
+ * by start, names point into the buffer the entries were received in */
+static mfu_copy_journal_range_t* mfu_copy_journal_ranges;
+static uint64_t mfu_copy_journal_ranges_count;
+static char* mfu_copy_journal_ranges_buf;
+
+/* stop journaling after an error, a later resume
+ * will copy the chunks we did not record again */
+static void mfu_copy_journal_abandon(void)
+{
+    MFU_LOG(MFU_LOG_ERR, "Failed to write to journal, no longer recording completed chunks (errno=%d %s)",
+        errno, strerror(errno));
+    fclose(mfu_copy_journal);
+    mfu_copy_journal = NULL;
+    mfu_copy_journal_pending_len = 0;
+}
+
+/* flush data written by this process to disk, and then write our
+ * pending records to the journal and sync it */
+static void mfu_copy_journal_checkpoint(void)
+{
+    if (mfu_copy_journal == NULL || mfu_copy_journal_pending_len == 0) {
+        return;
+    }
+
+    /* data must reach disk before the records that describe it */
+    sync();
+
+    size_t len = mfu_copy_journal_pending_len;
+    if (fwrite(mfu_copy_journal_pending, 1, len, mfu_copy_journal) != len ||
+        fflush(mfu_copy_journal) != 0 ||
+        fsync(fileno(mfu_copy_journal)) != 0)
+    {
+        mfu_copy_journal_abandon();
+        return;
+    }
+
+    mfu_copy_journal_pending_len = 0;
+    mfu_copy_journal_last = MPI_Wtime();
+}
+
+/* add a record for a copied chunk to those we will write at the next
+ * checkpoint, taking a checkpoint if it has been a while since the
+ * last one, st holds the attributes of the source from before the
+ * chunk was read */
+static void mfu_copy_journal_add(const char* src, const struct stat* st,
+        uint64_t offset, uint64_t length)
+{
+    /* format record at the end of our pending records,
+     * growing the buffer if it does not fit */
+    while (1) {
+        size_t avail = mfu_copy_journal_pending_max - mfu_copy_journal_pending_len;
+        int n = snprintf(mfu_copy_journal_pending + mfu_copy_journal_pending_len, avail,
+            "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %zu %s\n",
+            (uint64_t) st->st_size, (uint64_t) st->st_mtim.tv_sec,
+            (uint64_t) st->st_mtim.tv_nsec, offset, length, strlen(src), src);
+        if (n < 0) {
+            mfu_copy_journal_abandon();
+            return;
+        }
+        if ((size_t)n < avail) {
+            mfu_copy_journal_pending_len += (size_t)n;
+            break;
+        }
+
+        size_t newmax = mfu_copy_journal_pending_max * 2;
+        if (newmax < mfu_copy_journal_pending_len + (size_t)n + 1) {
+            newmax = mfu_copy_journal_pending_len + (size_t)n + 1;
+        }
+        char* buf = (char*) MFU_MALLOC(newmax);
+        if (mfu_copy_journal_pending_len > 0) {
+            memcpy(buf, mfu_copy_journal_pending, mfu_copy_journal_pending_len);
+        }
+        mfu_free(&mfu_copy_journal_pending);
+        mfu_copy_journal_pending = buf;
+        mfu_copy_journal_pending_max = newmax;
+    }
+
+    if (MPI_Wtime() - mfu_copy_journal_last >= MFU_COPY_JOURNAL_INTERVAL) {
+        mfu_copy_journal_checkpoint();
+    }
+}
+
+/* returns 1 if name is that of a journal file, 0 otherwise */
+static int mfu_copy_journal_is_file(const char* name)
+{
+    size_t len    = strlen(name);
+    size_t prefix = strlen(MFU_COPY_JOURNAL_PREFIX);
+    size_t suffix = strlen(MFU_COPY_JOURNAL_SUFFIX);
+    if (len <= prefix + suffix) {
+        return 0;
+    }
+    if (strncmp(name, MFU_COPY_JOURNAL_PREFIX, prefix) != 0) {
+        return 0;
+    }
+    if (strcmp(name + len - suffix, MFU_COPY_JOURNAL_SUFFIX) != 0) {
+        return 0;
+    }
+    return 1;
+}
+
+/* append entry to array, growing it as needed */
+static void mfu_copy_journal_entry_add(mfu_copy_journal_entry_t** pentries,
+        uint64_t* pcount, uint64_t* pmax, const mfu_copy_journal_entry_t* entry)
+{
+    if (*pcount == *pmax) {
+        uint64_t newmax = (*pmax > 0) ? *pmax * 2 : 1024;
+        mfu_copy_journal_entry_t* entries = (mfu_copy_journal_entry_t*) MFU_MALLOC(
+            newmax * sizeof(mfu_copy_journal_entry_t));
+        if (*pcount > 0) {
+            memcpy(entries, *pentries, *pcount * sizeof(mfu_copy_journal_entry_t));
+        }
+        mfu_free(pentries);
+        *pentries = entries;
+        *pmax     = newmax;
+    }
+    (*pentries)[*pcount] = *entry;
+    (*pcount)++;
+}
+
+/* read records from journal file at path and append them to entries,
+ * reading stops at the first incomplete record, which is expected
+ * when the run that wrote the journal was interrupted */
+static void mfu_copy_journal_read(const char* path,
+        mfu_copy_journal_entry_t** pentries, uint64_t* pcount, uint64_t* pmax)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open journal `%s' (errno=%d %s)",
+            path, errno, strerror(errno));
+        return;
+    }
+
+    while (1) {
+        mfu_copy_journal_entry_t entry;
+        size_t namelen;
+        int n = fscanf(fp, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %zu",
+            &entry.size, &entry.mtime, &entry.mtime_nsec,
+            &entry.offset, &entry.length, &namelen);
+        if (n != 6 || fgetc(fp) != ' ' || namelen == 0 || namelen > PATH_MAX) {
+            break;
+        }
+
+        char* name = (char*) MFU_MALLOC(namelen + 1);
+        if (fread(name, 1, namelen, fp) != namelen || fgetc(fp) != '\n') {
+            mfu_free(&name);
+            break;
+        }
+        name[namelen] = '\0';
+
+        entry.kind = MFU_COPY_JOURNAL_CHUNK;
+        entry.name = name;
+        mfu_copy_journal_entry_add(pentries, pcount, pmax, &entry);
+    }
+
+    fclose(fp);
+}
+
+/* sends each entry to the process selected by a hash of its name,
+ * returns an array of the entries we receive, whose names point into
+ * the buffer returned in pbuf, the number of entries sent to and
+ * received from each process are returned in send_entries and
+ * recv_entries, which must have space for one value per process */
+static mfu_copy_journal_entry_t* mfu_copy_journal_exchange(
+        const mfu_copy_journal_entry_t* entries, uint64_t count,
+        char** pbuf, uint64_t* pcount, int* send_entries, int* recv_entries)
+{
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* each entry is packed as six 64-bit values and a NUL-terminated name */
+    size_t entry_size = 6 * 8;
+
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets    = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* dests      = (int*) MFU_MALLOC(count * sizeof(int));
+    int r;
+    for (r = 0; r < ranks; r++) {
+        sendcounts[r]   = 0;
+        send_entries[r] = 0;
+    }
+
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        const char* name = entries[i].name;
+        size_t len = strlen(name);
+        dests[i] = (int) (mfu_hash_jenkins(name, len) % (uint32_t) ranks);
+        sendcounts[dests[i]] += (int)(entry_size + len + 1);
+        send_entries[dests[i]]++;
+    }
+
+    int sendbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        senddisps[r] = sendbytes;
+        offsets[r]   = sendbytes;
+        sendbytes += sendcounts[r];
+    }
+
+    /* pack entries in order, grouped by destination */
+    char* sendbuf = (char*) MFU_MALLOC((size_t)sendbytes);
+    for (i = 0; i < count; i++) {
+        const mfu_copy_journal_entry_t* e = &entries[i];
+        char* ptr = sendbuf + offsets[dests[i]];
+        mfu_pack_uint64(&ptr, e->kind);
+        mfu_pack_uint64(&ptr, e->size);
+        mfu_pack_uint64(&ptr, e->mtime);
+        mfu_pack_uint64(&ptr, e->mtime_nsec);
+        mfu_pack_uint64(&ptr, e->offset);
+        mfu_pack_uint64(&ptr, e->length);
+        strcpy(ptr, e->name);
+        ptr += strlen(e->name) + 1;
+        offsets[dests[i]] = (int)(ptr - sendbuf);
+    }
+
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    int recvbytes = 0;
+    for (r = 0; r < ranks; r++) {
+        recvdisps[r] = recvbytes;
+        recvbytes += recvcounts[r];
+    }
+    char* recvbuf = (char*) MFU_MALLOC((size_t)recvbytes);
+
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_CHAR,
+        recvbuf, recvcounts, recvdisps, MPI_CHAR, MPI_COMM_WORLD
+    );
+
+    /* unpack entries, counting the number that came from each process */
+    mfu_copy_journal_entry_t* recv = NULL;
+    uint64_t recv_count = 0;
+    uint64_t recv_max = 0;
+    for (r = 0; r < ranks; r++) {
+        recv_entries[r] = 0;
+        const char* ptr = recvbuf + recvdisps[r];
+        const char* end = ptr + recvcounts[r];
+        while (ptr < end) {
+            mfu_copy_journal_entry_t e;
+            mfu_unpack_uint64(&ptr, &e.kind);
+            mfu_unpack_uint64(&ptr, &e.size);
+            mfu_unpack_uint64(&ptr, &e.mtime);
+            mfu_unpack_uint64(&ptr, &e.mtime_nsec);
+            mfu_unpack_uint64(&ptr, &e.offset);
+            mfu_unpack_uint64(&ptr, &e.length);
+            e.name = ptr;
+            ptr += strlen(ptr) + 1;
+            mfu_copy_journal_entry_add(&recv, &recv_count, &recv_max, &e);
+            recv_entries[r]++;
+        }
+    }
+
+    mfu_free(&sendbuf);
+    mfu_free(&dests);
+    mfu_free(&offsets);
+    mfu_free(&recvdisps);
+    mfu_free(&recvcounts);
+    mfu_free(&senddisps);
+    mfu_free(&sendcounts);
+
+    *pbuf   = recvbuf;
+    *pcount = recv_count;
+    return recv;
+}
+
+/* orders entries by name, then file attributes before chunks,
+ * and then chunks by offset */
+static int mfu_copy_journal_compare(const void* a, const void* b)
+{
+    const mfu_copy_journal_entry_t* e1 = (const mfu_copy_journal_entry_t*) a;
+    const mfu_copy_journal_entry_t* e2 = (const mfu_copy_journal_entry_t*) b;
+    int cmp = strcmp(e1->name, e2->name);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (e1->kind != e2->kind) {
+        return (e1->kind < e2->kind) ? -1 : 1;
+    }
+    if (e1->offset != e2->offset) {
+        return (e1->offset < e2->offset) ? -1 : 1;
+    }
+    return 0;
+}
+
+/* given entries sorted with mfu_copy_journal_compare, merge chunks
+ * of files whose size and modification time match the current
+ * attributes of the source into ranges of completed bytes */
+static void mfu_copy_journal_merge(const mfu_copy_journal_entry_t* entries,
+        uint64_t count)
+{
+    mfu_copy_journal_ranges = (mfu_copy_journal_range_t*) MFU_MALLOC(
+        count * sizeof(mfu_copy_journal_range_t));
+    mfu_copy_journal_ranges_count = 0;
+
+    const mfu_copy_journal_entry_t* file = NULL;
+    mfu_copy_journal_range_t* range = NULL;
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        const mfu_copy_journal_entry_t* e = &entries[i];
+
+        /* the attributes of a file come before its chunks */
+        if (e->kind == MFU_COPY_JOURNAL_FILE) {
+            file  = e;
+            range = NULL;
+            continue;
+        }
+
+        /* skip chunks of files that are no longer in the list,
+         * and chunks copied before the file was last changed */
+        if (file == NULL || strcmp(file->name, e->name) != 0) {
+            continue;
+        }
+        if (file->size  != e->size  ||
+            file->mtime != e->mtime ||
+            file->mtime_nsec != e->mtime_nsec)
+        {
+            continue;
+        }
+
+        /* chunks are sorted by offset, so extend the current range
+         * if this chunk overlaps or follows it, else start a new one */
+        uint64_t end = e->offset + e->length;
+        if (range != NULL && e->offset <= range->end) {
+            if (end > range->end) {
+                range->end = end;
+            }
+        } else {
+            range = &mfu_copy_journal_ranges[mfu_copy_journal_ranges_count];
+            range->name  = e->name;
+            range->start = e->offset;
+            range->end   = end;
+            mfu_copy_journal_ranges_count++;
+        }
+    }
+}
+
+/* returns 1 if the given section of a file is within a completed range */
+static int mfu_copy_journal_covered(const char* name, uint64_t offset, uint64_t length)
+{
+    /* find the last range that starts at or before offset */
+    int64_t found = -1;
+    int64_t low   = 0;
+    int64_t high  = (int64_t) mfu_copy_journal_ranges_count - 1;
+    while (low <= high) {
+        int64_t mid = (low + high) / 2;
+        const mfu_copy_journal_range_t* range = &mfu_copy_journal_ranges[mid];
+        int cmp = strcmp(range->name, name);
+        if (cmp < 0 || (cmp == 0 && range->start <= offset)) {
+            found = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    if (found < 0) {
+        return 0;
+    }
+    const mfu_copy_journal_range_t* range = &mfu_copy_journal_ranges[found];
+    return (strcmp(range->name, name) == 0 && range->end >= offset + length);
+}
+
+/* returns 1 if any completed range belongs to the given file */
+static int mfu_copy_journal_started(const char* name)
+{
+    /* find the first range whose name is not before name */
+    uint64_t low  = 0;
+    uint64_t high = mfu_copy_journal_ranges_count;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (strcmp(mfu_copy_journal_ranges[mid].name, name) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return (low < mfu_copy_journal_ranges_count &&
+            strcmp(mfu_copy_journal_ranges[low].name, name) == 0);
+}
+
+/* send each query to the process holding the ranges of its file,
+ * and set done to the answer to each, which is whether the chunk is
+ * completed for MFU_COPY_JOURNAL_QUERY and whether any chunk of the
+ * file is completed for MFU_COPY_JOURNAL_STARTED */
+static void mfu_copy_journal_ask(const mfu_copy_journal_entry_t* queries,
+        uint64_t count, int* done)
+{
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* send queries to the processes holding the ranges of each file */
+    int* send_entries = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recv_entries = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    char* buf;
+    uint64_t recv_count;
+    mfu_copy_journal_entry_t* recv = mfu_copy_journal_exchange(queries, count,
+        &buf, &recv_count, send_entries, recv_entries);
+
+    /* answer each query we received, in the order we received them */
+    char* answers = (char*) MFU_MALLOC(recv_count);
+    uint64_t i;
+    for (i = 0; i < recv_count; i++) {
+        if (recv[i].kind == MFU_COPY_JOURNAL_STARTED) {
+            answers[i] = (char) mfu_copy_journal_started(recv[i].name);
+        } else {
+            answers[i] = (char) mfu_copy_journal_covered(recv[i].name,
+                recv[i].offset, recv[i].length);
+        }
+    }
+
+    /* return answers to the processes that asked */
+    int* senddisps = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets   = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int r;
+    int disp = 0;
+    for (r = 0; r < ranks; r++) {
+        recvdisps[r] = disp;
+        disp += recv_entries[r];
+    }
+    disp = 0;
+    for (r = 0; r < ranks; r++) {
+        senddisps[r] = disp;
+        offsets[r]   = disp;
+        disp += send_entries[r];
+    }
+    char* replies = (char*) MFU_MALLOC(count);
+    MPI_Alltoallv(
+        answers, recv_entries, recvdisps, MPI_CHAR,
+        replies, send_entries, senddisps, MPI_CHAR, MPI_COMM_WORLD
+    );
+
+    /* replies from each process are in the order we sent our queries,
+     * walk queries in the same order to find the reply to each */
+    for (i = 0; i < count; i++) {
+        const char* name = queries[i].name;
+        r = (int) (mfu_hash_jenkins(name, strlen(name)) % (uint32_t) ranks);
+        done[i] = (int) replies[offsets[r]];
+        offsets[r]++;
+    }
+
+    mfu_free(&replies);
+    mfu_free(&offsets);
+    mfu_free(&recvdisps);
+    mfu_free(&senddisps);
+    mfu_free(&answers);
+    mfu_free(&recv);
+    mfu_free(&buf);
+    mfu_free(&recv_entries);
+    mfu_free(&send_entries);
+}
+
+/* with sparse copies, holes and blocks of zeros are not written, so
+ * truncate each destination file no journal record covers, as it may
+ * hold data from before the copy or from an older version of its source,
+ * files with records were truncated by the run that wrote them */
+static void mfu_copy_journal_truncate(mfu_flist list,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* ask whether each of our regular files was started */
+    uint64_t size = mfu_flist_size(list);
+    mfu_copy_journal_entry_t* queries = NULL;
+    uint64_t* indices = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t count = 0;
+    uint64_t max = 0;
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(list, idx) != MFU_TYPE_FILE) {
+            continue;
+        }
+        mfu_copy_journal_entry_t q;
+        memset(&q, 0, sizeof(q));
+        q.kind = MFU_COPY_JOURNAL_STARTED;
+        q.name = mfu_flist_file_get_name(list, idx);
+        mfu_copy_journal_entry_add(&queries, &count, &max, &q);
+        indices[count - 1] = idx;
+    }
+    int* done = (int*) MFU_MALLOC(count * sizeof(int));
+    mfu_copy_journal_ask(queries, count, done);
+
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        if (done[i]) {
+            continue;
+        }
+
+        const char* name = mfu_flist_file_get_name(list, indices[i]);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, mfu_copy_opts);
+        if (dest == NULL) {
+            continue;
+        }
+        if (mfu_truncate(dest, 0) != 0 && errno != ENOENT) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: `%s' (errno=%d %s)",
+                dest, errno, strerror(errno));
+        }
+        mfu_free(&dest);
+    }
+
+    mfu_free(&done);
+    mfu_free(&indices);
+    mfu_free(&queries);
+}
+
+/* open our journal file, when resuming, first read the journals in
+ * the journal directory and determine which parts of the regular
+ * files in list were completed, otherwise delete old journal files,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_journal_open(mfu_flist list,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    int rc = 0;
+
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    const char* dir = mfu_copy_opts->journal_dir;
+
+    if (mfu_copy_opts->resume) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Reading journals in `%s'", dir);
+        }
+
+        mfu_copy_journal_entry_t* entries = NULL;
+        uint64_t count = 0;
+        uint64_t max = 0;
+
+        /* read the journal files that hash to us, the number of
+         * journals depends on the number of processes of the run
+         * that wrote them, which may differ from ours */
+        DIR* dirp = opendir(dir);
+        if (dirp == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open journal directory `%s' (errno=%d %s)",
+                dir, errno, strerror(errno));
+            rc = -1;
+        } else {
+            struct dirent* de;
+            while ((de = readdir(dirp)) != NULL) {
+                const char* name = de->d_name;
+                if (! mfu_copy_journal_is_file(name)) {
+                    continue;
+                }
+                uint32_t hash = mfu_hash_jenkins(name, strlen(name));
+                if ((int) (hash % (uint32_t) ranks) != rank) {
+                    continue;
+                }
+                mfu_path* p = mfu_path_from_str(dir);
+                mfu_path_append_str(p, name);
+                char* file = mfu_path_strdup(p);
+                mfu_copy_journal_read(file, &entries, &count, &max);
+                mfu_free(&file);
+                mfu_path_delete(&p);
+            }
+            closedir(dirp);
+        }
+
+        /* add the current attributes of each regular file in our list */
+        uint64_t idx;
+        uint64_t size = mfu_flist_size(list);
+        for (idx = 0; idx < size; idx++) {
+            if (mfu_flist_file_get_type(list, idx) != MFU_TYPE_FILE) {
+                continue;
+            }
+            mfu_copy_journal_entry_t entry;
+            entry.kind       = MFU_COPY_JOURNAL_FILE;
+            entry.size       = mfu_flist_file_get_size(list, idx);
+            entry.mtime      = mfu_flist_file_get_mtime(list, idx);
+            entry.mtime_nsec = mfu_flist_file_get_mtime_nsec(list, idx);
+            entry.offset     = 0;
+            entry.length     = 0;
+            entry.name       = mfu_flist_file_get_name(list, idx);
+            mfu_copy_journal_entry_add(&entries, &count, &max, &entry);
+        }
+
+        /* send records and file attributes to the process
+         * responsible for each file */
+        int* send_entries = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+        int* recv_entries = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+        uint64_t recv_count;
+        mfu_copy_journal_entry_t* recv = mfu_copy_journal_exchange(entries, count,
+            &mfu_copy_journal_ranges_buf, &recv_count, send_entries, recv_entries);
+
+        /* free the names we read from journals */
+        uint64_t i;
+        for (i = 0; i < count; i++) {
+            if (entries[i].kind == MFU_COPY_JOURNAL_CHUNK) {
+                mfu_free(&entries[i].name);
+            }
+        }
+        mfu_free(&entries);
+
+        /* build ranges of completed bytes for unchanged files */
+        qsort(recv, (size_t)recv_count, sizeof(mfu_copy_journal_entry_t),
+            mfu_copy_journal_compare);
+        mfu_copy_journal_merge(recv, recv_count);
+
+        mfu_free(&recv);
+        mfu_free(&recv_entries);
+        mfu_free(&send_entries);
+
+        /* clear out files we will copy from the start */
+        if (mfu_copy_opts->sparse) {
+            mfu_copy_journal_truncate(list, numpaths, paths, destpath, mfu_copy_opts);
+        }
+    } else {
+        /* create the journal directory if needed, and remove journals
+         * of earlier runs, which may have used more processes than we have */
+        if (rank == 0) {
+            if (mfu_mkdir(dir, DCOPY_DEF_PERMS_DIR) != 0 && errno != EEXIST) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to create journal directory `%s' (errno=%d %s)",
+                    dir, errno, strerror(errno));
+            }
+
+            DIR* dirp = opendir(dir);
+            if (dirp != NULL) {
+                struct dirent* de;
+                while ((de = readdir(dirp)) != NULL) {
+                    if (! mfu_copy_journal_is_file(de->d_name)) {
+                        continue;
+                    }
+                    mfu_path* p = mfu_path_from_str(dir);
+                    mfu_path_append_str(p, de->d_name);
+                    char* file = mfu_path_strdup(p);
+                    if (mfu_unlink(file) != 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to remove journal `%s' (errno=%d %s)",
+                            file, errno, strerror(errno));
+                    }
+                    mfu_free(&file);
+                    mfu_path_delete(&p);
+                }
+                closedir(dirp);
+            }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    /* open our journal, appending to it if we are resuming so
+     * another interruption does not lose earlier records */
+    char name[64];
+    snprintf(name, sizeof(name), "%s%d%s",
+        MFU_COPY_JOURNAL_PREFIX, rank, MFU_COPY_JOURNAL_SUFFIX);
+    mfu_path* p = mfu_path_from_str(dir);
+    mfu_path_append_str(p, name);
+    char* file = mfu_path_strdup(p);
+    mfu_copy_journal = fopen(file, mfu_copy_opts->resume ? "a" : "w");
+    if (mfu_copy_journal == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open journal `%s' (errno=%d %s)",
+            file, errno, strerror(errno));
+        rc = -1;
+    }
+    mfu_copy_journal_pending_len = 0;
+    mfu_copy_journal_last = MPI_Wtime();
+    mfu_free(&file);
+    mfu_path_delete(&p);
+
+    return rc;
+}
+
+/* close our journal and free ranges read when resuming */
+static void mfu_copy_journal_close(void)
+{
+    /* record chunks copied since the last checkpoint */
+    mfu_copy_journal_checkpoint();
+
+    if (mfu_copy_journal != NULL) {
+        if (fclose(mfu_copy_journal) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to close journal (errno=%d %s)",
+                errno, strerror(errno));
+        }
+        mfu_copy_journal = NULL;
+    }
+
+    mfu_free(&mfu_copy_journal_pending);
+    mfu_copy_journal_pending_len = 0;
+    mfu_copy_journal_pending_max = 0;
+
+    mfu_free(&mfu_copy_journal_ranges);
+    mfu_free(&mfu_copy_journal_ranges_buf);
+    mfu_copy_journal_ranges_count = 0;
+}
+
+/* when resuming, determine which small files in list and which
+ * chunks in our chunk list were completed by an earlier run,
+ * removes completed chunks from the chunk list and sets flags in
+ * small_done for completed small files, which must have one
+ * element per item in list */
+static void mfu_copy_journal_skip(mfu_flist list, mfu_file_chunk** phead,
+        int* small_done, mfu_copy_opts_t* mfu_copy_opts)
+{
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* build queries for our small files and chunks */
+    mfu_copy_journal_entry_t* queries = NULL;
+    uint64_t count = 0;
+    uint64_t max = 0;
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        small_done[idx] = 0;
+        if (mfu_copy_is_small_file(list, idx, mfu_copy_opts)) {
+            mfu_copy_journal_entry_t q;
+            memset(&q, 0, sizeof(q));
+            q.kind   = MFU_COPY_JOURNAL_QUERY;
+            q.offset = 0;
+            q.length = mfu_flist_file_get_size(list, idx);
+            q.name   = mfu_flist_file_get_name(list, idx);
+            mfu_copy_journal_entry_add(&queries, &count, &max, &q);
+        }
+    }
+    uint64_t small_count = count;
+
+    const mfu_file_chunk* p;
+    for (p = *phead; p != NULL; p = p->next) {
+        mfu_copy_journal_entry_t q;
+        memset(&q, 0, sizeof(q));
+        q.kind   = MFU_COPY_JOURNAL_QUERY;
+        q.offset = p->offset;
+        q.length = p->length;
+        q.name   = p->name;
+        mfu_copy_journal_entry_add(&queries, &count, &max, &q);
+    }
+
+    /* find which of them were completed */
+    int* done = (int*) MFU_MALLOC(count * sizeof(int));
+    mfu_copy_journal_ask(queries, count, done);
+
+    /* mark completed small files */
+    uint64_t skipped = 0;
+    uint64_t i = 0;
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_copy_is_small_file(list, idx, mfu_copy_opts)) {
+            if (done[i]) {
+                small_done[idx] = 1;
+                skipped += queries[i].length;
+            }
+            i++;
+        }
+    }
+
+    /* remove completed chunks from our chunk list, the list is one
+     * block with elements in order, so move those we keep to the
+     * front of the block, which must stay where it is to be freed */
+    mfu_file_chunk* head = *phead;
+    uint64_t kept = 0;
+    for (i = small_count; i < count; i++) {
+        mfu_file_chunk* elem = &head[i - small_count];
+        if (done[i]) {
+            skipped += elem->length;
+            continue;
+        }
+        if (kept > 0) {
+            head[kept - 1].next = &head[kept];
+        }
+        head[kept] = *elem;
+        head[kept].next = NULL;
+        kept++;
+    }
+    if (kept == 0) {
+        mfu_file_chunk_list_free(phead);
+    }
+
+    /* report amount of data we won't copy again */
+    uint64_t total_skipped;
+    MPI_Reduce(&skipped, &total_skipped, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        double size_tmp;
+        const char* size_units;
+        mfu_format_bytes(total_skipped, &size_tmp, &size_units);
+        MFU_LOG(MFU_LOG_INFO, "Resuming, skipping %.3lf %s copied by earlier run",
+            size_tmp, size_units);
+    }
+
+    mfu_free(&done);
+    mfu_free(&queries);
+}
+
+/* copy a section of a file, if the section covers the whole file and
+ * list is not NULL, also set ownership and permissions on the
+ * destination from item idx of list while it is open and set meta_set
+ * to 1, returns 0 on success and -1 on error */
+static int mfu_copy_file(
+    const char* src,
+    const char* dest,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_flist list,
+    uint64_t idx,
+    int* meta_set,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    int ret;
+    bool normal_copy_required = true;
+
+    /* assume we won't set metadata */
+    *meta_set = 0;
+
+    /* start a new checksum for this section */
+    copy_crc_reset();
+
+    /* open the input file */
+    int in_fd = mfu_copy_open_file(src, 1, mfu_copy_opts);
+    if (in_fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
+            src, errno, strerror(errno));
+        return -1;
+    }
+
+    /* open the output file */
+    int out_fd = mfu_copy_open_file(dest, 0, mfu_copy_opts);
+    if (out_fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        return -1;
+    }
+
+    /* if we're copying the whole file, no other process writes to it,
+     * so we can set its metadata when we're done */
+    int whole_file = (list != NULL && offset == 0 && length >= file_size &&
+                      mfu_copy_meta_on_fd(mfu_copy_opts));
+
+    /* the journal records source attributes to detect changes on
+     * resume, get them before reading so the access time is not changed */
+    struct stat st;
+    int have_st = 0;
+    if (mfu_copy_journal != NULL) {
+        have_st = (fstat(in_fd, &st) == 0);
+    }
+
+    /* read the source and write the destination sequentially,
+     * with O_DIRECT the data does not go through the page cache */
+    copy_hints = (mfu_io_cache_window > 0 && ! mfu_copy_opts->synchronous);
+    if (copy_hints) {
+        mfu_cache_hint_start(&copy_src_hint, in_fd, 0, (off_t)offset, (off_t)length);
+        mfu_cache_hint_start(&copy_dst_hint, out_fd, 1, (off_t)offset, (off_t)length);
+    }
+
+    if (mfu_copy_opts->synchronous) {
+        /* O_DIRECT needs aligned I/O, which handles sparse files itself */
+        ret = mfu_copy_file_direct(src, dest, in_fd, out_fd,
+                offset, length, file_size, mfu_copy_opts);
+        normal_copy_required = false;
+    } else if (mfu_copy_opts->sparse) {
+        ret = mfu_copy_file_sparse(src, dest, in_fd, out_fd, offset,
+                               length, file_size,
+                               &normal_copy_required, mfu_copy_opts);
+    }
+
+    if (normal_copy_required) {
+        /* discard anything the sparse path added before it gave up */
+        copy_crc_reset();
+
+        if (mfu_copy_opts->io_depth > 1 && ! mfu_copy_opts->sparse) {
+            /* overlap reads with writes if we have more than one buffer,
+             * the normal path detects blocks of zeros for sparse copies
+             * when the file system does not support SEEK_DATA */
+            ret = mfu_copy_file_async(src, dest, in_fd, out_fd,
+                    offset, length, file_size, mfu_copy_opts);
+        } else {
+            ret = mfu_copy_file_normal(src, dest, in_fd, out_fd,
+                    offset, length, file_size, mfu_copy_opts);
+        }
+    }
+
+    /* drop what's left of the chunk from the page cache,
+     * this also flushes data written to the destination */
+    if (copy_hints) {
+        mfu_cache_hint_finish(&copy_src_hint);
+        mfu_cache_hint_finish(&copy_dst_hint);
+        copy_hints = 0;
+    }
+
+    /* set metadata while we still have the destination open */
+    if (ret == 0 && whole_file) {
+        if (mfu_copy_set_metadata_fd(list, idx, dest, out_fd, mfu_copy_opts) == 0) {
+            *meta_set = 1;
+        }
+    }
+
+    /* record the chunk as complete, the record is written once
+     * the data is on disk at the next checkpoint */
+    if (ret == 0 && have_st && mfu_copy_journal != NULL) {
+        mfu_copy_journal_add(src, &st, offset, length);
+    }
+
+    return ret;
+}
+
+/****************************************
+ * Copy small files whole
+ ***************************************/
+
+/* cache open directory descriptors of source and destination
+ * directories so files in the same directory are opened relative
+ * to them instead of resolving the full path each time */
+static mfu_copy_file_cache_t mfu_copy_src_dir_cache;
+static mfu_copy_file_cache_t mfu_copy_dst_dir_cache;
+
+/* list used by compare function when sorting small files */
+static mfu_flist mfu_copy_small_list;
+
+/* orders list indices by parent directory and then by name,
+ * so that files in the same directory are copied together */
+static int mfu_copy_small_compare(const void* a, const void* b)
+{
+    const char* name_a = mfu_flist_file_get_name(mfu_copy_small_list, *(const uint64_t*)a);
+    const char* name_b = mfu_flist_file_get_name(mfu_copy_small_list, *(const uint64_t*)b);
+
+    /* compare parent directories first */
+    size_t len_a = mfu_copy_parent_len(name_a);
+    size_t len_b = mfu_copy_parent_len(name_b);
+    size_t len = (len_a < len_b) ? len_a : len_b;
+    int cmp = memcmp(name_a, name_b, len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (len_a != len_b) {
+        return (len_a < len_b) ? -1 : 1;
+    }
+
+    return strcmp(name_a, name_b);
+}
+
+/* splits path into parent directory and base name, opens the parent
+ * directory or returns the cached descriptor if it is already open,
+ * and sets base to point at the base name within path,
+ * returns directory descriptor or -1 on error */
+static int mfu_copy_open_parent(const char* path, const char** base,
+        mfu_copy_file_cache_t* cache)
+{
+    /* split path into parent directory and base name,
+     * a name without a slash lives in the current directory */
+    size_t len = mfu_copy_parent_len(path);
+    const char* slash = strrchr(path, '/');
+    char* dir;
+    if (slash == NULL) {
+        dir = MFU_STRDUP(".");
+        *base = path;
+    } else if (len == 0) {
+        dir = MFU_STRDUP("/");
+        *base = slash + 1;
+    } else {
+        dir = (char*) MFU_MALLOC(len + 1);
+        memcpy(dir, path, len);
+        dir[len] = '\0';
+        *base = slash + 1;
+    }
+
+    /* return cached descriptor if it refers to the same directory */
+    if (cache->name != NULL) {
+        if (strcmp(cache->name, dir) == 0) {
+            mfu_free(&dir);
+            return cache->fd;
+        }
+
+        /* different directory, close the old one */
+        mfu_close(cache->name, cache->fd);
+        mfu_free(&cache->name);
+    }
+
+    /* open the new directory */
+    int fd = mfu_open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open directory `%s' (errno=%d %s)",
+            dir, errno, strerror(errno));
+        mfu_free(&dir);
+        return -1;
+    }
+
+    /* cache the directory descriptor, takes ownership of name */
+    cache->name = dir;
+    cache->fd   = fd;
+    cache->read = 1;
+
+    return fd;
+}
+
+/* creates the destination file, copies the full contents of a small
+ * source file, and sets ownership and permissions on the destination
+ * using its open file descriptor, sets copied to 1 if the data was
+ * copied, a destination whose data failed to copy is removed,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_small_file(mfu_flist list, uint64_t idx,
+        const char* src, const char* dest, uint64_t* bytes, int* copied,
+        mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+    int data_rc = 0;
+    *copied = 0;
+
+    /* open parent directories of source and destination */
+    const char* src_base;
+    const char* dst_base;
+    int src_dirfd = mfu_copy_open_parent(src, &src_base, &mfu_copy_src_dir_cache);
+    int dst_dirfd = mfu_copy_open_parent(dest, &dst_base, &mfu_copy_dst_dir_cache);
+    if (src_dirfd < 0 || dst_dirfd < 0) {
+        return -1;
+    }
+
+    /* since file systems like Lustre require xattrs to be set before
+     * file is opened, create file with mknod and set xattrs first
+     * if we're preserving them */
+    if (mfu_copy_opts->preserve) {
+        if (mknodat(dst_dirfd, dst_base, DCOPY_DEF_PERMS_FILE | S_IFREG, 0) < 0 &&
+            errno != EEXIST)
+        {
+            MFU_LOG(MFU_LOG_ERR, "File `%s' mknod() failed (errno=%d %s)",
+                dest, errno, strerror(errno));
+            return -1;
+        }
+        if (mfu_copy_xattrs(list, idx, dest) < 0) {
+            rc = -1;
+        }
+    }
+
+    /* open source file */
+    int in_fd = openat(src_dirfd, src_base, O_RDONLY);
+    if (in_fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
+            src, errno, strerror(errno));
+        return -1;
+    }
+
+    /* get source attributes for the journal before reading */
+    struct stat st;
+    int have_st = (mfu_copy_journal != NULL && fstat(in_fd, &st) == 0);
+
+    /* create and open destination file, we copy the whole file
+     * so truncate anything that was there before */
+    int out_fd = openat(dst_dirfd, dst_base, O_WRONLY | O_CREAT | O_TRUNC, DCOPY_DEF_PERMS_FILE);
+    if (out_fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        mfu_close(src, in_fd);
+        return -1;
+    }
+
+    /* copy data until we hit end of file */
+    char* buf = (char*) mfu_copy_opts->block_buf1;
+    size_t buf_size = mfu_copy_opts->block_size;
+    uint64_t total_bytes = 0;
+    copy_crc_reset();
+    while (1) {
+        ssize_t nread = mfu_read(src, in_fd, buf, buf_size);
+        if (nread < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' (errno=%d %s)",
+                src, errno, strerror(errno));
+            data_rc = -1;
+            break;
+        }
+        if (nread == 0) {
+            break;
+        }
+
+        /* add data to checksum while it is in cache */
+        copy_crc_update(buf, (size_t)nread);
+
+        ssize_t nwrite = mfu_write(dest, out_fd, buf, (size_t)nread);
+        if (nwrite != nread) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to write `%s' (errno=%d %s)",
+                dest, errno, strerror(errno));
+            data_rc = -1;
+            break;
+        }
+
+        total_bytes += (uint64_t) nread;
+    }
+
+    /* drop the file data from the page cache */
+    if (mfu_io_cache_window > 0) {
+        mfu_cache_hint hint;
+        mfu_cache_hint_start(&hint, in_fd, 0, 0, (off_t)total_bytes);
+        mfu_cache_hint_finish(&hint);
+        mfu_cache_hint_start(&hint, out_fd, 1, 0, (off_t)total_bytes);
+        mfu_cache_hint_finish(&hint);
+    }
+
+    /* don't leave a partial copy behind, and skip its metadata */
+    if (data_rc != 0) {
+        mfu_close(dest, out_fd);
+        mfu_close(src, in_fd);
+        if (unlinkat(dst_dirfd, dst_base, 0) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
+                dest, errno, strerror(errno));
+        }
+        *bytes = total_bytes;
+        return -1;
+    }
+
+    /* set ownership and permissions while file is open, timestamps
+     * are set once data has been synced, as for chunked files */
+    if (mfu_copy_set_metadata_fd(list, idx, dest, out_fd, mfu_copy_opts) < 0) {
+        rc = -1;
+    }
+
+    /* record the file as complete, the record is written once
+     * the data is on disk at the next checkpoint */
+    if (have_st && mfu_copy_journal != NULL) {
+        mfu_copy_journal_add(src, &st, 0, total_bytes);
+    }
+
+    /* close files */
+    mfu_close(dest, out_fd);
+    mfu_close(src, in_fd);
+
+    /* update statistics */
+    mfu_copy_stats.total_files++;
+    mfu_copy_stats.total_size += (int64_t) total_bytes;
+    mfu_copy_stats.total_bytes_copied += (int64_t) total_bytes;
+
+    /* update number of bytes we have copied for progress messages,
+     * creating the file counts as a metadata operation */
+    copy_count += total_bytes;
+    mfu_progress_update(&copy_count, copy_prog);
+    mfu_throttle_consume(&mfu_copy_bw_throttle, total_bytes, copy_prog);
+    mfu_throttle_consume(&mfu_copy_ops_throttle, 1, copy_prog);
+
+    *bytes = total_bytes;
+    *copied = 1;
+    return rc;
+}
+
+/* copies small files in our portion of list whole, without splitting
+ * them into chunks or exchanging them with other processes, files are
+ * processed one directory at a time, skips files flagged in done if
+ * it is not NULL, sets flag in copied for each file whose data was
+ * copied, adds bytes copied to count,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_small_files(mfu_flist list,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        const int* done, int* copied, uint64_t* count)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* gather indices of small files in our list */
+    uint64_t size = mfu_flist_size(list);
+    uint64_t* indices = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t num = 0;
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_copy_is_small_file(list, idx, mfu_copy_opts) &&
+            (done == NULL || ! done[idx]))
+        {
+            indices[num] = idx;
+            num++;
+        }
     }
 
-    memset(fiemap->fm_extents, 0, extents_size);
-    fiemap->fm_extent_count   = fiemap->fm_mapped_extents;
-    fiemap->fm_mapped_extents = 0;
+    /* group files by directory */
+    mfu_copy_small_list = list;
+    qsort(indices, (size_t)num, sizeof(uint64_t), mfu_copy_small_compare);
 
-    if (ioctl(in_fd, FS_IOC_FIEMAP, fiemap) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "fiemap ioctl() failed for src `%s'", src);
-        goto fail_normal_copy;
-    }
-
-    uint64_t last_byte = offset + length;
+    uint64_t i;
+    for (i = 0; i < num; i++) {
+        idx = indices[i];
 
-    if (fiemap->fm_mapped_extents > 0) {
-        uint64_t fe_logical = fiemap->fm_extents[0].fe_logical;
-        uint64_t fe_length  = fiemap->fm_extents[0].fe_length;
-        if (fe_logical < offset) {
-            fiemap->fm_extents[0].fe_length -= (offset - fe_logical);
-            fiemap->fm_extents[0].fe_logical = offset;
+        /* get name of destination file */
+        const char* name = mfu_flist_file_get_name(list, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, mfu_copy_opts);
+        if (dest == NULL) {
+            /* No need to copy it */
+            continue;
         }
 
-        fe_logical = fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_logical;
-        fe_length  = fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_length;
-        if (fe_logical + fe_length > last_byte) {
-           fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_length -=
-           fe_logical + fe_length - last_byte;
+        /* copy file and its metadata */
+        uint64_t bytes = 0;
+        int tmp_rc = mfu_copy_small_file(list, idx, name, dest, &bytes,
+                &copied[idx], mfu_copy_opts);
+        if (tmp_rc < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to copy `%s' to `%s'", name, dest);
+            rc = -1;
+        } else if (copy_crc_enabled) {
+            /* we copied the whole file, so its checksum is complete */
+            mfu_manifest_add(&copy_manifest, &copy_manifest_count,
+                &copy_manifest_max, dest, bytes, copy_crc);
         }
+        *count += bytes;
+
+        /* free the dest name */
+        mfu_free(&dest);
     }
 
-    *normal_copy_required = false;
+    /* close directories */
+    mfu_copy_close_file(&mfu_copy_src_dir_cache);
+    mfu_copy_close_file(&mfu_copy_dst_dir_cache);
 
-    /* seek to offset in source file */
-    if (mfu_lseek(src, in_fd, (off_t)last_ext_start, SEEK_SET) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
-            src, errno, strerror(errno));
-        goto fail;
-    }
+    mfu_free(&indices);
 
-    /* seek to offset in destination file */
-    if (mfu_lseek(dest, out_fd, (off_t)last_ext_start, SEEK_SET) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-            dest, errno, strerror(errno));
-        goto fail;
-    }
+    return rc;
+}
 
-    unsigned int i;
-    for (i = 0; i < fiemap->fm_mapped_extents; i++) {
-        size_t ext_start;
-        size_t ext_len;
-        size_t ext_hole_size;
+/****************************************
+ * Copy chunks with dynamic load balancing
+ ***************************************/
 
-        size_t buf_size = mfu_copy_opts->block_size;
-        void* buf = mfu_copy_opts->block_buf1;
+/* state shared with libcircle callbacks during dynamic chunk copy */
+static const mfu_file_chunk* DYN_HEAD;      /* chunk list assigned to this process */
+static mfu_flist DYN_LIST;                  /* list of files this process owns */
+static uint64_t DYN_RANK;                   /* rank of this process */
+static uint64_t DYN_CHUNK_SIZE;             /* minimum size of unit of work to enqueue */
+static uint64_t DYN_CHUNK_SIZE_MAX;         /* maximum size of unit of work to enqueue */
+static int DYN_NUMPATHS;                    /* number of source paths */
+static const mfu_param_path* DYN_PATHS;     /* source paths */
+static const mfu_param_path* DYN_DESTPATH;  /* destination path */
+static mfu_copy_opts_t* DYN_OPTS;           /* copy options */
+static uint64_t DYN_BYTES;                  /* number of bytes this process copied */
+static mfu_copy_owner_list_t DYN_FAILED;   /* chunks that failed to copy */
+static mfu_copy_owner_list_t DYN_META;     /* files whose metadata was set during copy */
+
+/* copy a single unit of work and record whether it failed */
+static void mfu_copy_dyn_chunk(const char* name, uint64_t offset, uint64_t length,
+        uint64_t file_size, uint64_t rank_of_owner, uint64_t index_of_owner)
+{
+    /* get name of destination file */
+    char* dest = mfu_param_path_copy_dest(name, DYN_NUMPATHS,
+            DYN_PATHS, DYN_DESTPATH, DYN_OPTS);
+    if (dest == NULL) {
+        /* No need to copy it */
+        return;
+    }
 
-        ext_start = fiemap->fm_extents[i].fe_logical;
-        ext_len = fiemap->fm_extents[i].fe_length;
-        ext_hole_size = ext_start - (last_ext_start + last_ext_len);
+    /* add bytes to our running total */
+    DYN_BYTES += length;
+
+    /* copy portion of file corresponding to this chunk, we can only
+     * set metadata on files we own, since we need their attributes */
+    mfu_flist list = (rank_of_owner == DYN_RANK) ? DYN_LIST : NULL;
+    int meta_set;
+    int copy_rc = mfu_copy_file(name, dest, offset, length, file_size,
+            list, index_of_owner, &meta_set, DYN_OPTS);
+    if (copy_rc < 0) {
+        mfu_copy_owner_list_add(&DYN_FAILED, rank_of_owner, index_of_owner);
+    } else {
+        copy_crc_add_section(rank_of_owner, index_of_owner, offset);
+    }
+    if (meta_set) {
+        mfu_copy_owner_list_add(&DYN_META, rank_of_owner, index_of_owner);
+    }
 
-        if (ext_hole_size) {
-            if (mfu_lseek(src, in_fd, (off_t)ext_start, SEEK_SET) < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
-                    src, errno, strerror(errno));
-                goto fail;
-            }
-            if (mfu_lseek(dest, out_fd, (off_t)ext_hole_size, SEEK_CUR) < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-                    dest, errno, strerror(errno));
-                goto fail;
-            }
-        }
+    /* free the dest name */
+    mfu_free(&dest);
+}
 
-        last_ext_start = ext_start;
-        last_ext_len = ext_len;
+/* libcircle create callback, every process enqueues the chunks
+ * it was assigned by mfu_file_chunk_list_alloc, split into units
+ * of chunk size so that idle processes can steal them */
+static void mfu_copy_dyn_create(CIRCLE_handle* handle)
+{
+    /* libcircle pops from the top of the local queue, so we push
+     * elements in reverse order to work through each file's chunks
+     * in sequence, which lets us reuse our cached file descriptors */
+    uint64_t count = mfu_file_chunk_list_size(DYN_HEAD);
+    const mfu_file_chunk** elems = (const mfu_file_chunk**) MFU_MALLOC(count * sizeof(mfu_file_chunk*));
+    uint64_t i;
+    const mfu_file_chunk* p = DYN_HEAD;
+    for (i = 0; i < count; i++) {
+        elems[i] = p;
+        p = p->next;
+    }
 
-        while (ext_len) {
-            ssize_t num_read = mfu_read(src, in_fd, buf, MIN(ext_len, buf_size));
+    char item[CIRCLE_MAX_STRING_LEN];
+    for (i = count; i > 0; i--) {
+        p = elems[i - 1];
 
-            if (!num_read)
-                break;
+        /* use the same chunk size for this file as the chunk list */
+        uint64_t unit_size = mfu_file_chunk_size(p->file_size,
+            DYN_CHUNK_SIZE, DYN_CHUNK_SIZE_MAX);
 
-            ssize_t num_written = mfu_write(dest, out_fd, buf, (size_t)num_read);
+        /* compute number of units in this element, 0-length
+         * elements still need one unit to create the file */
+        uint64_t units = p->length / unit_size;
+        if (units * unit_size < p->length || p->length == 0) {
+            units++;
+        }
 
-            if (num_written < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
-                          src, dest, errno, strerror(errno));
-                goto fail;
-            }
-            if (num_written != num_read) {
-                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
-                    src, dest);
-                goto fail;
+        /* enqueue units from last to first */
+        uint64_t unit;
+        for (unit = units; unit > 0; unit--) {
+            uint64_t unit_offset = (unit - 1) * unit_size;
+            uint64_t offset = p->offset + unit_offset;
+            uint64_t length = p->length - unit_offset;
+            if (length > unit_size) {
+                length = unit_size;
             }
 
-            ext_len -= (size_t)num_written;
-            mfu_copy_stats.total_bytes_copied += (int64_t) num_written;
+            /* encode unit as owner rank, owner index, offset, length,
+             * file size, and file name */
+            int len = snprintf(item, sizeof(item), "%llu %llu %llu %llu %llu %s",
+                (unsigned long long) p->rank_of_owner,
+                (unsigned long long) p->index_of_owner,
+                (unsigned long long) offset,
+                (unsigned long long) length,
+                (unsigned long long) p->file_size,
+                p->name);
+            if (len >= 0 && (size_t)len < sizeof(item)) {
+                handle->enqueue(item);
+            } else {
+                /* name is too long to go through the queue, copy it ourselves */
+                mfu_copy_dyn_chunk(p->name, offset, length, p->file_size,
+                    p->rank_of_owner, p->index_of_owner);
+            }
         }
     }
 
-    off_t last_written = (off_t) last_byte;
-    off_t file_size_offt = (off_t) file_size;
-    if (last_written >= file_size_offt || file_size == 0) {
-        /* Use ftruncate() here rather than truncate(), because grouplock
-         * of Lustre would cause block to truncate() since the fd is different
-         * from the out_fd. */
-        if (mfu_ftruncate(out_fd, file_size_offt) < 0) {
-            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
-                dest, errno, strerror(errno));
-            goto fail;
-       }
-    }
+    mfu_free(&elems);
+}
 
-    if (last_written >= file_size_offt) {
-        mfu_copy_stats.total_size += (int64_t) (file_size_offt - (off_t) offset);
-    } else {
-        mfu_copy_stats.total_size += (int64_t) last_byte;
+/* libcircle process callback, copies one unit of work */
+static void mfu_copy_dyn_process(CIRCLE_handle* handle)
+{
+    /* get next item from queue */
+    char item[CIRCLE_MAX_STRING_LEN];
+    handle->dequeue(item);
+
+    /* decode item */
+    unsigned long long rank_of_owner, index_of_owner, offset, length, file_size;
+    int name_start = 0;
+    int matched = sscanf(item, "%llu %llu %llu %llu %llu %n",
+        &rank_of_owner, &index_of_owner, &offset, &length, &file_size, &name_start);
+    if (matched != 5) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to decode work item `%s'", item);
+        return;
     }
+    const char* name = item + name_start;
 
-    free(fiemap);
-    return 0;
-
-fail:
-    free(fiemap);
-
-fail_normal_copy:
-    return -1;
+    /* copy data */
+    mfu_copy_dyn_chunk(name, (uint64_t)offset, (uint64_t)length,
+        (uint64_t)file_size, (uint64_t)rank_of_owner, (uint64_t)index_of_owner);
 }
 
-static int mfu_copy_file(
-    const char* src,
-    const char* dest,
-    uint64_t offset,
-    uint64_t length,
-    uint64_t file_size,
-    mfu_copy_opts_t* mfu_copy_opts)
+/* copies chunks in list, using libcircle to move work from busy
+ * processes to idle ones, sets flag in results for each item in
+ * flist that failed to copy, sets flag in meta_done for each item
+ * whose metadata was set during the copy, and returns number of
+ * bytes this process was responsible for */
+static uint64_t mfu_copy_chunks_dynamic(mfu_flist flist,
+        const mfu_file_chunk* head, uint64_t chunk_size,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        int* results, int* meta_done)
 {
-    int ret;
-    bool normal_copy_required;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* open the input file */
-    int in_fd = mfu_copy_open_file(src, 1, &mfu_copy_src_cache, mfu_copy_opts);
-    if (in_fd < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
-            src, errno, strerror(errno));
-        return -1;
-    }
+    /* set globals for libcircle callbacks */
+    DYN_HEAD           = head;
+    DYN_LIST           = flist;
+    DYN_RANK           = (uint64_t) rank;
+    DYN_CHUNK_SIZE     = chunk_size;
+    DYN_CHUNK_SIZE_MAX = mfu_copy_opts->chunk_size_max;
+    DYN_NUMPATHS       = numpaths;
+    DYN_PATHS          = paths;
+    DYN_DESTPATH       = destpath;
+    DYN_OPTS           = mfu_copy_opts;
+    DYN_BYTES          = 0;
+
+    /* initialize libcircle, every process enqueues its own chunks */
+    CIRCLE_init(0, NULL, CIRCLE_SPLIT_EQUAL | CIRCLE_CREATE_GLOBAL | CIRCLE_TERM_TREE);
+
+    /* set libcircle verbosity level */
+    enum CIRCLE_loglevel loglevel = CIRCLE_LOG_WARN;
+    CIRCLE_enable_logging(loglevel);
+
+    /* register callbacks */
+    CIRCLE_cb_create(&mfu_copy_dyn_create);
+    CIRCLE_cb_process(&mfu_copy_dyn_process);
+
+    /* run the libcircle job */
+    CIRCLE_begin();
+    CIRCLE_finalize();
 
-    /* open the output file */
-    int out_fd = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache, mfu_copy_opts);
-    if (out_fd < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
-            dest, errno, strerror(errno));
-        return -1;
-    }
+    /* close files */
+    mfu_fd_cache_close_all();
 
-    if (mfu_copy_opts->sparse) {
-        ret = mfu_copy_file_fiemap(src, dest, in_fd, out_fd, offset,
-                               length, file_size,
-                               &normal_copy_required, mfu_copy_opts);
-        if (!ret || !normal_copy_required) {
-            return ret;
-        }
-    }
+    /* report chunks that failed to the processes owning those files */
+    mfu_file_chunk_lor_owners(DYN_FAILED.count, DYN_FAILED.ranks,
+        DYN_FAILED.indices, results);
 
-    ret = mfu_copy_file_normal(src, dest, in_fd, out_fd,
-            offset, length, file_size, mfu_copy_opts);
+    /* report files whose metadata we set to their owners */
+    mfu_file_chunk_lor_owners(DYN_META.count, DYN_META.ranks,
+        DYN_META.indices, meta_done);
 
-    return ret;
+    /* free our record of failed chunks and updated files */
+    mfu_copy_owner_list_free(&DYN_FAILED);
+    mfu_copy_owner_list_free(&DYN_META);
+
+    return DYN_BYTES;
 }
 
 /* slices files in list at boundaries of chunk size, evenly distributes
- * chunks, and copies data from source to destination file,
- * returns 0 on success and -1 on error */
+ * chunks, and copies data from source to destination file, returns
+ * a list of items from list whose metadata still needs to be set in
+ * meta_list, and a list of files whose ownership and permissions were
+ * set during the copy but which still need their timestamps in
+ * times_list, returns 0 on success and -1 on error */
 static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
         int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        mfu_flist* meta_list, mfu_flist* times_list)
 {
     /* assume we'll succeed */
     int rc = 0;
@@ -1973,80 +4890,149 @@ static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
     copy_count = 0;
     copy_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, copy_progress_fn);
 
+    /* build a list of items to be split into chunks, small files
+     * are copied whole on the process that has them in its list */
+    uint64_t i;
+    mfu_flist chunk_list = list;
+    if (mfu_copy_opts->small_file_size > 0) {
+        chunk_list = mfu_flist_subset(list);
+        uint64_t list_size = mfu_flist_size(list);
+        for (i = 0; i < list_size; i++) {
+            if (! mfu_copy_is_small_file(list, i, mfu_copy_opts)) {
+                mfu_flist_file_copy(list, i, chunk_list);
+            }
+        }
+        mfu_flist_summarize(chunk_list);
+    }
+
     /* split file list into a linked list of file sections,
      * this evenly spreads the file sections across processes */
-    mfu_file_chunk* head = mfu_file_chunk_list_alloc(list, chunk_size);
+    mfu_file_chunk* head = mfu_file_chunk_list_alloc_adaptive(chunk_list,
+            chunk_size, mfu_copy_opts->chunk_size_max);
+
+    /* when resuming, drop small files and chunks that an earlier run
+     * recorded as complete in its journal */
+    uint64_t list_size = mfu_flist_size(list);
+    int* small_done = NULL;
+    if (mfu_copy_opts->resume) {
+        small_done = (int*) MFU_MALLOC(list_size * sizeof(int));
+        mfu_copy_journal_skip(list, &head, small_done, mfu_copy_opts);
+    }
+
+    /* copy small files */
+    int* small_copied = (int*) MFU_MALLOC(list_size * sizeof(int));
+    for (i = 0; i < list_size; i++) {
+        small_copied[i] = 0;
+    }
+    if (mfu_copy_opts->small_file_size > 0) {
+        int tmp_rc = mfu_copy_small_files(list, numpaths, paths, destpath,
+                mfu_copy_opts, small_done, small_copied, &total_count);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
 
     /* get a count of how many items are the chunk list */
     uint64_t list_count = mfu_file_chunk_list_size(head);
 
-    /* allocate a flag for each element in chunk list,
-     * will store 0 to mean copy of this chunk succeeded and 1 otherwise
-     * to be used as input to logical OR to determine state of entire file */
-    int* vals = (int*) MFU_MALLOC(list_count * sizeof(int));
+    /* allocate a flag for each item in our file list, and another
+     * to record whether its metadata was set during the copy */
+    uint64_t size = mfu_flist_size(chunk_list);
+    int* results   = (int*) MFU_MALLOC(size * sizeof(int));
+    int* meta_done = (int*) MFU_MALLOC(size * sizeof(int));
 
-    /* loop over and copy data for each file section we're responsible for */
-    uint64_t i;
-    const mfu_file_chunk* p = head;
-    for (i = 0; i < list_count; i++) {
-         /* assume we'll succeed in copying this chunk */
-         vals[i] = 0;
+    /* intialize values, since not every item is represented
+     * in chunk list */
+    for (i = 0; i < size; i++) {
+        results[i]   = 0;
+        meta_done[i] = 0;
+    }
 
-        /* get name of destination file */
-        char* dest = mfu_param_path_copy_dest(p->name, numpaths,
-                paths, destpath, mfu_copy_opts);
-        if (dest == NULL) {
-            /* No need to copy it */
-            p = p->next;
-            continue;
-        }
+    if (mfu_copy_opts->dynamic) {
+        /* copy our chunks, letting idle processes steal work,
+         * and determine which files were copied correctly */
+        total_count += mfu_copy_chunks_dynamic(chunk_list, head, chunk_size, numpaths,
+                paths, destpath, mfu_copy_opts, results, meta_done);
 
-        /* add bytes to our running total */
-        total_count += (uint64_t)p->length;
+        /* barrier to ensure all files are closed,
+         * may try to unlink bad destination files below */
+        MPI_Barrier(MPI_COMM_WORLD);
+    } else {
+        /* allocate a flag for each element in chunk list,
+         * will store 0 to mean copy of this chunk succeeded and 1 otherwise
+         * to be used as input to logical OR to determine state of entire file */
+        int* vals = (int*) MFU_MALLOC(list_count * sizeof(int));
+
+        /* record files whose metadata we set while copying */
+        mfu_copy_owner_list_t meta = {0, 0, NULL, NULL};
+
+        /* loop over and copy data for each file section we're responsible for */
+        const mfu_file_chunk* p = head;
+        for (i = 0; i < list_count; i++) {
+             /* assume we'll succeed in copying this chunk */
+             vals[i] = 0;
+
+            /* get name of destination file */
+            char* dest = mfu_param_path_copy_dest(p->name, numpaths,
+                    paths, destpath, mfu_copy_opts);
+            if (dest == NULL) {
+                /* No need to copy it */
+                p = p->next;
+                continue;
+            }
 
-        /* copy portion of file corresponding to this chunk,
-         * and record whether copy operation succeeded */
-        int copy_rc = mfu_copy_file(p->name, dest, (uint64_t)p->offset,
-                (uint64_t)p->length, (uint64_t)p->file_size, mfu_copy_opts);
-        if (copy_rc < 0) {
-            /* error copying file */
-            vals[i] = 1;
-        }
+            /* add bytes to our running total */
+            total_count += (uint64_t)p->length;
+
+            /* copy portion of file corresponding to this chunk,
+             * and record whether copy operation succeeded, we can
+             * only set metadata on files we own */
+            mfu_flist owner_list = (p->rank_of_owner == (uint64_t)rank) ? chunk_list : NULL;
+            int meta_set;
+            int copy_rc = mfu_copy_file(p->name, dest, (uint64_t)p->offset,
+                    (uint64_t)p->length, (uint64_t)p->file_size,
+                    owner_list, p->index_of_owner, &meta_set, mfu_copy_opts);
+            if (copy_rc < 0) {
+                /* error copying file */
+                vals[i] = 1;
+            } else {
+                copy_crc_add_section(p->rank_of_owner, p->index_of_owner, p->offset);
+            }
+            if (meta_set) {
+                mfu_copy_owner_list_add(&meta, p->rank_of_owner, p->index_of_owner);
+            }
 
-        /* free the dest name */
-        mfu_free(&dest);
+            /* free the dest name */
+            mfu_free(&dest);
 
-        /* update pointer to next element */
-        p = p->next;
-    }
+            /* update pointer to next element */
+            p = p->next;
+        }
 
-    /* close files */
-    mfu_copy_close_file(&mfu_copy_src_cache);
-    mfu_copy_close_file(&mfu_copy_dst_cache);
+        /* close files */
+        mfu_fd_cache_close_all();
 
-    /* barrier to ensure all files are closed,
-     * may try to unlink bad destination files below */
-    MPI_Barrier(MPI_COMM_WORLD);
+        /* barrier to ensure all files are closed,
+         * may try to unlink bad destination files below */
+        MPI_Barrier(MPI_COMM_WORLD);
 
-    /* allocate a flag for each item in our file list */
-    uint64_t size = mfu_flist_size(list);
-    int* results = (int*) MFU_MALLOC(size * sizeof(int));
+        /* determnie which files were copied correctly */
+        mfu_file_chunk_list_lor(chunk_list, head, vals, results);
 
-    /* intialize values, since not every item is represented
-     * in chunk list */
-    for (i = 0; i < size; i++) {
-        results[i] = 0;
-    }
+        /* report files whose metadata we set to their owners */
+        mfu_file_chunk_lor_owners(meta.count, meta.ranks, meta.indices, meta_done);
 
-    /* determnie which files were copied correctly */
-    mfu_file_chunk_list_lor(list, head, vals, results);
+        /* free chunk flags */
+        mfu_free(&vals);
+        mfu_copy_owner_list_free(&meta);
+    }
 
     /* delete any destination file that failed to copy */
     for (i = 0; i < size; i++) {
         if (results[i] != 0) {
             /* found a file that had an error during copy,
              * compute destination name and delete it */
-            const char* name = mfu_flist_file_get_name(list, i);
+            const char* name = mfu_flist_file_get_name(chunk_list, i);
             const char* dest = mfu_param_path_copy_dest(name, numpaths,
                 paths, destpath, mfu_copy_opts);
             if (dest != NULL) {
@@ -2071,12 +5057,102 @@ static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
         }
     }
 
+    /* combine checksums of the sections of each file and record
+     * files we copied in full in the manifest */
+    if (copy_crc_enabled) {
+        mfu_crc128* crcs = (mfu_crc128*) MFU_MALLOC(size * sizeof(mfu_crc128));
+        int* valid       = (int*)        MFU_MALLOC(size * sizeof(int));
+        mfu_file_chunk_crc_combine(chunk_list, copy_crc_sections_count,
+            copy_crc_sections, crcs, valid);
+        copy_crc_sections_count = 0;
+
+        /* files skipped on resume or that failed to copy
+         * are left out of the manifest */
+        uint64_t omitted = 0;
+        for (i = 0; i < size; i++) {
+            mfu_filetype type = mfu_flist_file_get_type(chunk_list, i);
+            if (type != MFU_TYPE_FILE) {
+                continue;
+            }
+
+            const char* name = mfu_flist_file_get_name(chunk_list, i);
+            char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, mfu_copy_opts);
+            if (dest == NULL) {
+                continue;
+            }
+
+            if (valid[i] && results[i] == 0) {
+                uint64_t file_size = mfu_flist_file_get_size(chunk_list, i);
+                mfu_manifest_add(&copy_manifest, &copy_manifest_count,
+                    &copy_manifest_max, dest, file_size, crcs[i]);
+            } else {
+                omitted++;
+            }
+
+            mfu_free(&dest);
+        }
+
+        /* let user know if some files have no checksum */
+        uint64_t all_omitted;
+        MPI_Allreduce(&omitted, &all_omitted, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        if (rank == 0 && all_omitted > 0) {
+            MFU_LOG(MFU_LOG_WARN, "Omitting %" PRIu64 " files not fully copied in this run from manifest",
+                all_omitted);
+        }
+
+        mfu_free(&crcs);
+        mfu_free(&valid);
+    }
+
+    /* build list of items whose metadata still needs to be set,
+     * files whose ownership and permissions were set while copying
+     * only need their timestamps, small files skipped on resume need
+     * everything, small files that failed to copy were removed,
+     * chunk_list holds items of list in the same order */
+    *meta_list  = mfu_flist_subset(list);
+    *times_list = mfu_flist_subset(list);
+    uint64_t chunk_idx = 0;
+    for (i = 0; i < list_size; i++) {
+        int meta_set;
+        if (mfu_copy_is_small_file(list, i, mfu_copy_opts)) {
+            if (small_done != NULL && small_done[i]) {
+                mfu_flist_file_copy(list, i, *meta_list);
+                continue;
+            }
+            meta_set = small_copied[i];
+            if (! meta_set) {
+                continue;
+            }
+        } else {
+            meta_set = meta_done[chunk_idx];
+            chunk_idx++;
+            if (! meta_set) {
+                mfu_flist_file_copy(list, i, *meta_list);
+                continue;
+            }
+        }
+        if (mfu_copy_opts->preserve) {
+            mfu_flist_file_copy(list, i, *times_list);
+        }
+    }
+    mfu_flist_summarize(*meta_list);
+    mfu_flist_summarize(*times_list);
+
     /* free copy flags */
     mfu_free(&results);
+    mfu_free(&meta_done);
+    mfu_free(&small_done);
+    mfu_free(&small_copied);
 
     /* free the list of file chunks */
     mfu_file_chunk_list_free(&head);
 
+    /* free the list of files we split into chunks */
+    if (chunk_list != list) {
+        mfu_flist_free(&chunk_list);
+    }
+
     /* finalize progress messages for the copy */
     mfu_progress_complete(&copy_count, &copy_prog);
 
@@ -2264,10 +5340,12 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
     /* TODO: consider file system striping params here */
     /* hard code some configurables for now */
 
-    /* allocate buffer to read/write files, aligned on 1MB boundaraies */
+    /* allocate buffer to read/write files, aligned on 1MB boundaraies,
+     * the second buffer holds blocks read ahead while writing the first */
     size_t alignment = 1024*1024;
+    size_t ahead = (mfu_copy_opts->io_depth > 1) ? mfu_copy_opts->io_depth - 1 : 1;
     mfu_copy_opts->block_buf1 = (char*) MFU_MEMALIGN(mfu_copy_opts->block_size, alignment);
-    mfu_copy_opts->block_buf2 = (char*) MFU_MEMALIGN(mfu_copy_opts->block_size, alignment);
+    mfu_copy_opts->block_buf2 = (char*) MFU_MEMALIGN(ahead * mfu_copy_opts->block_size, alignment);
 
     /* Grab a relative and actual start time for the epilogue. */
     time(&(mfu_copy_stats.time_started));
@@ -2280,15 +5358,38 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
     mfu_copy_stats.total_size  = 0;
     mfu_copy_stats.total_bytes_copied = 0;
 
-    /* Initialize file cache */
-    mfu_copy_src_cache.name = NULL;
-    mfu_copy_dst_cache.name = NULL;
+    /* Initialize limits on rates of data and metadata operations */
+    mfu_throttle_init(&mfu_copy_bw_throttle, (double) mfu_copy_opts->bw_limit, MPI_COMM_WORLD);
+    mfu_throttle_init(&mfu_copy_ops_throttle, (double) mfu_copy_opts->ops_limit, MPI_COMM_WORLD);
+
+    /* compute checksums of data as it is copied if writing a manifest */
+    copy_crc_enabled        = (mfu_copy_opts->manifest_file != NULL);
+    copy_crc_sections_count = 0;
+    copy_manifest_count     = 0;
+
+    /* copy data of files with several hard links once,
+     * and link their other names to that copy */
+    mfu_flist copy_list = src_cp_list;
+    mfu_flist link_list = NULL;
+    char** link_targets = NULL;
+    if (mfu_copy_opts->hardlinks) {
+        mfu_copy_split_hardlinks(src_cp_list, &copy_list, &link_list, &link_targets);
+    }
+
+    /* record completed chunks so an interrupted copy can be resumed */
+    if (mfu_copy_opts->journal_dir != NULL) {
+        int tmp_rc = mfu_copy_journal_open(copy_list, numpaths, paths,
+            destpath, mfu_copy_opts);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
 
     /* split items in file list into sublists depending on their
      * directory depth */
     int levels, minlevel;
     mfu_flist* lists;
-    mfu_flist_array_by_depth(src_cp_list, &levels, &minlevel, &lists);
+    mfu_flist_array_by_depth(copy_list, &levels, &minlevel, &lists);
 
     /* TODO: filter out files that are bigger than 0 bytes if we can't read them */
 
@@ -2305,15 +5406,15 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
         /* operate in batches, get total size of list, our global
          * offset within it, and the local size of our list to
          * compute which batch our files are part of */
-        uint64_t src_size   = mfu_flist_global_size(src_cp_list);
-        uint64_t src_offset = mfu_flist_global_offset(src_cp_list);
-        uint64_t src_count  = mfu_flist_size(src_cp_list);
+        uint64_t src_size   = mfu_flist_global_size(copy_list);
+        uint64_t src_offset = mfu_flist_global_offset(copy_list);
+        uint64_t src_count  = mfu_flist_size(copy_list);
 
         /* execute our batch copy */
         uint64_t batch_offset = 0;
         while (batch_offset < src_size) {
             /* create temporary list to copy a batch of files into */
-            mfu_flist tmplist = mfu_flist_subset(src_cp_list);
+            mfu_flist tmplist = mfu_flist_subset(copy_list);
 
             /* copy a full batch or until we run out of files */
             uint64_t count = 0;
@@ -2327,9 +5428,9 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
                     uint64_t idx = global_idx - src_offset;
 
                     /* copy item into temp list if is not a directory */
-                    mfu_filetype type = mfu_flist_file_get_type(src_cp_list, idx);
+                    mfu_filetype type = mfu_flist_file_get_type(copy_list, idx);
                     if (type != MFU_TYPE_DIR) {
-                        mfu_flist_file_copy(src_cp_list, idx, tmplist);
+                        mfu_flist_file_copy(copy_list, idx, tmplist);
                     }
                 }
 
@@ -2363,8 +5464,11 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
                 }
 
                 /* copy data */
+                mfu_flist metalist;
+                mfu_flist timeslist;
                 tmp_rc = mfu_copy_files(spreadlist, mfu_copy_opts->chunk_size,
-                        numpaths, paths, destpath, mfu_copy_opts);
+                        numpaths, paths, destpath, mfu_copy_opts, &metalist,
+                        &timeslist);
                 if (tmp_rc < 0) {
                     rc = -1;
                 }
@@ -2373,9 +5477,23 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
                  * setting mismatch, which may happen on lustre */
                 mfu_sync_all("Syncing data to disk.");
 
-                /* set permissions, ownership, and timestamps if needed */
-                mfu_copy_set_metadata(levels2, minlevel2, lists2, numpaths,
+                /* set timestamps on files updated during the copy */
+                tmp_rc = mfu_copy_set_timestamps(timeslist, numpaths,
+                        paths, destpath, mfu_copy_opts);
+                if (tmp_rc < 0) {
+                    rc = -1;
+                }
+                mfu_flist_free(&timeslist);
+
+                /* set permissions, ownership, and timestamps if needed
+                 * on items that were not updated during the copy */
+                int levels3, minlevel3;
+                mfu_flist* lists3;
+                mfu_flist_array_by_depth(metalist, &levels3, &minlevel3, &lists3);
+                mfu_copy_set_metadata(levels3, minlevel3, lists3, numpaths,
                         paths, destpath, mfu_copy_opts);
+                mfu_flist_array_free(levels3, &lists3);
+                mfu_flist_free(&metalist);
 
                 /* free our lists of levels */
                 mfu_flist_array_free(levels2, &lists2);
@@ -2460,6 +5578,16 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
             }
         }
 
+        /* link other names of hard linked files now that
+         * all files have been created */
+        if (link_list != NULL) {
+            tmp_rc = mfu_copy_link_names(link_list, link_targets,
+                    numpaths, paths, destpath, mfu_copy_opts);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+        }
+
         /* set permissions, ownership, and timestamps if needed */
         mfu_copy_set_metadata_dirs(levels, minlevel, lists, numpaths,
                 paths, destpath, mfu_copy_opts);
@@ -2477,19 +5605,47 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
         }
 
         /* copy data */
-        tmp_rc = mfu_copy_files(src_cp_list, mfu_copy_opts->chunk_size,
-                numpaths, paths, destpath, mfu_copy_opts);
+        mfu_flist metalist;
+        mfu_flist timeslist;
+        tmp_rc = mfu_copy_files(copy_list, mfu_copy_opts->chunk_size,
+                numpaths, paths, destpath, mfu_copy_opts, &metalist,
+                &timeslist);
         if (tmp_rc < 0) {
             rc = -1;
         }
 
+        /* link other names of hard linked files now that all files
+         * exist, before setting metadata on their parent directories */
+        if (link_list != NULL) {
+            tmp_rc = mfu_copy_link_names(link_list, link_targets,
+                    numpaths, paths, destpath, mfu_copy_opts);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+        }
+
         /* force data to backend to avoid the following metadata
          * setting mismatch, which may happen on lustre */
         mfu_sync_all("Syncing data to disk.");
 
-        /* set permissions, ownership, and timestamps if needed */
-        mfu_copy_set_metadata(levels, minlevel, lists, numpaths,
+        /* set timestamps on files updated during the copy */
+        tmp_rc = mfu_copy_set_timestamps(timeslist, numpaths,
+                paths, destpath, mfu_copy_opts);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+        mfu_flist_free(&timeslist);
+
+        /* set permissions, ownership, and timestamps if needed
+         * on items that were not updated during the copy,
+         * mostly directories and links */
+        int levels2, minlevel2;
+        mfu_flist* lists2;
+        mfu_flist_array_by_depth(metalist, &levels2, &minlevel2, &lists2);
+        mfu_copy_set_metadata(levels2, minlevel2, lists2, numpaths,
                 paths, destpath, mfu_copy_opts);
+        mfu_flist_array_free(levels2, &lists2);
+        mfu_flist_free(&metalist);
 
         /* force updates to disk */
         mfu_sync_all("Syncing directory updates to disk.");
@@ -2498,6 +5654,40 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
     /* free our lists of levels */
     mfu_flist_array_free(levels, &lists);
 
+    /* free lists of hard linked names */
+    if (link_list != NULL) {
+        uint64_t link_idx;
+        uint64_t link_count = mfu_flist_size(link_list);
+        for (link_idx = 0; link_idx < link_count; link_idx++) {
+            mfu_free(&link_targets[link_idx]);
+        }
+        mfu_free(&link_targets);
+        mfu_flist_free(&link_list);
+        mfu_flist_free(&copy_list);
+    }
+
+    /* close our journal */
+    mfu_copy_journal_close();
+
+    /* write checksums of copied files */
+    if (copy_crc_enabled) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Writing manifest: %s", mfu_copy_opts->manifest_file);
+        }
+        tmp_rc = mfu_manifest_write(mfu_copy_opts->manifest_file,
+            copy_manifest_count, copy_manifest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+
+        mfu_manifest_free(copy_manifest_count, &copy_manifest);
+        copy_manifest_count = 0;
+        copy_manifest_max   = 0;
+        mfu_free(&copy_crc_sections);
+        copy_crc_sections_max = 0;
+        copy_crc_enabled = 0;
+    }
+
     /* free buffers */
     mfu_free(&mfu_copy_opts->block_buf1);
     mfu_free(&mfu_copy_opts->block_buf2);
@@ -2643,7 +5833,7 @@ static int mfu_fill_file(
     int ret;
 
     /* open the file */
-    int out_fd = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache, mfu_copy_opts);
+    int out_fd = mfu_copy_open_file(dest, 0, mfu_copy_opts);
     if (out_fd < 0) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
             dest, errno, strerror(errno));
@@ -2814,7 +6004,7 @@ int mfu_flist_fill(mfu_flist list, mfu_copy_opts_t* mfu_copy_opts)
     }
 
     /* close files */
-    mfu_copy_close_file(&mfu_copy_dst_cache);
+    mfu_fd_cache_close_all();
 
     /* barrier to ensure all files are closed,
      * may try to unlink bad destination files below */
@@ -2934,10 +6124,6 @@ int mfu_flist_hardlink(mfu_flist src_link_list,
     mfu_copy_stats.total_size  = 0;
     mfu_copy_stats.total_bytes_copied = 0;
 
-    /* Initialize file cache */
-    mfu_copy_src_cache.name = NULL;
-    mfu_copy_dst_cache.name = NULL;
-
     /* split items in file list into sublists depending on their
      * directory depth */
     int levels, minlevel;
@@ -3100,6 +6286,11 @@ int mfu_flist_file_sync_meta(mfu_flist src_list, uint64_t src_index, mfu_flist d
     return rc;
 }
 
+int mfu_flist_file_copy_timestamps(mfu_flist flist, uint64_t idx, const char* dest_path)
+{
+    return mfu_copy_timestamps(flist, idx, dest_path);
+}
+
 /* return a newly allocated copy_opts structure, set default values on its fields */
 mfu_copy_opts_t* mfu_copy_opts_new(void)
 {
@@ -3129,8 +6320,36 @@ mfu_copy_opts_t* mfu_copy_opts_new(void)
     /* Set default chunk size */
     opts->chunk_size    = FD_CHUNK_SIZE;
 
+    /* By default, use a fixed chunk size */
+    opts->chunk_size_max = 0;
+
+    /* By default, copy chunks on the process they are assigned to */
+    opts->dynamic       = false;
+
+    /* By default, split all files into chunks */
+    opts->small_file_size = 0;
+
+    /* By default, don't limit rates of data or metadata operations */
+    opts->bw_limit      = 0;
+    opts->ops_limit     = 0;
+
+    /* By default, don't record completed chunks */
+    opts->journal_dir   = NULL;
+    opts->resume        = false;
+
+    /* By default, don't compute checksums of copied files */
+    opts->manifest_file = NULL;
+
+    /* By default, copy each hard linked name as a separate file */
+    opts->hardlinks     = false;
+
+    /* By default, let destination files grow as data is written */
+    opts->prealloc_size = 0;
+    opts->layout        = false;
+
     /* temporaries used during the copy operation for buffers to read/write data */
     opts->block_size    = FD_BLOCK_SIZE;
+    opts->io_depth      = FD_IO_DEPTH;
     opts->block_buf1    = NULL;
     opts->block_buf2    = NULL;
 
@@ -3152,6 +6371,8 @@ void mfu_copy_opts_delete(mfu_copy_opts_t** popts)
     if (opts != NULL) {
       mfu_free(&opts->dest_path);
       mfu_free(&opts->input_file);
+      mfu_free(&opts->journal_dir);
+      mfu_free(&opts->manifest_file);
       mfu_free(&opts->block_buf1);
       mfu_free(&opts->block_buf2);
     }
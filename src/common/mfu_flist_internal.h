@@ -40,6 +40,9 @@ typedef struct list_elem {
     uint64_t ctime;         /* create time */
     uint64_t ctime_nsec;    /* create time nanoseconds */
     uint64_t size;          /* file size in bytes */
+    uint64_t dev;           /* id of device holding file */
+    uint64_t ino;           /* inode number */
+    uint64_t nlink;         /* number of hard links */
     struct list_elem* next; /* pointer to next item */
 } elem_t;
 
@@ -8,6 +8,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -203,6 +204,9 @@ static void list_elem_decode(char* buf, elem_t* elem)
     elem->depth = mfu_flist_compute_depth(file);
 
     elem->detail = 0;
+    elem->dev    = 0;
+    elem->ino    = 0;
+    elem->nlink  = 0;
 
     const char* type = strtok(NULL, "|");
     if (type == NULL) {
@@ -228,11 +232,15 @@ static void list_elem_decode(char* buf, elem_t* elem)
 }
 
 /* create a datatype to hold file name and stat info */
-/* return number of bytes needed to pack element */
-static size_t list_elem_pack_size(int detail, uint64_t chars, const elem_t* elem)
+/* return number of bytes needed to pack element, starting with
+ * version 5, stat info includes device, inode, and link count */
+static size_t list_elem_pack_size(int detail, uint64_t version, uint64_t chars, const elem_t* elem)
 {
     size_t size;
-    if (detail) {
+    if (detail && version >= 5) {
+        size = chars + 0 * 4 + 13 * 8;
+    }
+    else if (detail) {
         size = chars + 0 * 4 + 10 * 8;
     }
     else {
@@ -242,7 +250,7 @@ static size_t list_elem_pack_size(int detail, uint64_t chars, const elem_t* elem
 }
 
 /* pack element into buffer and return number of bytes written */
-static size_t list_elem_pack(void* buf, int detail, uint64_t chars, const elem_t* elem)
+static size_t list_elem_pack(void* buf, int detail, uint64_t version, uint64_t chars, const elem_t* elem)
 {
     /* set pointer to start of buffer */
     char* start = (char*) buf;
@@ -264,6 +272,11 @@ static size_t list_elem_pack(void* buf, int detail, uint64_t chars, const elem_t
         mfu_pack_io_uint64(&ptr, elem->ctime);
         mfu_pack_io_uint64(&ptr, elem->ctime_nsec);
         mfu_pack_io_uint64(&ptr, elem->size);
+        if (version >= 5) {
+            mfu_pack_io_uint64(&ptr, elem->dev);
+            mfu_pack_io_uint64(&ptr, elem->ino);
+            mfu_pack_io_uint64(&ptr, elem->nlink);
+        }
     }
     else {
         /* just have the file type */
@@ -275,7 +288,7 @@ static size_t list_elem_pack(void* buf, int detail, uint64_t chars, const elem_t
 }
 
 /* unpack element from buffer and return number of bytes read */
-static size_t list_elem_unpack(const void* buf, int detail, uint64_t chars, elem_t* elem)
+static size_t list_elem_unpack(const void* buf, int detail, uint64_t version, uint64_t chars, elem_t* elem)
 {
     const char* start = (const char*) buf;
     const char* ptr = start;
@@ -292,6 +305,11 @@ static size_t list_elem_unpack(const void* buf, int detail, uint64_t chars, elem
 
     elem->detail = detail;
 
+    /* inode numbers are not recorded in cache files before version 5 */
+    elem->dev   = 0;
+    elem->ino   = 0;
+    elem->nlink = 0;
+
     if (detail) {
         /* extract fields */
         mfu_unpack_io_uint64(&ptr, &elem->mode);
@@ -304,6 +322,11 @@ static size_t list_elem_unpack(const void* buf, int detail, uint64_t chars, elem
         mfu_unpack_io_uint64(&ptr, &elem->ctime);
         mfu_unpack_io_uint64(&ptr, &elem->ctime_nsec);
         mfu_unpack_io_uint64(&ptr, &elem->size);
+        if (version >= 5) {
+            mfu_unpack_io_uint64(&ptr, &elem->dev);
+            mfu_unpack_io_uint64(&ptr, &elem->ino);
+            mfu_unpack_io_uint64(&ptr, &elem->nlink);
+        }
 
         /* use mode to set file type */
         elem->type = mfu_flist_mode_to_filetype((mode_t)elem->mode);
@@ -332,13 +355,13 @@ static void list_insert_decode(flist_t* flist, char* buf)
 }
 
 /* insert a file given a pointer to packed data */
-static size_t list_insert_ptr(flist_t* flist, char* ptr, int detail, uint64_t chars)
+static size_t list_insert_ptr(flist_t* flist, char* ptr, int detail, uint64_t version, uint64_t chars)
 {
     /* create new element to record file path, file type, and stat info */
     elem_t* elem = (elem_t*) MFU_MALLOC(sizeof(elem_t));
 
     /* get name and advance pointer */
-    size_t bytes = list_elem_unpack(ptr, detail, chars, elem);
+    size_t bytes = list_elem_unpack(ptr, detail, version, chars, elem);
 
     /* append element to tail of linked list */
     mfu_flist_insert_elem(flist, elem);
@@ -762,7 +785,7 @@ static void read_cache_v3(
             uint64_t packcount = 0;
             while (packcount < (uint64_t) read_count) {
                 /* unpack item from buffer and advance pointer */
-                list_insert_ptr(flist, ptr, 1, chars);
+                list_insert_ptr(flist, ptr, 1, 3, chars);
                 ptr += extent_file;
                 packcount++;
             }
@@ -799,12 +822,15 @@ static void read_cache_v3(
  *   list of <username(str), userid(uint64_t)>
  *   list of <groupname(str), groupid(uint64_t)>
  *   list of <files(str)>
- *   */
+ *
+ * version 5 adds device, inode, and link count to the stat
+ * info of each file, otherwise it is the same as version 4 */
 static void read_cache_v4(
     const char* name,
     MPI_Offset* outdisp,
     MPI_File fh,
     char* datarep,
+    uint64_t version,
     flist_t* flist)
 {
     MPI_Status status;
@@ -920,7 +946,7 @@ static void read_cache_v4(
     /* read files, if any */
     if (all_count > 0 && chars > 0) {
         /* get size of file element */
-        size_t elem_size = list_elem_pack_size(flist->detail, (int)chars, NULL);
+        size_t elem_size = list_elem_pack_size(flist->detail, version, (int)chars, NULL);
 
         /* in order to avoid blowing out memory, we'll pack into a smaller
          * buffer and iteratively make many collective reads */
@@ -980,7 +1006,7 @@ static void read_cache_v4(
             uint64_t packcount = 0;
             while (packcount < (uint64_t) read_count) {
                 /* unpack item from buffer and advance pointer */
-                list_insert_ptr(flist, ptr, 1, chars);
+                list_insert_ptr(flist, ptr, 1, version, chars);
                 ptr += elem_size;
                 packcount++;
             }
@@ -1059,8 +1085,8 @@ void mfu_flist_read_cache(
     disp += 1 * 8; /* 9 consecutive uint64_t types in external32 */
 
     /* read data from file */
-    if (version == 4) {
-        read_cache_v4(name, &disp, fh, datarep, flist);
+    if (version == 4 || version == 5) {
+        read_cache_v4(name, &disp, fh, datarep, version, flist);
     } else if (version == 3) {
         /* need a couple of dummy params to record walk start and end times */
         uint64_t outstart = 0;
@@ -1100,6 +1126,54 @@ void mfu_flist_read_cache(
     return;
 }
 
+int mfu_flist_read_cache_under(
+    const char* name,
+    const char* path,
+    mfu_flist flist)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    mfu_flist_read_cache(name, flist);
+
+    /* metadata comparisons need the stat fields of each item */
+    if (! mfu_flist_have_detail(flist)) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cache `%s' has no stat information, "
+                "it must be written by walking without --lite", name);
+        }
+        return -1;
+    }
+
+    /* items are matched by the portion of their name following path,
+     * so every item must be path itself or fall under it */
+    size_t path_len = strlen(path);
+    int is_root = (path_len > 0 && path[path_len - 1] == '/');
+    uint64_t outside = 0;
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(flist);
+    for (idx = 0; idx < size; idx++) {
+        const char* file = mfu_flist_file_get_name(flist, idx);
+        if (strncmp(file, path, path_len) != 0 ||
+            (! is_root && file[path_len] != '\0' && file[path_len] != '/'))
+        {
+            outside++;
+        }
+    }
+
+    uint64_t all_outside;
+    MPI_Allreduce(&outside, &all_outside, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (all_outside > 0) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cache `%s' has %" PRIu64 " items not under `%s'",
+                name, all_outside, path);
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
 /****************************************
  * Write file list to file
  ***************************************/
@@ -1109,7 +1183,10 @@ void mfu_flist_read_cache(
  * 2: version, start, end, files, file chars, list (file, type)
  * 3: version, start, end, files, users, user chars, groups, group chars,
  *    files, file chars, list (user, userid), list (group, groupid),
- *    list (stat) */
+ *    list (stat)
+ * 4: version, users, user chars, groups, group chars, files, file chars,
+ *    list (user, userid), list (group, groupid), list (stat)
+ * 5: same as 4, with device, inode, and link count in each stat */
 
 /* write each record in ASCII format, terminated with newlines */
 static void write_cache_readdir_variable(
@@ -1357,7 +1434,7 @@ static void write_cache_readdir(
         uint64_t packcount = 0;
         while (current != NULL && packcount < bufcount) {
             /* pack item into buffer and advance pointer */
-            size_t pack_bytes = list_elem_pack(ptr, flist->detail, (uint64_t)chars, current);
+            size_t pack_bytes = list_elem_pack(ptr, flist->detail, 3, (uint64_t)chars, current);
             ptr += pack_bytes;
             packcount++;
             current = current->next;
@@ -1534,7 +1611,7 @@ static void write_cache_stat_v3(
         uint64_t packcount = 0;
         while (current != NULL && packcount < bufcount) {
             /* pack item into buffer and advance pointer */
-            size_t pack_bytes = list_elem_pack(ptr, flist->detail, (uint64_t)chars, current);
+            size_t pack_bytes = list_elem_pack(ptr, flist->detail, 3, (uint64_t)chars, current);
             ptr += pack_bytes;
             packcount++;
             current = current->next;
@@ -1566,7 +1643,7 @@ static void write_cache_stat_v3(
     return;
 }
 
-static void write_cache_stat_v4(
+static void write_cache_stat_v5(
     const char* name,
     flist_t* flist)
 {
@@ -1597,7 +1674,7 @@ static void write_cache_stat_v4(
     chars *= 8;
 
     /* compute size of each element */
-    size_t elem_size = list_elem_pack_size(flist->detail, chars, NULL);
+    size_t elem_size = list_elem_pack_size(flist->detail, 5, chars, NULL);
 
     /* open file */
     MPI_Status status;
@@ -1621,7 +1698,7 @@ static void write_cache_stat_v4(
     /* prepare header */
     uint64_t header[7];
     char* ptr = (char*) header;
-    mfu_pack_io_uint64(&ptr, 4);               /* file version */
+    mfu_pack_io_uint64(&ptr, 5);               /* file version */
     mfu_pack_io_uint64(&ptr, users->count);    /* number of user records */
     mfu_pack_io_uint64(&ptr, users->chars);    /* number of chars in user name */
     mfu_pack_io_uint64(&ptr, groups->count);   /* number of group records */
@@ -1705,7 +1782,7 @@ static void write_cache_stat_v4(
         uint64_t packcount = 0;
         while (current != NULL && packcount < bufbytes) {
             /* pack item into buffer and advance pointer */
-            size_t pack_bytes = list_elem_pack(ptr, flist->detail, (uint64_t)chars, current);
+            size_t pack_bytes = list_elem_pack(ptr, flist->detail, 5, (uint64_t)chars, current);
             ptr += pack_bytes;
             packcount += (uint64_t)pack_bytes;
             current = current->next;
@@ -1755,7 +1832,7 @@ void mfu_flist_write_cache(
     if (all_count > 0) {
         if (flist->detail) {
             //write_cache_stat_v3(name, 0, 0, flist);
-            write_cache_stat_v4(name, flist);
+            write_cache_stat_v5(name, flist);
         }
         else {
             //write_cache_readdir(name, 0, 0, flist);
@@ -17,7 +17,6 @@
 #include <errno.h>
 
 #include "libcircle.h"
-#include "dtcmp.h"
 #include "mfu.h"
 
 typedef enum {
@@ -33,200 +32,473 @@ typedef enum {
     FILESIZE,
 } sort_field;
 
-/* routine for sorting strings in ascending order */
-static int my_strcmp(const void* a, const void* b)
+/* a field to sort on and whether to sort it in descending order */
+typedef struct {
+    sort_field field;
+    int reverse;
+} sort_key_t;
+
+/* maximum number of fields in a sort key */
+#define SORT_MAX_FIELDS (9)
+
+/* each rank contributes one sample per rank when selecting splitters,
+ * which bounds the items any rank receives to about twice its share,
+ * but at least this many, so small jobs still get even splitters */
+#define SORT_SAMPLES (32)
+
+/* max number of samples rank 0 gathers in total, which keeps
+ * the bytes it receives well below INT_MAX for any path length */
+#define SORT_SAMPLES_TOTAL (256 * 1024)
+
+/* max number of bytes a rank sends in one round of the exchange,
+ * split evenly across destinations, so that counts and displacements
+ * passed to MPI_Alltoallv always fit in an int */
+#define SORT_EXCHANGE_BYTES (1024 * 1024 * 1024)
+
+/* identifies an item during the sort, pos is the index of the item
+ * in the list being sorted, while rank and idx record where the item
+ * came from in the original list so that items with equal keys still
+ * have a total order */
+typedef struct {
+    uint64_t pos;
+    uint64_t idx;
+    int rank;
+} sort_item_t;
+
+/* qsort does not take an argument for the comparison function,
+ * so record the list and fields it should use here */
+static mfu_flist sort_list = NULL;
+static const sort_key_t* sort_keys = NULL;
+static int sort_nkeys = 0;
+
+static int sort_cmp_uint64(uint64_t a, uint64_t b)
 {
-    return strcmp((const char*)a, (const char*)b);
+    if (a < b) {
+        return -1;
+    }
+    if (a > b) {
+        return 1;
+    }
+    return 0;
 }
 
-static int my_strcmp_rev(const void* a, const void* b)
+static int sort_cmp_str(const char* a, const char* b)
 {
-    return strcmp((const char*)b, (const char*)a);
+    /* treat a missing user or group name as empty */
+    if (a == NULL) {
+        a = "";
+    }
+    if (b == NULL) {
+        b = "";
+    }
+    int cmp = strcmp(a, b);
+    if (cmp < 0) {
+        return -1;
+    }
+    if (cmp > 0) {
+        return 1;
+    }
+    return 0;
 }
 
-static int sort_files_readdir(const char* sortfields, mfu_flist* pflist)
+/* compare item x from list a to item y from list b by the sort fields,
+ * and then by original rank and index */
+static int sort_cmp_items(mfu_flist a, const sort_item_t* x, mfu_flist b, const sort_item_t* y)
 {
-    /* get list from caller */
-    mfu_flist flist = *pflist;
+    uint64_t i = x->pos;
+    uint64_t j = y->pos;
+
+    int k;
+    for (k = 0; k < sort_nkeys; k++) {
+        int cmp = 0;
+        switch (sort_keys[k].field) {
+        case FILENAME:
+            cmp = sort_cmp_str(mfu_flist_file_get_name(a, i), mfu_flist_file_get_name(b, j));
+            break;
+        case USERNAME:
+            cmp = sort_cmp_str(mfu_flist_file_get_username(a, i), mfu_flist_file_get_username(b, j));
+            break;
+        case GROUPNAME:
+            cmp = sort_cmp_str(mfu_flist_file_get_groupname(a, i), mfu_flist_file_get_groupname(b, j));
+            break;
+        case USERID:
+            cmp = sort_cmp_uint64(mfu_flist_file_get_uid(a, i), mfu_flist_file_get_uid(b, j));
+            break;
+        case GROUPID:
+            cmp = sort_cmp_uint64(mfu_flist_file_get_gid(a, i), mfu_flist_file_get_gid(b, j));
+            break;
+        case ATIME:
+            cmp = sort_cmp_uint64(mfu_flist_file_get_atime(a, i), mfu_flist_file_get_atime(b, j));
+            break;
+        case MTIME:
+            cmp = sort_cmp_uint64(mfu_flist_file_get_mtime(a, i), mfu_flist_file_get_mtime(b, j));
+            break;
+        case CTIME:
+            cmp = sort_cmp_uint64(mfu_flist_file_get_ctime(a, i), mfu_flist_file_get_ctime(b, j));
+            break;
+        case FILESIZE:
+            cmp = sort_cmp_uint64(mfu_flist_file_get_size(a, i), mfu_flist_file_get_size(b, j));
+            break;
+        default:
+            break;
+        }
+        if (cmp != 0) {
+            return sort_keys[k].reverse ? -cmp : cmp;
+        }
+    }
 
-    /* create a new list as subset of original list */
-    mfu_flist flist2 = mfu_flist_subset(flist);
+    /* break ties by where the items came from */
+    if (x->rank != y->rank) {
+        return (x->rank < y->rank) ? -1 : 1;
+    }
+    return sort_cmp_uint64(x->idx, y->idx);
+}
 
-    uint64_t incount = mfu_flist_size(flist);
-    uint64_t chars   = mfu_flist_file_max_name(flist);
+/* qsort routine to order items in sort_list */
+static int sort_cmp_qsort(const void* a, const void* b)
+{
+    return sort_cmp_items(sort_list, (const sort_item_t*)a, sort_list, (const sort_item_t*)b);
+}
+
+/* number of bytes to pack an item for the sort */
+static size_t sort_item_pack_size(mfu_flist flist, const sort_item_t* item)
+{
+    return 4 + 8 + mfu_flist_file_pack_compact_size(flist, item->pos);
+}
 
-    /* create datatype for packed file list element */
-    MPI_Datatype dt_sat;
-    size_t bytes = mfu_flist_file_pack_size(flist);
-    MPI_Type_contiguous((int)bytes, MPI_BYTE, &dt_sat);
+/* pack an item along with its original rank and index */
+static size_t sort_item_pack(char* buf, mfu_flist flist, const sort_item_t* item)
+{
+    char* ptr = buf;
+    mfu_pack_uint32(&ptr, (uint32_t) item->rank);
+    mfu_pack_uint64(&ptr, item->idx);
+    ptr += mfu_flist_file_pack_compact(ptr, flist, item->pos);
+    return (size_t)(ptr - buf);
+}
+
+/* unpack count items from buf into flist, filling in items */
+static void sort_item_unpack(const char* buf, uint64_t count, mfu_flist flist, sort_item_t* items)
+{
+    const char* ptr = buf;
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        uint32_t rank;
+        mfu_unpack_uint32(&ptr, &rank);
+        mfu_unpack_uint64(&ptr, &items[i].idx);
+        items[i].rank = (int) rank;
+        items[i].pos  = mfu_flist_size(flist);
+        ptr += mfu_flist_file_unpack(ptr, flist);
+    }
+}
 
+/* given the locally sorted items of flist, select ranks-1 splitters
+ * by sampling, unpack them into splitlist and record them in splits,
+ * returns number of splitters */
+static int sort_select_splitters(mfu_flist flist, const sort_item_t* items, uint64_t count,
+                                 mfu_flist splitlist, sort_item_t* splits)
+{
     /* get our rank and the size of comm_world */
     int rank, ranks;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    /* build type for file path */
-    MPI_Datatype dt_filepath;
-    MPI_Type_contiguous((int)chars, MPI_CHAR, &dt_filepath);
-    MPI_Type_commit(&dt_filepath);
-
-    /* build comparison op for filenames */
-    DTCMP_Op op_filepath;
-    if (DTCMP_Op_create(dt_filepath, my_strcmp, &op_filepath) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create sorting operation for filepath");
+    /* pick evenly spaced samples from our sorted items, the number
+     * grows with the number of ranks until rank 0 would gather too many */
+    uint64_t samples = (uint64_t) ranks;
+    if (samples < SORT_SAMPLES) {
+        samples = SORT_SAMPLES;
     }
-
-    /* build comparison op for filenames */
-    DTCMP_Op op_filepath_rev;
-    if (DTCMP_Op_create(dt_filepath, my_strcmp_rev, &op_filepath_rev) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create reverse sorting operation for filepath");
+    if (samples * (uint64_t) ranks > SORT_SAMPLES_TOTAL) {
+        samples = SORT_SAMPLES_TOTAL / (uint64_t) ranks;
+        if (samples == 0) {
+            samples = 1;
+        }
+    }
+    if (samples > count) {
+        samples = count;
     }
 
-    /* TODO: process sort fields */
-    const int MAXFIELDS = 1;
-    MPI_Datatype types[MAXFIELDS];
-    DTCMP_Op ops[MAXFIELDS];
-    sort_field fields[MAXFIELDS];
-    size_t lengths[MAXFIELDS];
-    int nfields = 0;
-    for (nfields = 0; nfields < MAXFIELDS; nfields++) {
-        types[nfields]   = MPI_DATATYPE_NULL;
-        ops[nfields]     = DTCMP_OP_NULL;
+    /* pack samples to send to rank 0 */
+    uint64_t s;
+    size_t sendbytes = 0;
+    for (s = 0; s < samples; s++) {
+        uint64_t i = ((2 * s + 1) * count) / (2 * samples);
+        sendbytes += sort_item_pack_size(flist, &items[i]);
     }
-    nfields = 0;
-    char* sortfields_copy = MFU_STRDUP(sortfields);
-    char* token = strtok(sortfields_copy, ",");
-    while (token != NULL) {
-        int valid = 1;
-        if (strcmp(token, "name") == 0) {
-            types[nfields]   = dt_filepath;
-            ops[nfields]     = op_filepath;
-            fields[nfields]  = FILENAME;
-            lengths[nfields] = chars;
-        }
-        else if (strcmp(token, "-name") == 0) {
-            types[nfields]   = dt_filepath;
-            ops[nfields]     = op_filepath_rev;
-            fields[nfields]  = FILENAME;
-            lengths[nfields] = chars;
-        }
-        else {
-            /* invalid token */
-            valid = 0;
-            if (rank == 0) {
-                MFU_LOG(MFU_LOG_ERR, "Invalid sort field: %s\n", token);
-            }
+    char* sendbuf = (char*) MFU_MALLOC(sendbytes);
+    char* ptr = sendbuf;
+    for (s = 0; s < samples; s++) {
+        uint64_t i = ((2 * s + 1) * count) / (2 * samples);
+        ptr += sort_item_pack(ptr, flist, &items[i]);
+    }
+
+    /* gather sample counts and sizes to rank 0 */
+    int sendinfo[2];
+    sendinfo[0] = (int) samples;
+    sendinfo[1] = (int) sendbytes;
+    int* recvinfo = (int*) MFU_MALLOC((size_t)ranks * 2 * sizeof(int));
+    MPI_Gather(sendinfo, 2, MPI_INT, recvinfo, 2, MPI_INT, 0, MPI_COMM_WORLD);
+
+    /* compute displacements and totals on rank 0 */
+    int* counts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* disps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    uint64_t total = 0;
+    int recvbytes = 0;
+    if (rank == 0) {
+        int i;
+        for (i = 0; i < ranks; i++) {
+            counts[i] = recvinfo[2 * i + 1];
+            disps[i]  = recvbytes;
+            recvbytes += counts[i];
+            total += (uint64_t) recvinfo[2 * i];
         }
-        if (valid) {
-            nfields++;
+    }
+
+    /* gather samples to rank 0 */
+    char* recvbuf = (char*) MFU_MALLOC((size_t) recvbytes);
+    MPI_Gatherv(sendbuf, (int)sendbytes, MPI_BYTE, recvbuf, counts, disps, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    /* rank 0 sorts the samples and packs the splitters */
+    int splitinfo[2] = {0, 0};
+    char* splitbuf = NULL;
+    if (rank == 0 && total > 0) {
+        /* unpack and sort samples */
+        mfu_flist samplelist = mfu_flist_subset(flist);
+        sort_item_t* sampleitems = (sort_item_t*) MFU_MALLOC(total * sizeof(sort_item_t));
+        sort_item_unpack(recvbuf, total, samplelist, sampleitems);
+        sort_list = samplelist;
+        qsort(sampleitems, (size_t) total, sizeof(sort_item_t), sort_cmp_qsort);
+
+        /* pick ranks-1 evenly spaced splitters from the samples */
+        size_t splitbytes = 0;
+        int j;
+        for (j = 1; j < ranks; j++) {
+            uint64_t i = ((uint64_t)j * total) / (uint64_t)ranks;
+            splitbytes += sort_item_pack_size(samplelist, &sampleitems[i]);
         }
-        if (nfields > MAXFIELDS) {
-            /* TODO: print warning if we have too many fields */
-            break;
+        splitbuf = (char*) MFU_MALLOC(splitbytes);
+        ptr = splitbuf;
+        for (j = 1; j < ranks; j++) {
+            uint64_t i = ((uint64_t)j * total) / (uint64_t)ranks;
+            ptr += sort_item_pack(ptr, samplelist, &sampleitems[i]);
         }
-        token = strtok(NULL, ",");
-    }
-    mfu_free(&sortfields_copy);
+        splitinfo[0] = ranks - 1;
+        splitinfo[1] = (int) splitbytes;
 
-    /* build key type */
-    MPI_Datatype dt_key;
-    if (DTCMP_Type_create_series(nfields, types, &dt_key) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create type for key");
+        mfu_free(&sampleitems);
+        mfu_flist_free(&samplelist);
     }
 
-    /* create sort op */
-    DTCMP_Op op_key;
-    if (DTCMP_Op_create_series(nfields, ops, &op_key) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create sorting operation for key");
+    /* send splitters to all ranks */
+    MPI_Bcast(splitinfo, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank != 0) {
+        splitbuf = (char*) MFU_MALLOC((size_t) splitinfo[1]);
     }
+    MPI_Bcast(splitbuf, splitinfo[1], MPI_BYTE, 0, MPI_COMM_WORLD);
+    sort_item_unpack(splitbuf, (uint64_t) splitinfo[0], splitlist, splits);
 
-    /* build keysat type */
-    MPI_Datatype dt_keysat, keysat_types[2];
-    keysat_types[0] = dt_key;
-    keysat_types[1] = dt_sat;
-    if (DTCMP_Type_create_series(2, keysat_types, &dt_keysat) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create type for keysat");
-    }
+    mfu_free(&splitbuf);
+    mfu_free(&recvbuf);
+    mfu_free(&disps);
+    mfu_free(&counts);
+    mfu_free(&recvinfo);
+    mfu_free(&sendbuf);
 
-    /* get extent of key type */
-    MPI_Aint key_lb, key_extent;
-    MPI_Type_get_extent(dt_key, &key_lb, &key_extent);
+    return splitinfo[0];
+}
 
-    /* get extent of keysat type */
-    MPI_Aint keysat_lb, keysat_extent;
-    MPI_Type_get_extent(dt_keysat, &keysat_lb, &keysat_extent);
+/* sort list with a sample sort, the sort key is never copied into a
+ * fixed-size record, items are compared in place and each is sent to
+ * its destination just once as a packed element sized to its own name,
+ * so memory and network volume scale with the actual path lengths
+ * rather than with the longest path in the list */
+static int sort_files(const sort_key_t* keys, int nkeys, mfu_flist* pflist)
+{
+    /* get list from caller */
+    mfu_flist flist = *pflist;
 
-    /* get extent of sat type */
-    MPI_Aint sat_lb, sat_extent;
-    MPI_Type_get_extent(dt_sat, &sat_lb, &sat_extent);
+    /* get our rank and the size of comm_world */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    /* compute size of sort element and allocate buffer */
-    size_t sortbufsize = (size_t)keysat_extent * incount;
-    void* sortbuf = MFU_MALLOC(sortbufsize);
+    /* record fields for comparison routines */
+    sort_keys  = keys;
+    sort_nkeys = nkeys;
 
-    /* copy data into sort elements */
-    uint64_t idx = 0;
-    char* sortptr = (char*) sortbuf;
-    while (idx < incount) {
-        /* copy in access time */
-        int i;
-        for (i = 0; i < nfields; i++) {
-            if (fields[i] == FILENAME) {
-                const char* name = mfu_flist_file_get_name(flist, idx);
-                strcpy(sortptr, name);
-            }
-            sortptr += lengths[i];
+    /* sort our local items */
+    uint64_t incount = mfu_flist_size(flist);
+    sort_item_t* items = (sort_item_t*) MFU_MALLOC(incount * sizeof(sort_item_t));
+    uint64_t idx;
+    for (idx = 0; idx < incount; idx++) {
+        items[idx].pos  = idx;
+        items[idx].idx  = idx;
+        items[idx].rank = rank;
+    }
+    sort_list = flist;
+    qsort(items, (size_t) incount, sizeof(sort_item_t), sort_cmp_qsort);
+
+    /* select splitters that divide items among ranks */
+    mfu_flist splitlist = mfu_flist_subset(flist);
+    sort_item_t* splits = (sort_item_t*) MFU_MALLOC((size_t)ranks * sizeof(sort_item_t));
+    int nsplits = sort_select_splitters(flist, items, incount, splitlist, splits);
+
+    /* items are in order, so the destination only ever moves forward,
+     * an item goes to the first rank whose splitter is not less than it,
+     * record the first item for each destination */
+    uint64_t* dest_start = (uint64_t*) MFU_MALLOC(((size_t)ranks + 1) * sizeof(uint64_t));
+    uint64_t* sendtotal  = (uint64_t*) MFU_MALLOC((size_t)ranks * sizeof(uint64_t));
+    uint64_t* recvtotal  = (uint64_t*) MFU_MALLOC((size_t)ranks * sizeof(uint64_t));
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendtotal[i] = 0;
+    }
+    int dest = 0;
+    dest_start[0] = 0;
+    for (idx = 0; idx < incount; idx++) {
+        while (dest < nsplits && sort_cmp_items(flist, &items[idx], splitlist, &splits[dest]) > 0) {
+            dest++;
+            dest_start[dest] = idx;
         }
+        sendtotal[dest]++;
+    }
+    while (dest < ranks) {
+        dest++;
+        dest_start[dest] = incount;
+    }
 
-        /* pack file element */
-        sortptr += mfu_flist_file_pack(sortptr, flist, idx);
+    /* let every process know how many items it will receive in all */
+    MPI_Alltoall(sendtotal, 1, MPI_UINT64_T, recvtotal, 1, MPI_UINT64_T, MPI_COMM_WORLD);
+    uint64_t recvitems = 0;
+    for (i = 0; i < ranks; i++) {
+        recvitems += recvtotal[i];
+    }
 
-        idx++;
+    /* allocate arrays for alltoall, item counts and bytes for each rank */
+    int* sendinfo   = (int*) MFU_MALLOC((size_t)ranks * 2 * sizeof(int));
+    int* recvinfo   = (int*) MFU_MALLOC((size_t)ranks * 2 * sizeof(int));
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+
+    /* send items in rounds, each sending at most limit bytes to each
+     * rank, and at least one item if any are left, so the bytes sent
+     * and received in a round stay within range of an int */
+    size_t limit = SORT_EXCHANGE_BYTES / (size_t) ranks;
+    uint64_t* cursor = (uint64_t*) MFU_MALLOC((size_t)ranks * sizeof(uint64_t));
+    for (i = 0; i < ranks; i++) {
+        cursor[i] = dest_start[i];
     }
+    mfu_flist tmplist = mfu_flist_subset(flist);
+    sort_item_t* recvlist = (sort_item_t*) MFU_MALLOC(recvitems * sizeof(sort_item_t));
+    uint64_t received = 0;
+    int more = 1;
+    while (more) {
+        /* pick the items we send to each rank in this round */
+        size_t sendbytes = 0;
+        for (i = 0; i < ranks; i++) {
+            size_t bytes = 0;
+            uint64_t end = cursor[i];
+            while (end < dest_start[i + 1]) {
+                size_t size = sort_item_pack_size(flist, &items[end]);
+                if (end > cursor[i] && bytes + size > limit) {
+                    break;
+                }
+                bytes += size;
+                end++;
+            }
+            sendinfo[2 * i + 0] = (int) (end - cursor[i]);
+            sendinfo[2 * i + 1] = (int) bytes;
+            sendbytes += bytes;
+        }
+
+        /* pack items, which are already grouped by destination */
+        char* sendbuf = (char*) MFU_MALLOC(sendbytes);
+        char* ptr = sendbuf;
+        for (i = 0; i < ranks; i++) {
+            uint64_t end = cursor[i] + (uint64_t) sendinfo[2 * i + 0];
+            for (idx = cursor[i]; idx < end; idx++) {
+                ptr += sort_item_pack(ptr, flist, &items[idx]);
+            }
+            cursor[i] = end;
+        }
+
+        /* alltoall to let every process know how much it will be receiving */
+        MPI_Alltoall(sendinfo, 2, MPI_INT, recvinfo, 2, MPI_INT, MPI_COMM_WORLD);
+
+        /* compute displacements and totals for alltoallv */
+        uint64_t round_items = 0;
+        int recvbytes = 0;
+        int sendoffset = 0;
+        for (i = 0; i < ranks; i++) {
+            sendcounts[i] = sendinfo[2 * i + 1];
+            senddisps[i]  = sendoffset;
+            sendoffset += sendcounts[i];
+
+            recvcounts[i] = recvinfo[2 * i + 1];
+            recvdisps[i]  = recvbytes;
+            recvbytes += recvcounts[i];
+            round_items += (uint64_t) recvinfo[2 * i + 0];
+        }
 
-    /* sort data */
-    void* outsortbuf;
-    int outsortcount;
-    DTCMP_Handle handle;
-    int sort_rc = DTCMP_Sortz(
-                      sortbuf, (int)incount, &outsortbuf, &outsortcount,
-                      dt_key, dt_keysat, op_key, DTCMP_FLAG_NONE,
-                      MPI_COMM_WORLD, &handle
-                  );
-    if (sort_rc != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to sort data");
+        /* send each item to its destination */
+        char* recvbuf = (char*) MFU_MALLOC((size_t) recvbytes);
+        MPI_Alltoallv(
+            sendbuf, sendcounts, senddisps, MPI_BYTE,
+            recvbuf, recvcounts, recvdisps, MPI_BYTE, MPI_COMM_WORLD
+        );
+        mfu_free(&sendbuf);
+
+        /* unpack the items we received */
+        sort_item_unpack(recvbuf, round_items, tmplist, &recvlist[received]);
+        received += round_items;
+        mfu_free(&recvbuf);
+
+        /* keep going while any process has items left to send */
+        int left = 0;
+        for (i = 0; i < ranks; i++) {
+            if (cursor[i] < dest_start[i + 1]) {
+                left = 1;
+            }
+        }
+        MPI_Allreduce(&left, &more, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
     }
+    mfu_free(&cursor);
+    mfu_free(&items);
 
-    /* step through sorted data filenames */
-    idx = 0;
-    sortptr = (char*) outsortbuf;
-    while (idx < (uint64_t)outsortcount) {
-        sortptr += key_extent;
-        sortptr += mfu_flist_file_unpack(sortptr, flist2);
-        idx++;
+    /* sort the items we received */
+    sort_list = tmplist;
+    qsort(recvlist, (size_t) recvitems, sizeof(sort_item_t), sort_cmp_qsort);
+
+    /* copy items into a new list in sorted order */
+    mfu_flist flist2 = mfu_flist_subset(flist);
+    for (idx = 0; idx < recvitems; idx++) {
+        mfu_flist_file_copy(tmplist, recvlist[idx].pos, flist2);
     }
 
     /* build summary of new list */
     mfu_flist_summarize(flist2);
 
-    /* free memory */
-    DTCMP_Free(&handle);
+    mfu_free(&recvlist);
+    mfu_flist_free(&tmplist);
 
-    /* free ops */
-    DTCMP_Op_free(&op_key);
-    DTCMP_Op_free(&op_filepath_rev);
-    DTCMP_Op_free(&op_filepath);
+    mfu_free(&recvdisps);
+    mfu_free(&senddisps);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
+    mfu_free(&recvinfo);
+    mfu_free(&sendinfo);
+    mfu_free(&recvtotal);
+    mfu_free(&sendtotal);
+    mfu_free(&dest_start);
 
-    /* free types */
-    MPI_Type_free(&dt_keysat);
-    MPI_Type_free(&dt_key);
-    MPI_Type_free(&dt_filepath);
+    mfu_free(&splits);
+    mfu_flist_free(&splitlist);
 
-    /* free input buffer holding sort elements */
-    mfu_free(&sortbuf);
-
-    /* free the satellite type */
-    MPI_Type_free(&dt_sat);
+    sort_list  = NULL;
+    sort_keys  = NULL;
+    sort_nkeys = 0;
 
     /* return new list and free old one */
     *pflist = flist2;
@@ -235,394 +507,670 @@ static int sort_files_readdir(const char* sortfields, mfu_flist* pflist)
     return MFU_SUCCESS;
 }
 
-static int sort_files_stat(const char* sortfields, mfu_flist* pflist)
+/* parse comma-delimited list of sort fields into keys,
+ * returns number of fields, only the file name is available
+ * when the list does not have stat detail */
+static int sort_parse_fields(const char* sortfields, int detail, sort_key_t* keys)
 {
-    /* get list from caller */
+    int nkeys = 0;
+    char* sortfields_copy = MFU_STRDUP(sortfields);
+    char* token = strtok(sortfields_copy, ",");
+    while (token != NULL) {
+        /* a leading '-' reverses the order */
+        int reverse = 0;
+        const char* name = token;
+        if (name[0] == '-') {
+            reverse = 1;
+            name++;
+        }
+
+        sort_field field = NULLFIELD;
+        if (strcmp(name, "name") == 0) {
+            field = FILENAME;
+        }
+        else if (detail) {
+            if (strcmp(name, "user") == 0) {
+                field = USERNAME;
+            }
+            else if (strcmp(name, "group") == 0) {
+                field = GROUPNAME;
+            }
+            else if (strcmp(name, "uid") == 0) {
+                field = USERID;
+            }
+            else if (strcmp(name, "gid") == 0) {
+                field = GROUPID;
+            }
+            else if (strcmp(name, "atime") == 0) {
+                field = ATIME;
+            }
+            else if (strcmp(name, "mtime") == 0) {
+                field = MTIME;
+            }
+            else if (strcmp(name, "ctime") == 0) {
+                field = CTIME;
+            }
+            else if (strcmp(name, "size") == 0) {
+                field = FILESIZE;
+            }
+        }
+
+        if (field == NULLFIELD) {
+            /* invalid token */
+            if (mfu_rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Invalid sort field: %s\n", token);
+            }
+        }
+        else if (nkeys < SORT_MAX_FIELDS) {
+            keys[nkeys].field   = field;
+            keys[nkeys].reverse = reverse;
+            nkeys++;
+        }
+
+        token = strtok(NULL, ",");
+    }
+    mfu_free(&sortfields_copy);
+
+    return nkeys;
+}
+
+/* sort flist by specified fields, given as common-delimitted list
+ * precede field name with '-' character to reverse sort order:
+ *   name,user,group,uid,gid,atime,mtime,ctime,size
+ * For example to sort by size in descending order, followed by name
+ *   char fields[] = "size,-name"; */
+int mfu_flist_sort(const char* sortfields, mfu_flist* pflist)
+{
+    if (sortfields == NULL || pflist == NULL) {
+        return MFU_FAILURE;
+    }
+
+    /* get pointer to list */
     mfu_flist flist = *pflist;
 
-    /* create a new list as subset of original list */
-    mfu_flist flist2 = mfu_flist_subset(flist);
+    /* start timer */
+    double start_sort = MPI_Wtime();
 
-    uint64_t incount     = mfu_flist_size(flist);
-    uint64_t chars       = mfu_flist_file_max_name(flist);
-    uint64_t chars_user  = mfu_flist_user_max_name(flist);
-    uint64_t chars_group = mfu_flist_group_max_name(flist);
+    /* sort list */
+    sort_key_t keys[SORT_MAX_FIELDS];
+    int nkeys = sort_parse_fields(sortfields, mfu_flist_have_detail(flist), keys);
+    int rc = sort_files(keys, nkeys, pflist);
 
-    /* create datatype for packed file list element */
-    MPI_Datatype dt_sat;
-    size_t bytes = mfu_flist_file_pack_size(flist);
-    MPI_Type_contiguous((int)bytes, MPI_BYTE, &dt_sat);
+    /* end timer */
+    double end_sort = MPI_Wtime();
 
-    /* get our rank and the size of comm_world */
-    int rank, ranks;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    /* report sort count, time, and rate */
+    if (mfu_rank == 0) {
+        uint64_t all_count = mfu_flist_global_size(*pflist);
+        double secs = end_sort - start_sort;
+        double rate = 0.0;
+        if (secs > 0.0) {
+            rate = ((double)all_count) / secs;
+        }
+        MFU_LOG(MFU_LOG_INFO, "Sorted %lu files in %f seconds (%f files/sec)",
+               all_count, secs, rate
+              );
+    }
+
+    /* wait for summary to be printed */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    return rc;
+}
+
+/* parse a numeric field for top-k and quantile queries,
+ * a leading '-' selects descending order, returns MFU_SUCCESS
+ * if the field is valid */
+static int value_parse_field(const char* str, sort_field* field, int* reverse)
+{
+    *reverse = 0;
+    if (str[0] == '-') {
+        *reverse = 1;
+        str++;
+    }
+
+    if (strcmp(str, "uid") == 0) {
+        *field = USERID;
+    }
+    else if (strcmp(str, "gid") == 0) {
+        *field = GROUPID;
+    }
+    else if (strcmp(str, "atime") == 0) {
+        *field = ATIME;
+    }
+    else if (strcmp(str, "mtime") == 0) {
+        *field = MTIME;
+    }
+    else if (strcmp(str, "ctime") == 0) {
+        *field = CTIME;
+    }
+    else if (strcmp(str, "size") == 0) {
+        *field = FILESIZE;
+    }
+    else {
+        return MFU_FAILURE;
+    }
+    return MFU_SUCCESS;
+}
 
-    /* build type for file path */
-    MPI_Datatype dt_filepath, dt_user, dt_group;
-    MPI_Type_contiguous((int)chars,       MPI_CHAR, &dt_filepath);
-    MPI_Type_contiguous((int)chars_user,  MPI_CHAR, &dt_user);
-    MPI_Type_contiguous((int)chars_group, MPI_CHAR, &dt_group);
-    MPI_Type_commit(&dt_filepath);
-    MPI_Type_commit(&dt_user);
-    MPI_Type_commit(&dt_group);
+int mfu_flist_numeric_field_valid(const char* field)
+{
+    sort_field f;
+    int reverse;
+    return (value_parse_field(field, &f, &reverse) == MFU_SUCCESS);
+}
 
-    /* build comparison op for filenames */
-    DTCMP_Op op_filepath, op_user, op_group;
-    if (DTCMP_Op_create(dt_filepath, my_strcmp, &op_filepath) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create sorting operation for filepath");
+int mfu_flist_parse_topk(const char* str, char** field, uint64_t* count)
+{
+    *field = NULL;
+    *count = 0;
+
+    /* split at the last ':' into field name and count */
+    const char* sep = strrchr(str, ':');
+    unsigned long long val = 0;
+    if (sep == NULL || mfu_abtoull(sep + 1, &val) != MFU_SUCCESS || val == 0) {
+        return MFU_FAILURE;
     }
-    if (DTCMP_Op_create(dt_user, my_strcmp, &op_user) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create sorting operation for username");
+
+    size_t len = (size_t)(sep - str);
+    char* name = (char*) MFU_MALLOC(len + 1);
+    memcpy(name, str, len);
+    name[len] = '\0';
+    if (! mfu_flist_numeric_field_valid(name)) {
+        mfu_free(&name);
+        return MFU_FAILURE;
     }
-    if (DTCMP_Op_create(dt_group, my_strcmp, &op_group) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create sorting operation for groupname");
+
+    *field = name;
+    *count = (uint64_t) val;
+    return MFU_SUCCESS;
+}
+
+/* return value of numeric field for specified item */
+static uint64_t value_get(mfu_flist flist, uint64_t idx, sort_field field)
+{
+    switch (field) {
+    case USERID:
+        return mfu_flist_file_get_uid(flist, idx);
+    case GROUPID:
+        return mfu_flist_file_get_gid(flist, idx);
+    case ATIME:
+        return mfu_flist_file_get_atime(flist, idx);
+    case MTIME:
+        return mfu_flist_file_get_mtime(flist, idx);
+    case CTIME:
+        return mfu_flist_file_get_ctime(flist, idx);
+    case FILESIZE:
+        return mfu_flist_file_get_size(flist, idx);
+    default:
+        break;
     }
+    return 0;
+}
 
-    /* build comparison op for filenames */
-    DTCMP_Op op_filepath_rev, op_user_rev, op_group_rev;
-    if (DTCMP_Op_create(dt_filepath, my_strcmp_rev, &op_filepath_rev) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create reverse sorting operation for groupname");
+/* format value of numeric field for printing */
+static void value_format(sort_field field, uint64_t value, char* buf, size_t bufsize)
+{
+    if (field == FILESIZE) {
+        double size_tmp;
+        const char* size_units;
+        mfu_format_bytes(value, &size_tmp, &size_units);
+        snprintf(buf, bufsize, "%7.3f %2s", size_tmp, size_units);
     }
-    if (DTCMP_Op_create(dt_user, my_strcmp_rev, &op_user_rev) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create reverse sorting operation for groupname");
+    else if (field == ATIME || field == MTIME || field == CTIME) {
+        time_t t = (time_t) value;
+        if (strftime(buf, bufsize, "%FT%T", localtime(&t)) == 0) {
+            buf[0] = '\0';
+        }
     }
-    if (DTCMP_Op_create(dt_group, my_strcmp_rev, &op_group_rev) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create reverse sorting operation for groupname");
+    else {
+        snprintf(buf, bufsize, "%llu", (unsigned long long) value);
     }
+}
+
+/* a candidate for the top-k list, rank is set to UINT64_MAX
+ * in unused slots, which order after all valid entries */
+typedef struct {
+    uint64_t value;
+    uint64_t rank;
+    uint64_t idx;
+} topk_entry_t;
 
-    /* TODO: process sort fields */
-    const int MAXFIELDS = 7;
-    MPI_Datatype types[MAXFIELDS];
-    DTCMP_Op ops[MAXFIELDS];
-    sort_field fields[MAXFIELDS];
-    size_t lengths[MAXFIELDS];
-    int nfields = 0;
-    for (nfields = 0; nfields < MAXFIELDS; nfields++) {
-        types[nfields]   = MPI_DATATYPE_NULL;
-        ops[nfields]     = DTCMP_OP_NULL;
+/* number of entries and order used by the reduction operation */
+static uint64_t topk_count   = 0;
+static int      topk_reverse = 0;
+
+/* returns negative if a comes before b in the top-k order */
+static int topk_cmp(const topk_entry_t* a, const topk_entry_t* b)
+{
+    if (a->rank == UINT64_MAX || b->rank == UINT64_MAX) {
+        return sort_cmp_uint64(a->rank == UINT64_MAX, b->rank == UINT64_MAX);
     }
-    nfields = 0;
-    char* sortfields_copy = MFU_STRDUP(sortfields);
-    char* token = strtok(sortfields_copy, ",");
-    while (token != NULL) {
-        int valid = 1;
-        if (strcmp(token, "name") == 0) {
-            types[nfields]   = dt_filepath;
-            ops[nfields]     = op_filepath;
-            fields[nfields]  = FILENAME;
-            lengths[nfields] = chars;
-        }
-        else if (strcmp(token, "-name") == 0) {
-            types[nfields]   = dt_filepath;
-            ops[nfields]     = op_filepath_rev;
-            fields[nfields]  = FILENAME;
-            lengths[nfields] = chars;
-        }
-        else if (strcmp(token, "user") == 0) {
-            types[nfields]   = dt_user;
-            ops[nfields]     = op_user;
-            fields[nfields]  = USERNAME;
-            lengths[nfields] = chars_user;
-        }
-        else if (strcmp(token, "-user") == 0) {
-            types[nfields]   = dt_user;
-            ops[nfields]     = op_user_rev;
-            fields[nfields]  = USERNAME;
-            lengths[nfields] = chars_user;
-        }
-        else if (strcmp(token, "group") == 0) {
-            types[nfields]   = dt_group;
-            ops[nfields]     = op_group;
-            fields[nfields]  = GROUPNAME;
-            lengths[nfields] = chars_group;
-        }
-        else if (strcmp(token, "-group") == 0) {
-            types[nfields]   = dt_group;
-            ops[nfields]     = op_group_rev;
-            fields[nfields]  = GROUPNAME;
-            lengths[nfields] = chars_group;
-        }
-        else if (strcmp(token, "uid") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_ASCEND;
-            fields[nfields]  = USERID;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "-uid") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_DESCEND;
-            fields[nfields]  = USERID;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "gid") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_ASCEND;
-            fields[nfields]  = GROUPID;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "-gid") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_DESCEND;
-            fields[nfields]  = GROUPID;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "atime") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_ASCEND;
-            fields[nfields]  = ATIME;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "-atime") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_DESCEND;
-            fields[nfields]  = ATIME;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "mtime") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_ASCEND;
-            fields[nfields]  = MTIME;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "-mtime") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_DESCEND;
-            fields[nfields]  = MTIME;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "ctime") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_ASCEND;
-            fields[nfields]  = CTIME;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "-ctime") == 0) {
-            types[nfields]   = MPI_UINT32_T;
-            ops[nfields]     = DTCMP_OP_UINT32T_DESCEND;
-            fields[nfields]  = CTIME;
-            lengths[nfields] = 4;
-        }
-        else if (strcmp(token, "size") == 0) {
-            types[nfields]   = MPI_UINT64_T;
-            ops[nfields]     = DTCMP_OP_UINT64T_ASCEND;
-            fields[nfields]  = FILESIZE;
-            lengths[nfields] = 8;
-        }
-        else if (strcmp(token, "-size") == 0) {
-            types[nfields]   = MPI_UINT64_T;
-            ops[nfields]     = DTCMP_OP_UINT64T_DESCEND;
-            fields[nfields]  = FILESIZE;
-            lengths[nfields] = 8;
-        }
-        else {
-            /* invalid token */
-            valid = 0;
-            if (rank == 0) {
-                MFU_LOG(MFU_LOG_ERR, "Invalid sort field: %s\n", token);
-            }
+    int cmp = sort_cmp_uint64(a->value, b->value);
+    if (cmp != 0) {
+        return topk_reverse ? -cmp : cmp;
+    }
+    cmp = sort_cmp_uint64(a->rank, b->rank);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return sort_cmp_uint64(a->idx, b->idx);
+}
+
+static int topk_cmp_qsort(const void* a, const void* b)
+{
+    return topk_cmp((const topk_entry_t*)a, (const topk_entry_t*)b);
+}
+
+/* restore heap order below slot i, the heap keeps the entry
+ * that comes last in the top-k order at the root */
+static void topk_heap_down(topk_entry_t* heap, uint64_t count, uint64_t i)
+{
+    while (1) {
+        uint64_t worst = i;
+        uint64_t left  = 2 * i + 1;
+        uint64_t right = 2 * i + 2;
+        if (left < count && topk_cmp(&heap[left], &heap[worst]) > 0) {
+            worst = left;
         }
-        if (valid) {
-            nfields++;
+        if (right < count && topk_cmp(&heap[right], &heap[worst]) > 0) {
+            worst = right;
         }
-        if (nfields > MAXFIELDS) {
-            /* TODO: print warning if we have too many fields */
+        if (worst == i) {
             break;
         }
-        token = strtok(NULL, ",");
+        topk_entry_t tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
     }
-    mfu_free(&sortfields_copy);
+}
 
-    /* build key type */
-    MPI_Datatype dt_key;
-    if (DTCMP_Type_create_series(nfields, types, &dt_key) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create key type");
+/* reduction operation that merges two sorted lists of topk_count
+ * entries and keeps the first topk_count entries in inoutvec */
+static void topk_merge(void* invec, void* inoutvec, int* len, MPI_Datatype* type)
+{
+    topk_entry_t* a = (topk_entry_t*) invec;
+    topk_entry_t* b = (topk_entry_t*) inoutvec;
+    topk_entry_t* merged = (topk_entry_t*) MFU_MALLOC(topk_count * sizeof(topk_entry_t));
+
+    int n;
+    for (n = 0; n < *len; n++) {
+        uint64_t i = 0;
+        uint64_t j = 0;
+        uint64_t k;
+        for (k = 0; k < topk_count; k++) {
+            if (topk_cmp(&a[i], &b[j]) <= 0) {
+                merged[k] = a[i++];
+            }
+            else {
+                merged[k] = b[j++];
+            }
+        }
+        memcpy(b, merged, topk_count * sizeof(topk_entry_t));
+        a += topk_count;
+        b += topk_count;
     }
 
-    /* create op to sort by access time, then filename */
-    DTCMP_Op op_key;
-    if (DTCMP_Op_create_series(nfields, ops, &op_key) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create sorting operation for key");
+    mfu_free(&merged);
+}
+
+/* return a new list holding the first count items of flist as they
+ * would be ordered by mfu_flist_sort on the given numeric field,
+ * without sorting the list: each rank keeps its best count items in a
+ * heap, and a reduction merges these into the global winners, so
+ * communication is O(count) rather than O(list size), all items of
+ * the new list are placed in order on rank 0 */
+int mfu_flist_topk(mfu_flist flist, const char* field, uint64_t count, mfu_flist* ptopk)
+{
+    /* get our rank and the size of comm_world */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* create new list to hold result */
+    mfu_flist topk = mfu_flist_subset(flist);
+    *ptopk = topk;
+
+    /* check that we have a valid field, these all require stat data */
+    sort_field key;
+    int reverse;
+    if (field == NULL || value_parse_field(field, &key, &reverse) != MFU_SUCCESS ||
+        !mfu_flist_have_detail(flist))
+    {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Invalid field or list lacks stat data: %s", (field != NULL) ? field : "");
+        }
+        mfu_flist_summarize(topk);
+        return MFU_FAILURE;
     }
 
-    /* build keysat type */
-    MPI_Datatype dt_keysat, keysat_types[2];
-    keysat_types[0] = dt_key;
-    keysat_types[1] = dt_sat;
-    if (DTCMP_Type_create_series(2, keysat_types, &dt_keysat) != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to create keysat type");
+    /* the reduction sends count entries in a single datatype */
+    if (count * 3 > (uint64_t) INT_MAX) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Too many items requested: %llu", (unsigned long long) count);
+        }
+        mfu_flist_summarize(topk);
+        return MFU_FAILURE;
     }
 
-    /* get extent of key type */
-    MPI_Aint key_lb, key_extent;
-    MPI_Type_get_extent(dt_key, &key_lb, &key_extent);
+    if (count == 0) {
+        mfu_flist_summarize(topk);
+        return MFU_SUCCESS;
+    }
 
-    /* get extent of keysat type */
-    MPI_Aint keysat_lb, keysat_extent;
-    MPI_Type_get_extent(dt_keysat, &keysat_lb, &keysat_extent);
+    topk_count   = count;
+    topk_reverse = reverse;
+
+    /* select our best count items using a heap */
+    topk_entry_t* entries = (topk_entry_t*) MFU_MALLOC(count * sizeof(topk_entry_t));
+    uint64_t used = 0;
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(flist);
+    for (idx = 0; idx < size; idx++) {
+        topk_entry_t entry;
+        entry.value = value_get(flist, idx, key);
+        entry.rank  = (uint64_t) rank;
+        entry.idx   = idx;
+
+        if (used < count) {
+            /* heap is not full, add the item and sift it up */
+            uint64_t i = used;
+            entries[i] = entry;
+            used++;
+            while (i > 0) {
+                uint64_t parent = (i - 1) / 2;
+                if (topk_cmp(&entries[i], &entries[parent]) <= 0) {
+                    break;
+                }
+                topk_entry_t tmp = entries[i];
+                entries[i] = entries[parent];
+                entries[parent] = tmp;
+                i = parent;
+            }
+        }
+        else if (topk_cmp(&entry, &entries[0]) < 0) {
+            /* item beats the worst one we have, replace it */
+            entries[0] = entry;
+            topk_heap_down(entries, used, 0);
+        }
+    }
 
-    /* get extent of sat type */
-    MPI_Aint stat_lb, stat_extent;
-    MPI_Type_get_extent(dt_sat, &stat_lb, &stat_extent);
+    /* order our entries and mark any unused slots */
+    qsort(entries, (size_t) used, sizeof(topk_entry_t), topk_cmp_qsort);
+    for (idx = used; idx < count; idx++) {
+        entries[idx].value = 0;
+        entries[idx].rank  = UINT64_MAX;
+        entries[idx].idx   = 0;
+    }
 
-    /* compute size of sort element and allocate buffer */
-    size_t sortbufsize = (size_t)keysat_extent * incount;
-    void* sortbuf = MFU_MALLOC(sortbufsize);
+    /* merge lists from all ranks */
+    MPI_Datatype dt_topk;
+    MPI_Type_contiguous((int)(count * 3), MPI_UINT64_T, &dt_topk);
+    MPI_Type_commit(&dt_topk);
 
-    /* copy data into sort elements */
-    uint64_t idx = 0;
-    char* sortptr = (char*) sortbuf;
-    while (idx < incount) {
-        /* copy in access time */
-        int i;
-        for (i = 0; i < nfields; i++) {
-            if (fields[i] == FILENAME) {
-                const char* name = mfu_flist_file_get_name(flist, idx);
-                strcpy(sortptr, name);
-            }
-            else if (fields[i] == USERNAME) {
-                const char* name = mfu_flist_file_get_username(flist, idx);
-                strcpy(sortptr, name);
-            }
-            else if (fields[i] == GROUPNAME) {
-                const char* name = mfu_flist_file_get_groupname(flist, idx);
-                strcpy(sortptr, name);
-            }
-            else if (fields[i] == USERID) {
-                uint32_t val32 = (uint32_t) mfu_flist_file_get_uid(flist, idx);
-                memcpy(sortptr, &val32, 4);
-            }
-            else if (fields[i] == GROUPID) {
-                uint32_t val32 = (uint32_t) mfu_flist_file_get_gid(flist, idx);
-                memcpy(sortptr, &val32, 4);
-            }
-            else if (fields[i] == ATIME) {
-                uint32_t val32 = (uint32_t) mfu_flist_file_get_atime(flist, idx);
-                memcpy(sortptr, &val32, 4);
-            }
-            else if (fields[i] == MTIME) {
-                uint32_t val32 = (uint32_t) mfu_flist_file_get_mtime(flist, idx);
-                memcpy(sortptr, &val32, 4);
-            }
-            else if (fields[i] == CTIME) {
-                uint32_t val32 = (uint32_t) mfu_flist_file_get_ctime(flist, idx);
-                memcpy(sortptr, &val32, 4);
-            }
-            else if (fields[i] == FILESIZE) {
-                uint64_t val64 = mfu_flist_file_get_size(flist, idx);
-                memcpy(sortptr, &val64, 8);
-            }
+    MPI_Op op_topk;
+    MPI_Op_create(topk_merge, 1, &op_topk);
 
-            sortptr += lengths[i];
-        }
+    topk_entry_t* winners = (topk_entry_t*) MFU_MALLOC(count * sizeof(topk_entry_t));
+    MPI_Allreduce(entries, winners, 1, dt_topk, op_topk, MPI_COMM_WORLD);
 
-        /* pack file element */
-        sortptr += mfu_flist_file_pack(sortptr, flist, idx);
+    MPI_Op_free(&op_topk);
+    MPI_Type_free(&dt_topk);
 
-        idx++;
+    /* pack the winners we own, each tagged with its position */
+    size_t sendbytes = 0;
+    for (idx = 0; idx < count; idx++) {
+        if (winners[idx].rank == (uint64_t) rank) {
+            sendbytes += 8 + mfu_flist_file_pack_compact_size(flist, winners[idx].idx);
+        }
     }
+    char* sendbuf = (char*) MFU_MALLOC(sendbytes);
+    char* ptr = sendbuf;
+    for (idx = 0; idx < count; idx++) {
+        if (winners[idx].rank == (uint64_t) rank) {
+            mfu_pack_uint64(&ptr, idx);
+            ptr += mfu_flist_file_pack_compact(ptr, flist, winners[idx].idx);
+        }
+    }
+
+    /* gather winners to rank 0 */
+    int bytes = (int) sendbytes;
+    int* counts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* disps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    MPI_Gather(&bytes, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-    /* sort data */
-    void* outsortbuf;
-    int outsortcount;
-    DTCMP_Handle handle;
-    int sort_rc = DTCMP_Sortz(
-                      sortbuf, (int)incount, &outsortbuf, &outsortcount,
-                      dt_key, dt_keysat, op_key, DTCMP_FLAG_NONE,
-                      MPI_COMM_WORLD, &handle
-                  );
-    if (sort_rc != DTCMP_SUCCESS) {
-        MFU_ABORT(1, "Failed to sort data");
+    int recvbytes = 0;
+    if (rank == 0) {
+        int i;
+        for (i = 0; i < ranks; i++) {
+            disps[i] = recvbytes;
+            recvbytes += counts[i];
+        }
     }
+    char* recvbuf = (char*) MFU_MALLOC((size_t) recvbytes);
+    MPI_Gatherv(sendbuf, bytes, MPI_BYTE, recvbuf, counts, disps, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    /* unpack items and insert them into the new list in order */
+    if (rank == 0) {
+        mfu_flist tmplist = mfu_flist_subset(flist);
+        uint64_t* order = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+        const char* recvptr = recvbuf;
+        const char* end = recvbuf + recvbytes;
+        while (recvptr < end) {
+            uint64_t pos;
+            mfu_unpack_uint64(&recvptr, &pos);
+            order[pos] = mfu_flist_size(tmplist);
+            recvptr += mfu_flist_file_unpack(recvptr, tmplist);
+        }
+
+        for (idx = 0; idx < count; idx++) {
+            if (winners[idx].rank != UINT64_MAX) {
+                mfu_flist_file_copy(tmplist, order[idx], topk);
+            }
+        }
 
-    /* step through sorted data filenames */
-    idx = 0;
-    sortptr = (char*) outsortbuf;
-    while (idx < (uint64_t)outsortcount) {
-        sortptr += key_extent;
-        sortptr += mfu_flist_file_unpack(sortptr, flist2);
-        idx++;
+        mfu_free(&order);
+        mfu_flist_free(&tmplist);
     }
 
-    /* build summary of new list */
-    mfu_flist_summarize(flist2);
+    mfu_flist_summarize(topk);
 
-    /* free memory */
-    DTCMP_Free(&handle);
+    mfu_free(&recvbuf);
+    mfu_free(&disps);
+    mfu_free(&counts);
+    mfu_free(&sendbuf);
+    mfu_free(&winners);
+    mfu_free(&entries);
 
-    /* free ops */
-    DTCMP_Op_free(&op_key);
-    DTCMP_Op_free(&op_group_rev);
-    DTCMP_Op_free(&op_user_rev);
-    DTCMP_Op_free(&op_filepath_rev);
-    DTCMP_Op_free(&op_group);
-    DTCMP_Op_free(&op_user);
-    DTCMP_Op_free(&op_filepath);
+    return MFU_SUCCESS;
+}
 
-    /* free types */
-    MPI_Type_free(&dt_keysat);
-    MPI_Type_free(&dt_key);
-    MPI_Type_free(&dt_group);
-    MPI_Type_free(&dt_user);
-    MPI_Type_free(&dt_filepath);
+/* values below 2^QUANTILE_BITS each get their own bucket, larger values
+ * are split into 2^QUANTILE_BITS buckets per power of two, so an
+ * estimate from the middle of a bucket is within 1/2^(QUANTILE_BITS+1)
+ * of the true value */
+#define QUANTILE_BITS (6)
+#define QUANTILE_SUB (1ULL << QUANTILE_BITS)
+#define QUANTILE_BUCKETS (QUANTILE_SUB + (64 - QUANTILE_BITS) * QUANTILE_SUB)
 
-    /* free input buffer holding sort elements */
-    mfu_free(&sortbuf);
+/* return bucket index for value */
+static uint64_t quantile_bucket(uint64_t value)
+{
+    if (value < QUANTILE_SUB) {
+        return value;
+    }
 
-    /* free the satellite type */
-    MPI_Type_free(&dt_sat);
+    /* find position of most significant bit */
+    int msb = 63;
+    while ((value >> msb) == 0) {
+        msb--;
+    }
 
-    /* return new list and free old one */
-    *pflist = flist2;
-    mfu_flist_free(&flist);
+    /* use the bits following the leading one as the sub-bucket */
+    int shift = msb - QUANTILE_BITS;
+    uint64_t sub = (value >> shift) - QUANTILE_SUB;
+    return QUANTILE_SUB + (uint64_t)shift * QUANTILE_SUB + sub;
+}
 
-    return MFU_SUCCESS;
+/* return the value in the middle of a bucket */
+static uint64_t quantile_value(uint64_t bucket)
+{
+    if (bucket < QUANTILE_SUB) {
+        return bucket;
+    }
+    uint64_t shift = (bucket - QUANTILE_SUB) / QUANTILE_SUB;
+    uint64_t sub   = (bucket - QUANTILE_SUB) % QUANTILE_SUB;
+    uint64_t low   = (QUANTILE_SUB + sub) << shift;
+    uint64_t width = 1ULL << shift;
+    return low + width / 2;
 }
 
-/* sort flist by specified fields, given as common-delimitted list
- * precede field name with '-' character to reverse sort order:
- *   name,user,group,uid,gid,atime,mtime,ctime,size
- * For example to sort by size in descending order, followed by name
- *   char fields[] = "size,-name"; */
-int mfu_flist_sort(const char* sortfields, mfu_flist* pflist)
+/* estimate the values of a numeric field at n quantiles, each in
+ * the range [0,1], and return them in values on all ranks,
+ * items are counted into a log-linear histogram that is merged with
+ * a single allreduce, so estimates are within 1% of the true value,
+ * while the 0 and 1 quantiles are the exact min and max,
+ * the '-' prefix on the field name is ignored */
+int mfu_flist_quantiles(mfu_flist flist, const char* field, int n, const double* quantiles, uint64_t* values)
 {
-    if (sortfields == NULL || pflist == NULL) {
+    int i;
+    for (i = 0; i < n; i++) {
+        values[i] = 0;
+    }
+
+    /* check that we have a valid field, these all require stat data */
+    sort_field key;
+    int reverse;
+    if (field == NULL || value_parse_field(field, &key, &reverse) != MFU_SUCCESS ||
+        !mfu_flist_have_detail(flist))
+    {
+        if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Invalid field or list lacks stat data: %s", (field != NULL) ? field : "");
+        }
         return MFU_FAILURE;
     }
 
-    /* get pointer to list */
-    mfu_flist flist = *pflist;
+    /* count items into buckets and track min and max */
+    uint64_t* counts = (uint64_t*) MFU_MALLOC(QUANTILE_BUCKETS * sizeof(uint64_t));
+    uint64_t* totals = (uint64_t*) MFU_MALLOC(QUANTILE_BUCKETS * sizeof(uint64_t));
+    memset(counts, 0, QUANTILE_BUCKETS * sizeof(uint64_t));
+
+    uint64_t minmax[2] = {UINT64_MAX, 0};
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(flist);
+    for (idx = 0; idx < size; idx++) {
+        uint64_t value = value_get(flist, idx, key);
+        counts[quantile_bucket(value)]++;
+        if (value < minmax[0]) {
+            minmax[0] = value;
+        }
+        if (value > minmax[1]) {
+            minmax[1] = value;
+        }
+    }
 
-    /* start timer */
-    double start_sort = MPI_Wtime();
+    /* merge histograms */
+    MPI_Allreduce(counts, totals, (int) QUANTILE_BUCKETS, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    uint64_t min, max;
+    MPI_Allreduce(&minmax[0], &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+    MPI_Allreduce(&minmax[1], &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
 
-    /* sort list */
-    int rc;
-    if (mfu_flist_have_detail(flist)) {
-        rc = sort_files_stat(sortfields, pflist);
+    uint64_t total = 0;
+    uint64_t b;
+    for (b = 0; b < QUANTILE_BUCKETS; b++) {
+        total += totals[b];
     }
-    else {
-        rc = sort_files_readdir(sortfields, pflist);
+
+    /* walk the histogram to find the bucket holding each quantile */
+    for (i = 0; i < n && total > 0; i++) {
+        double q = quantiles[i];
+        if (q <= 0.0) {
+            values[i] = min;
+            continue;
+        }
+        if (q >= 1.0) {
+            values[i] = max;
+            continue;
+        }
+
+        uint64_t target = (uint64_t)(q * (double)(total - 1));
+        uint64_t seen = 0;
+        for (b = 0; b < QUANTILE_BUCKETS; b++) {
+            seen += totals[b];
+            if (seen > target) {
+                break;
+            }
+        }
+
+        /* keep estimate within the range of actual values */
+        uint64_t value = quantile_value(b);
+        if (value < min) {
+            value = min;
+        }
+        if (value > max) {
+            value = max;
+        }
+        values[i] = value;
     }
 
-    /* end timer */
-    double end_sort = MPI_Wtime();
+    mfu_free(&totals);
+    mfu_free(&counts);
 
-    /* report sort count, time, and rate */
-    if (mfu_rank == 0) {
-        uint64_t all_count = mfu_flist_global_size(flist);
-        double secs = end_sort - start_sort;
-        double rate = 0.0;
-        if (secs > 0.0) {
-            rate = ((double)all_count) / secs;
+    return MFU_SUCCESS;
+}
+
+/* print the first count items of flist as ordered by the given
+ * numeric field */
+void mfu_flist_print_topk(mfu_flist flist, const char* field, uint64_t count)
+{
+    mfu_flist topk;
+    int rc = mfu_flist_topk(flist, field, count, &topk);
+
+    if (rc == MFU_SUCCESS && mfu_rank == 0) {
+        sort_field key;
+        int reverse;
+        value_parse_field(field, &key, &reverse);
+
+        printf("First %llu items by %s:\n", (unsigned long long) mfu_flist_size(topk), field);
+        uint64_t idx;
+        uint64_t size = mfu_flist_size(topk);
+        for (idx = 0; idx < size; idx++) {
+            char value_s[64];
+            value_format(key, value_get(topk, idx, key), value_s, sizeof(value_s));
+            printf("%s %s\n", value_s, mfu_flist_file_get_name(topk, idx));
         }
-        MFU_LOG(MFU_LOG_INFO, "Sorted %lu files in %f seconds (%f files/sec)",
-               all_count, secs, rate
-              );
+        printf("\n");
+        fflush(stdout);
     }
 
-    /* wait for summary to be printed */
-    MPI_Barrier(MPI_COMM_WORLD);
+    mfu_flist_free(&topk);
+}
 
-    return rc;
+/* print estimated percentiles of the given numeric field */
+void mfu_flist_print_quantiles(mfu_flist flist, const char* field)
+{
+    const int n = 11;
+    const double quantiles[] = {0.0, 0.01, 0.05, 0.10, 0.25, 0.50, 0.75, 0.90, 0.95, 0.99, 1.0};
+    const char* labels[] = {"min", "p1", "p5", "p10", "p25", "p50", "p75", "p90", "p95", "p99", "max"};
+    uint64_t values[11];
+
+    int rc = mfu_flist_quantiles(flist, field, n, quantiles, values);
+
+    if (rc == MFU_SUCCESS && mfu_rank == 0) {
+        sort_field key;
+        int reverse;
+        value_parse_field(field, &key, &reverse);
+
+        uint64_t total = mfu_flist_global_size(flist);
+        printf("Percentiles of %s over %llu items:\n", field, (unsigned long long) total);
+        int i;
+        for (i = 0; i < n && total > 0; i++) {
+            char value_s[64];
+            value_format(key, values[i], value_s, sizeof(value_s));
+            printf("%5s: %s\n", labels[i], value_s);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
 }
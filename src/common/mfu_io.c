@@ -1,5 +1,10 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 #include <fcntl.h>
@@ -383,7 +388,7 @@ ssize_t mfu_read(const char* file, int fd, void* buf, size_t size)
 /* reliable write to file descriptor (retries, if necessary, until hard error) */
 ssize_t mfu_write(const char* file, int fd, const void* buf, size_t size)
 {
-    int tries = 10;
+    int tries = MFU_IO_TRIES;
     ssize_t n = 0;
     while ((size_t)n < size) {
         errno = 0;
@@ -416,6 +421,78 @@ ssize_t mfu_write(const char* file, int fd, const void* buf, size_t size)
     return n;
 }
 
+/* reliable read from file descriptor at given offset without moving file pointer
+ * (retries, if necessary, until hard error) */
+ssize_t mfu_pread(const char* file, int fd, void* buf, size_t size, off_t offset)
+{
+    int tries = MFU_IO_TRIES;
+    ssize_t n = 0;
+    while ((size_t)n < size) {
+        errno = 0;
+        ssize_t rc = pread(fd, (char*) buf + n, size - (size_t)n, offset + (off_t)n);
+        if (rc > 0) {
+            /* read some data */
+            n += rc;
+            tries = MFU_IO_TRIES;
+        }
+        else if (rc == 0) {
+            /* EOF */
+            return n;
+        }
+        else {   /* (rc < 0) */
+            /* something worth printing an error about */
+            tries--;
+            if (tries <= 0) {
+                /* too many failed retries, give up */
+                MFU_ABORT(-1, "Failed to read file %s errno=%d (%s)",
+                            file, errno, strerror(errno)
+                           );
+            }
+
+            /* sleep a bit before consecutive tries */
+            usleep(MFU_IO_USLEEP);
+        }
+    }
+    return n;
+}
+
+/* reliable write to file descriptor at given offset without moving file pointer
+ * (retries, if necessary, until hard error) */
+ssize_t mfu_pwrite(const char* file, int fd, const void* buf, size_t size, off_t offset)
+{
+    int tries = MFU_IO_TRIES;
+    ssize_t n = 0;
+    while ((size_t)n < size) {
+        errno = 0;
+        ssize_t rc = pwrite(fd, (const char*) buf + n, size - (size_t)n, offset + (off_t)n);
+        if (rc > 0) {
+            /* wrote some data */
+            n += rc;
+            tries = MFU_IO_TRIES;
+        }
+        else if (rc == 0) {
+            /* something bad happened, print an error and abort */
+            MFU_ABORT(-1, "Failed to write file %s errno=%d (%s)",
+                        file, errno, strerror(errno)
+                       );
+        }
+        else {   /* (rc < 0) */
+            /* something worth printing an error about */
+            tries--;
+            if (tries <= 0) {
+                /* too many failed retries, give up */
+                MFU_ABORT(-1, "Failed to write file %s errno=%d (%s)",
+                            file, errno, strerror(errno)
+                           );
+            }
+
+            /* sleep a bit before consecutive tries */
+            usleep(MFU_IO_USLEEP);
+        }
+    }
+    return n;
+}
+
 /* truncate a file */
 int mfu_truncate(const char* file, off_t length)
 {
@@ -500,6 +577,256 @@ retry:
     return rc;
 }
 
+/*****************************
+ * Open file cache
+ ****************************/
+
+/* an open descriptor in the cache */
+typedef struct {
+    char*    name;  /* path of open file, NULL if entry is free */
+    uint32_t hash;  /* hash of path to skip most string compares */
+    int      flags; /* flags file was opened with */
+    int      fd;    /* open file descriptor */
+    uint64_t used;  /* value of clock when descriptor was last returned */
+} mfu_fd_cache_entry;
+
+static mfu_fd_cache_entry* mfu_fd_cache = NULL;
+static int mfu_fd_cache_max = 0;
+static uint64_t mfu_fd_cache_clock = 0;
+static int mfu_fd_cache_sync = 0;
+
+/* allocate cache entries on first use, we keep at most a quarter of
+ * the descriptors we may open so that callers have plenty to spare,
+ * but at least two, since callers often hold a source and destination */
+static void mfu_fd_cache_init(void)
+{
+    int max = MFU_FD_CACHE_SIZE;
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur != RLIM_INFINITY) {
+        if (lim.rlim_cur / 4 < (rlim_t) max) {
+            max = (int) (lim.rlim_cur / 4);
+        }
+    }
+    if (max < 2) {
+        max = 2;
+    }
+
+    mfu_fd_cache = (mfu_fd_cache_entry*) MFU_MALLOC((size_t)max * sizeof(mfu_fd_cache_entry));
+    int i;
+    for (i = 0; i < max; i++) {
+        mfu_fd_cache[i].name = NULL;
+    }
+    mfu_fd_cache_max = max;
+}
+
+/* close descriptor held in entry and mark entry as free,
+ * descriptors open for writing are flushed first if sync is set */
+static int mfu_fd_cache_evict(mfu_fd_cache_entry* e, int sync)
+{
+    int rc = 0;
+    if (sync && (e->flags & (O_WRONLY | O_RDWR))) {
+        if (mfu_fsync(e->name, e->fd) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to fsync `%s' (errno=%d %s)",
+                e->name, errno, strerror(errno));
+            rc = -1;
+        }
+    }
+    if (mfu_close(e->name, e->fd) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to close `%s' (errno=%d %s)",
+            e->name, errno, strerror(errno));
+        rc = -1;
+    }
+    mfu_free(&e->name);
+    return rc;
+}
+
+int mfu_fd_cache_open(const char* file, int flags, mode_t mode, int* opened)
+{
+    *opened = 0;
+
+    if (mfu_fd_cache == NULL) {
+        mfu_fd_cache_init();
+    }
+
+    /* return the descriptor if we have it, and otherwise pick
+     * a free entry, or the least recently used one to replace */
+    uint32_t hash = mfu_hash_jenkins(file, strlen(file));
+    mfu_fd_cache_entry* victim = NULL;
+    int i;
+    for (i = 0; i < mfu_fd_cache_max; i++) {
+        mfu_fd_cache_entry* e = &mfu_fd_cache[i];
+        if (e->name == NULL) {
+            if (victim == NULL || victim->name != NULL) {
+                victim = e;
+            }
+            continue;
+        }
+        if (e->hash == hash && e->flags == flags && strcmp(e->name, file) == 0) {
+            e->used = ++mfu_fd_cache_clock;
+            return e->fd;
+        }
+        if (victim == NULL || (victim->name != NULL && e->used < victim->used)) {
+            victim = e;
+        }
+    }
+
+    /* make room, unless the caller asked us to sync, data written
+     * through the old descriptor is flushed by the file system on its own */
+    if (victim->name != NULL) {
+        mfu_fd_cache_evict(victim, mfu_fd_cache_sync);
+    }
+
+    int fd;
+    if (flags & O_CREAT) {
+        fd = mfu_open(file, flags, mode);
+    } else {
+        fd = mfu_open(file, flags);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+
+    victim->name  = MFU_STRDUP(file);
+    victim->hash  = hash;
+    victim->flags = flags;
+    victim->fd    = fd;
+    victim->used  = ++mfu_fd_cache_clock;
+
+    *opened = 1;
+    return fd;
+}
+
+void mfu_fd_cache_set_sync(int sync)
+{
+    mfu_fd_cache_sync = sync;
+}
+
+int mfu_fd_cache_close_all(void)
+{
+    int rc = 0;
+    int i;
+    for (i = 0; i < mfu_fd_cache_max; i++) {
+        mfu_fd_cache_entry* e = &mfu_fd_cache[i];
+        if (e->name != NULL) {
+            if (mfu_fd_cache_evict(e, 1) != 0) {
+                rc = -1;
+            }
+        }
+    }
+    return rc;
+}
+
+/*****************************
+ * Page cache
+ ****************************/
+
+uint64_t mfu_io_cache_window = 0;
+
+/* start writeback of dirty pages in the given range without waiting */
+static void mfu_cache_start_writeback(mfu_cache_hint* h, off_t pos)
+{
+    if (pos > h->started) {
+        sync_file_range(h->fd, h->started, pos - h->started, SYNC_FILE_RANGE_WRITE);
+        h->started = pos;
+    }
+}
+
+/* drop pages before pos from the page cache, when writing we first wait
+ * for writeback to complete since dirty pages can not be dropped */
+static void mfu_cache_drop(mfu_cache_hint* h, off_t pos)
+{
+    if (pos > h->dropped) {
+        off_t len = pos - h->dropped;
+        if (h->write) {
+            sync_file_range(h->fd, h->dropped, len,
+                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        }
+        posix_fadvise(h->fd, h->dropped, len, POSIX_FADV_DONTNEED);
+        h->dropped = pos;
+    }
+}
+
+/* request readahead so the window ahead of pos is in the page cache */
+static void mfu_cache_readahead(mfu_cache_hint* h, off_t pos)
+{
+    off_t window = (off_t) mfu_io_cache_window;
+
+    /* issue requests in half windows to avoid a call per block */
+    if (h->ahead < h->end && pos + window / 2 >= h->ahead) {
+        off_t stop = pos + window;
+        if (stop > h->end) {
+            stop = h->end;
+        }
+        off_t len = stop - h->ahead;
+        posix_fadvise(h->fd, h->ahead, len, POSIX_FADV_WILLNEED);
+        h->ahead += len;
+    }
+}
+
+/* the hints are advisory, so errors are ignored, the file system
+ * may not support sync_file_range, in which case pages that are still
+ * dirty are simply not dropped */
+void mfu_cache_hint_start(mfu_cache_hint* h, int fd, int write, off_t offset, off_t length)
+{
+    h->fd      = fd;
+    h->write   = write;
+    h->end     = offset + length;
+    h->ahead   = offset;
+    h->started = offset;
+    h->dropped = offset;
+
+    if (mfu_io_cache_window == 0) {
+        return;
+    }
+
+    if (! write) {
+        /* double the kernel readahead and start on the first window */
+        posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+        mfu_cache_readahead(h, offset);
+    }
+}
+
+void mfu_cache_hint_advance(mfu_cache_hint* h, off_t pos)
+{
+    if (mfu_io_cache_window == 0) {
+        return;
+    }
+
+    if (h->write) {
+        /* start writeback of everything written, and once a full window
+         * is in flight, wait on and drop the half window before it,
+         * so that at most one window of data is in the cache */
+        off_t half = (off_t) mfu_io_cache_window / 2;
+        if (pos - h->started >= half) {
+            off_t prev = h->started;
+            mfu_cache_start_writeback(h, pos);
+            if (prev - h->dropped >= half) {
+                mfu_cache_drop(h, prev);
+            }
+        }
+    } else {
+        /* keep a window ahead in the cache, and drop pages once
+         * a full window behind the current position */
+        mfu_cache_readahead(h, pos);
+        if (pos - h->dropped >= (off_t) mfu_io_cache_window) {
+            mfu_cache_drop(h, pos);
+        }
+    }
+}
+
+void mfu_cache_hint_finish(mfu_cache_hint* h)
+{
+    if (mfu_io_cache_window == 0) {
+        return;
+    }
+
+    /* everything up to the end of the range has been processed */
+    if (h->write) {
+        mfu_cache_start_writeback(h, h->end);
+    }
+    mfu_cache_drop(h, h->end);
+}
+
 /*****************************
  * Directories
  ****************************/
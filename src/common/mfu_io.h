@@ -29,6 +29,7 @@ extern "C" {
 
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -102,6 +103,12 @@ ssize_t mfu_read(const char* file, int fd, void* buf, size_t size);
 /* reliable write to opened file descriptor (retries, if necessary, until hard error) */
 ssize_t mfu_write(const char* file, int fd, const void* buf, size_t size);
 
+/* reliable read from opened file descriptor at offset, file pointer is not changed */
+ssize_t mfu_pread(const char* file, int fd, void* buf, size_t size, off_t offset);
+
+/* reliable write to opened file descriptor at offset, file pointer is not changed */
+ssize_t mfu_pwrite(const char* file, int fd, const void* buf, size_t size, off_t offset);
+
 /* truncate a file */
 int mfu_truncate(const char* file, off_t length);
 
@@ -114,6 +121,65 @@ int mfu_unlink(const char* file);
 /* force flush of written data */
 int mfu_fsync(const char* file, int fd);
 
+/*****************************
+ * Open file cache
+ ****************************/
+
+/* maximum number of descriptors kept open by mfu_fd_cache_open,
+ * further limited to a quarter of the process limit on open files */
+#define MFU_FD_CACHE_SIZE (64)
+
+/* opens file with flags (and mode when creating it), reusing the
+ * descriptor from an earlier call on the same path with the same flags
+ * if it is still cached, closes the least recently used descriptor
+ * when the cache is full, sets opened to 1 if a new descriptor was
+ * opened and 0 otherwise, returns -1 and sets errno on error,
+ * descriptors are owned by the cache and must not be closed by the caller */
+int mfu_fd_cache_open(const char* file, int flags, mode_t mode, int* opened);
+
+/* closes all cached descriptors, calling fsync first on those
+ * open for writing, returns 0 on success and -1 on error */
+int mfu_fd_cache_close_all(void);
+
+/* if sync is set, descriptors open for writing that are closed to make
+ * room in the cache are flushed with fsync first, callers that need all
+ * data on disk when they call mfu_fd_cache_close_all should set this,
+ * it is off by default */
+void mfu_fd_cache_set_sync(int sync);
+
+/*****************************
+ * Page cache
+ ****************************/
+
+/* default number of bytes kept in the page cache around the current
+ * position of a bulk read or write when dropping pages is enabled */
+#define MFU_IO_CACHE_WINDOW (16ULL * 1024ULL * 1024ULL)
+
+/* when nonzero, bulk readers and writers read ahead this many bytes
+ * and drop pages from the page cache once they are behind the current
+ * position by this many bytes, 0 leaves caching to the kernel */
+extern uint64_t mfu_io_cache_window;
+
+/* tracks hints issued for a range of a file being read or written */
+typedef struct {
+    int fd;           /* file descriptor to issue hints on */
+    int write;        /* whether data is written through fd */
+    off_t end;        /* offset just past last byte of the range */
+    off_t ahead;      /* readahead has been requested up to this offset */
+    off_t started;    /* writeback has been started up to this offset */
+    off_t dropped;    /* pages have been dropped up to this offset */
+} mfu_cache_hint;
+
+/* start issuing hints for a sequential pass over length bytes of fd
+ * starting at offset, reading if write == 0 and writing otherwise */
+void mfu_cache_hint_start(mfu_cache_hint* h, int fd, int write, off_t offset, off_t length);
+
+/* advance the hints after all bytes before pos have been processed */
+void mfu_cache_hint_advance(mfu_cache_hint* h, off_t pos);
+
+/* drop any pages that remain in the page cache for the range */
+void mfu_cache_hint_finish(mfu_cache_hint* h);
+
 /*****************************
  * Directories
  ****************************/
@@ -95,10 +95,22 @@ typedef struct {
     bool   preserve;      /* whether to preserve timestamps, ownership, permissions, etc. */
     bool   synchronous;   /* whether to use O_DIRECT */
     bool   sparse;        /* whether to create sparse files */
-    size_t chunk_size;    /* size to chunk files by */
+    size_t chunk_size;    /* size to chunk files by, minimum size if chunk_size_max is larger */
+    size_t chunk_size_max; /* maximum size to chunk large files by (0 for fixed chunk_size) */
+    bool   dynamic;       /* whether to rebalance chunks among processes with work stealing */
+    uint64_t small_file_size; /* files up to this size are copied whole by their owner (0 to disable) */
+    uint64_t bw_limit;    /* bytes copied per second summed across ranks (0 for no limit) */
+    uint64_t ops_limit;   /* metadata operations per second summed across ranks (0 for no limit) */
+    char*  journal_dir;   /* directory to record completed chunks in, NULL to disable */
+    bool   resume;        /* whether to skip chunks recorded as complete in journal_dir */
+    char*  manifest_file; /* file to write checksums of copied files to, NULL to disable */
+    bool   hardlinks;     /* whether to copy data of hard linked files once and link other names */
+    uint64_t prealloc_size; /* reserve space for destination files of at least this size (0 to disable) */
+    bool   layout;        /* whether to pick Lustre layout of preallocated files from their size */
     size_t block_size;    /* block size to read/write to file system */
+    size_t io_depth;      /* number of blocks to keep in flight while copying, 1 disables read-ahead */
     char*  block_buf1;    /* buffer to read / write data */
-    char*  block_buf2;    /* another buffer to read / write data */
+    char*  block_buf2;    /* (io_depth - 1) more buffers to read ahead while writing block_buf1 */
     int    grouplock_id;  /* Lustre grouplock ID */
     uint64_t batch_files; /* max batch size to copy files, 0 implies no limit */
 } mfu_copy_opts_t;
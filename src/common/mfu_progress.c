@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "mfu.h"
 
@@ -31,6 +32,9 @@ mfu_progress* mfu_progress_start(int secs, int count, MPI_Comm comm, mfu_progres
      * all processes call complete */
     prg->keep_going = 1;
 
+    /* assume all ranks are working until we hear otherwise */
+    MPI_Comm_size(prg->comm, &prg->active);
+
     /* record number of items to sum in progress updates */
     prg->count = count;
 
@@ -52,7 +56,7 @@ mfu_progress* mfu_progress_start(int secs, int count, MPI_Comm comm, mfu_progres
     int rank;
     MPI_Comm_rank(prg->comm, &rank);
     if (rank != 0) {
-        MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
+        MPI_Ibcast(prg->bcast_vals, 2, MPI_INT, 0, prg->comm, &(prg->bcast_req));
     }
 #endif
 
@@ -61,6 +65,22 @@ mfu_progress* mfu_progress_start(int secs, int count, MPI_Comm comm, mfu_progres
 
 /* fallback to a NOP if non-blocking collectives aren't available */
 #if MPI_VERSION >= 3
+/* on rank 0, start a bcast of the keep_going flag and the number
+ * of ranks that were working as of the last reduction */
+static void mfu_progress_bcast(mfu_progress* prg)
+{
+    prg->bcast_vals[0] = prg->keep_going;
+    prg->bcast_vals[1] = prg->active;
+    MPI_Ibcast(prg->bcast_vals, 2, MPI_INT, 0, prg->comm, &(prg->bcast_req));
+}
+
+/* on ranks other than 0, extract values from a completed bcast */
+static void mfu_progress_bcast_done(mfu_progress* prg)
+{
+    prg->keep_going = prg->bcast_vals[0];
+    prg->active     = prg->bcast_vals[1];
+}
+
 static void mfu_progress_reduce(uint64_t complete, uint64_t* vals, mfu_progress* prg)
 {
     /* set our complete flag to indicate whether we have finished */
@@ -107,7 +127,7 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
             }
 
             /* signal other procs that it's time for a reduction */
-            MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
+            mfu_progress_bcast(prg);
 
             /* set our complete flag to 0 to indicate that we have not finished,
              * and contribute our current values */
@@ -126,6 +146,9 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
 
             /* print new progress message when bcast and reduce have completed */
             if (bcast_done && reduce_done) {
+                /* record number of ranks still working */
+                prg->active = ranks - (int)prg->global_vals[0];
+
                 /* print progress message */
                 if (prg->progfn) {
                     double now = MPI_Wtime();
@@ -146,6 +169,9 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
         MPI_Test(&(prg->bcast_req), &bcast_done, MPI_STATUS_IGNORE);
         MPI_Test(&(prg->bcast_req), &bcast_done, MPI_STATUS_IGNORE);
         MPI_Test(&(prg->bcast_req), &bcast_done, MPI_STATUS_IGNORE);
+        if (bcast_done) {
+            mfu_progress_bcast_done(prg);
+        }
 
         /* get current time and compute number of seconds since
          * we last reported a message */
@@ -176,7 +202,7 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
         /* since we are not in complete,
          * we can infer that keep_going must be 1,
          * so initiate new bcast for another bcast/reduce iteration */
-        MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
+        MPI_Ibcast(prg->bcast_vals, 2, MPI_INT, 0, prg->comm, &(prg->bcast_req));
     }
 #endif
 }
@@ -202,7 +228,7 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
             /* send a bcast/request pair */
             if (prg->bcast_req == MPI_REQUEST_NULL && prg->reduce_req == MPI_REQUEST_NULL) {
                 /* initiate a new bcast/reduce iteration */
-                MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
+                mfu_progress_bcast(prg);
 
                 /* we have reached complete, so set our complete flag to 1,
                  * and contribute our current values */
@@ -219,6 +245,9 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
                     break;
                 }
 
+                /* record number of ranks still working */
+                prg->active = ranks - (int)prg->global_vals[0];
+
                 /* print progress message */
                 if (prg->progfn) {
                     /* skip printing anything if we finish before the
@@ -248,6 +277,7 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
 
             /* wait for bcast to finish */
             MPI_Wait(&(prg->bcast_req), MPI_STATUS_IGNORE);
+            mfu_progress_bcast_done(prg);
 
             /* we have reached complete, so set our complete flag to 1,
              * and contribute our current values */
@@ -255,7 +285,7 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
 
             /* if keep_going flag is set then wait for another bcast */
             if (prg->keep_going) {
-                MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
+                MPI_Ibcast(prg->bcast_vals, 2, MPI_INT, 0, prg->comm, &(prg->bcast_req));
             } else {
                 /* everyone is finished, wait on the reduce we just started */
                 MPI_Wait(&(prg->reduce_req), MPI_STATUS_IGNORE);
@@ -275,3 +305,50 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
     mfu_free(pprg);
 #endif
 }
+
+void mfu_throttle_init(mfu_throttle* thr, double rate, MPI_Comm comm)
+{
+    thr->rate      = rate;
+    thr->tokens    = 0.0;
+    thr->time_last = MPI_Wtime();
+    MPI_Comm_size(comm, &thr->ranks);
+}
+
+/* token bucket, each rank adds tokens at its share of the rate and
+ * sleeps when it has consumed more than it has, a rank may save up
+ * to one second of tokens so short pauses don't reduce throughput */
+void mfu_throttle_consume(mfu_throttle* thr, uint64_t amount, const mfu_progress* prg)
+{
+    /* nothing to do if there is no limit */
+    if (thr->rate <= 0.0) {
+        return;
+    }
+
+    /* split limit among ranks that are still working,
+     * so the total stays the same as ranks finish */
+    int active = thr->ranks;
+    if (prg != NULL && prg->active > 0) {
+        active = prg->active;
+    }
+    double rate = thr->rate / (double) active;
+
+    /* add tokens for time since we were last called */
+    double now = MPI_Wtime();
+    thr->tokens += (now - thr->time_last) * rate;
+    if (thr->tokens > rate) {
+        thr->tokens = rate;
+    }
+    thr->time_last = now;
+
+    /* consume tokens, and if we've used more than we have,
+     * sleep until we've earned them, tokens for the time we
+     * sleep are added on the next call */
+    thr->tokens -= (double) amount;
+    if (thr->tokens < 0.0) {
+        double secs = -thr->tokens / rate;
+        struct timespec ts;
+        ts.tv_sec  = (time_t) secs;
+        ts.tv_nsec = (long) ((secs - (double) ts.tv_sec) * 1000000000.0);
+        nanosleep(&ts, NULL);
+    }
+}
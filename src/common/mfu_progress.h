@@ -25,6 +25,8 @@ typedef struct {
     double time_last;       /* time when last report was requested */
     double timeout;         /* number of seconds between reports */
     int keep_going;         /* flag indicating whether any process is still working */
+    int active;             /* number of ranks still working as of the last reduction */
+    int bcast_vals[2];      /* buffer to bcast keep_going and active from rank 0 */
     int count;              /* number of items in values arrays */
     uint64_t* values;       /* array holding contribution to global sum from local proc */
     uint64_t* global_vals;  /* array to hold global sum across ranks */
@@ -50,6 +52,32 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg);
  *   pprg  - IN address of pointer to struct returned in start */
 void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg);
 
+/* state to limit the rate at which all ranks consume some resource,
+ * like bytes written or metadata operations, the limit is split evenly
+ * among the ranks that were still working as of the most recent
+ * progress reduction, or among all ranks if progress is disabled */
+typedef struct {
+    double rate;      /* limit summed across ranks in units per second, 0 for no limit */
+    double tokens;    /* units this rank may consume before it must wait */
+    double time_last; /* time when tokens were last added */
+    int ranks;        /* number of ranks sharing the limit */
+} mfu_throttle;
+
+/* initialize throttle to limit all ranks in comm to rate units
+ * per second in total, a rate of 0 disables the limit
+ *   thr   - IN pointer to throttle to initialize
+ *   rate  - IN limit summed across ranks in units per second
+ *   comm  - IN communicator of ranks sharing the limit */
+void mfu_throttle_init(mfu_throttle* thr, double rate, MPI_Comm comm);
+
+/* consume amount units, sleeping if needed to stay within our share
+ * of the limit
+ *   thr    - IN pointer to throttle
+ *   amount - IN number of units consumed
+ *   prg    - IN progress of current phase to determine number of
+ *            working ranks, may be NULL */
+void mfu_throttle_consume(mfu_throttle* thr, uint64_t amount, const mfu_progress* prg);
+
 #endif /* MFU_PROGRESS_H */
 
 /* enable C++ codes to include this header directly */
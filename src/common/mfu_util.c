@@ -15,6 +15,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <aio.h>
+#include <signal.h>
+#include <pthread.h>
 
 #ifndef ULLONG_MAX
 #define ULLONG_MAX (__LONG_LONG_MAX__ * 2UL + 1UL)
@@ -561,6 +564,321 @@ uint32_t mfu_hash_jenkins(const char* key, size_t len)
     return hash;
 }
 
+/* CRC-32C polynomial in reversed bit order */
+#define MFU_CRC32C_POLY (0x82f63b78)
+
+/* lookup tables to process 8 bytes at a time, built once on first use,
+ * callers may run in several threads, so tables are built under
+ * pthread_once */
+static uint32_t mfu_crc32c_table[8][256];
+static pthread_once_t mfu_crc32c_table_once = PTHREAD_ONCE_INIT;
+
+/* x^(2^k) modulo the polynomial for k = 0..31, used to combine checksums */
+static uint32_t mfu_crc32c_x2n[32];
+
+/* multiply a and b modulo the polynomial, in reversed bit order */
+static uint32_t mfu_crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+    while (1) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ MFU_CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+static void mfu_crc32c_init(void)
+{
+    uint32_t i, j;
+    for (i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 1) ? (crc >> 1) ^ MFU_CRC32C_POLY : crc >> 1;
+        }
+        mfu_crc32c_table[0][i] = crc;
+    }
+    for (i = 0; i < 256; i++) {
+        uint32_t crc = mfu_crc32c_table[0][i];
+        for (j = 1; j < 8; j++) {
+            crc = mfu_crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+            mfu_crc32c_table[j][i] = crc;
+        }
+    }
+
+    /* x^1, then square repeatedly */
+    uint32_t p = (uint32_t)1 << 30;
+    mfu_crc32c_x2n[0] = p;
+    for (i = 1; i < 32; i++) {
+        p = mfu_crc32c_multmodp(p, p);
+        mfu_crc32c_x2n[i] = p;
+    }
+}
+
+uint32_t mfu_crc32c(uint32_t crc, const void* buf, size_t len)
+{
+    pthread_once(&mfu_crc32c_table_once, mfu_crc32c_init);
+
+    const unsigned char* ptr = (const unsigned char*) buf;
+    crc = ~crc;
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+    /* use the crc32 instruction when the compiler targets it */
+    while (len > 0 && ((uintptr_t)ptr & 7) != 0) {
+        crc = __builtin_ia32_crc32qi(crc, *ptr++);
+        len--;
+    }
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        crc64 = __builtin_ia32_crc32di(crc64, *(const uint64_t*)ptr);
+        ptr += 8;
+        len -= 8;
+    }
+    crc = (uint32_t) crc64;
+    while (len > 0) {
+        crc = __builtin_ia32_crc32qi(crc, *ptr++);
+        len--;
+    }
+#else
+    /* process bytes until pointer is aligned, then 8 bytes at a time */
+    while (len > 0 && ((uintptr_t)ptr & 7) != 0) {
+        crc = mfu_crc32c_table[0][(crc ^ *ptr++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)ptr[0] | (uint32_t)ptr[1] << 8 |
+                             (uint32_t)ptr[2] << 16 | (uint32_t)ptr[3] << 24);
+        uint32_t hi = ((uint32_t)ptr[4] | (uint32_t)ptr[5] << 8 |
+                       (uint32_t)ptr[6] << 16 | (uint32_t)ptr[7] << 24);
+        crc = mfu_crc32c_table[7][lo & 0xff] ^
+              mfu_crc32c_table[6][(lo >> 8) & 0xff] ^
+              mfu_crc32c_table[5][(lo >> 16) & 0xff] ^
+              mfu_crc32c_table[4][lo >> 24] ^
+              mfu_crc32c_table[3][hi & 0xff] ^
+              mfu_crc32c_table[2][(hi >> 8) & 0xff] ^
+              mfu_crc32c_table[1][(hi >> 16) & 0xff] ^
+              mfu_crc32c_table[0][hi >> 24];
+        ptr += 8;
+        len -= 8;
+    }
+    while (len > 0) {
+        crc = mfu_crc32c_table[0][(crc ^ *ptr++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+#endif
+
+    return ~crc;
+}
+
+/* multiply crc by x^(8*len) modulo the polynomial, which is the
+ * effect of passing len zero bytes through the raw shift register */
+static uint32_t mfu_crc32c_shift(uint32_t crc, uint64_t len)
+{
+    pthread_once(&mfu_crc32c_table_once, mfu_crc32c_init);
+
+    /* compute x^(8*len), starting from x^0 and k = 3 for 8 bits per byte */
+    uint32_t p = (uint32_t)1 << 31;
+    unsigned k = 3;
+    while (len > 0) {
+        if (len & 1) {
+            p = mfu_crc32c_multmodp(mfu_crc32c_x2n[k & 31], p);
+        }
+        len >>= 1;
+        k++;
+    }
+
+    return mfu_crc32c_multmodp(p, crc);
+}
+
+uint32_t mfu_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+    return mfu_crc32c_shift(crc1, len2) ^ crc2;
+}
+
+uint32_t mfu_crc32c_zeros(uint32_t crc, uint64_t len)
+{
+    /* zeros leave a zero register unchanged, so only the
+     * pre and post inversions need to be accounted for */
+    return ~mfu_crc32c_shift(~crc, len);
+}
+
+/* reversed polynomials of the two CRC-64s that make up a mfu_crc128,
+ * CRC-64/XZ (ECMA-182) in the low half and CRC-64/NVME in the high half */
+static const uint64_t mfu_crc64_poly[2] = {
+    0xc96c5795d7870f42ULL,
+    0x9a6c9329ac4bc9b5ULL
+};
+
+/* lookup tables to process 8 bytes at a time and x^(2^k) modulo
+ * each polynomial, built once on first use like the CRC-32C tables */
+static uint64_t mfu_crc64_table[2][8][256];
+static uint64_t mfu_crc64_x2n[2][64];
+static pthread_once_t mfu_crc64_table_once = PTHREAD_ONCE_INIT;
+
+/* multiply a and b modulo polynomial p, in reversed bit order */
+static uint64_t mfu_crc64_multmodp(uint64_t poly, uint64_t a, uint64_t b)
+{
+    uint64_t m = (uint64_t)1 << 63;
+    uint64_t p = 0;
+    while (1) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+    }
+    return p;
+}
+
+static void mfu_crc64_init(void)
+{
+    int w;
+    for (w = 0; w < 2; w++) {
+        uint64_t poly = mfu_crc64_poly[w];
+        uint32_t i, j;
+        for (i = 0; i < 256; i++) {
+            uint64_t crc = i;
+            for (j = 0; j < 8; j++) {
+                crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+            }
+            mfu_crc64_table[w][0][i] = crc;
+        }
+        for (i = 0; i < 256; i++) {
+            uint64_t crc = mfu_crc64_table[w][0][i];
+            for (j = 1; j < 8; j++) {
+                crc = mfu_crc64_table[w][0][crc & 0xff] ^ (crc >> 8);
+                mfu_crc64_table[w][j][i] = crc;
+            }
+        }
+
+        /* x^1, then square repeatedly */
+        uint64_t p = (uint64_t)1 << 62;
+        mfu_crc64_x2n[w][0] = p;
+        for (i = 1; i < 64; i++) {
+            p = mfu_crc64_multmodp(poly, p, p);
+            mfu_crc64_x2n[w][i] = p;
+        }
+    }
+}
+
+/* advance the raw registers of both CRC-64s over len bytes of buf,
+ * the two are updated in the same pass so their table lookups overlap */
+static void mfu_crc64_pair(uint64_t* lo, uint64_t* hi, const unsigned char* ptr, size_t len)
+{
+    const uint64_t (*t0)[256] = mfu_crc64_table[0];
+    const uint64_t (*t1)[256] = mfu_crc64_table[1];
+    uint64_t a = *lo;
+    uint64_t b = *hi;
+
+    /* process bytes until pointer is aligned, then 8 bytes at a time */
+    while (len > 0 && ((uintptr_t)ptr & 7) != 0) {
+        a = t0[0][(a ^ *ptr) & 0xff] ^ (a >> 8);
+        b = t1[0][(b ^ *ptr) & 0xff] ^ (b >> 8);
+        ptr++;
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t v = (uint64_t)ptr[0]       | (uint64_t)ptr[1] << 8  |
+                     (uint64_t)ptr[2] << 16 | (uint64_t)ptr[3] << 24 |
+                     (uint64_t)ptr[4] << 32 | (uint64_t)ptr[5] << 40 |
+                     (uint64_t)ptr[6] << 48 | (uint64_t)ptr[7] << 56;
+        a ^= v;
+        b ^= v;
+        a = t0[7][a & 0xff] ^
+            t0[6][(a >> 8) & 0xff] ^
+            t0[5][(a >> 16) & 0xff] ^
+            t0[4][(a >> 24) & 0xff] ^
+            t0[3][(a >> 32) & 0xff] ^
+            t0[2][(a >> 40) & 0xff] ^
+            t0[1][(a >> 48) & 0xff] ^
+            t0[0][a >> 56];
+        b = t1[7][b & 0xff] ^
+            t1[6][(b >> 8) & 0xff] ^
+            t1[5][(b >> 16) & 0xff] ^
+            t1[4][(b >> 24) & 0xff] ^
+            t1[3][(b >> 32) & 0xff] ^
+            t1[2][(b >> 40) & 0xff] ^
+            t1[1][(b >> 48) & 0xff] ^
+            t1[0][b >> 56];
+        ptr += 8;
+        len -= 8;
+    }
+    while (len > 0) {
+        a = t0[0][(a ^ *ptr) & 0xff] ^ (a >> 8);
+        b = t1[0][(b ^ *ptr) & 0xff] ^ (b >> 8);
+        ptr++;
+        len--;
+    }
+
+    *lo = a;
+    *hi = b;
+}
+
+/* multiply crc by x^(8*len) modulo the given polynomial */
+static uint64_t mfu_crc64_shift(int w, uint64_t crc, uint64_t len)
+{
+    uint64_t poly = mfu_crc64_poly[w];
+
+    /* compute x^(8*len), starting from x^0 and k = 3 for 8 bits per byte */
+    uint64_t p = (uint64_t)1 << 63;
+    unsigned k = 3;
+    while (len > 0) {
+        if (len & 1) {
+            p = mfu_crc64_multmodp(poly, mfu_crc64_x2n[w][k & 63], p);
+        }
+        len >>= 1;
+        k++;
+    }
+
+    return mfu_crc64_multmodp(poly, p, crc);
+}
+
+mfu_crc128 mfu_crc128_update(mfu_crc128 crc, const void* buf, size_t len)
+{
+    pthread_once(&mfu_crc64_table_once, mfu_crc64_init);
+
+    uint64_t lo = ~crc.lo;
+    uint64_t hi = ~crc.hi;
+    mfu_crc64_pair(&lo, &hi, (const unsigned char*) buf, len);
+    crc.lo = ~lo;
+    crc.hi = ~hi;
+    return crc;
+}
+
+mfu_crc128 mfu_crc128_combine(mfu_crc128 crc1, mfu_crc128 crc2, uint64_t len2)
+{
+    pthread_once(&mfu_crc64_table_once, mfu_crc64_init);
+
+    mfu_crc128 crc;
+    crc.lo = mfu_crc64_shift(0, crc1.lo, len2) ^ crc2.lo;
+    crc.hi = mfu_crc64_shift(1, crc1.hi, len2) ^ crc2.hi;
+    return crc;
+}
+
+mfu_crc128 mfu_crc128_zeros(mfu_crc128 crc, uint64_t len)
+{
+    pthread_once(&mfu_crc64_table_once, mfu_crc64_init);
+
+    /* as for mfu_crc32c_zeros, only the inversions need accounting */
+    crc.lo = ~mfu_crc64_shift(0, ~crc.lo, len);
+    crc.hi = ~mfu_crc64_shift(1, ~crc.hi, len);
+    return crc;
+}
+
+int mfu_crc128_equal(mfu_crc128 a, mfu_crc128 b)
+{
+    return (a.lo == b.lo && a.hi == b.hi);
+}
+
 void mfu_stat_get_atimes(const struct stat* sb, uint64_t* secs, uint64_t* nsecs)
 {
     *secs = (uint64_t) sb->st_atime;
@@ -675,6 +993,100 @@ void mfu_stat_set_ctimes (struct stat* sb, uint64_t secs, uint64_t nsecs)
 #endif
 }
 
+/* buffers used by mfu_compare_contents, kept from one call to the next
+ * since callers compare many chunks in a row */
+static void*  mfu_compare_src_buf = NULL;
+static void*  mfu_compare_dst_buf = NULL;
+static size_t mfu_compare_bufsize = 0;
+
+/* free buffers kept by mfu_compare_contents */
+void mfu_compare_contents_free(void)
+{
+    mfu_free(&mfu_compare_dst_buf);
+    mfu_free(&mfu_compare_src_buf);
+    mfu_compare_bufsize = 0;
+}
+
+/* read size bytes at pos from both files, the source is read with
+ * an asynchronous read while the destination is read in this thread,
+ * so that both requests are in flight at once, returns 0 on success
+ * and sets number of bytes read from each, which is short only at EOF,
+ * returns -1 on error */
+static int mfu_compare_read_pair(
+    const char* src_name,
+    int src_fd,
+    void* src_buf,
+    ssize_t* src_read,
+    const char* dst_name,
+    int dst_fd,
+    void* dst_buf,
+    ssize_t* dst_read,
+    size_t size,
+    off_t pos)
+{
+    /* start read of source file */
+    struct aiocb cb;
+    memset(&cb, 0, sizeof(struct aiocb));
+    cb.aio_fildes = src_fd;
+    cb.aio_buf    = src_buf;
+    cb.aio_nbytes = size;
+    cb.aio_offset = pos;
+    cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+    int active = (aio_read(&cb) == 0);
+
+    /* read destination file while source read is in flight */
+    errno = 0;
+    *dst_read = mfu_pread(dst_name, dst_fd, dst_buf, size, pos);
+    int dst_errno = errno;
+
+    /* wait for source read to complete, or read it now if the
+     * request could not be queued (e.g., EAGAIN) */
+    ssize_t nread;
+    int src_errno = 0;
+    if (active) {
+        const struct aiocb* list[1];
+        list[0] = &cb;
+        int err;
+        while ((err = aio_error(&cb)) == EINPROGRESS) {
+            aio_suspend(list, 1, NULL);
+        }
+        nread = aio_return(&cb);
+        if (err != 0) {
+            src_errno = err;
+            nread = -1;
+        } else if (nread > 0 && (size_t)nread < size) {
+            /* an asynchronous read may return fewer bytes than
+             * requested before EOF, read the rest with a blocking read */
+            errno = 0;
+            ssize_t rest = mfu_pread(src_name, src_fd, (char*)src_buf + nread,
+                size - (size_t)nread, pos + (off_t)nread);
+            src_errno = errno;
+            nread = (rest < 0) ? -1 : nread + rest;
+        }
+    } else {
+        errno = 0;
+        nread = mfu_pread(src_name, src_fd, src_buf, size, pos);
+        src_errno = errno;
+    }
+    *src_read = nread;
+
+    if (*src_read < 0) {
+        /* hit a read error */
+        MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' at offset %llx (errno=%d %s)",
+          src_name, (unsigned long long)pos, src_errno, strerror(src_errno));
+        return -1;
+    }
+
+    if (*dst_read < 0) {
+        /* hit a read error */
+        MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' at offset %llx (errno=%d %s)",
+          dst_name, (unsigned long long)pos, dst_errno, strerror(dst_errno));
+        return -1;
+    }
+
+    return 0;
+}
+
 /* compares contents of two files and optionally overwrite dest with source,
  * returns -1 on error, 0 if equal, 1 if different */
 int mfu_compare_contents(
@@ -688,8 +1100,13 @@ int mfu_compare_contents(
     uint64_t* count_bytes_written, /* OUT - number of bytes written to dest */
     mfu_progress* prg)             /* IN  - progress message structure */
 {
+    /* open files through the open file cache, since chunks of the same
+     * file tend to be compared one after another, callers close the
+     * cache with mfu_fd_cache_close_all when done comparing */
+    int opened;
+
     /* open source file */
-    int src_fd = mfu_open(src_name, O_RDONLY);
+    int src_fd = mfu_fd_cache_open(src_name, O_RDONLY, 0, &opened);
     if (src_fd < 0) {
         /* log error if there is an open failure on the src side */
         MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
@@ -704,12 +1121,11 @@ int mfu_compare_contents(
     }
 
     /* open destination file */
-    int dst_fd = mfu_open(dst_name, dst_flags);
+    int dst_fd = mfu_fd_cache_open(dst_name, dst_flags, 0, &opened);
     if (dst_fd < 0) {
         /* log error if there is an open failure on the dst side */
         MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
           dst_name, errno, strerror(errno));
-        mfu_close(src_name, src_fd);
         return -1;
     }
 
@@ -717,32 +1133,24 @@ int mfu_compare_contents(
     posix_fadvise(src_fd, offset, length, POSIX_FADV_SEQUENTIAL);
     posix_fadvise(dst_fd, offset, length, POSIX_FADV_SEQUENTIAL);
 
+    /* read ahead and drop pages behind us if asked to,
+     * the destination is flushed before dropping when overwriting */
+    mfu_cache_hint src_hint, dst_hint;
+    mfu_cache_hint_start(&src_hint, src_fd, 0, offset, length);
+    mfu_cache_hint_start(&dst_hint, dst_fd, overwrite, offset, length);
+
     /* assume we'll find that file contents are the same */
     int rc = 0;
 
-    /* seek to offset in source file */
-    if (mfu_lseek(src_name, src_fd, offset, SEEK_SET) == (off_t)-1) {
-        /* log error if there is an lseek failure on the src side */
-        MFU_LOG(MFU_LOG_ERR, "Failed to lseek `%s', offset: %lx (errno=%d %s)",
-          src_name, (unsigned long)offset, errno, strerror(errno));
-        mfu_close(dst_name, dst_fd);
-        mfu_close(src_name, src_fd);
-        return -1;
+    /* grow buffers to read file data if needed */
+    if (bufsize > mfu_compare_bufsize) {
+        mfu_compare_contents_free();
+        mfu_compare_src_buf = MFU_MALLOC(bufsize);
+        mfu_compare_dst_buf = MFU_MALLOC(bufsize);
+        mfu_compare_bufsize = bufsize;
     }
-
-    /* seek to offset in destination file */
-    if (mfu_lseek(dst_name, dst_fd, offset, SEEK_SET) == (off_t)-1) {
-        /* log error if there is an lseek failure on the dst side */
-        MFU_LOG(MFU_LOG_ERR, "Failed to lseek `%s', offset: %lx (errno=%d %s)",
-          dst_name, (unsigned long)offset, errno, strerror(errno));
-        mfu_close(dst_name, dst_fd);
-        mfu_close(src_name, src_fd);
-        return -1;
-    }
-
-    /* allocate buffers to read file data */
-    void* src_buf  = MFU_MALLOC(bufsize);
-    void* dest_buf = MFU_MALLOC(bufsize);
+    void* src_buf  = mfu_compare_src_buf;
+    void* dest_buf = mfu_compare_dst_buf;
 
     /* read and compare data from files */
     off_t total_bytes = 0;
@@ -761,39 +1169,22 @@ int mfu_compare_contents(
             }
         }
 
-        /* read data from source file */
-        ssize_t src_read = mfu_read(src_name, src_fd, (ssize_t*)src_buf, left_to_read);
-        if (src_read < 0) {
-            /* hit a read error */
-            MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' at offset %llx (errno=%d %s)",
-              src_name, (unsigned long long)pos, errno, strerror(errno));
+        /* read data from source and destination files together */
+        ssize_t src_read, dst_read;
+        int read_rc = mfu_compare_read_pair(src_name, src_fd, src_buf, &src_read,
+            dst_name, dst_fd, dest_buf, &dst_read, left_to_read, pos);
+        if (read_rc != 0) {
             rc = -1;
             break;
         }
 
         /* tally up number of bytes read */
         *count_bytes_read += (uint64_t) src_read;
-
-        /* read data from destination file */
-        ssize_t dst_read = mfu_read(dst_name, dst_fd, (ssize_t*)dest_buf, left_to_read);
-        if (dst_read < 0) {
-            /* hit a read error */
-            MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' at offset %llx (errno=%d %s)",
-              dst_name, (unsigned long long)pos, errno, strerror(errno));
-            rc = -1;
-            break;
-        }
-
-        /* tally up number of bytes read */
         *count_bytes_read += (uint64_t) dst_read;
 
-        /* TODO: could be a non-error short read, we could just adjust number
-         * of bytes we compare and update offset to shorter of the two values
-         * numread = min(src_read, dst_read) */
-
         /* check that we got the same number of bytes from each */
         if (src_read != dst_read) {
-            /* one read came up shorter than the other */
+            /* one file came up shorter than the other */
             rc = 1;
             if (! overwrite) {
                 break;
@@ -807,9 +1198,10 @@ int mfu_compare_contents(
             break;
         }
 
-        /* if have same size buffers, and read some data, let's check the contents */
+        /* if have same size buffers, and read some data, let's check the contents,
+         * the C library memcmp uses vector instructions where available */
         if (src_read == dst_read) {
-            if (memcmp((ssize_t*)src_buf, (ssize_t*)dest_buf, (size_t)src_read) != 0) {
+            if (memcmp(src_buf, dest_buf, (size_t)src_read) != 0) {
                 /* memory contents are different */
                 rc = 1;
                 if (! overwrite) {
@@ -822,22 +1214,13 @@ int mfu_compare_contents(
         /* if the bytes are different,
          * then copy the bytes from the source into the destination */
         if (overwrite && need_copy == 1) {
-            /* seek back to position to write to in destination file */
-            if (mfu_lseek(dst_name, dst_fd, pos, SEEK_SET) == (off_t)-1) {
-                /* log error if there is an lseek failure on the dst side */
-                MFU_LOG(MFU_LOG_ERR, "Failed to lseek `%s', offset: %llx (errno=%d %s)",
-                  dst_name, (unsigned long long)pos, strerror(errno));
-                rc = -1;
-                break;
-            }
-
             /* write data to destination file */
             size_t bytes_to_write = (size_t) src_read;
-            ssize_t bytes_written = mfu_write(dst_name, dst_fd, src_buf, bytes_to_write);
+            ssize_t bytes_written = mfu_pwrite(dst_name, dst_fd, src_buf, bytes_to_write, pos);
             if (bytes_written < 0) {
                 /* hit a write error */
                 MFU_LOG(MFU_LOG_ERR, "Failed to write `%s' at offset %llx (errno=%d %s)",
-                  dst_name, (unsigned long long)pos, strerror(errno));
+                  dst_name, (unsigned long long)pos, errno, strerror(errno));
                 rc = -1;
                 break;
             }
@@ -854,15 +1237,20 @@ int mfu_compare_contents(
         count_bytes[0] = *count_bytes_read;
         count_bytes[1] = *count_bytes_written;
         mfu_progress_update(count_bytes, prg);
-    }
 
-    /* free buffers */
-    mfu_free(&dest_buf);
-    mfu_free(&src_buf);
+        /* advance page cache hints past the bytes we compared */
+        mfu_cache_hint_advance(&src_hint, offset + total_bytes);
+        mfu_cache_hint_advance(&dst_hint, offset + total_bytes);
+
+        /* stop at end of source file */
+        if ((size_t)src_read < left_to_read) {
+            break;
+        }
+    }
 
-    /* close files */
-    mfu_close(dst_name, dst_fd);
-    mfu_close(src_name, src_fd);
+    /* drop what's left of the range from the page cache */
+    mfu_cache_hint_finish(&src_hint);
+    mfu_cache_hint_finish(&dst_hint);
 
     return rc;
 }
@@ -916,14 +1304,18 @@ int mfu_stripe_get(const char *path, uint64_t *stripe_size, uint64_t *stripe_cou
     return 0;
 }
 
-/* create a striped lustre file at the path provided with the specified stripe size and count */
-void mfu_stripe_set(const char *path, uint64_t stripe_size, int stripe_count)
+/* create a striped lustre file at the path provided with the specified
+ * stripe size and count, returns 0 on success and -1 with errno set
+ * on failure */
+int mfu_stripe_try_set(const char *path, uint64_t stripe_size, int stripe_count)
 {
 #ifdef LUSTRE_SUPPORT
 #if defined(HAVE_LLAPI_LAYOUT)
     /* create a new llapi_layout for file creation */
     struct llapi_layout *layout = llapi_layout_alloc();
-    int fd = -1;
+    if (layout == NULL) {
+        return -1;
+    }
 
     if (stripe_count == -1) {
         /* stripe count of -1 means use all availabe devices */
@@ -940,29 +1332,58 @@ void mfu_stripe_set(const char *path, uint64_t stripe_size, int stripe_count)
     llapi_layout_stripe_size_set(layout, stripe_size);
 
     /* create the file */
-    fd = llapi_layout_file_create(path, 0, 0644, layout);
-    if (fd < 0) {
-        fprintf(stderr, "cannot create %s: %s\n", path, strerror(errno));
-        fflush(stderr);
-        MPI_Abort(MPI_COMM_WORLD, 1);
-    }
-    close(fd);
+    int fd = llapi_layout_file_create(path, 0, 0644, layout);
+    int err = errno;
 
     /* free our alloced llapi_layout */
     llapi_layout_free(layout);
+
+    if (fd < 0) {
+        errno = err;
+        return -1;
+    }
+    close(fd);
+    return 0;
 #elif defined(HAVE_LLAPI_FILE_CREATE)
     int rc = llapi_file_create(path, stripe_size, 0, stripe_count, LOV_PATTERN_RAID0);
     if (rc < 0) {
-        fprintf(stderr, "cannot create %s: %s\n", path, strerror(-rc));
+        errno = -rc;
+        return -1;
+    }
+    return 0;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/* create a striped lustre file at the path provided with the specified stripe size and count */
+void mfu_stripe_set(const char *path, uint64_t stripe_size, int stripe_count)
+{
+#ifdef LUSTRE_SUPPORT
+    if (mfu_stripe_try_set(path, stripe_size, stripe_count) != 0) {
+        fprintf(stderr, "cannot create %s: %s\n", path, strerror(errno));
         fflush(stderr);
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
-#else
-    fprintf(stderr, "Unexpected Lustre version.\n");
-    fflush(stderr);
-    MPI_Abort(MPI_COMM_WORLD, 1);
 #endif
+}
+
+/* returns the number of OSTs in the lustre file system holding path,
+ * which must exist, or -1 if it cannot be determined */
+int mfu_stripe_ost_count(const char *path)
+{
+#ifdef LUSTRE_SUPPORT
+    int count = 0;
+    if (llapi_get_obd_count((char*)path, &count, 0) == 0 && count > 0) {
+        return count;
+    }
 #endif
+    return -1;
 }
 
 /* executes a logical AND operation on flag on all procs on comm,
@@ -221,6 +221,40 @@ void mfu_unpack_uint64(const char** pptr, uint64_t* value);
 /* Bob Jenkins one-at-a-time hash: http://en.wikipedia.org/wiki/Jenkins_hash_function */
 uint32_t mfu_hash_jenkins(const char* key, size_t len);
 
+/* given the CRC-32C (Castagnoli) checksum of some data, or 0 to start,
+ * return the checksum of that data followed by len bytes from buf */
+uint32_t mfu_crc32c(uint32_t crc, const void* buf, size_t len);
+
+/* given checksums crc1 and crc2 of two consecutive sections of data,
+ * where the second section is len2 bytes long, return the checksum
+ * of both sections together */
+uint32_t mfu_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/* given the checksum of some data, return the checksum of that data
+ * followed by len bytes of zeros, without touching len bytes */
+uint32_t mfu_crc32c_zeros(uint32_t crc, uint64_t len);
+
+/* 128-bit checksum made of two CRC-64s with different polynomials,
+ * CRC-64/XZ and CRC-64/NVME, which together act as a CRC of degree 128,
+ * used where a 32-bit checksum is too likely to miss a change,
+ * a zero value is the checksum of no data */
+typedef struct {
+    uint64_t hi; /* CRC-64/NVME */
+    uint64_t lo; /* CRC-64/XZ */
+} mfu_crc128;
+
+/* same as mfu_crc32c for mfu_crc128 */
+mfu_crc128 mfu_crc128_update(mfu_crc128 crc, const void* buf, size_t len);
+
+/* same as mfu_crc32c_combine for mfu_crc128 */
+mfu_crc128 mfu_crc128_combine(mfu_crc128 crc1, mfu_crc128 crc2, uint64_t len2);
+
+/* same as mfu_crc32c_zeros for mfu_crc128 */
+mfu_crc128 mfu_crc128_zeros(mfu_crc128 crc, uint64_t len);
+
+/* return 1 if two checksums are equal, 0 otherwise */
+int mfu_crc128_equal(mfu_crc128 a, mfu_crc128 b);
+
 /* get secs and nsecs values from stat structure */
 void mfu_stat_get_atimes(const struct stat* sb, uint64_t* secs, uint64_t* nsecs);
 void mfu_stat_get_mtimes(const struct stat* sb, uint64_t* secs, uint64_t* nsecs);
@@ -232,6 +266,9 @@ void mfu_stat_set_mtimes(struct stat* sb, uint64_t secs, uint64_t nsecs);
 void mfu_stat_set_ctimes(struct stat* sb, uint64_t secs, uint64_t nsecs);
 
 /* compares contents of two files and optionally overwrite dest with source,
+ * files are opened with mfu_fd_cache_open and left open for later calls,
+ * source and destination are read concurrently into buffers that are kept
+ * for later calls until mfu_compare_contents_free is called,
  * returns -1 on error, 0 if equal, 1 if different */
 int mfu_compare_contents(
     const char* src,         /* IN  - path name to souce file */
@@ -245,12 +282,23 @@ int mfu_compare_contents(
     mfu_progress* prg        /* IN  - progress message structure */
 );
 
+/* free I/O buffers kept by mfu_compare_contents */
+void mfu_compare_contents_free(void);
+
 /* uses the lustre api to obtain stripe count and stripe size of a file */
 int mfu_stripe_get(const char *path, uint64_t *stripe_size, uint64_t *stripe_count);
 
 /* create a striped lustre file at the path provided with the specified stripe size and count */
 void mfu_stripe_set(const char *path, uint64_t stripe_size, int stripe_count);
 
+/* like mfu_stripe_set, but returns 0 on success and -1 with errno set
+ * on failure rather than aborting */
+int mfu_stripe_try_set(const char *path, uint64_t stripe_size, int stripe_count);
+
+/* returns the number of OSTs in the lustre file system holding path,
+ * which must exist, or -1 if it cannot be determined */
+int mfu_stripe_ost_count(const char *path);
+
 /* executes a logical AND operation on flag on all procs on comm,
  * returns 1 if all true and 0 otherwise */
 int mfu_alltrue(int flag, MPI_Comm comm);
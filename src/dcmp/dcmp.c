@@ -17,7 +17,7 @@
 #include <assert.h>
 
 #include "mfu.h"
-#include "strmap.h"
+#include "cmpmap.h"
 #include "list.h"
 
 /* Print a usage message */
@@ -25,15 +25,26 @@ static void print_usage(void)
 {
     printf("\n");
     printf("Usage: dcmp [options] source target\n");
+    printf("       dcmp [options] --write-manifest <file> path\n");
+    printf("       dcmp [options] --manifest <file> path\n");
+    printf("       dcmp [options] --input <file> --dest-input <file> source target\n");
     printf("\n");
     printf("Options:\n");
     printf("  -o, --output <EXPR:FILE>  - write list of entries matching EXPR to FILE\n");
     printf("  -t, --text                - change output option to write in text format\n");
     printf("  -b, --base                - enable base checks and normal output with --output\n");
+    printf("  -i, --input <FILE>        - read list of source items from cache FILE rather than walking source\n");
+    printf("      --dest-input <FILE>   - read list of target items from cache FILE rather than walking target\n");
+    printf("      --blocksize <SIZE>    - IO buffer size in bytes when comparing contents (default 1MB)\n");
+    printf("  -k, --chunksize <SIZE>    - work size per task in bytes when comparing contents (default 1MB)\n");
+    printf("      --write-manifest <FILE> - write checksums of files and their chunks in path to FILE\n");
+    printf("      --manifest <FILE>     - compare files in path against checksums in manifest FILE\n");
+    printf("      --drop-cache          - drop file data from the page cache while comparing\n");
     printf("      --progress <N>        - print progress every N seconds\n");
     printf("  -v, --verbose             - verbose output\n");
     printf("  -q, --quiet               - quiet output\n");
     printf("  -l, --lite                - only compares file modification time and size\n");
+    printf("      --merge-join          - match items by sorting and merging paths rather than hashing them\n");
     //printf("  -d, --debug               - run in debug mode\n");
     printf("  -h, --help                - print usage\n");
     printf("\n");
@@ -83,7 +94,7 @@ typedef enum _dcmp_state {
       * This file only exist in dest directory.
       * Only valid for DCMPF_EXIST.
       * Not used yet,
-      * becuase we don't want to waste a loop in dcmp_strmap_compare()
+      * becuase we don't want to waste a loop in dcmp_map_compare()
       */
     DCMPS_ONLY_DEST,
 
@@ -164,6 +175,9 @@ struct dcmp_options {
     int format;			   /* output data format, 0 for text, 1 for raw */
     int base;                      /* whether to do base check */
     int debug;                     /* check result after get result */
+    int merge_join;                /* match items with sorted maps rather than hashed maps */
+    uint64_t chunk_size;           /* size of file sections compared by a process */
+    size_t block_size;             /* size of I/O buffer used to compare contents */
     int need_compare[DCMPF_MAX];   /* fields that need to be compared  */
 };
 
@@ -175,6 +189,9 @@ struct dcmp_options options = {
     .format       = 1,
     .base         = 0,
     .debug        = 0,
+    .merge_join   = 0,
+    .chunk_size   = 1024 * 1024,
+    .block_size   = 1024 * 1024,
     .need_compare = {0,}
 };
 
@@ -348,110 +365,99 @@ static int dcmp_state_from_string(const char* string, dcmp_state *state)
     return -ENOENT;
 }
 
-/* given a filename as the key, encode an index followed
- * by the init state */
-static void dcmp_strmap_item_init(
-    strmap* map,
+/* given a filename as the key, record its index
+ * and set each field to the init state */
+static void dcmp_map_item_init(
+    cmpmap* map,
     const char *key,
     uint64_t item_index)
 {
-    /* Should be long enough for 64 bit number and DCMPF_MAX */
-    char val[21 + DCMPF_MAX];
-    int i;
-
-    /* encode the index */
-    int len = snprintf(val, sizeof(val), "%llu",
-                       (unsigned long long) item_index);
-
-    /* encode the state (state characters and trailing NUL) */
-    assert((size_t)len + DCMPF_MAX + 1 <= (sizeof(val)));
-    size_t position = strlen(val);
-    for (i = 0; i < DCMPF_MAX; i++) {
-        val[position] = DCMPS_INIT;
-        position++;
-    }
-    val[position] = '\0';
-
-    /* add item to map */
-    strmap_set(map, key, val);
+    cmpmap_set(map, key, item_index);
 }
 
-static void dcmp_strmap_item_update(
-    strmap* map,
+static void dcmp_map_item_update(
+    cmpmap* map,
     const char *key,
     dcmp_field field,
     dcmp_state state)
 {
-    /* Should be long enough for 64 bit number and DCMPF_MAX */
-    char new_val[21 + DCMPF_MAX];
-
     /* lookup item from map */
-    const char* val = strmap_get(map, key);
-
-    /* copy existing index over */
+    cmpmap_entry* entry = cmpmap_get(map, key);
+    assert(entry != NULL);
     assert(field < DCMPF_MAX);
-    assert(strlen(val) + 1 <= sizeof(new_val));
-    strcpy(new_val, val);
 
     /* set new state value */
-    size_t position = strlen(new_val) - DCMPF_MAX;
-    new_val[position + field] = state;
-
-    /* reinsert item in map */
-    strmap_set(map, key, new_val);
+    entry->states[field] = (char) state;
 }
 
-static int dcmp_strmap_item_index(
-    strmap* map,
+static int dcmp_map_item_index(
+    cmpmap* map,
     const char *key,
     uint64_t *item_index)
 {
-    /* Should be long enough for 64 bit number and DCMPF_MAX */
-    char new_val[21 + DCMPF_MAX];
+    /* lookup item from map */
+    const cmpmap_entry* entry = cmpmap_get(map, key);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    /* extract index */
+    *item_index = entry->index;
 
+    return 0;
+}
+
+/* like dcmp_map_item_index, but when the map is sorted and keys
+ * are given in increasing order, cursor lets the lookups walk the
+ * map once, as in the merge pass of a sort-merge join */
+static int dcmp_map_item_match(
+    cmpmap* map,
+    const char *key,
+    uint64_t *cursor,
+    uint64_t *item_index)
+{
     /* lookup item from map */
-    const char* val = strmap_get(map, key);
-    if (val == NULL) {
+    const cmpmap_entry* entry = cmpmap_match(map, key, cursor);
+    if (entry == NULL) {
         return -1;
     }
 
     /* extract index */
-    assert(strlen(val) + 1 <= sizeof(new_val));
-    strcpy(new_val, val);
-    new_val[strlen(new_val) - DCMPF_MAX] = '\0';
-    *item_index = strtoull(new_val, NULL, 0);
+    *item_index = entry->index;
 
     return 0;
 }
 
-static int dcmp_strmap_item_state(
-    strmap* map,
+static int dcmp_map_item_state(
+    cmpmap* map,
     const char *key,
     dcmp_field field,
     dcmp_state *state)
 {
     /* lookup item from map */
-    const char* val = strmap_get(map, key);
-    if (val == NULL) {
+    const cmpmap_entry* entry = cmpmap_get(map, key);
+    if (entry == NULL) {
         return -1;
     }
 
     /* extract state */
-    assert(strlen(val) > DCMPF_MAX);
     assert(field < DCMPF_MAX);
-    size_t position = strlen(val) - DCMPF_MAX;
-    *state = val[position + field];
+    *state = (dcmp_state) entry->states[field];
 
     return 0;
 }
 
 /* map each file name to its index in the file list and initialize
  * its state for comparison operation */
-static strmap* dcmp_strmap_creat(mfu_flist list, const char* prefix)
+static cmpmap* dcmp_map_creat(mfu_flist list, const char* prefix)
 {
-    /* create a new string map to map a file name to a string
-     * encoding its index and state */
-    strmap* map = strmap_new();
+    /* create a new map from a file name to its index and state */
+    cmpmap* map;
+    if (options.merge_join) {
+        map = cmpmap_new_sorted(DCMPF_MAX, DCMPS_INIT, mfu_flist_size(list));
+    } else {
+        map = cmpmap_new(DCMPF_MAX, DCMPS_INIT, mfu_flist_size(list));
+    }
 
     /* determine length of prefix string */
     size_t prefix_len = strlen(prefix);
@@ -467,12 +473,16 @@ static strmap* dcmp_strmap_creat(mfu_flist list, const char* prefix)
         name += prefix_len;
 
         /* create entry for this file */
-        dcmp_strmap_item_init(map, name, i);
+        dcmp_map_item_init(map, name, i);
 
         /* go to next item in list */
         i++;
     }
 
+    /* sort entries by path so maps can be matched in a merge pass,
+     * this does nothing for hashed maps */
+    cmpmap_sort(map);
+
     return map;
 }
 
@@ -482,8 +492,8 @@ static void dcmp_compare_acl(
     uint64_t src_index,
     mfu_flist dst_list,
     uint64_t dst_index,
-    strmap* src_map,
-    strmap* dst_map,
+    cmpmap* src_map,
+    cmpmap* dst_map,
     int *diff)
 {
     void *src_val, *dst_val;
@@ -537,11 +547,11 @@ out:
 
 #endif
     if (is_same) {
-        dcmp_strmap_item_update(src_map, key, DCMPF_ACL, DCMPS_COMMON);
-        dcmp_strmap_item_update(dst_map, key, DCMPF_ACL, DCMPS_COMMON);
+        dcmp_map_item_update(src_map, key, DCMPF_ACL, DCMPS_COMMON);
+        dcmp_map_item_update(dst_map, key, DCMPF_ACL, DCMPS_COMMON);
     } else {
-        dcmp_strmap_item_update(src_map, key, DCMPF_ACL, DCMPS_DIFFER);
-        dcmp_strmap_item_update(dst_map, key, DCMPF_ACL, DCMPS_DIFFER);
+        dcmp_map_item_update(src_map, key, DCMPF_ACL, DCMPS_DIFFER);
+        dcmp_map_item_update(dst_map, key, DCMPF_ACL, DCMPS_DIFFER);
         (*diff)++;
     }
 }
@@ -554,10 +564,10 @@ static int dcmp_option_need_compare(dcmp_field field)
 /* Return -1 when error, return 0 when equal, return > 0 when diff */
 static int dcmp_compare_metadata(
     mfu_flist src_list,
-    strmap* src_map,
+    cmpmap* src_map,
     uint64_t src_index,
     mfu_flist dst_list,
-    strmap* dst_map,
+    cmpmap* dst_map,
     uint64_t dst_index,
     const char* key)
 {
@@ -570,16 +580,16 @@ static int dcmp_compare_metadata(
             uint64_t dst = mfu_flist_file_get_size(dst_list, dst_index);
             if (src != dst) {
                 /* file size is different */
-                dcmp_strmap_item_update(src_map, key, DCMPF_SIZE, DCMPS_DIFFER);
-                dcmp_strmap_item_update(dst_map, key, DCMPF_SIZE, DCMPS_DIFFER);
+                dcmp_map_item_update(src_map, key, DCMPF_SIZE, DCMPS_DIFFER);
+                dcmp_map_item_update(dst_map, key, DCMPF_SIZE, DCMPS_DIFFER);
                 diff++;
              } else {
-                dcmp_strmap_item_update(src_map, key, DCMPF_SIZE, DCMPS_COMMON);
-                dcmp_strmap_item_update(dst_map, key, DCMPF_SIZE, DCMPS_COMMON);
+                dcmp_map_item_update(src_map, key, DCMPF_SIZE, DCMPS_COMMON);
+                dcmp_map_item_update(dst_map, key, DCMPF_SIZE, DCMPS_COMMON);
              }
         } else {
-            dcmp_strmap_item_update(src_map, key, DCMPF_SIZE, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_SIZE, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_SIZE, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_SIZE, DCMPS_COMMON);
         }
     }
     if (dcmp_option_need_compare(DCMPF_GID)) {
@@ -587,12 +597,12 @@ static int dcmp_compare_metadata(
         uint64_t dst = mfu_flist_file_get_gid(dst_list, dst_index);
         if (src != dst) {
             /* file gid is different */
-            dcmp_strmap_item_update(src_map, key, DCMPF_GID, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_GID, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_GID, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_GID, DCMPS_DIFFER);
              diff++;
         } else {
-            dcmp_strmap_item_update(src_map, key, DCMPF_GID, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_GID, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_GID, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_GID, DCMPS_COMMON);
         }
     }
     if (dcmp_option_need_compare(DCMPF_UID)) {
@@ -600,12 +610,12 @@ static int dcmp_compare_metadata(
         uint64_t dst = mfu_flist_file_get_uid(dst_list, dst_index);
         if (src != dst) {
             /* file uid is different */
-            dcmp_strmap_item_update(src_map, key, DCMPF_UID, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_UID, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_UID, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_UID, DCMPS_DIFFER);
             diff++;
         } else {
-            dcmp_strmap_item_update(src_map, key, DCMPF_UID, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_UID, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_UID, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_UID, DCMPS_COMMON);
         }
     }
     if (dcmp_option_need_compare(DCMPF_ATIME)) {
@@ -615,12 +625,12 @@ static int dcmp_compare_metadata(
         uint64_t dst_atime_nsec = mfu_flist_file_get_atime_nsec(dst_list, dst_index);
         if ((src_atime != dst_atime) || (src_atime_nsec != dst_atime_nsec)) {
             /* file atime is different */
-            dcmp_strmap_item_update(src_map, key, DCMPF_ATIME, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_ATIME, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_ATIME, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_ATIME, DCMPS_DIFFER);
             diff++;
         } else {
-            dcmp_strmap_item_update(src_map, key, DCMPF_ATIME, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_ATIME, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_ATIME, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_ATIME, DCMPS_COMMON);
         }
     }
     if (dcmp_option_need_compare(DCMPF_MTIME)) {
@@ -630,12 +640,12 @@ static int dcmp_compare_metadata(
         uint64_t dst_mtime_nsec = mfu_flist_file_get_mtime_nsec(dst_list, dst_index);
         if ((src_mtime != dst_mtime) || (src_mtime_nsec != dst_mtime_nsec)) {
             /* file mtime is different */
-            dcmp_strmap_item_update(src_map, key, DCMPF_MTIME, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_MTIME, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_MTIME, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_MTIME, DCMPS_DIFFER);
             diff++;
         } else {
-            dcmp_strmap_item_update(src_map, key, DCMPF_MTIME, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_MTIME, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_MTIME, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_MTIME, DCMPS_COMMON);
         }
     }
     if (dcmp_option_need_compare(DCMPF_CTIME)) {
@@ -645,12 +655,12 @@ static int dcmp_compare_metadata(
         uint64_t dst_ctime_nsec = mfu_flist_file_get_ctime_nsec(dst_list, dst_index);
         if ((src_ctime != dst_ctime) || (src_ctime_nsec != dst_ctime_nsec)) {
             /* file ctime is different */
-            dcmp_strmap_item_update(src_map, key, DCMPF_CTIME, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_CTIME, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_CTIME, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_CTIME, DCMPS_DIFFER);
             diff++;
         } else {
-            dcmp_strmap_item_update(src_map, key, DCMPF_CTIME, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_CTIME, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_CTIME, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_CTIME, DCMPS_COMMON);
         }
     }
     if (dcmp_option_need_compare(DCMPF_PERM)) {
@@ -658,12 +668,12 @@ static int dcmp_compare_metadata(
         uint64_t dst = mfu_flist_file_get_perm(dst_list, dst_index);
         if (src != dst) {
             /* file perm is different */
-            dcmp_strmap_item_update(src_map, key, DCMPF_PERM, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_PERM, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_PERM, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_PERM, DCMPS_DIFFER);
             diff++;
         } else {
-            dcmp_strmap_item_update(src_map, key, DCMPF_PERM, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_PERM, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_PERM, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_PERM, DCMPS_COMMON);
         }
     }
     if (dcmp_option_need_compare(DCMPF_ACL)) {
@@ -749,11 +759,11 @@ static void compare_progress_fn(const uint64_t* vals, int count, int complete, i
 /* given a list of source/destination files to compare, spread file
  * sections to processes to compare in parallel, fill
  * in comparison results in source and dest string maps */
-static int dcmp_strmap_compare_data(
+static int dcmp_map_compare_data(
     mfu_flist src_compare_list,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_compare_list,
-    strmap* dst_map,
+    cmpmap* dst_map,
     size_t strlen_prefix)
 {
     /* assume we'll succeed */
@@ -764,8 +774,8 @@ static int dcmp_strmap_compare_data(
          MFU_LOG(MFU_LOG_INFO, "Comparing file contents");
     }
 
-    /* get chunk size for copying files (just hard-coded for now) */
-    uint64_t chunk_size = 1024 * 1024;
+    /* get chunk size for comparing files */
+    uint64_t chunk_size = options.chunk_size;
 
     /* get the linked list of file chunks for the src and dest */
     mfu_file_chunk* src_head = mfu_file_chunk_list_alloc(src_compare_list, chunk_size);
@@ -783,42 +793,19 @@ static int dcmp_strmap_compare_data(
     mfu_progress* prg = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
 
     /* compare bytes for each file section and set flag based on what we find */
-    uint64_t i = 0;
-    const mfu_file_chunk* src_p = src_head;
-    const mfu_file_chunk* dst_p = dst_head;
     uint64_t bytes_read    = 0;
     uint64_t bytes_written = 0;
-    for (i = 0; i < list_count; i++) {
-        /* get offset into file that we should compare (bytes) */
-        off_t offset = (off_t)src_p->offset;
-
-        /* get length of section that we should compare (bytes) */
-        off_t length = (off_t)src_p->length;
-
-        /* compare the contents of the files */
-        int overwrite = 0;
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length,
-                1048576, overwrite, &bytes_read, &bytes_written, prg);
-        if (compare_rc == -1) {
-            /* we hit an error while reading */
-            rc = -1;
-            MFU_LOG(MFU_LOG_ERR,
-              "Failed to open, lseek, or read %s and/or %s. Assuming contents are different.",
-                 src_p->name, dst_p->name);
-
-            /* consider files to be different,
-             * they could be the same, but we'll draw attention to them this way */
-            compare_rc = 1;
-        }
-
-        /* record results of comparison */
-        vals[i] = compare_rc;
-
-        /* update pointers for src and dest in linked list */
-        src_p = src_p->next;
-        dst_p = dst_p->next;
+    int overwrite = 0;
+    if (mfu_file_chunk_list_compare(src_head, dst_head, chunk_size, options.block_size,
+            overwrite, vals, &bytes_read, &bytes_written, prg) != 0)
+    {
+        rc = -1;
     }
 
+    /* close files left open by the comparisons and free their buffers */
+    mfu_fd_cache_close_all();
+    mfu_compare_contents_free();
+
     /* finalize progress messages */
     uint64_t count_bytes[2];
     count_bytes[0] = bytes_read;
@@ -832,9 +819,10 @@ static int dcmp_strmap_compare_data(
     /* execute logical OR over chunks for each file */
     mfu_file_chunk_list_lor(src_compare_list, src_head, vals, results);
 
-    /* unpack contents of recv buffer & store results in strmap */
+    /* unpack contents of recv buffer & store results in cmpmap */
+    uint64_t i;
     for (i = 0; i < size; i++) {
-        /* lookup name of file based on id to send to strmap updata call */
+        /* lookup name of file based on id to send to map update call */
         const char* name = mfu_flist_file_get_name(src_compare_list, i);
 
         /* ignore prefix portion of path to use as key */
@@ -843,16 +831,16 @@ static int dcmp_strmap_compare_data(
         /* get comparison results for this item */
         int flag = results[i];
 
-        /* set flag in strmap to record status of file */
+        /* set flag in map to record status of file */
         if (flag != 0) {
             /* update to say contents of the files were found to be different */
-            dcmp_strmap_item_update(src_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
 
         } else {
             /* update to say contents of the files were found to be the same */
-            dcmp_strmap_item_update(src_map, name, DCMPF_CONTENT, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, name, DCMPF_CONTENT, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_COMMON);
         }
     }
 
@@ -871,7 +859,7 @@ static int dcmp_strmap_compare_data(
     return rc;
 }
 
-static void time_strmap_compare(mfu_flist src_list, double start_compare,
+static void time_map_compare(mfu_flist src_list, double start_compare,
                                 double end_compare, time_t *time_started,
                                 time_t *time_ended, uint64_t total_bytes_read) {
 
@@ -928,10 +916,10 @@ static void time_strmap_compare(mfu_flist src_list, double start_compare,
 }
 
 /* compare entries from src into dst */
-static int dcmp_strmap_compare(mfu_flist src_list,
-                                strmap* src_map,
+static int dcmp_map_compare(mfu_flist src_list,
+                                cmpmap* src_map,
                                 mfu_flist dst_list,
-                                strmap* dst_map,
+                                cmpmap* dst_map,
                                 size_t strlen_prefix,
                                 const mfu_param_path* src_path,
                                 const mfu_param_path* dest_path)
@@ -965,20 +953,23 @@ static int dcmp_strmap_compare(mfu_flist src_list,
     uint64_t dst_mtime_nsec;
 
     /* iterate over each item in source map */
-    const strmap_node* node;
-    strmap_foreach(src_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t src_cursor = 0;
+    uint64_t dst_cursor = 0;
+    cmpmap_foreach(src_map, node) {
 
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
 
         /* get index of source file */
         uint64_t src_index;
-        tmp_rc = dcmp_strmap_item_index(src_map, key, &src_index);
+        tmp_rc = dcmp_map_item_match(src_map, key, &src_cursor, &src_index);
         assert(tmp_rc == 0);
 
         /* get index of destination file */
         uint64_t dst_index;
-        tmp_rc = dcmp_strmap_item_index(dst_map, key, &dst_index);
+        tmp_rc = dcmp_map_item_match(dst_map, key, &dst_cursor, &dst_index);
 
         /* get mtime seconds and nsecs to check modification times of src & dst */
         src_mtime      = mfu_flist_file_get_mtime(src_list, src_index);
@@ -987,14 +978,14 @@ static int dcmp_strmap_compare(mfu_flist src_list,
         dst_mtime_nsec = mfu_flist_file_get_mtime_nsec(dst_list, dst_index);
 
         if (tmp_rc) {
-            dcmp_strmap_item_update(src_map, key, DCMPF_EXIST, DCMPS_ONLY_SRC);
+            dcmp_map_item_update(src_map, key, DCMPF_EXIST, DCMPS_ONLY_SRC);
 
             /* skip uncommon files, all other states are DCMPS_INIT */
             continue;
         }
 
-        dcmp_strmap_item_update(src_map, key, DCMPF_EXIST, DCMPS_COMMON);
-        dcmp_strmap_item_update(dst_map, key, DCMPF_EXIST, DCMPS_COMMON);
+        dcmp_map_item_update(src_map, key, DCMPF_EXIST, DCMPS_COMMON);
+        dcmp_map_item_update(dst_map, key, DCMPF_EXIST, DCMPS_COMMON);
 
         /* get modes of files */
         mode_t src_mode = (mode_t) mfu_flist_file_get_mode(src_list,
@@ -1019,21 +1010,21 @@ static int dcmp_strmap_compare(mfu_flist src_list,
         /* check whether files are of the same type */
         if ((src_mode & S_IFMT) != (dst_mode & S_IFMT)) {
             /* file type is different, no need to go any futher */
-            dcmp_strmap_item_update(src_map, key, DCMPF_TYPE, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_TYPE, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_TYPE, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_TYPE, DCMPS_DIFFER);
 
             if (!dcmp_option_need_compare(DCMPF_CONTENT)) {
                 continue;
             }
 
             /* take them as differ content */
-            dcmp_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
             continue;
         }
 
-        dcmp_strmap_item_update(src_map, key, DCMPF_TYPE, DCMPS_COMMON);
-        dcmp_strmap_item_update(dst_map, key, DCMPF_TYPE, DCMPS_COMMON);
+        dcmp_map_item_update(src_map, key, DCMPF_TYPE, DCMPS_COMMON);
+        dcmp_map_item_update(dst_map, key, DCMPF_TYPE, DCMPS_COMMON);
 
         if (!dcmp_option_need_compare(DCMPF_CONTENT)) {
             /* Skip if no need to compare content. */
@@ -1044,18 +1035,18 @@ static int dcmp_strmap_compare(mfu_flist src_list,
         /* TODO: add support for symlinks */
         if (! S_ISREG(dst_mode)) {
             /* not regular file, take them as common content */
-            dcmp_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_COMMON);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_COMMON);
+            dcmp_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_COMMON);
+            dcmp_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_COMMON);
             continue;
         }
 
         dcmp_state state;
-        tmp_rc = dcmp_strmap_item_state(src_map, key, DCMPF_SIZE, &state);
+        tmp_rc = dcmp_map_item_state(src_map, key, DCMPF_SIZE, &state);
         assert(tmp_rc == 0);
         if (state == DCMPS_DIFFER) {
             /* file size is different, their contents should be different */
-            dcmp_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
-            dcmp_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dcmp_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dcmp_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
             continue;
         }
 
@@ -1065,11 +1056,11 @@ static int dcmp_strmap_compare(mfu_flist src_list,
                  * I don't think we can assume contents are different if the
                  * lite option is not on. Because files can have different
                  * modification times, but still have the same content. */
-                dcmp_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
-                dcmp_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+                dcmp_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+                dcmp_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
             } else {
-                dcmp_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_COMMON);
-                dcmp_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_COMMON);
+                dcmp_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_COMMON);
+                dcmp_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_COMMON);
             }
             continue;
         }
@@ -1091,7 +1082,7 @@ static int dcmp_strmap_compare(mfu_flist src_list,
         /* compare the contents of the files if we have anything in the compare list */
         cmp_global_size = mfu_flist_global_size(src_compare_list);
         if (cmp_global_size > 0) {
-            tmp_rc = dcmp_strmap_compare_data(src_compare_list, src_map, dst_compare_list,
+            tmp_rc = dcmp_map_compare_data(src_compare_list, src_map, dst_compare_list,
                     dst_map, strlen_prefix);
             if (tmp_rc < 0) {
                 /* got a read error, signal that back to caller */
@@ -1113,7 +1104,7 @@ static int dcmp_strmap_compare(mfu_flist src_list,
         total_bytes_read = get_total_bytes_read(src_compare_list);
     }
 
-    time_strmap_compare(src_list, start_compare, end_compare, &time_started,
+    time_map_compare(src_list, start_compare, end_compare, &time_started,
                         &time_ended, total_bytes_read);
 
     /* free the compare flists */
@@ -1124,37 +1115,40 @@ static int dcmp_strmap_compare(mfu_flist src_list,
 }
 
 /* loop on the src map to check the results */
-static void dcmp_strmap_check_src(strmap* src_map,
-                                  strmap* dst_map)
+static void dcmp_map_check_src(cmpmap* src_map,
+                                  cmpmap* dst_map)
 {
     assert(dcmp_option_need_compare(DCMPF_EXIST));
     /* iterate over each item in source map */
-    const strmap_node* node;
-    strmap_foreach(src_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t src_cursor = 0;
+    uint64_t dst_cursor = 0;
+    cmpmap_foreach(src_map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
         int only_src = 0;
 
         /* get index of source file */
         uint64_t src_index;
-        int ret = dcmp_strmap_item_index(src_map, key, &src_index);
+        int ret = dcmp_map_item_match(src_map, key, &src_cursor, &src_index);
         assert(ret == 0);
 
         /* get index of destination file */
         uint64_t dst_index;
-        ret = dcmp_strmap_item_index(dst_map, key, &dst_index);
+        ret = dcmp_map_item_match(dst_map, key, &dst_cursor, &dst_index);
         if (ret) {
             only_src = 1;
         }
 
         /* First check exist state */
         dcmp_state src_exist_state;
-        ret = dcmp_strmap_item_state(src_map, key, DCMPF_EXIST,
+        ret = dcmp_map_item_state(src_map, key, DCMPF_EXIST,
             &src_exist_state);
         assert(ret == 0);
 
         dcmp_state dst_exist_state;
-        ret = dcmp_strmap_item_state(dst_map, key, DCMPF_EXIST,
+        ret = dcmp_map_item_state(dst_map, key, DCMPF_EXIST,
             &dst_exist_state);
         if (only_src) {
             assert(ret);
@@ -1178,11 +1172,11 @@ static void dcmp_strmap_check_src(strmap* src_map,
 
             /* get state of src and dest */
             dcmp_state src_state;
-            ret = dcmp_strmap_item_state(src_map, key, field, &src_state);
+            ret = dcmp_map_item_state(src_map, key, field, &src_state);
             assert(ret == 0);
 
             dcmp_state dst_state;
-            ret = dcmp_strmap_item_state(dst_map, key, field, &dst_state);
+            ret = dcmp_map_item_state(dst_map, key, field, &dst_state);
             if (only_src) {
                 assert(ret);
             } else {
@@ -1211,26 +1205,29 @@ static void dcmp_strmap_check_src(strmap* src_map,
 }
 
 /* loop on the dest map to check the results */
-static void dcmp_strmap_check_dst(strmap* src_map,
-    strmap* dst_map)
+static void dcmp_map_check_dst(cmpmap* src_map,
+    cmpmap* dst_map)
 {
     assert(dcmp_option_need_compare(DCMPF_EXIST));
 
     /* iterate over each item in dest map */
-    const strmap_node* node;
-    strmap_foreach(dst_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t dst_cursor = 0;
+    uint64_t src_cursor = 0;
+    cmpmap_foreach(dst_map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
         int only_dest = 0;
 
         /* get index of destination file */
         uint64_t dst_index;
-        int ret = dcmp_strmap_item_index(dst_map, key, &dst_index);
+        int ret = dcmp_map_item_match(dst_map, key, &dst_cursor, &dst_index);
         assert(ret == 0);
 
         /* get index of source file */
         uint64_t src_index;
-        ret = dcmp_strmap_item_index(src_map, key, &src_index);
+        ret = dcmp_map_item_match(src_map, key, &src_cursor, &src_index);
         if (ret) {
             /* This file only exist in dest */
             only_dest = 1;
@@ -1238,7 +1235,7 @@ static void dcmp_strmap_check_dst(strmap* src_map,
 
         /* First check exist state */
         dcmp_state src_exist_state;
-        ret = dcmp_strmap_item_state(src_map, key, DCMPF_EXIST,
+        ret = dcmp_map_item_state(src_map, key, DCMPF_EXIST,
             &src_exist_state);
         if (only_dest) {
             assert(ret);
@@ -1247,7 +1244,7 @@ static void dcmp_strmap_check_dst(strmap* src_map,
         }
 
         dcmp_state dst_exist_state;
-        ret = dcmp_strmap_item_state(dst_map, key, DCMPF_EXIST,
+        ret = dcmp_map_item_state(dst_map, key, DCMPF_EXIST,
             &dst_exist_state);
         assert(ret == 0);
 
@@ -1268,7 +1265,7 @@ static void dcmp_strmap_check_dst(strmap* src_map,
 
             /* get state of src and dest */
             dcmp_state src_state;
-            ret = dcmp_strmap_item_state(src_map, key, field,
+            ret = dcmp_map_item_state(src_map, key, field,
                 &src_state);
             if (only_dest) {
                 assert(ret);
@@ -1277,7 +1274,7 @@ static void dcmp_strmap_check_dst(strmap* src_map,
             }
 
             dcmp_state dst_state;
-            ret = dcmp_strmap_item_state(dst_map, key, field,
+            ret = dcmp_map_item_state(dst_map, key, field,
                 &dst_state);
             assert(ret == 0);
 
@@ -1311,12 +1308,12 @@ static void dcmp_strmap_check_dst(strmap* src_map,
 }
 
 /* check the result maps are valid */
-static void dcmp_strmap_check(
-    strmap* src_map,
-    strmap* dst_map)
+static void dcmp_map_check(
+    cmpmap* src_map,
+    cmpmap* dst_map)
 {
-    dcmp_strmap_check_src(src_map, dst_map);
-    dcmp_strmap_check_dst(src_map, dst_map);
+    dcmp_map_check_src(src_map, dst_map);
+    dcmp_map_check_dst(src_map, dst_map);
 }
 
 static int dcmp_map_fn(
@@ -1341,6 +1338,329 @@ static int dcmp_map_fn(
     return rank;
 }
 
+/* return relative path of item used as its name in a manifest,
+ * which is the portion following the prefix without a leading slash,
+ * or "." for the prefix itself */
+static const char* dcmp_manifest_key(const char* name, size_t strlen_prefix)
+{
+    const char* key = name + strlen_prefix;
+    if (key[0] == '/') {
+        key++;
+    }
+    if (key[0] == '\0') {
+        key = ".";
+    }
+    return key;
+}
+
+/* return rank responsible for a manifest key */
+static int dcmp_manifest_key_rank(const char* key, int ranks)
+{
+    uint32_t hash = mfu_hash_jenkins(key, strlen(key));
+    return (int) (hash % (uint32_t)ranks);
+}
+
+static int dcmp_manifest_rank_fn(const char* name, int ranks, const void* args)
+{
+    return dcmp_manifest_key_rank(name, ranks);
+}
+
+static int dcmp_manifest_map_fn(
+    mfu_flist flist,
+    uint64_t idx,
+    int ranks,
+    void *args)
+{
+    /* the args pointer is a pointer to the directory prefix to
+     * be ignored in full path name */
+    const char* prefix = (const char*)args;
+    const char* name = mfu_flist_file_get_name(flist, idx);
+    const char* key = dcmp_manifest_key(name, strlen(prefix));
+    return dcmp_manifest_key_rank(key, ranks);
+}
+
+/* number of chunks a file of given size is split into,
+ * an empty file has a single empty chunk */
+static uint64_t dcmp_manifest_chunks(uint64_t size, uint64_t chunk_size)
+{
+    uint64_t chunks = size / chunk_size;
+    if (chunks * chunk_size < size || size == 0) {
+        chunks++;
+    }
+    return chunks;
+}
+
+/* compute checksums of all regular files in flist, which was walked
+ * from prefix, and write them to a manifest file with their paths
+ * relative to prefix, returns 0 on success and -1 on error */
+static int dcmp_manifest_create(
+    mfu_flist flist,
+    const char* prefix,
+    const char* file)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Computing checksums of file contents");
+    }
+
+    /* start timer */
+    double start_create = MPI_Wtime();
+
+    /* compute checksum of each file and each of its chunks */
+    uint64_t chunk_size = options.chunk_size;
+    uint64_t size = mfu_flist_size(flist);
+    mfu_crc128* crcs = (mfu_crc128*) MFU_MALLOC(size * sizeof(mfu_crc128));
+    int* valid = (int*) MFU_MALLOC(size * sizeof(int));
+    mfu_crc128** chunk_crcs = (mfu_crc128**) MFU_MALLOC(size * sizeof(mfu_crc128*));
+    if (mfu_flist_checksum_chunks(flist, chunk_size, options.block_size,
+        crcs, valid, chunk_crcs) != 0)
+    {
+        rc = -1;
+    }
+
+    /* build manifest entries of regular files */
+    uint64_t count = 0;
+    uint64_t max = 0;
+    mfu_manifest_entry* entries = NULL;
+    size_t strlen_prefix = strlen(prefix);
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+        if (type != MFU_TYPE_FILE || ! valid[idx]) {
+            continue;
+        }
+
+        const char* name = mfu_flist_file_get_name(flist, idx);
+        uint64_t file_size = mfu_flist_file_get_size(flist, idx);
+        uint64_t chunks = dcmp_manifest_chunks(file_size, chunk_size);
+        mfu_manifest_add_chunks(&entries, &count, &max,
+            dcmp_manifest_key(name, strlen_prefix),
+            file_size, mfu_flist_file_get_mtime(flist, idx),
+            mfu_flist_file_get_mtime_nsec(flist, idx),
+            crcs[idx], chunks, chunk_crcs[idx]);
+    }
+
+    /* write manifest */
+    if (mfu_manifest_write_chunks(file, chunk_size, count, entries) != 0) {
+        rc = -1;
+    }
+
+    /* stop timer */
+    double end_create = MPI_Wtime();
+
+    /* report number of files recorded */
+    uint64_t all_count;
+    MPI_Allreduce(&count, &all_count, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Wrote checksums of %" PRIu64 " files to `%s' in %.3lf secs",
+            all_count, file, end_create - start_create);
+    }
+
+    mfu_manifest_free(count, &entries);
+    for (idx = 0; idx < size; idx++) {
+        mfu_free(&chunk_crcs[idx]);
+    }
+    mfu_free(&chunk_crcs);
+    mfu_free(&valid);
+    mfu_free(&crcs);
+
+    return rc;
+}
+
+/* compare regular files in flist, which was walked from prefix,
+ * against checksums recorded in a manifest file, reads only the files
+ * whose size matches the manifest, returns 0 on success and -1 on error */
+static int dcmp_manifest_compare(
+    mfu_flist flist,
+    const char* prefix,
+    const char* file)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* start timer */
+    double start_compare = MPI_Wtime();
+
+    /* read manifest, manifests without checksums of chunks
+     * can still be compared file by file */
+    uint64_t chunk_size;
+    uint64_t count;
+    mfu_manifest_entry* entries;
+    if (mfu_manifest_read_chunks(file, &chunk_size, &count, &entries) != 0) {
+        mfu_manifest_free(count, &entries);
+        return -1;
+    }
+    if (chunk_size == 0) {
+        chunk_size = options.chunk_size;
+    }
+
+    /* bring each manifest entry and each item with the same
+     * relative path to the same rank */
+    mfu_manifest_spread(&count, &entries, dcmp_manifest_rank_fn, NULL);
+    mfu_flist list = mfu_flist_remap(flist, (mfu_flist_map_fn)dcmp_manifest_map_fn, (const void*)prefix);
+
+    /* map relative path of each item to its index,
+     * the state records whether the manifest names it */
+    size_t strlen_prefix = strlen(prefix);
+    uint64_t size = mfu_flist_size(list);
+    cmpmap* map = cmpmap_new(1, 0, size);
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        const char* name = mfu_flist_file_get_name(list, idx);
+        cmpmap_set(map, dcmp_manifest_key(name, strlen_prefix), idx);
+    }
+
+    /* match manifest entries to items, build a list of files
+     * whose contents we need to read */
+    uint64_t only_manifest = 0;
+    uint64_t only_tree     = 0;
+    uint64_t size_differ   = 0;
+    mfu_flist check_list = mfu_flist_subset(list);
+    uint64_t* check_entries = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+    for (idx = 0; idx < count; idx++) {
+        const mfu_manifest_entry* e = &entries[idx];
+        cmpmap_entry* item = cmpmap_get(map, e->name);
+        if (item == NULL) {
+            only_manifest++;
+            if (options.verbose) {
+                MFU_LOG(MFU_LOG_INFO, "Only in manifest: `%s'", e->name);
+            }
+            continue;
+        }
+        item->states[0] = 1;
+
+        mfu_filetype type = mfu_flist_file_get_type(list, item->index);
+        uint64_t item_size = mfu_flist_file_get_size(list, item->index);
+        if (type != MFU_TYPE_FILE || item_size != e->size) {
+            size_differ++;
+            if (options.verbose) {
+                MFU_LOG(MFU_LOG_INFO, "Type or size differs: `%s'", e->name);
+            }
+            continue;
+        }
+
+        uint64_t check_idx = mfu_flist_size(check_list);
+        mfu_flist_file_copy(list, item->index, check_list);
+        check_entries[check_idx] = idx;
+    }
+    mfu_flist_summarize(check_list);
+
+    /* count regular files the manifest does not name */
+    const cmpmap_entry* node;
+    cmpmap_foreach(map, node) {
+        if (node->states[0] == 0 &&
+            mfu_flist_file_get_type(list, node->index) == MFU_TYPE_FILE)
+        {
+            only_tree++;
+            if (options.verbose) {
+                MFU_LOG(MFU_LOG_INFO, "Only in tree: `%s'", node->key);
+            }
+        }
+    }
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Comparing file contents");
+    }
+
+    /* compute checksums of files with the chunk size of the manifest */
+    uint64_t check_size = mfu_flist_size(check_list);
+    mfu_crc128* crcs = (mfu_crc128*) MFU_MALLOC(check_size * sizeof(mfu_crc128));
+    int* valid = (int*) MFU_MALLOC(check_size * sizeof(int));
+    mfu_crc128** chunk_crcs = (mfu_crc128**) MFU_MALLOC(check_size * sizeof(mfu_crc128*));
+    if (mfu_flist_checksum_chunks(check_list, chunk_size, options.block_size,
+        crcs, valid, chunk_crcs) != 0)
+    {
+        rc = -1;
+    }
+
+    /* compare against checksums in manifest */
+    uint64_t content_differ = 0;
+    uint64_t content_common = 0;
+    uint64_t chunks_differ  = 0;
+    for (idx = 0; idx < check_size; idx++) {
+        const mfu_manifest_entry* e = &entries[check_entries[idx]];
+        if (valid[idx] && mfu_crc128_equal(crcs[idx], e->crc)) {
+            content_common++;
+            continue;
+        }
+        content_differ++;
+
+        /* count chunks that differ, which is all of them if we
+         * could not read the file or the manifest has no chunks */
+        uint64_t chunks = dcmp_manifest_chunks(e->size, chunk_size);
+        uint64_t differ = chunks;
+        if (valid[idx] && e->chunks == chunks) {
+            differ = 0;
+            uint64_t j;
+            for (j = 0; j < chunks; j++) {
+                if (! mfu_crc128_equal(chunk_crcs[idx][j], e->chunk_crcs[j])) {
+                    differ++;
+                }
+            }
+        }
+        chunks_differ += differ;
+
+        if (options.verbose) {
+            MFU_LOG(MFU_LOG_INFO, "Contents differ: `%s' (%" PRIu64 " of %" PRIu64 " chunks)",
+                e->name, differ, chunks);
+        }
+    }
+
+    /* sum counts across processes */
+    uint64_t vals[7], all_vals[7];
+    vals[0] = count;
+    vals[1] = only_manifest;
+    vals[2] = only_tree;
+    vals[3] = size_differ;
+    vals[4] = content_differ;
+    vals[5] = chunks_differ;
+    vals[6] = content_common;
+    MPI_Allreduce(vals, all_vals, 7, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    /* stop timer */
+    double end_compare = MPI_Wtime();
+
+    if (rank == 0) {
+        printf("Number of files in manifest: %" PRIu64 "\n", all_vals[0]);
+        printf("Number of files only in manifest: %" PRIu64 "\n", all_vals[1]);
+        printf("Number of files only in tree: %" PRIu64 "\n", all_vals[2]);
+        printf("Number of files that have different type or size: %" PRIu64 "\n", all_vals[3]);
+        printf("Number of files that have different contents: %" PRIu64 " (%" PRIu64 " chunks)\n",
+            all_vals[4], all_vals[5]);
+        printf("Number of files that have the same contents: %" PRIu64 "\n", all_vals[6]);
+        fflush(stdout);
+        MFU_LOG(MFU_LOG_INFO, "Compared against manifest in %.3lf secs",
+            end_compare - start_compare);
+    }
+
+    for (idx = 0; idx < check_size; idx++) {
+        mfu_free(&chunk_crcs[idx]);
+    }
+    mfu_free(&chunk_crcs);
+    mfu_free(&valid);
+    mfu_free(&crcs);
+    mfu_free(&check_entries);
+    mfu_flist_free(&check_list);
+    cmpmap_delete(&map);
+    mfu_flist_free(&list);
+    mfu_manifest_free(count, &entries);
+
+    /* determine whether any process hit an error */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all_rc;
+}
+
 static struct dcmp_expression* dcmp_expression_alloc(void)
 {
     struct dcmp_expression *expression;
@@ -1407,14 +1727,14 @@ static void dcmp_expression_print(
 
 static int dcmp_expression_match(
     struct dcmp_expression *expression,
-    strmap* map,
+    cmpmap* map,
     const char* key)
 {
     int ret;
     dcmp_state state;
     dcmp_state exist_state;
 
-    ret = dcmp_strmap_item_state(map, key, DCMPF_EXIST, &exist_state);
+    ret = dcmp_map_item_state(map, key, DCMPF_EXIST, &exist_state);
     assert(ret == 0);
     if (exist_state == DCMPS_ONLY_SRC) {
         /*
@@ -1454,7 +1774,7 @@ static int dcmp_expression_match(
     assert(exist_state == DCMPS_COMMON);
     assert(expression->field != DCMPF_EXIST);
 
-    ret = dcmp_strmap_item_state(map, key, expression->field, &state);
+    ret = dcmp_map_item_state(map, key, expression->field, &state);
     assert(ret == 0);
 
      /* All fields should have been compared. */
@@ -1536,7 +1856,7 @@ static void dcmp_conjunction_print(
 /* if matched return 1, else return 0 */
 static int dcmp_conjunction_match(
     struct dcmp_conjunction *conjunction,
-    strmap* map,
+    cmpmap* map,
     const char* key)
 {
     struct dcmp_expression* expression;
@@ -1635,7 +1955,7 @@ static void dcmp_disjunction_print(
 /* if matched return 1, else return 0 */
 static int dcmp_disjunction_match(
     struct dcmp_disjunction* disjunction,
-    strmap* map,
+    cmpmap* map,
     const char* key,
     int is_src)
 {
@@ -1728,23 +2048,25 @@ static void dcmp_option_add_comparison(dcmp_field field)
 
 static int dcmp_output_flist_match(
     struct dcmp_output *output,
-    strmap* map,
+    cmpmap* map,
     mfu_flist flist,
     mfu_flist new_flist,
     mfu_flist *matched_flist,
     int is_src)
 {
-    const strmap_node* node;
+    const cmpmap_entry* node;
     struct dcmp_conjunction *conjunction;
 
     /* iterate over each item in map */
-    strmap_foreach(map, node) {
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t cursor = 0;
+    cmpmap_foreach(map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
 
         /* get index of file */
         uint64_t idx;
-        int ret = dcmp_strmap_item_index(map, key, &idx);
+        int ret = dcmp_map_item_match(map, key, &cursor, &idx);
         assert(ret == 0);
 
         if (dcmp_disjunction_match(output->disjunction, map, key, is_src)) {
@@ -1771,9 +2093,9 @@ static int dcmp_output_flist_match(
 static int dcmp_output_write(
     struct dcmp_output *output,
     mfu_flist src_flist,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_flist,
-    strmap* dst_map)
+    cmpmap* dst_map)
 {
     int ret = 0;
     mfu_flist new_flist = mfu_flist_subset(src_flist);
@@ -1828,9 +2150,9 @@ static int dcmp_output_write(
 
 static int dcmp_outputs_write(
     mfu_flist src_list,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_list,
-    strmap* dst_map)
+    cmpmap* dst_map)
 {
     struct dcmp_output* output;
     int ret = 0;
@@ -2040,30 +2362,41 @@ int main(int argc, char **argv)
     /* pointer to mfu_walk_opts */
     mfu_walk_opts_t* walk_opts = mfu_walk_opts_new();
 
-    /* TODO: allow user to specify file lists as input files */
-
     /* TODO: three levels of comparison:
      *   1) file names only
      *   2) stat info + items in #1
      *   3) file contents + items in #2 */
 
-    /* walk by default because there is no input file option */
-    int walk = 1;
-
     /* By default, show info log messages. */
     /* we back off a level on CIRCLE verbosity since its INFO is verbose */
     CIRCLE_loglevel CIRCLE_debug = CIRCLE_LOG_WARN;
     mfu_debug_level = MFU_LOG_VERBOSE;
 
+    /* By default, compare two trees rather than use a manifest */
+    char* write_manifest_name = NULL;
+    char* manifest_name = NULL;
+
+    /* By default, walk both trees rather than read cache files */
+    char* src_input_name = NULL;
+    char* dst_input_name = NULL;
+
     int option_index = 0;
     static struct option long_options[] = {
         {"output",   1, 0, 'o'},
         {"text",     0, 0, 't'},
         {"base",     0, 0, 'b'},
+        {"input",    1, 0, 'i'},
+        {"dest-input", 1, 0, 'I'},
+        {"drop-cache", 0, 0, 'C'},
         {"progress", 1, 0, 'P'},
         {"verbose",  0, 0, 'v'},
         {"quiet",    0, 0, 'q'},
         {"lite",     0, 0, 'l'},
+        {"merge-join", 0, 0, 'M'},
+        {"chunksize", 1, 0, 'k'},
+        {"blocksize", 1, 0, 'B'},
+        {"write-manifest", 1, 0, 'W'},
+        {"manifest", 1, 0, 'm'},
         {"debug",    0, 0, 'd'},
         {"help",     0, 0, 'h'},
         {0, 0, 0, 0}
@@ -2074,9 +2407,10 @@ int main(int argc, char **argv)
     /* read in command line options */
     int usage = 0;
     int help  = 0;
+    unsigned long long bytes = 0;
     while (1) {
         int c = getopt_long(
-            argc, argv, "o:tbvqldh",
+            argc, argv, "o:tbi:k:vqldh",
             long_options, &option_index
         );
 
@@ -2097,6 +2431,17 @@ int main(int argc, char **argv)
         case 'b':
             options.base++;
             break;
+        case 'i':
+            mfu_free(&src_input_name);
+            src_input_name = MFU_STRDUP(optarg);
+            break;
+        case 'I':
+            mfu_free(&dst_input_name);
+            dst_input_name = MFU_STRDUP(optarg);
+            break;
+        case 'C':
+            mfu_io_cache_window = MFU_IO_CACHE_WINDOW;
+            break;
         case 'P':
             mfu_progress_timeout = atoi(optarg);
             break;
@@ -2114,6 +2459,39 @@ int main(int argc, char **argv)
         case 'l':
             options.lite++;
             break;
+        case 'M':
+            options.merge_join = 1;
+            break;
+        case 'k':
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR,
+                            "Failed to parse chunk size: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                options.chunk_size = (uint64_t)bytes;
+            }
+            break;
+        case 'B':
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR,
+                            "Failed to parse block size: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                options.block_size = (size_t)bytes;
+            }
+            break;
+        case 'W':
+            mfu_free(&write_manifest_name);
+            write_manifest_name = MFU_STRDUP(optarg);
+            break;
+        case 'm':
+            mfu_free(&manifest_name);
+            manifest_name = MFU_STRDUP(optarg);
+            break;
         case 'd':
             options.debug++;
             break;
@@ -2136,6 +2514,30 @@ int main(int argc, char **argv)
         usage = 1;
     }
 
+    /* a manifest replaces one of the two trees */
+    int manifest_mode = (write_manifest_name != NULL || manifest_name != NULL);
+    if (write_manifest_name != NULL && manifest_name != NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cannot use --write-manifest with --manifest");
+        }
+        usage = 1;
+    }
+    if (manifest_mode && (options.base || ! list_empty(&options.outputs))) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cannot use --output or --base with a manifest");
+        }
+        usage = 1;
+    }
+
+    /* a cache replaces walking one or both trees */
+    int input_mode = (src_input_name != NULL || dst_input_name != NULL);
+    if (input_mode && manifest_mode) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cannot use --input or --dest-input with a manifest");
+        }
+        usage = 1;
+    }
+
     /* Generate default output */
     if (options.base || list_empty(&options.outputs)) {
         /*
@@ -2152,11 +2554,26 @@ int main(int argc, char **argv)
         }
     }
 
-    /* we should have two arguments left, source and dest paths */
+    /* ACLs are read from the file system rather than the file list */
+    if (input_mode && dcmp_option_need_compare(DCMPF_ACL)) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cannot compare ACL with --input or --dest-input");
+        }
+        usage = 1;
+    }
+
+    /* we should have two arguments left, source and dest paths,
+     * or a single path to compare with a manifest */
     int numargs = argc - optind;
 
     /* if help flag was thrown, don't bother checking usage */
-    if (numargs != 2 && !help) {
+    if (manifest_mode) {
+        if (numargs != 1 && !help) {
+            MFU_LOG(MFU_LOG_ERR,
+                "You must specify a single path with a manifest.");
+            usage = 1;
+        }
+    } else if (numargs != 2 && !help) {
         MFU_LOG(MFU_LOG_ERR,
             "You must specify a source and destination path.");
         usage = 1;
@@ -2167,6 +2584,10 @@ int main(int argc, char **argv)
         if (rank == 0) {
             print_usage();
         }
+        mfu_free(&write_manifest_name);
+        mfu_free(&manifest_name);
+        mfu_free(&src_input_name);
+        mfu_free(&dst_input_name);
         dcmp_option_fini();
         mfu_finalize();
         MPI_Finalize();
@@ -2183,6 +2604,37 @@ int main(int argc, char **argv)
     /* advance to next set of options */
     optind += numargs;
 
+    /* write or compare against a manifest of a single tree */
+    if (manifest_mode) {
+        mfu_flist flist = mfu_flist_new();
+
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Walking path");
+        }
+        mfu_flist_walk_param_paths(1, &paths[0], walk_opts, flist);
+
+        int tmp_rc;
+        if (write_manifest_name != NULL) {
+            tmp_rc = dcmp_manifest_create(flist, paths[0].path, write_manifest_name);
+        } else {
+            tmp_rc = dcmp_manifest_compare(flist, paths[0].path, manifest_name);
+        }
+        if (tmp_rc < 0) {
+            rc = 1;
+        }
+
+        mfu_flist_free(&flist);
+        mfu_param_path_free_all(numargs, paths);
+        mfu_free(&paths);
+        mfu_free(&write_manifest_name);
+        mfu_free(&manifest_name);
+        dcmp_option_fini();
+        mfu_walk_opts_delete(&walk_opts);
+        mfu_finalize();
+        MPI_Finalize();
+        return rc;
+    }
+
     /* first item is source and second is dest */
     const mfu_param_path* srcpath  = &paths[0];
     const mfu_param_path* destpath = &paths[1];
@@ -2191,16 +2643,59 @@ int main(int argc, char **argv)
     mfu_flist flist1 = mfu_flist_new();
     mfu_flist flist2 = mfu_flist_new();
 
+    /* comparing file contents would read the trees we avoid walking,
+     * so decide them from size and modification time alone */
+    if (input_mode && !options.lite) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Comparing contents by size and mtime of cached items");
+        }
+        options.lite = 1;
+    }
 
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Walking source path");
+    int input_rc = 0;
+    if (src_input_name != NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Reading source list from `%s'", src_input_name);
+        }
+        if (mfu_flist_read_cache_under(src_input_name, srcpath->path, flist1) != 0) {
+            input_rc = -1;
+        }
+    } else {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Walking source path");
+        }
+        mfu_flist_walk_param_paths(1,  srcpath, walk_opts, flist1);
     }
-    mfu_flist_walk_param_paths(1,  srcpath, walk_opts, flist1);
 
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Walking destination path");
+    if (dst_input_name != NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Reading destination list from `%s'", dst_input_name);
+        }
+        if (mfu_flist_read_cache_under(dst_input_name, destpath->path, flist2) != 0) {
+            input_rc = -1;
+        }
+    } else {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Walking destination path");
+        }
+        mfu_flist_walk_param_paths(1, destpath, walk_opts, flist2);
+    }
+
+    mfu_free(&src_input_name);
+    mfu_free(&dst_input_name);
+
+    /* give up if either cache could not be used */
+    if (input_rc != 0) {
+        mfu_flist_free(&flist1);
+        mfu_flist_free(&flist2);
+        mfu_param_path_free_all(numargs, paths);
+        mfu_free(&paths);
+        dcmp_option_fini();
+        mfu_walk_opts_delete(&walk_opts);
+        mfu_finalize();
+        MPI_Finalize();
+        return 1;
     }
-    mfu_flist_walk_param_paths(1, destpath, walk_opts, flist2);
 
     /* store src and dest path strings */
     const char* path1 = srcpath->path;
@@ -2211,11 +2706,11 @@ int main(int argc, char **argv)
     mfu_flist flist4 = mfu_flist_remap(flist2, (mfu_flist_map_fn)dcmp_map_fn, (const void*)path2);
 
     /* map each file name to its index and its comparison state */
-    strmap* map1 = dcmp_strmap_creat(flist3, path1);
-    strmap* map2 = dcmp_strmap_creat(flist4, path2);
+    cmpmap* map1 = dcmp_map_creat(flist3, path1);
+    cmpmap* map2 = dcmp_map_creat(flist4, path2);
 
     /* compare files in map1 with those in map2 */
-    int tmp_rc = dcmp_strmap_compare(flist3, map1, flist4, map2, strlen(path1), srcpath, destpath);
+    int tmp_rc = dcmp_map_compare(flist3, map1, flist4, map2, strlen(path1), srcpath, destpath);
     if (tmp_rc < 0) {
         /* hit a read error on at least one file */
         rc = 1;
@@ -2223,15 +2718,15 @@ int main(int argc, char **argv)
 
     /* check the results are valid */
     if (options.debug) {
-        dcmp_strmap_check(map1, map2);
+        dcmp_map_check(map1, map2);
     }
 
     /* write data to cache files and print summary */
     dcmp_outputs_write(flist3, map1, flist4, map2);
 
     /* free maps of file names to comparison state info */
-    strmap_delete(&map1);
-    strmap_delete(&map2);
+    cmpmap_delete(&map1);
+    cmpmap_delete(&map2);
 
     /* free file lists */
     mfu_flist_free(&flist1);
@@ -59,6 +59,7 @@ void print_usage(void)
     printf("\n");
     printf("Usage: dcp [options] source target\n");
     printf("       dcp [options] source ... target_dir\n");
+    printf("       dcp [options] --verify manifest\n");
     printf("\n");
     printf("Options:\n");
     /* printf("  -d, --debug <level> - specify debug verbosity level (default info)\n"); */
@@ -66,12 +67,28 @@ void print_usage(void)
     /* printf("  -g, --grouplock <id> - use Lustre grouplock when reading/writing file\n"); */
 #endif
     printf("  -b, --blocksize     - IO buffer size in bytes (default 1MB)\n");
+    printf("      --bwlimit <SIZE> - limit total bytes copied per second across all processes\n");
+    printf("      --drop-cache    - drop file data from the page cache while copying\n");
+    printf("      --dynamic       - balance chunks across processes with work stealing\n");
+    printf("  -H, --hardlinks     - copy data of hard linked files once and link their other names\n");
     printf("  -i, --input <file>  - read source list from file\n");
+    printf("      --iodepth <N>   - number of blocks in flight per process while copying (default 2)\n");
+    printf("      --journal <dir> - record completed chunks in dir so the copy can be resumed\n");
+#ifdef LUSTRE_SUPPORT
+    printf("      --layout        - stripe preallocated files based on their size\n");
+#endif
     printf("  -k, --chunksize     - work size per task in bytes (default 1MB)\n");
+    printf("      --chunksize-max <SIZE> - adapt work size per file up to SIZE bytes\n");
+    printf("      --manifest <file> - write checksums of copied files to file\n");
     printf("  -p, --preserve      - preserve permissions, ownership, timestamps, extended attributes\n");
+    printf("      --prealloc <SIZE> - reserve space for destination files of at least SIZE bytes\n");
+    printf("      --resume        - skip chunks recorded as complete in the journal\n");
+    printf("      --opslimit <N>  - limit total metadata operations per second across all processes\n");
+    printf("      --smallfile <N> - copy files up to N bytes whole on one process (default 0, disabled)\n");
     printf("  -s, --synchronous   - use synchronous read/write calls (O_DIRECT)\n");
     printf("  -S, --sparse        - create sparse files when possible\n");
     printf("      --progress <N>  - print progress every N seconds\n");
+    printf("      --verify <file> - compare files against checksums in manifest file\n");
     printf("  -v, --verbose       - verbose output\n");
     printf("  -q, --quiet         - quiet output\n");
     printf("  -h, --help          - print usage\n");
@@ -109,17 +126,34 @@ int main(int argc, char** argv)
     /* By default, don't have iput file. */
     char* inputname = NULL;
 
+    /* By default, copy files rather than verify a manifest */
+    char* verifyname = NULL;
+
     int option_index = 0;
     static struct option long_options[] = {
         {"blocksize"            , required_argument, 0, 'b'},
+        {"bwlimit"              , required_argument, 0, 'W'},
         {"debug"                , required_argument, 0, 'd'}, // undocumented
+        {"drop-cache"           , no_argument      , 0, 'C'},
+        {"dynamic"              , no_argument      , 0, 'D'},
         {"grouplock"            , required_argument, 0, 'g'}, // untested
+        {"hardlinks"            , no_argument      , 0, 'H'},
         {"input"                , required_argument, 0, 'i'},
+        {"iodepth"              , required_argument, 0, 'Q'},
+        {"journal"              , required_argument, 0, 'J'},
+        {"layout"               , no_argument      , 0, 'L'},
         {"chunksize"            , required_argument, 0, 'k'},
+        {"chunksize-max"        , required_argument, 0, 'K'},
+        {"manifest"             , required_argument, 0, 'M'},
+        {"opslimit"             , required_argument, 0, 'O'},
         {"preserve"             , no_argument      , 0, 'p'},
+        {"prealloc"             , required_argument, 0, 'A'},
+        {"resume"               , no_argument      , 0, 'R'},
+        {"smallfile"            , required_argument, 0, 'F'},
         {"synchronous"          , no_argument      , 0, 's'},
         {"sparse"               , no_argument      , 0, 'S'},
         {"progress"             , required_argument, 0, 'P'},
+        {"verify"               , required_argument, 0, 'V'},
         {"verbose"              , no_argument      , 0, 'v'},
         {"quiet"                , no_argument      , 0, 'q'},
         {"help"                 , no_argument      , 0, 'h'},
@@ -131,7 +165,7 @@ int main(int argc, char** argv)
     int usage = 0;
     while(1) {
         int c = getopt_long(
-                    argc, argv, "b:d:g:i:k:psSvqh",
+                    argc, argv, "b:d:g:Hi:k:psSvqh",
                     long_options, &option_index
                 );
 
@@ -194,6 +228,15 @@ int main(int argc, char** argv)
                     }
                 }
                 break;
+            case 'C':
+                mfu_io_cache_window = MFU_IO_CACHE_WINDOW;
+                break;
+            case 'D':
+                mfu_copy_opts->dynamic = true;
+                if(rank == 0) {
+                    MFU_LOG(MFU_LOG_INFO, "Balancing chunks dynamically.");
+                }
+                break;
 #ifdef LUSTRE_SUPPORT
             case 'g':
                 mfu_copy_opts->grouplock_id = atoi(optarg);
@@ -209,6 +252,17 @@ int main(int argc, char** argv)
                     MFU_LOG(MFU_LOG_INFO, "Using input list.");
                 }
                 break;
+            case 'Q':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "I/O depth must be a positive integer: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->io_depth = (size_t) bytes;
+                }
+                break;
             case 'k':
                 if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
                     if (rank == 0) {
@@ -220,12 +274,94 @@ int main(int argc, char** argv)
                     mfu_copy_opts->chunk_size = bytes;
                 }
                 break;
+            case 'K':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse maximum chunk size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->chunk_size_max = (size_t)bytes;
+                }
+                break;
             case 'p':
                 mfu_copy_opts->preserve = true;
                 if(rank == 0) {
                     MFU_LOG(MFU_LOG_INFO, "Preserving file attributes.");
                 }
                 break;
+            case 'W':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse bandwidth limit: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->bw_limit = (uint64_t)bytes;
+                }
+                break;
+            case 'O':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse metadata operation limit: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->ops_limit = (uint64_t)bytes;
+                }
+                break;
+            case 'H':
+                mfu_copy_opts->hardlinks = true;
+                break;
+            case 'J':
+                mfu_free(&mfu_copy_opts->journal_dir);
+                mfu_copy_opts->journal_dir = MFU_STRDUP(optarg);
+                break;
+            case 'R':
+                mfu_copy_opts->resume = true;
+                break;
+            case 'M':
+                mfu_free(&mfu_copy_opts->manifest_file);
+                mfu_copy_opts->manifest_file = MFU_STRDUP(optarg);
+                break;
+            case 'V':
+                mfu_free(&verifyname);
+                verifyname = MFU_STRDUP(optarg);
+                break;
+            case 'A':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse preallocation size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->prealloc_size = (uint64_t)bytes;
+                }
+                break;
+            case 'L':
+#ifdef LUSTRE_SUPPORT
+                mfu_copy_opts->layout = true;
+#else
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_WARN, "Ignoring --layout, which requires Lustre support");
+                }
+#endif
+                break;
+            case 'F':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse small file size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->small_file_size = (uint64_t)bytes;
+                }
+                break;
             case 's':
                 mfu_copy_opts->synchronous = 1;
                 if(rank == 0) {
@@ -271,6 +407,53 @@ int main(int argc, char** argv)
         usage = 1;
     }
 
+    /* resuming needs the journal of the interrupted copy */
+    if (mfu_copy_opts->resume && mfu_copy_opts->journal_dir == NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "The --resume option requires --journal");
+        }
+        usage = 1;
+    }
+
+    /* layouts are only chosen for files that are preallocated */
+    if (mfu_copy_opts->layout && mfu_copy_opts->prealloc_size == 0) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "The --layout option requires --prealloc");
+        }
+        usage = 1;
+    }
+
+    /* verifying a manifest only reads the destination files it names */
+    if (verifyname != NULL) {
+        if (optind < argc) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "The --verify option takes no source or destination paths");
+            }
+            usage = 1;
+        }
+
+        if (usage) {
+            if (rank == 0) {
+                print_usage();
+            }
+            rc = 1;
+        } else {
+            int tmp_rc = mfu_manifest_verify(verifyname,
+                mfu_copy_opts->chunk_size, mfu_copy_opts->block_size);
+            if (tmp_rc < 0) {
+                rc = 1;
+            }
+        }
+
+        mfu_free(&verifyname);
+        mfu_free(&inputname);
+        mfu_copy_opts_delete(&mfu_copy_opts);
+        mfu_walk_opts_delete(&walk_opts);
+        mfu_finalize();
+        MPI_Finalize();
+        return rc;
+    }
+
     /* paths to walk come after the options */
     int numpaths = 0;
     int numpaths_src = 0;
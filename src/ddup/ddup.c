@@ -76,7 +76,8 @@ static void mtcmp_cmp_fini(DTCMP_Op* cmp)
     DTCMP_Op_free(cmp);
 }
 
-/* open the specified file, read specified chunk, and close file,
+/* open the specified file, read specified chunk, the file is left
+ * open in the open file cache for the next chunk,
  * returns -1 on any read error */
 static int read_data(const char* fname, char* chunk_buf, uint64_t chunk_id,
                      uint64_t chunk_size, uint64_t file_size,
@@ -93,7 +94,8 @@ static int read_data(const char* fname, char* chunk_buf, uint64_t chunk_id,
     memset(chunk_buf, 0, chunk_size);
 
     /* open the file */
-    int fd = mfu_open(fname, O_RDONLY);
+    int opened;
+    int fd = mfu_fd_cache_open(fname, O_RDONLY, 0, &opened);
     if (fd < 0) {
         return -1;
     }
@@ -135,8 +137,6 @@ static int read_data(const char* fname, char* chunk_buf, uint64_t chunk_id,
     *data_size = (uint64_t)read_size;
 
 out:
-    /* close our file and return */
-    mfu_close(fname, fd);
     return status;
 }
 
@@ -505,6 +505,9 @@ int main(int argc, char** argv)
                       MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
     }
 
+    /* close files left open by read_data */
+    mfu_fd_cache_close_all();
+
     /* free the walk options */
     mfu_walk_opts_delete(&walk_opts);
 
@@ -63,6 +63,8 @@ static void print_usage(void)
     printf("Options:\n");
     printf("  -i, --input <file>                      - read list from file\n");
     printf("  -o, --output <file>                     - write processed list to file\n");
+    printf("      --top <field>:<N>                   - print first N matches as sorted by numeric field\n");
+    printf("      --percentiles <field>               - print estimated percentiles of numeric field over matches\n");
     printf("  -v, --verbose                           - verbose output\n");
     printf("  -q, --quiet                             - quiet output\n");
     printf("  -h, --help                              - print usage\n");
@@ -92,6 +94,8 @@ static void print_usage(void)
     printf("\n");
     printf("  Tests with N can use -N (less than N), N (exactly N), +N (more than N)\n");
     printf("\n");
+    printf("Numeric fields: uid,gid,atime,mtime,ctime,size, precede with '-' to sort in descending order\n");
+    printf("\n");
     printf("Actions:\n");
     printf("  --print        - print item name to stdout\n");
     printf("  --exec CMD ;   - execute CMD on item\n");
@@ -206,6 +210,9 @@ int main (int argc, char** argv)
     mfu_pred* pred_head = mfu_pred_new();
     char* inputname  = NULL;
     char* outputname = NULL;
+    char* topfield   = NULL;
+    char* pctfield   = NULL;
+    uint64_t topcount = 0;
     int walk = 0;
     int text = 0;
 
@@ -215,6 +222,8 @@ int main (int argc, char** argv)
         {"verbose",   0, 0, 'v'},
         {"quiet",     0, 0, 'q'},
         {"help",      0, 0, 'h'},
+        {"top",         1, 0, 'K'},
+        {"percentiles", 1, 0, 'Q'},
 
         { "maxdepth", required_argument, NULL, 'd' },
 
@@ -418,6 +427,12 @@ int main (int argc, char** argv)
         case 'o':
             outputname = MFU_STRDUP(optarg);
             break;
+        case 'K':
+            topfield = MFU_STRDUP(optarg);
+            break;
+        case 'Q':
+            pctfield = MFU_STRDUP(optarg);
+            break;
         case 'v':
             mfu_debug_level = MFU_LOG_VERBOSE;
             break;
@@ -470,6 +485,28 @@ int main (int argc, char** argv)
         }
     }
 
+    /* parse <field>:<N> for top items */
+    if (topfield != NULL) {
+        char* field;
+        if (mfu_flist_parse_topk(topfield, &field, &topcount) != MFU_SUCCESS) {
+            if (rank == 0) {
+                printf("Invalid top argument, expected <field>:<N> with a numeric field: %s\n", topfield);
+            }
+            usage = 1;
+        }
+        else {
+            mfu_free(&topfield);
+            topfield = field;
+        }
+    }
+
+    if (pctfield != NULL && ! mfu_flist_numeric_field_valid(pctfield)) {
+        if (rank == 0) {
+            printf("Invalid percentiles field: %s\n", pctfield);
+        }
+        usage = 1;
+    }
+
     if (usage) {
         if (rank == 0) {
             print_usage();
@@ -495,6 +532,16 @@ int main (int argc, char** argv)
     /* apply predicates to each item in list */
     mfu_flist flist2 = mfu_flist_filter_pred(flist, pred_head);
 
+    /* print first matching items by numeric field */
+    if (topfield != NULL) {
+        mfu_flist_print_topk(flist2, topfield, topcount);
+    }
+
+    /* print percentiles of numeric field over matching items */
+    if (pctfield != NULL) {
+        mfu_flist_print_quantiles(flist2, pctfield);
+    }
+
     /* write data to cache file */
     if (outputname != NULL) {
         if (!text) {
@@ -514,6 +561,8 @@ int main (int argc, char** argv)
     mfu_pred_free(&pred_head);
 
     /* free memory allocated for options */
+    mfu_free(&pctfield);
+    mfu_free(&topfield);
     mfu_free(&outputname);
     mfu_free(&inputname);
 
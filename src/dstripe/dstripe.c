@@ -264,15 +264,19 @@ static void write_file_chunk(mfu_file_chunk* p, const char* out_path)
     /* allocate buffer */
     void* buf = MFU_MALLOC(chunk_size);
 
+    /* open files through the open file cache, since we often
+     * write several stripes of the same file one after another */
+    int opened;
+
     /* open input file for reading */
-    int in_fd = mfu_open(in_path, O_RDONLY);
+    int in_fd = mfu_fd_cache_open(in_path, O_RDONLY, 0, &opened);
     if (in_fd < 0) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open input file %s (%s)", in_path, strerror(errno));
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
     /* open output file for writing */
-    int out_fd = mfu_open(out_path, O_WRONLY);
+    int out_fd = mfu_fd_cache_open(out_path, O_WRONLY, 0, &opened);
     if (out_fd < 0) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open output file %s (%s)", out_path, strerror(errno));
         MPI_Abort(MPI_COMM_WORLD, 1);
@@ -372,11 +376,6 @@ static void write_file_chunk(mfu_file_chunk* p, const char* out_path)
         chunk_id++;
     }
 
-    /* close files */
-    mfu_fsync(out_path, out_fd);
-    mfu_close(out_path, out_fd);
-    mfu_close(in_path, in_fd);
-
     /* free buffer */
     mfu_free(&buf);
 }
@@ -637,6 +636,10 @@ int main(int argc, char* argv[])
     stripe_prog_bytes = 0;
     stripe_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, stripe_progress_fn);
 
+    /* the temp files replace the originals, so make sure their data
+     * is on disk, including files closed to make room for others */
+    mfu_fd_cache_set_sync(1);
+
     /* found a suffix, now we need to break our files into chunks based on stripe size */
     mfu_file_chunk* file_chunks = mfu_file_chunk_list_alloc(filtered, stripe_size);
     mfu_file_chunk* p = file_chunks;
@@ -654,6 +657,13 @@ int main(int argc, char* argv[])
     }
     mfu_file_chunk_list_free(&file_chunks);
 
+    /* flush and close files before we rename them */
+    if (mfu_fd_cache_close_all() != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to flush restriped files");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    mfu_fd_cache_set_sync(0);
+
     /* finalize progress messages */
     mfu_progress_complete(&stripe_prog_bytes, &stripe_prog);
 
@@ -38,7 +38,7 @@
 #include <assert.h>
 
 #include "mfu.h"
-#include "strmap.h"
+#include "cmpmap.h"
 #include "list.h"
 
 /* Print a usage message */
@@ -46,13 +46,25 @@ static void print_usage(void)
 {
     printf("\n");
     printf("Usage: dsync [options] source target\n");
+    printf("       dsync --dryrun [options] --input <file> --dest-input <file> source target\n");
     printf("\n");
     printf("Options:\n");
     printf("      --dryrun          - show differences, but do not synchronize files\n");
     printf("  -b  --batch-files <N> - batch files into groups of N during copy\n");
+    printf("      --blocksize <SIZE> - IO buffer size in bytes (default 1MB)\n");
+    printf("      --bwlimit <SIZE>  - limit total bytes copied per second across all processes\n");
+    printf("      --chunksize <SIZE> - work size per task in bytes (default 1MB)\n");
     printf("  -c, --contents        - read and compare file contents rather than compare size and mtime\n");
     printf("  -D, --delete          - delete extraneous files from target\n");
+    printf("      --delta           - update changed files in place, writing only chunks that differ\n");
+    printf("      --delta-manifest <FILE> - compare chunks against target checksums in manifest FILE, implies --delta\n");
+    printf("      --detect-renames  - rename target files matching new source files in size and mtime, requires --delete\n");
+    printf("      --drop-cache      - drop file data from the page cache while copying and comparing\n");
+    printf("  -i, --input <FILE>    - read list of source items from cache FILE, requires --dryrun\n");
+    printf("      --dest-input <FILE> - read list of target items from cache FILE, requires --dryrun\n");
     printf("      --link-dest <DIR> - hardlink to files in DIR when unchanged\n");
+    printf("      --merge-join      - match items by sorting and merging paths rather than hashing them\n");
+    printf("      --opslimit <N>    - limit total metadata operations per second during copy\n");
     printf("  -S, --sparse          - create sparse files when possible\n");
     printf("      --progress <N>    - print progress every N seconds\n");
     printf("  -v, --verbose         - verbose output\n");
@@ -83,7 +95,7 @@ typedef enum _dsync_state {
       * This file only exist in dest directory.
       * Only valid for DCMPF_EXIST.
       * Not used yet,
-      * becuase we don't want to waste a loop in dsync_strmap_compare()
+      * becuase we don't want to waste a loop in dsync_map_compare()
       */
     DCMPS_ONLY_DEST,
 
@@ -165,6 +177,12 @@ struct dsync_options {
     int debug;                     /* check result after get result */
     int delete;                    /* delete extraneous files from destination dirs */
     char* link_dest;               /* link dest dir */
+    int merge_join;                /* match items with sorted maps rather than hashed maps */
+    int delta;                     /* update changed files in place rather than replace them */
+    char* delta_manifest;          /* manifest of destination chunk checksums for delta */
+    int detect_renames;            /* rename files in destination rather than copy them again */
+    uint64_t chunk_size;           /* size of file sections compared by a process */
+    size_t block_size;             /* size of I/O buffer used to compare contents */
     int need_compare[DCMPF_MAX];   /* fields that need to be compared  */
 };
 
@@ -177,6 +195,12 @@ struct dsync_options options = {
     .debug        = 0,
     .delete       = 0,
     .link_dest    = NULL,
+    .merge_join   = 0,
+    .delta        = 0,
+    .delta_manifest = NULL,
+    .detect_renames = 0,
+    .chunk_size   = 1024 * 1024,
+    .block_size   = 1024 * 1024,
     .need_compare = {0,}
 };
 
@@ -350,110 +374,99 @@ static int dsync_state_from_string(const char* string, dsync_state *state)
     return -ENOENT;
 }
 
-/* given a filename as the key, encode an index followed
- * by the init state */
-static void dsync_strmap_item_init(
-    strmap* map,
+/* given a filename as the key, record its index
+ * and set each field to the init state */
+static void dsync_map_item_init(
+    cmpmap* map,
     const char *key,
     uint64_t item_index)
 {
-    /* Should be long enough for 64 bit number and DCMPF_MAX */
-    char val[21 + DCMPF_MAX];
-    int i;
-
-    /* encode the index */
-    int len = snprintf(val, sizeof(val), "%llu",
-                       (unsigned long long) item_index);
-
-    /* encode the state (state characters and trailing NUL) */
-    assert((size_t)len + DCMPF_MAX + 1 <= (sizeof(val)));
-    size_t position = strlen(val);
-    for (i = 0; i < DCMPF_MAX; i++) {
-        val[position] = DCMPS_INIT;
-        position++;
-    }
-    val[position] = '\0';
-
-    /* add item to map */
-    strmap_set(map, key, val);
+    cmpmap_set(map, key, item_index);
 }
 
-static void dsync_strmap_item_update(
-    strmap* map,
+static void dsync_map_item_update(
+    cmpmap* map,
     const char *key,
     dsync_field field,
     dsync_state state)
 {
-    /* Should be long enough for 64 bit number and DCMPF_MAX */
-    char new_val[21 + DCMPF_MAX];
-
     /* lookup item from map */
-    const char* val = strmap_get(map, key);
-
-    /* copy existing index over */
+    cmpmap_entry* entry = cmpmap_get(map, key);
+    assert(entry != NULL);
     assert(field < DCMPF_MAX);
-    assert(strlen(val) + 1 <= sizeof(new_val));
-    strcpy(new_val, val);
 
     /* set new state value */
-    size_t position = strlen(new_val) - DCMPF_MAX;
-    new_val[position + field] = state;
-
-    /* reinsert item in map */
-    strmap_set(map, key, new_val);
+    entry->states[field] = (char) state;
 }
 
-static int dsync_strmap_item_index(
-    strmap* map,
+static int dsync_map_item_index(
+    cmpmap* map,
     const char *key,
     uint64_t *item_index)
 {
-    /* Should be long enough for 64 bit number and DCMPF_MAX */
-    char new_val[21 + DCMPF_MAX];
+    /* lookup item from map */
+    const cmpmap_entry* entry = cmpmap_get(map, key);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    /* extract index */
+    *item_index = entry->index;
+
+    return 0;
+}
 
+/* like dsync_map_item_index, but when the map is sorted and keys
+ * are given in increasing order, cursor lets the lookups walk the
+ * map once, as in the merge pass of a sort-merge join */
+static int dsync_map_item_match(
+    cmpmap* map,
+    const char *key,
+    uint64_t *cursor,
+    uint64_t *item_index)
+{
     /* lookup item from map */
-    const char* val = strmap_get(map, key);
-    if (val == NULL) {
+    const cmpmap_entry* entry = cmpmap_match(map, key, cursor);
+    if (entry == NULL) {
         return -1;
     }
 
     /* extract index */
-    assert(strlen(val) + 1 <= sizeof(new_val));
-    strcpy(new_val, val);
-    new_val[strlen(new_val) - DCMPF_MAX] = '\0';
-    *item_index = strtoull(new_val, NULL, 0);
+    *item_index = entry->index;
 
     return 0;
 }
 
-static int dsync_strmap_item_state(
-    strmap* map,
+static int dsync_map_item_state(
+    cmpmap* map,
     const char *key,
     dsync_field field,
     dsync_state *state)
 {
     /* lookup item from map */
-    const char* val = strmap_get(map, key);
-    if (val == NULL) {
+    const cmpmap_entry* entry = cmpmap_get(map, key);
+    if (entry == NULL) {
         return -1;
     }
 
     /* extract state */
-    assert(strlen(val) > DCMPF_MAX);
     assert(field < DCMPF_MAX);
-    size_t position = strlen(val) - DCMPF_MAX;
-    *state = val[position + field];
+    *state = (dsync_state) entry->states[field];
 
     return 0;
 }
 
 /* map each file name to its index in the file list and initialize
  * its state for comparison operation */
-static strmap* dsync_strmap_creat(mfu_flist list, const char* prefix)
+static cmpmap* dsync_map_creat(mfu_flist list, const char* prefix)
 {
-    /* create a new string map to map a file name to a string
-     * encoding its index and state */
-    strmap* map = strmap_new();
+    /* create a new map from a file name to its index and state */
+    cmpmap* map;
+    if (options.merge_join) {
+        map = cmpmap_new_sorted(DCMPF_MAX, DCMPS_INIT, mfu_flist_size(list));
+    } else {
+        map = cmpmap_new(DCMPF_MAX, DCMPS_INIT, mfu_flist_size(list));
+    }
 
     /* determine length of prefix string */
     size_t prefix_len = strlen(prefix);
@@ -469,12 +482,16 @@ static strmap* dsync_strmap_creat(mfu_flist list, const char* prefix)
         name += prefix_len;
 
         /* create entry for this file */
-        dsync_strmap_item_init(map, name, i);
+        dsync_map_item_init(map, name, i);
 
         /* go to next item in list */
         i++;
     }
 
+    /* sort entries by path so maps can be matched in a merge pass,
+     * this does nothing for hashed maps */
+    cmpmap_sort(map);
+
     return map;
 }
 
@@ -484,12 +501,12 @@ do {                                                                         \
     uint64_t dst = mfu_flist_file_get_ ## field_name(dst_list, dst_index); \
     if (src != dst) {                                                        \
         /* file type is different */                                         \
-        dsync_strmap_item_update(src_map, key, field, DCMPS_DIFFER);          \
-        dsync_strmap_item_update(dst_map, key, field, DCMPS_DIFFER);          \
+        dsync_map_item_update(src_map, key, field, DCMPS_DIFFER);          \
+        dsync_map_item_update(dst_map, key, field, DCMPS_DIFFER);          \
         diff++;                                                              \
     } else {                                                                 \
-        dsync_strmap_item_update(src_map, key, field, DCMPS_COMMON);          \
-        dsync_strmap_item_update(dst_map, key, field, DCMPS_COMMON);          \
+        dsync_map_item_update(src_map, key, field, DCMPS_COMMON);          \
+        dsync_map_item_update(dst_map, key, field, DCMPS_COMMON);          \
     }                                                                        \
 } while(0)
 
@@ -499,8 +516,8 @@ static void dsync_compare_acl(
     uint64_t src_index,
     mfu_flist dst_list,
     uint64_t dst_index,
-    strmap* src_map,
-    strmap* dst_map,
+    cmpmap* src_map,
+    cmpmap* dst_map,
     int *diff)
 {
     void *src_val, *dst_val;
@@ -554,11 +571,11 @@ out:
 
 #endif
     if (is_same) {
-        dsync_strmap_item_update(src_map, key, DCMPF_ACL, DCMPS_COMMON);
-        dsync_strmap_item_update(dst_map, key, DCMPF_ACL, DCMPS_COMMON);
+        dsync_map_item_update(src_map, key, DCMPF_ACL, DCMPS_COMMON);
+        dsync_map_item_update(dst_map, key, DCMPF_ACL, DCMPS_COMMON);
     } else {
-        dsync_strmap_item_update(src_map, key, DCMPF_ACL, DCMPS_DIFFER);
-        dsync_strmap_item_update(dst_map, key, DCMPF_ACL, DCMPS_DIFFER);
+        dsync_map_item_update(src_map, key, DCMPF_ACL, DCMPS_DIFFER);
+        dsync_map_item_update(dst_map, key, DCMPF_ACL, DCMPS_DIFFER);
         (*diff)++;
     }
 }
@@ -571,10 +588,10 @@ static int dsync_option_need_compare(dsync_field field)
 /* Return -1 when error, return 0 when equal, return > 0 when diff */
 static int dsync_compare_metadata(
     mfu_flist src_list,
-    strmap* src_map,
+    cmpmap* src_map,
     uint64_t src_index,
     mfu_flist dst_list,
-    strmap* dst_map,
+    cmpmap* dst_map,
     uint64_t dst_index,
     const char* key)
 {
@@ -585,8 +602,8 @@ static int dsync_compare_metadata(
         if (type != MFU_TYPE_DIR) {
             dsync_compare_field(size, DCMPF_SIZE);
         } else {
-            dsync_strmap_item_update(src_map, key, DCMPF_SIZE, DCMPS_COMMON);
-            dsync_strmap_item_update(dst_map, key, DCMPF_SIZE, DCMPS_COMMON);
+            dsync_map_item_update(src_map, key, DCMPF_SIZE, DCMPS_COMMON);
+            dsync_map_item_update(dst_map, key, DCMPF_SIZE, DCMPS_COMMON);
         }
     }
     if (dsync_option_need_compare(DCMPF_GID)) {
@@ -678,7 +695,7 @@ static void compare_progress_fn(const uint64_t* vals, int count, int complete, i
 /* given a list of source/destination files to compare, spread file
  * sections to processes to compare in parallel, fill
  * in comparison results in source and dest string maps */
-static void dsync_strmap_compare_data_link_dest(
+static void dsync_map_compare_data_link_dest(
     mfu_flist src_compare_list,
     mfu_flist link_compare_list,
     mfu_flist link_same_list,
@@ -688,8 +705,8 @@ static void dsync_strmap_compare_data_link_dest(
     /* assume we'll succeed */
     int rc = 0;
 
-    /* get chunk size for copying files (just hard-coded for now) */
-    uint64_t chunk_size = 1024 * 1024;
+    /* get chunk size for comparing files */
+    uint64_t chunk_size = options.chunk_size;
 
     /* get the linked list of file chunks for the src and dest */
     mfu_file_chunk* src_head = mfu_file_chunk_list_alloc(src_compare_list, chunk_size);
@@ -713,39 +730,16 @@ static void dsync_strmap_compare_data_link_dest(
     mfu_progress* compare_prog = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
 
     /* compare bytes for each file section and set flag based on what we find */
-    uint64_t i = 0;
-    const mfu_file_chunk* src_p = src_head;
-    const mfu_file_chunk* dst_p = dst_head;
-    for (i = 0; i < list_count; i++) {
-        /* get offset into file that we should compare (bytes) */
-        off_t offset = (off_t)src_p->offset;
-
-        /* get length of section that we should compare (bytes) */
-        off_t length = (off_t)src_p->length;
-        
-        /* compare the contents of the files */
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length,
-                1048576, overwrite, count_bytes_read, count_bytes_written, compare_prog);
-        if (compare_rc == -1) {
-            /* we hit an error while reading */
-            rc = -1;
-            MFU_LOG(MFU_LOG_ERR,
-              "Failed to open, lseek, or read %s and/or %s. Assuming contents are different.",
-                 src_p->name, dst_p->name);
-
-            /* set flag to consider files to be different,
-             * could actually be the same, but we'll draw attention to them this way */
-            compare_rc = 1;
-        }
-
-        /* record results of comparison */
-        vals[i] = compare_rc;
-
-        /* update pointers for src and dest in linked list */
-        src_p = src_p->next;
-        dst_p = dst_p->next;
+    if (mfu_file_chunk_list_compare(src_head, dst_head, chunk_size, options.block_size,
+            overwrite, vals, count_bytes_read, count_bytes_written, compare_prog) != 0)
+    {
+        rc = -1;
     }
 
+    /* close files left open by the comparisons and free their buffers */
+    mfu_fd_cache_close_all();
+    mfu_compare_contents_free();
+
     /* finalize progress messages */
     count_bytes[0] = *count_bytes_read;
     count_bytes[1] = *count_bytes_written;
@@ -758,12 +752,13 @@ static void dsync_strmap_compare_data_link_dest(
     /* execute logical OR over chunks for each file */
     mfu_file_chunk_list_lor(src_compare_list, src_head, vals, results);
 
-    /* unpack contents of recv buffer & store results in strmap */
+    /* unpack contents of recv buffer & store results in cmpmap */
+    uint64_t i;
     for (i = 0; i < size; i++) {
         /* get comparison results for this item */
         int flag = results[i];
 
-        /* set flag in strmap to record status of file */
+        /* set flag in map to record status of file */
         if (flag == 0) {
             /* if same, add to same list */
 	    mfu_flist_file_copy(link_compare_list, i, link_same_list);
@@ -783,11 +778,11 @@ static void dsync_strmap_compare_data_link_dest(
     rc = all_rc;
 }
 
-static int dsync_strmap_compare_data(
+static int dsync_map_compare_data(
     mfu_flist src_compare_list,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_compare_list,
-    strmap* dst_map,
+    cmpmap* dst_map,
     mfu_flist src_list,
     mfu_flist src_cp_list,
     mfu_flist dst_same_list,
@@ -800,8 +795,8 @@ static int dsync_strmap_compare_data(
     /* assume we'll succeed */
     int rc = 0;
 
-    /* get chunk size for copying files (just hard-coded for now) */
-    uint64_t chunk_size = 1024 * 1024;
+    /* get chunk size for comparing files */
+    uint64_t chunk_size = options.chunk_size;
 
     /* get the linked list of file chunks for the src and dest */
     mfu_file_chunk* src_head = mfu_file_chunk_list_alloc(src_compare_list, chunk_size);
@@ -828,39 +823,16 @@ static int dsync_strmap_compare_data(
     mfu_progress* compare_prog = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
 
     /* compare bytes for each file section and set flag based on what we find */
-    uint64_t i = 0;
-    const mfu_file_chunk* src_p = src_head;
-    const mfu_file_chunk* dst_p = dst_head;
-    for (i = 0; i < list_count; i++) {
-        /* get offset into file that we should compare (bytes) */
-        off_t offset = (off_t)src_p->offset;
-
-        /* get length of section that we should compare (bytes) */
-        off_t length = (off_t)src_p->length;
-
-        /* compare the contents of the files */
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length,
-                1048576, overwrite, count_bytes_read, count_bytes_written, compare_prog);
-        if (compare_rc == -1) {
-            /* we hit an error while reading */
-            rc = -1;
-            MFU_LOG(MFU_LOG_ERR,
-              "Failed to open, lseek, or read %s and/or %s. Assuming contents are different.",
-                 src_p->name, dst_p->name);
-
-            /* set flag to consider files to be different,
-             * could actually be the same, but we'll draw attention to them this way */
-            compare_rc = 1;
-        }
-
-        /* record results of comparison */
-        vals[i] = compare_rc;
-
-        /* update pointers for src and dest in linked list */
-        src_p = src_p->next;
-        dst_p = dst_p->next;
+    if (mfu_file_chunk_list_compare(src_head, dst_head, chunk_size, options.block_size,
+            overwrite, vals, count_bytes_read, count_bytes_written, compare_prog) != 0)
+    {
+        rc = -1;
     }
 
+    /* close files left open by the comparisons and free their buffers */
+    mfu_fd_cache_close_all();
+    mfu_compare_contents_free();
+
     /* finalize progress messages */
     count_bytes[0] = *count_bytes_read;
     count_bytes[1] = *count_bytes_written;
@@ -873,9 +845,10 @@ static int dsync_strmap_compare_data(
     /* execute logical OR over chunks for each file */
     mfu_file_chunk_list_lor(src_compare_list, src_head, vals, results);
 
-    /* unpack contents of recv buffer & store results in strmap */
+    /* unpack contents of recv buffer & store results in cmpmap */
+    uint64_t i;
     for (i = 0; i < size; i++) {
-        /* lookup name of file based on id to send to strmap updata call */
+        /* lookup name of file based on id to send to map update call */
         const char* name = mfu_flist_file_get_name(src_compare_list, i);
 
         /* ignore prefix portion of path to use as key */
@@ -884,25 +857,26 @@ static int dsync_strmap_compare_data(
         /* get comparison results for this item */
         int flag = results[i];
 
-        /* set flag in strmap to record status of file */
+        /* set flag in map to record status of file */
         if (flag != 0) {
             /* update to say contents of the files were found to be different */
-            dsync_strmap_item_update(src_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
-            dsync_strmap_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(src_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
 
-            /* mark file to be deleted from destination, copied from source */
-            if (use_hardlinks) {
+            /* mark file to be deleted from destination, copied from source,
+             * a dry run records it to report what a sync would replace */
+            if (use_hardlinks || options.dry_run) {
                 mfu_flist_file_copy(dst_compare_list, i, dst_remove_list);
                 mfu_flist_file_copy(src_compare_list, i, src_cp_list);
             }
 
             /* Note: File does not need to be truncated for syncing because the size
              * of the dst and src will be the same. It is one of the checks in
-             * dsync_strmap_compare */
+             * dsync_map_compare */
         } else {
             /* update to say contents of the files were found to be the same */
-            dsync_strmap_item_update(src_map, name, DCMPF_CONTENT, DCMPS_COMMON);
-            dsync_strmap_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_COMMON);
+            dsync_map_item_update(src_map, name, DCMPF_CONTENT, DCMPS_COMMON);
+            dsync_map_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_COMMON);
 
             /* record that detination file matches source */
             if (use_hardlinks) {
@@ -936,7 +910,7 @@ static void dsync_generate_real_lists(
     size_t src_strlen_prefix,   /* length of prefix string to source directory */
     const mfu_param_path *link_path, /* param path for link-dest directory */
     mfu_flist dst_list,         /* list of files in destination */
-    strmap *dst_map,            /* map each file in destination to its index in dst_list */
+    cmpmap *dst_map,            /* map each file in destination to its index in dst_list */
     mfu_flist src_cp_list,      /* list of files to be copied to destination */
     mfu_flist dst_same_list,    /* list of files in destination that are same as in source */
     mfu_flist link_same_list,   /* list of files in link-dest that are same as in source */
@@ -947,7 +921,7 @@ static void dsync_generate_real_lists(
     uint64_t idx;
 
     /* create map of item name to index in its respective list */
-    strmap* link_same_map = dsync_strmap_creat(link_same_list, link_path->path);
+    cmpmap* link_same_map = dsync_map_creat(link_same_list, link_path->path);
 
     /* walk list of files we need to copy from source to destination,
      * and split into set that must actually be copied and set that
@@ -971,7 +945,7 @@ static void dsync_generate_real_lists(
          * is the same, if so, we'll create a hardlink,
          * otherwise we need to make a fresh copy */
         uint64_t index;
-        int rc = dsync_strmap_item_index(link_same_map, name, &index);
+        int rc = dsync_map_item_index(link_same_map, name, &index);
         if (rc >= 0) {
             /* file in link-dest is same as source,
              * create a hardlink in destination */
@@ -1004,11 +978,11 @@ static void dsync_generate_real_lists(
          * remove existing item at destination and replace with hardlink,
          * otherwise, do nothing */
         uint64_t index;
-        int rc = dsync_strmap_item_index(link_same_map, name, &index);
+        int rc = dsync_map_item_index(link_same_map, name, &index);
         if (rc >= 0) {
             /* get index of item in destination list */
             uint64_t dst_index;
-            rc = dsync_strmap_item_index(dst_map, name, &dst_index);
+            rc = dsync_map_item_index(dst_map, name, &dst_index);
             assert(rc >= 0);
 
             /* get full path to destination and link-dest */
@@ -1040,13 +1014,13 @@ static void dsync_generate_real_lists(
     mfu_flist_summarize(dst_remove_list);
 
     /* free the map */
-    strmap_delete(&link_same_map);
+    cmpmap_delete(&link_same_map);
 }
 
 /* given a list of source/destination files to compare, spread file
  * sections to processes to compare in parallel, fill
  * in comparison results in source and dest string maps */
-static void dsync_strmap_compare_lite_link_dest(
+static void dsync_map_compare_lite_link_dest(
     mfu_flist src_compare_list,
     mfu_flist link_compare_list,
     mfu_flist link_same_list)
@@ -1079,14 +1053,16 @@ static void dsync_strmap_compare_lite_link_dest(
 /* given a list of source/destination files to compare, spread file
  * sections to processes to compare in parallel, fill
  * in comparison results in source and dest string maps */
-static int dsync_strmap_compare_lite(
+static int dsync_map_compare_lite(
     mfu_flist src_compare_list,
     mfu_flist src_cp_list,
     mfu_flist dst_same_list,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_compare_list,
     mfu_flist dst_remove_list,
-    strmap* dst_map,
+    cmpmap* dst_map,
+    mfu_flist src_delta_list,
+    mfu_flist dst_delta_list,
     size_t strlen_prefix,
     bool use_hardlinks)
 {
@@ -1099,7 +1075,7 @@ static int dsync_strmap_compare_lite(
     /* check size and mtime of each item */
     uint64_t idx;
     for (idx = 0; idx < size; idx++) {
-        /* lookup name of file based on id to send to strmap updata call */
+        /* lookup name of file based on id to send to map update call */
         const char* name = mfu_flist_file_get_name(src_compare_list, idx);
 
         /* ignore prefix portion of path to use as key */
@@ -1120,18 +1096,22 @@ static int dsync_strmap_compare_lite(
             (src_mtime != dst_mtime) || (src_mtime_nsec != dst_mtime_nsec))
         {
             /* update to say contents of the files were found to be different */
-            dsync_strmap_item_update(src_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
-            dsync_strmap_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(src_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_DIFFER);
 
-            /* mark file to be deleted from destination, copied from source */
-            if (!options.dry_run || use_hardlinks) {
+            if (options.delta) {
+                /* mark file to be updated in place from source */
+                mfu_flist_file_copy(src_compare_list, idx, src_delta_list);
+                mfu_flist_file_copy(dst_compare_list, idx, dst_delta_list);
+            } else {
+                /* mark file to be deleted from destination, copied from source */
                 mfu_flist_file_copy(dst_compare_list, idx, dst_remove_list);
                 mfu_flist_file_copy(src_compare_list, idx, src_cp_list);
             }
         } else {
             /* update to say contents of the files were found to be the same */
-            dsync_strmap_item_update(src_map, name, DCMPF_CONTENT, DCMPS_COMMON);
-            dsync_strmap_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_COMMON);
+            dsync_map_item_update(src_map, name, DCMPF_CONTENT, DCMPS_COMMON);
+            dsync_map_item_update(dst_map, name, DCMPF_CONTENT, DCMPS_COMMON);
 
             /* record that detination file matches source */
             if (use_hardlinks) {
@@ -1226,34 +1206,545 @@ static void print_comparison_stats(
 }
 
 /* loop on the dest map to check for files only in the dst list
- * and copy to a remove_list for the --sync option */
-static void dsync_only_dst(strmap* src_map,
-    strmap* dst_map, mfu_flist dst_list, mfu_flist dst_remove_list)
+ * and copy to a remove_list for the --sync option, skipping any
+ * set in moved, which may be NULL */
+static void dsync_only_dst(cmpmap* src_map,
+    cmpmap* dst_map, mfu_flist dst_list, mfu_flist dst_remove_list,
+    const int* moved)
 {
     /* iterate over each item in dest map */
-    const strmap_node* node;
-    strmap_foreach(dst_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t dst_cursor = 0;
+    uint64_t src_cursor = 0;
+    cmpmap_foreach(dst_map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
 
         /* get index of destination file */
         uint64_t dst_index;
-        int ret = dsync_strmap_item_index(dst_map, key, &dst_index);
+        int ret = dsync_map_item_match(dst_map, key, &dst_cursor, &dst_index);
         assert(ret == 0);
 
         /* get index of source file */
         uint64_t src_index;
-        ret = dsync_strmap_item_index(src_map, key, &src_index);
-        if (ret) {
+        ret = dsync_map_item_match(src_map, key, &src_cursor, &src_index);
+        if (ret && (moved == NULL || ! moved[dst_index])) {
             /* This file only exist in dest */
             mfu_flist_file_copy(dst_list, dst_index, dst_remove_list);
         }
     }
 }
 
+/* a regular file only in the source or only in the destination,
+ * which may be the same file under another name */
+typedef struct {
+    uint64_t size;       /* size of file in bytes */
+    uint64_t mtime;      /* modification time seconds */
+    uint64_t mtime_nsec; /* modification time nanoseconds */
+    uint64_t side;       /* 0 if file is in source, 1 if in destination */
+    int rank;            /* rank that owns the file */
+    uint64_t index;      /* index of file in candidate list on its owner */
+    const char* buf;     /* packed file */
+    uint64_t bytes;      /* number of bytes in packed file */
+} dsync_rename_rec;
+
+/* order records by size and mtime, then source before destination,
+ * and then by owner, so files are paired the same way on every run */
+static int dsync_rename_rec_cmp(const void* a, const void* b)
+{
+    const dsync_rename_rec* x = (const dsync_rename_rec*) a;
+    const dsync_rename_rec* y = (const dsync_rename_rec*) b;
+    if (x->size != y->size) {
+        return (x->size < y->size) ? -1 : 1;
+    }
+    if (x->mtime != y->mtime) {
+        return (x->mtime < y->mtime) ? -1 : 1;
+    }
+    if (x->mtime_nsec != y->mtime_nsec) {
+        return (x->mtime_nsec < y->mtime_nsec) ? -1 : 1;
+    }
+    if (x->side != y->side) {
+        return (x->side < y->side) ? -1 : 1;
+    }
+    if (x->rank != y->rank) {
+        return (x->rank < y->rank) ? -1 : 1;
+    }
+    if (x->index != y->index) {
+        return (x->index < y->index) ? -1 : 1;
+    }
+    return 0;
+}
+
+/* return rank that pairs up files with the size and mtime of this one */
+static int dsync_rename_rank(mfu_flist list, uint64_t idx, int ranks)
+{
+    uint64_t vals[3];
+    vals[0] = mfu_flist_file_get_size(list, idx);
+    vals[1] = mfu_flist_file_get_mtime(list, idx);
+    vals[2] = mfu_flist_file_get_mtime_nsec(list, idx);
+    uint32_t hash = mfu_hash_jenkins((const char*)vals, sizeof(vals));
+    return (int) (hash % (uint32_t)ranks);
+}
+
+/* number of bytes packed for each file ahead of the file itself */
+#define DSYNC_RENAME_HEADER (6 * 8)
+
+/* pair regular files only in the source with regular files only in
+ * the destination that have the same size and mtime, files from both
+ * sides are sent to a rank picked by hashing those values, which sorts
+ * them and pairs them up, size and mtime alone do not tell which of
+ * several such files is which, so a group with more than one file on
+ * either side is only paired up in order when --contents will check
+ * each pair before it is renamed, matched source files are added to
+ * src_rename_list with their destination file at the same position in
+ * dst_rename_list, and moved is set for the destination file on its
+ * owner, other source files are added to src_cp_list */
+static void dsync_match_renames(
+    mfu_flist src_move_list,   /* IN  - regular files only in source */
+    cmpmap* src_map,           /* IN  - map of source files */
+    mfu_flist dst_list,        /* IN  - list of destination files */
+    cmpmap* dst_map,           /* IN  - map of destination files */
+    mfu_flist src_cp_list,     /* OUT - source files to be copied */
+    mfu_flist src_rename_list, /* OUT - source files found in destination */
+    mfu_flist dst_rename_list, /* OUT - destination files to be renamed */
+    int* moved)                /* OUT - set to 1 for renamed files in dst_list */
+{
+    /* get number of ranks */
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* find regular files that are only in the destination, recording
+     * their index in dst_list, empty files are left to be created and
+     * removed as before since there is no data to save */
+    mfu_flist dst_move_list = mfu_flist_subset(dst_list);
+    uint64_t* dst_move_index = (uint64_t*) MFU_MALLOC(mfu_flist_size(dst_list) * sizeof(uint64_t));
+    uint64_t dst_move_count = 0;
+    const cmpmap_entry* node;
+    uint64_t dst_cursor = 0;
+    uint64_t src_cursor = 0;
+    cmpmap_foreach(dst_map, node) {
+        const char* key = node->key;
+
+        uint64_t dst_index;
+        int ret = dsync_map_item_match(dst_map, key, &dst_cursor, &dst_index);
+        assert(ret == 0);
+
+        uint64_t src_index;
+        ret = dsync_map_item_match(src_map, key, &src_cursor, &src_index);
+        if (ret &&
+            mfu_flist_file_get_type(dst_list, dst_index) == MFU_TYPE_FILE &&
+            mfu_flist_file_get_size(dst_list, dst_index) > 0)
+        {
+            mfu_flist_file_copy(dst_list, dst_index, dst_move_list);
+            dst_move_index[dst_move_count] = dst_index;
+            dst_move_count++;
+        }
+    }
+
+    /* allocate arrays for alltoall -- one for sending, and one for receiving */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    char** ptrs     = (char**) MFU_MALLOC((size_t)ranks * sizeof(char*));
+
+    /* send each file to the rank for its size and mtime */
+    mfu_flist lists[2];
+    lists[0] = src_move_list;
+    lists[1] = dst_move_list;
+    int i;
+    int side;
+    uint64_t idx;
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
+    }
+    for (side = 0; side < 2; side++) {
+        uint64_t size = mfu_flist_size(lists[side]);
+        for (idx = 0; idx < size; idx++) {
+            int dest = dsync_rename_rank(lists[side], idx, ranks);
+            size_t bytes = mfu_flist_file_pack_compact_size(lists[side], idx);
+            sendcounts[dest] += (int)(DSYNC_RENAME_HEADER + bytes);
+        }
+    }
+    senddisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        senddisps[i] = senddisps[i - 1] + sendcounts[i - 1];
+    }
+    size_t sendbytes = (size_t)senddisps[ranks - 1] + (size_t)sendcounts[ranks - 1];
+    char* sendbuf = (char*) MFU_MALLOC(sendbytes);
+    for (i = 0; i < ranks; i++) {
+        ptrs[i] = sendbuf + senddisps[i];
+    }
+    for (side = 0; side < 2; side++) {
+        mfu_flist list = lists[side];
+        uint64_t size = mfu_flist_size(list);
+        for (idx = 0; idx < size; idx++) {
+            int dest = dsync_rename_rank(list, idx, ranks);
+            char** pptr = &ptrs[dest];
+            mfu_pack_uint64(pptr, (uint64_t)side);
+            mfu_pack_uint64(pptr, idx);
+            mfu_pack_uint64(pptr, mfu_flist_file_get_size(list, idx));
+            mfu_pack_uint64(pptr, mfu_flist_file_get_mtime(list, idx));
+            mfu_pack_uint64(pptr, mfu_flist_file_get_mtime_nsec(list, idx));
+            mfu_pack_uint64(pptr, (uint64_t)mfu_flist_file_pack_compact_size(list, idx));
+            *pptr += mfu_flist_file_pack_compact(*pptr, list, idx);
+        }
+    }
+
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+    int recv_total = recvcounts[0];
+    recvdisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        recv_total += recvcounts[i];
+        recvdisps[i] = recvdisps[i - 1] + recvcounts[i - 1];
+    }
+    char* recvbuf = (char*) MFU_MALLOC((size_t)recv_total);
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_BYTE,
+        recvbuf, recvcounts, recvdisps, MPI_BYTE, MPI_COMM_WORLD
+    );
+    mfu_free(&sendbuf);
+
+    /* count the files we received and record each one */
+    uint64_t count = 0;
+    const char* ptr = recvbuf;
+    const char* end = recvbuf + recv_total;
+    while (ptr < end) {
+        uint64_t bytes;
+        ptr += DSYNC_RENAME_HEADER - 8;
+        mfu_unpack_uint64(&ptr, &bytes);
+        ptr += bytes;
+        count++;
+    }
+    dsync_rename_rec* recs = (dsync_rename_rec*) MFU_MALLOC(count * sizeof(dsync_rename_rec));
+    count = 0;
+    for (i = 0; i < ranks; i++) {
+        ptr = recvbuf + recvdisps[i];
+        end = ptr + recvcounts[i];
+        while (ptr < end) {
+            dsync_rename_rec* rec = &recs[count];
+            mfu_unpack_uint64(&ptr, &rec->side);
+            mfu_unpack_uint64(&ptr, &rec->index);
+            mfu_unpack_uint64(&ptr, &rec->size);
+            mfu_unpack_uint64(&ptr, &rec->mtime);
+            mfu_unpack_uint64(&ptr, &rec->mtime_nsec);
+            mfu_unpack_uint64(&ptr, &rec->bytes);
+            rec->rank = i;
+            rec->buf  = ptr;
+            ptr += rec->bytes;
+            count++;
+        }
+    }
+
+    /* sort files so that each group with the same size and mtime
+     * lists its source files ahead of its destination files,
+     * then pair them up in order, recording the pairs as the
+     * positions of the source and destination records, each
+     * record is in at most one pair, so count entries suffice */
+    if (count > 0) {
+        qsort(recs, (size_t)count, sizeof(dsync_rename_rec), dsync_rename_rec_cmp);
+    }
+    uint64_t* pairs = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+    uint64_t pair_count = 0;
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
+    }
+    uint64_t start = 0;
+    while (start < count) {
+        /* find the end of this group and its first destination file */
+        uint64_t stop = start;
+        uint64_t dst_start = count;
+        while (stop < count &&
+               recs[stop].size       == recs[start].size  &&
+               recs[stop].mtime      == recs[start].mtime &&
+               recs[stop].mtime_nsec == recs[start].mtime_nsec)
+        {
+            if (recs[stop].side == 1 && dst_start == count) {
+                dst_start = stop;
+            }
+            stop++;
+        }
+
+        /* without checking contents, only pair a file that has a
+         * single candidate on the other side */
+        int unique = (dst_start - start == 1 && stop - dst_start == 1);
+
+        /* the owner of the source file gets the index of its file and
+         * the packed destination file, the owner of the destination
+         * file gets the index of its file */
+        uint64_t s = start;
+        uint64_t d = dst_start;
+        while ((unique || options.contents) && s < dst_start && d < stop) {
+            sendcounts[recs[s].rank] += (int)(16 + recs[d].bytes);
+            sendcounts[recs[d].rank] += 16;
+            pairs[2 * pair_count + 0] = s;
+            pairs[2 * pair_count + 1] = d;
+            pair_count++;
+            s++;
+            d++;
+        }
+
+        start = stop;
+    }
+
+    /* pack replies, tagged by whether they name a source file */
+    senddisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        senddisps[i] = senddisps[i - 1] + sendcounts[i - 1];
+    }
+    sendbytes = (size_t)senddisps[ranks - 1] + (size_t)sendcounts[ranks - 1];
+    sendbuf = (char*) MFU_MALLOC(sendbytes);
+    for (i = 0; i < ranks; i++) {
+        ptrs[i] = sendbuf + senddisps[i];
+    }
+    for (idx = 0; idx < pair_count; idx++) {
+        const dsync_rename_rec* src = &recs[pairs[2 * idx + 0]];
+        const dsync_rename_rec* dst = &recs[pairs[2 * idx + 1]];
+
+        char** pptr = &ptrs[src->rank];
+        mfu_pack_uint64(pptr, 0);
+        mfu_pack_uint64(pptr, src->index);
+        memcpy(*pptr, dst->buf, (size_t)dst->bytes);
+        *pptr += dst->bytes;
+
+        pptr = &ptrs[dst->rank];
+        mfu_pack_uint64(pptr, 1);
+        mfu_pack_uint64(pptr, dst->index);
+    }
+
+    mfu_free(&pairs);
+    mfu_free(&recs);
+    mfu_free(&recvbuf);
+
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+    recv_total = recvcounts[0];
+    recvdisps[0] = 0;
+    for (i = 1; i < ranks; i++) {
+        recv_total += recvcounts[i];
+        recvdisps[i] = recvdisps[i - 1] + recvcounts[i - 1];
+    }
+    recvbuf = (char*) MFU_MALLOC((size_t)recv_total);
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_BYTE,
+        recvbuf, recvcounts, recvdisps, MPI_BYTE, MPI_COMM_WORLD
+    );
+
+    /* record pairs for our source files, keeping source and
+     * destination lists in the same order, and flag our
+     * destination files that will be renamed */
+    uint64_t src_move_count = mfu_flist_size(src_move_list);
+    int* matched = (int*) MFU_MALLOC(src_move_count * sizeof(int));
+    for (idx = 0; idx < src_move_count; idx++) {
+        matched[idx] = 0;
+    }
+    ptr = recvbuf;
+    end = recvbuf + recv_total;
+    while (ptr < end) {
+        uint64_t tag, index;
+        mfu_unpack_uint64(&ptr, &tag);
+        mfu_unpack_uint64(&ptr, &index);
+        if (tag == 0) {
+            matched[index] = 1;
+            mfu_flist_file_copy(src_move_list, index, src_rename_list);
+            ptr += mfu_flist_file_unpack(ptr, dst_rename_list);
+        } else {
+            moved[dst_move_index[index]] = 1;
+        }
+    }
+
+    /* copy source files that were not found in the destination */
+    for (idx = 0; idx < src_move_count; idx++) {
+        if (! matched[idx]) {
+            mfu_flist_file_copy(src_move_list, idx, src_cp_list);
+        }
+    }
+
+    mfu_flist_summarize(src_rename_list);
+    mfu_flist_summarize(dst_rename_list);
+
+    mfu_free(&matched);
+    mfu_free(&recvbuf);
+    mfu_free(&sendbuf);
+    mfu_free(&ptrs);
+    mfu_free(&senddisps);
+    mfu_free(&recvdisps);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
+    mfu_free(&dst_move_index);
+    mfu_flist_free(&dst_move_list);
+}
+
+/* create the parent directory of the given path and any of its
+ * own parents that are missing, returns 0 on success */
+static int dsync_mkdir_parent(const char* name)
+{
+    mfu_path* path = mfu_path_from_str(name);
+    mfu_path_dirname(path);
+    char* dir = mfu_path_strdup(path);
+    mfu_path_delete(&path);
+
+    int rc = mfu_mkdir(dir, DCOPY_DEF_PERMS_DIR);
+    if (rc != 0 && errno == ENOENT) {
+        rc = dsync_mkdir_parent(dir);
+        if (rc == 0) {
+            rc = mfu_mkdir(dir, DCOPY_DEF_PERMS_DIR);
+        }
+    }
+    if (rc != 0 && errno == EEXIST) {
+        /* another rank may have just created it */
+        rc = 0;
+    }
+
+    mfu_free(&dir);
+    return rc;
+}
+
+/* move each destination file in dst_rename_list to the name of the
+ * source file at the same position in src_rename_list and set its
+ * metadata, the parent directories are created as needed and get their
+ * metadata when they are copied, if the rename fails or --contents
+ * finds the files differ, the destination file is removed and the
+ * source file is added to src_cp_list to be copied instead */
+static int dsync_rename_files(
+    mfu_flist src_rename_list,
+    mfu_flist dst_rename_list,
+    mfu_flist src_cp_list,
+    size_t strlen_prefix,
+    const mfu_param_path* dest_path)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    uint64_t total_files = mfu_flist_global_size(src_rename_list);
+    if (total_files == 0) {
+        return 0;
+    }
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Renaming %" PRIu64 " items in destination", total_files);
+    }
+
+    /* start timer */
+    double start_rename = MPI_Wtime();
+
+    uint64_t count_bytes_read    = 0;
+    uint64_t count_bytes_written = 0;
+    uint64_t vals[2] = {0, 0};
+    size_t strlen_dest = strlen(dest_path->path);
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(src_rename_list);
+
+    /* check that files really are the same if asked to, spreading
+     * sections of each pair among processes as for other compares,
+     * both lists have the same file sizes in the same order, so
+     * their chunk lists line up */
+    int* results = (int*) MFU_MALLOC(size * sizeof(int));
+    for (idx = 0; idx < size; idx++) {
+        results[idx] = 0;
+    }
+    if (options.contents) {
+        mfu_file_chunk* src_head = mfu_file_chunk_list_alloc(src_rename_list, options.chunk_size);
+        mfu_file_chunk* dst_head = mfu_file_chunk_list_alloc(dst_rename_list, options.chunk_size);
+        uint64_t list_count = mfu_file_chunk_list_size(src_head);
+        int* chunk_vals = (int*) MFU_MALLOC(list_count * sizeof(int));
+
+        uint64_t count_bytes[2] = {0, 0};
+        mfu_progress* compare_prog = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
+
+        /* a read error counts as a difference,
+         * so the source file is copied instead */
+        mfu_file_chunk_list_compare(src_head, dst_head, options.chunk_size, options.block_size,
+            0, chunk_vals, &count_bytes_read, &count_bytes_written, compare_prog);
+
+        /* close files and free buffers used to compare contents */
+        mfu_fd_cache_close_all();
+        mfu_compare_contents_free();
+
+        count_bytes[0] = count_bytes_read;
+        count_bytes[1] = count_bytes_written;
+        mfu_progress_complete(count_bytes, &compare_prog);
+
+        /* a pair differs if any of its sections do */
+        mfu_file_chunk_list_lor(src_rename_list, src_head, chunk_vals, results);
+
+        mfu_free(&chunk_vals);
+        mfu_file_chunk_list_free(&src_head);
+        mfu_file_chunk_list_free(&dst_head);
+    }
+
+    for (idx = 0; idx < size; idx++) {
+        const char* src_name = mfu_flist_file_get_name(src_rename_list, idx);
+        const char* old_name = mfu_flist_file_get_name(dst_rename_list, idx);
+
+        /* build new destination name from the source name */
+        const char* key = src_name + strlen_prefix;
+        char* new_name = (char*) MFU_MALLOC(strlen_dest + strlen(key) + 1);
+        memcpy(new_name, dest_path->path, strlen_dest);
+        strcpy(new_name + strlen_dest, key);
+
+        int same = (results[idx] == 0);
+        if (same) {
+            if (dsync_mkdir_parent(new_name) != 0) {
+                MFU_LOG(MFU_LOG_WARN, "Failed to create parent of `%s' (errno=%d %s)",
+                    new_name, errno, strerror(errno));
+                same = 0;
+            } else if (rename(old_name, new_name) != 0) {
+                MFU_LOG(MFU_LOG_WARN, "Failed to rename `%s' to `%s' (errno=%d %s)",
+                    old_name, new_name, errno, strerror(errno));
+                same = 0;
+            }
+        }
+
+        if (same) {
+            /* file now has its new name, bring its metadata
+             * in line with the source */
+            mfu_flist_file_set_name(dst_rename_list, idx, new_name);
+            if (mfu_flist_file_sync_meta(src_rename_list, idx, dst_rename_list, idx) < 0) {
+                rc = -1;
+            }
+            vals[0]++;
+        } else {
+            /* remove the old file, since it is not in the source,
+             * and copy the source file instead */
+            if (mfu_unlink(old_name) != 0 && errno != ENOENT) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
+                    old_name, errno, strerror(errno));
+                rc = -1;
+            }
+            mfu_flist_file_copy(src_rename_list, idx, src_cp_list);
+            vals[1]++;
+        }
+
+        mfu_free(&new_name);
+    }
+
+    mfu_free(&results);
+
+    uint64_t all_vals[2];
+    MPI_Allreduce(vals, all_vals, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    double end_rename = MPI_Wtime();
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Renamed %" PRIu64 " items in %.3lf secs, %" PRIu64 " left to copy",
+            all_vals[0], end_rename - start_rename, all_vals[1]);
+    }
+
+    /* determine whether any process hit an error,
+     * input is either 0 or -1, so MIN will return -1 if any */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    rc = all_rc;
+
+    return rc;
+}
+
 static int dsync_sync_files(
-        strmap* src_map,
-        strmap* dst_map,
+        cmpmap* src_map,
+        cmpmap* dst_map,
         const mfu_param_path* src_path,
         const mfu_param_path* dest_path,
         const mfu_param_path* link_path,
@@ -1261,6 +1752,7 @@ static int dsync_sync_files(
         mfu_flist dst_remove_list,
         mfu_flist link_dst_list,
         mfu_flist src_cp_list,
+        const int* moved,
         mfu_copy_opts_t* mfu_copy_opts)
 {
     /* assume we'll succeed */
@@ -1291,7 +1783,7 @@ static int dsync_sync_files(
 
     /* get files that are only in the destination directory */
     if (options.delete) {
-        dsync_only_dst(src_map, dst_map, dst_list, dst_remove_list);
+        dsync_only_dst(src_map, dst_map, dst_list, dst_remove_list, moved);
     }
 
     /* summarize dst remove list and remove files */
@@ -1343,12 +1835,668 @@ static int dsync_sync_files(
     return rc;
 }
 
+/* return key of a destination manifest entry, which names items by
+ * their path relative to the destination without a leading slash
+ * and the destination itself as ".", while keys hold the portion of
+ * the path following the prefix, caller must free the key */
+static char* dsync_manifest_key(const char* name)
+{
+    if (strcmp(name, ".") == 0) {
+        return MFU_STRDUP("");
+    }
+    size_t len = strlen(name);
+    char* key = (char*) MFU_MALLOC(len + 2);
+    key[0] = '/';
+    memcpy(key + 1, name, len + 1);
+    return key;
+}
+
+/* send a manifest entry to the rank dsync_map_fn picks for its item */
+static int dsync_manifest_rank_fn(const char* name, int ranks, const void* args)
+{
+    char* key = dsync_manifest_key(name);
+    uint32_t hash = mfu_hash_jenkins(key, strlen(key));
+    mfu_free(&key);
+    return (int) (hash % (uint32_t)ranks);
+}
+
+/* number of uint64_t values in a request for the checksum of a chunk */
+#define DSYNC_DELTA_PACK_COUNT (3)
+
+/* return number of chunks in a chunk list element, which may
+ * span several consecutive chunks of a file, an element of an
+ * empty file counts as one chunk */
+static uint64_t dsync_delta_chunks(const mfu_file_chunk* p)
+{
+    uint64_t chunks = (p->length + options.chunk_size - 1) / options.chunk_size;
+    if (chunks == 0) {
+        chunks = 1;
+    }
+    return chunks;
+}
+
+/* look up the checksum a manifest of the destination records for each
+ * chunk in the list, in order, sets valid[i] to 1 and crcs[i] to the
+ * checksum of chunk i if the manifest records the destination file at
+ * the size and mtime it had when walked and a chunk of the same length
+ * as the source chunk, and sets valid[i] to 0 otherwise */
+static void dsync_delta_lookup(
+    const char* file,         /* manifest of destination */
+    mfu_flist patch_list,     /* files to be updated in place */
+    const uint64_t* dst_sizes,/* size of destination of each file in patch_list */
+    const uint64_t* dst_mtimes,/* mtime secs and nsecs of destination of each file */
+    size_t strlen_prefix,     /* length of source prefix in names */
+    const mfu_file_chunk* head,
+    uint64_t chunk_count,     /* number of chunks in list */
+    int* valid,
+    mfu_crc128* crcs)
+{
+    /* get our rank and number of ranks */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    uint64_t i;
+    for (i = 0; i < chunk_count; i++) {
+        valid[i] = 0;
+    }
+
+    /* read manifest, we can only use checksums of chunks
+     * that cover the same bytes as the chunks we compare */
+    uint64_t chunk_size;
+    uint64_t count;
+    mfu_manifest_entry* entries;
+    if (mfu_manifest_read_chunks(file, &chunk_size, &count, &entries) != 0) {
+        mfu_manifest_free(count, &entries);
+        return;
+    }
+    if (chunk_size != options.chunk_size) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_WARN, "Ignoring manifest `%s', its chunk size %" PRIu64
+                " differs from %" PRIu64, file, chunk_size, options.chunk_size);
+        }
+        mfu_manifest_free(count, &entries);
+        return;
+    }
+
+    /* bring each entry to the rank that owns its item */
+    mfu_manifest_spread(&count, &entries, dsync_manifest_rank_fn, NULL);
+    cmpmap* map = cmpmap_new(1, DCMPS_INIT, count);
+    uint64_t idx;
+    for (idx = 0; idx < count; idx++) {
+        char* key = dsync_manifest_key(entries[idx].name);
+        cmpmap_set(map, key, idx);
+        mfu_free(&key);
+    }
+
+    /* allocate arrays for alltoall -- one for sending, and one for receiving */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets    = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+
+    /* ask the owner of each chunk for its checksum, a request is
+     * the index of the file on its owner and the chunk offset,
+     * and is answered with a flag and the two halves of a checksum */
+    int r;
+    for (r = 0; r < ranks; r++) {
+        sendcounts[r] = 0;
+    }
+    const mfu_file_chunk* p;
+    for (p = head; p != NULL; p = p->next) {
+        sendcounts[p->rank_of_owner] += (int)(DSYNC_DELTA_PACK_COUNT * dsync_delta_chunks(p));
+    }
+    senddisps[0] = 0;
+    for (r = 1; r < ranks; r++) {
+        senddisps[r] = senddisps[r - 1] + sendcounts[r - 1];
+    }
+    int send_total = senddisps[ranks - 1] + sendcounts[ranks - 1];
+    uint64_t* sendbuf = (uint64_t*) MFU_MALLOC((size_t)send_total * sizeof(uint64_t));
+    for (r = 0; r < ranks; r++) {
+        offsets[r] = senddisps[r];
+    }
+    uint64_t k;
+    for (p = head; p != NULL; p = p->next) {
+        int owner = (int) p->rank_of_owner;
+        uint64_t chunks = dsync_delta_chunks(p);
+        for (k = 0; k < chunks; k++) {
+            sendbuf[offsets[owner]++] = p->index_of_owner;
+            sendbuf[offsets[owner]++] = p->offset + k * chunk_size;
+            sendbuf[offsets[owner]++] = 0;
+        }
+    }
+
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+    recvdisps[0] = 0;
+    for (r = 1; r < ranks; r++) {
+        recvdisps[r] = recvdisps[r - 1] + recvcounts[r - 1];
+    }
+    int recv_total = recvdisps[ranks - 1] + recvcounts[ranks - 1];
+    uint64_t* recvbuf = (uint64_t*) MFU_MALLOC((size_t)recv_total * sizeof(uint64_t));
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_UINT64_T,
+        recvbuf, recvcounts, recvdisps, MPI_UINT64_T, MPI_COMM_WORLD
+    );
+
+    /* answer each request in place with a flag and a checksum */
+    int j;
+    for (j = 0; j < recv_total; j += DSYNC_DELTA_PACK_COUNT) {
+        uint64_t index  = recvbuf[j + 0];
+        uint64_t offset = recvbuf[j + 1];
+        recvbuf[j + 0] = 0;
+        recvbuf[j + 1] = 0;
+        recvbuf[j + 2] = 0;
+
+        const char* key = mfu_flist_file_get_name(patch_list, index) + strlen_prefix;
+        const cmpmap_entry* node = cmpmap_get(map, key);
+        if (node == NULL) {
+            continue;
+        }
+
+        /* the manifest must describe the destination as we found it,
+         * a file rewritten since the manifest was made most likely has
+         * a new mtime even if its size is the same */
+        const mfu_manifest_entry* e = &entries[node->index];
+        uint64_t dst_size = dst_sizes[index];
+        uint64_t src_size = mfu_flist_file_get_size(patch_list, index);
+        uint64_t chunk = offset / chunk_size;
+        if (e->size != dst_size || chunk >= e->chunks ||
+            e->mtime      != dst_mtimes[2 * index + 0] ||
+            e->mtime_nsec != dst_mtimes[2 * index + 1])
+        {
+            continue;
+        }
+
+        /* and its chunk must cover the bytes of the source chunk */
+        uint64_t dst_len = (offset < dst_size) ? dst_size - offset : 0;
+        uint64_t src_len = (offset < src_size) ? src_size - offset : 0;
+        if (dst_len > chunk_size) {
+            dst_len = chunk_size;
+        }
+        if (src_len > chunk_size) {
+            src_len = chunk_size;
+        }
+        if (dst_len == src_len) {
+            recvbuf[j + 0] = 1;
+            recvbuf[j + 1] = e->chunk_crcs[chunk].hi;
+            recvbuf[j + 2] = e->chunk_crcs[chunk].lo;
+        }
+    }
+
+    /* send answers back, which arrive in the order we asked */
+    MPI_Alltoallv(
+        recvbuf, recvcounts, recvdisps, MPI_UINT64_T,
+        sendbuf, sendcounts, senddisps, MPI_UINT64_T, MPI_COMM_WORLD
+    );
+    for (r = 0; r < ranks; r++) {
+        offsets[r] = senddisps[r];
+    }
+    i = 0;
+    for (p = head; p != NULL; p = p->next) {
+        int owner = (int) p->rank_of_owner;
+        uint64_t chunks = dsync_delta_chunks(p);
+        for (k = 0; k < chunks; k++) {
+            valid[i]   = (int) sendbuf[offsets[owner]++];
+            crcs[i].hi = sendbuf[offsets[owner]++];
+            crcs[i].lo = sendbuf[offsets[owner]++];
+            i++;
+        }
+    }
+
+    mfu_free(&recvbuf);
+    mfu_free(&sendbuf);
+    mfu_free(&offsets);
+    mfu_free(&senddisps);
+    mfu_free(&recvdisps);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
+    cmpmap_delete(&map);
+    mfu_manifest_free(count, &entries);
+}
+
+/* read a chunk of the source file into buf, which must hold length
+ * bytes, in reads of at most block_size bytes, and write the chunk to
+ * the destination if its checksum differs from crc, the checksum of
+ * the destination chunk, returns -1 on error, 0 if equal, 1 if written */
+static int dsync_delta_chunk(
+    const char* src_name,
+    const char* dst_name,
+    off_t offset,
+    off_t length,
+    mfu_crc128 crc,
+    char* buf,
+    size_t block_size,
+    uint64_t* count_bytes_read,
+    uint64_t* count_bytes_written)
+{
+    int opened;
+    int src_fd = mfu_fd_cache_open(src_name, O_RDONLY, 0, &opened);
+    if (src_fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
+            src_name, errno, strerror(errno));
+        return -1;
+    }
+
+    /* read and checksum source bytes */
+    mfu_crc128 src_crc = {0, 0};
+    off_t total = 0;
+    while (total < length) {
+        size_t size = block_size;
+        if (length - total < (off_t)block_size) {
+            size = (size_t)(length - total);
+        }
+        ssize_t nread = mfu_pread(src_name, src_fd, buf + total, size, offset + total);
+        if (nread <= 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' at offset %llx",
+                src_name, (unsigned long long)(offset + total));
+            return -1;
+        }
+        src_crc = mfu_crc128_update(src_crc, buf + total, (size_t)nread);
+        *count_bytes_read += (uint64_t) nread;
+        total += (off_t) nread;
+    }
+    if (mfu_crc128_equal(src_crc, crc)) {
+        return 0;
+    }
+
+    /* write the chunk from the bytes we just read */
+    int dst_fd = mfu_fd_cache_open(dst_name, O_RDWR, 0, &opened);
+    if (dst_fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
+            dst_name, errno, strerror(errno));
+        return -1;
+    }
+    ssize_t nwrite = mfu_pwrite(dst_name, dst_fd, buf, (size_t)length, offset);
+    if (nwrite != (ssize_t)length) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to write `%s' at offset %llx (errno=%d %s)",
+            dst_name, (unsigned long long)offset, errno, strerror(errno));
+        return -1;
+    }
+    *count_bytes_written += (uint64_t) nwrite;
+    return 1;
+}
+
+/* update regular files in the destination in place so they match the
+ * source, given in matching order in src_delta_list and dst_delta_list,
+ * each destination is set to the size of its source and then only its
+ * chunks that differ are written, chunks are compared byte by byte, or
+ * by checksum against the destination manifest if one was given,
+ * files with other hard links, whose other names must keep their data,
+ * and files that cannot be truncated or written are added to the copy
+ * and remove lists to be replaced instead, returns 0 on success and -1
+ * on error */
+static int dsync_delta_files(
+    mfu_flist src_delta_list,
+    mfu_flist dst_delta_list,
+    mfu_flist src_cp_list,
+    mfu_flist dst_remove_list,
+    size_t strlen_prefix,
+    const mfu_param_path* dest_path)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    mfu_flist_summarize(src_delta_list);
+    uint64_t total_files = mfu_flist_global_size(src_delta_list);
+    if (total_files == 0) {
+        return 0;
+    }
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Updating contents of %" PRIu64 " items in place", total_files);
+    }
+
+    /* start timer */
+    double start_delta = MPI_Wtime();
+
+    /* set each destination to the size of its source, so chunks can be
+     * written in any order, and bytes past the end of the source go */
+    uint64_t size = mfu_flist_size(src_delta_list);
+    mfu_flist patch_list = mfu_flist_subset(src_delta_list);
+    uint64_t* dst_sizes  = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t* dst_mtimes = (uint64_t*) MFU_MALLOC(2 * size * sizeof(uint64_t));
+    uint64_t* patch_index = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t patch_count = 0;
+    uint64_t linked = 0;
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        const char* dst_name = mfu_flist_file_get_name(dst_delta_list, idx);
+        uint64_t src_size = mfu_flist_file_get_size(src_delta_list, idx);
+
+        /* writing in place would change every name linked to the
+         * destination, a link count that is not known is treated
+         * the same way */
+        if (mfu_flist_file_get_nlink(dst_delta_list, idx) != 1) {
+            mfu_flist_file_copy(src_delta_list, idx, src_cp_list);
+            mfu_flist_file_copy(dst_delta_list, idx, dst_remove_list);
+            linked++;
+            continue;
+        }
+
+        if (mfu_truncate(dst_name, (off_t)src_size) != 0) {
+            MFU_LOG(MFU_LOG_WARN, "Failed to truncate `%s' (errno=%d %s), replacing it",
+                dst_name, errno, strerror(errno));
+            mfu_flist_file_copy(src_delta_list, idx, src_cp_list);
+            mfu_flist_file_copy(dst_delta_list, idx, dst_remove_list);
+            continue;
+        }
+        mfu_flist_file_copy(src_delta_list, idx, patch_list);
+        patch_index[patch_count] = idx;
+        dst_sizes[patch_count] = mfu_flist_file_get_size(dst_delta_list, idx);
+        dst_mtimes[2 * patch_count + 0] = mfu_flist_file_get_mtime(dst_delta_list, idx);
+        dst_mtimes[2 * patch_count + 1] = mfu_flist_file_get_mtime_nsec(dst_delta_list, idx);
+        patch_count++;
+    }
+    mfu_flist_summarize(patch_list);
+
+    uint64_t all_linked;
+    MPI_Allreduce(&linked, &all_linked, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0 && all_linked > 0) {
+        MFU_LOG(MFU_LOG_INFO, "Replacing %" PRIu64 " items with other hard links", all_linked);
+    }
+
+    /* split source files into chunks and spread them among ranks */
+    mfu_file_chunk* head = mfu_file_chunk_list_alloc(patch_list, options.chunk_size);
+    const mfu_file_chunk* p;
+    uint64_t chunk_count = 0;
+    uint64_t elem_count = 0;
+    for (p = head; p != NULL; p = p->next) {
+        chunk_count += dsync_delta_chunks(p);
+        elem_count++;
+    }
+
+    /* flag each element of the chunk list that failed to update */
+    int* failed = (int*) MFU_MALLOC(elem_count * sizeof(int));
+
+    /* get checksums of destination chunks if we have a manifest */
+    int* valid = (int*) MFU_MALLOC(chunk_count * sizeof(int));
+    mfu_crc128* crcs = (mfu_crc128*) MFU_MALLOC(chunk_count * sizeof(mfu_crc128));
+    if (options.delta_manifest != NULL) {
+        dsync_delta_lookup(options.delta_manifest, patch_list, dst_sizes,
+            dst_mtimes, strlen_prefix, head, chunk_count, valid, crcs);
+    } else {
+        for (idx = 0; idx < chunk_count; idx++) {
+            valid[idx] = 0;
+        }
+    }
+
+    /* start progress messages */
+    uint64_t count_bytes_read    = 0;
+    uint64_t count_bytes_written = 0;
+    uint64_t count_bytes[2] = {0, 0};
+    mfu_progress* delta_prog = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
+
+    /* buffer to hold a chunk while it is checksummed and written */
+    char* buf = NULL;
+    if (options.delta_manifest != NULL) {
+        buf = (char*) MFU_MALLOC(options.chunk_size);
+    }
+
+    /* destination name of the file of the current chunk,
+     * chunks of a file are adjacent and share a name */
+    const char* src_name = NULL;
+    char* dst_name = NULL;
+    size_t strlen_dest = strlen(dest_path->path);
+
+    uint64_t i = 0;
+    uint64_t elem = 0;
+    for (p = head; p != NULL; p = p->next, elem++) {
+        failed[elem] = 0;
+        if (p->name != src_name) {
+            src_name = p->name;
+            const char* key = src_name + strlen_prefix;
+            mfu_free(&dst_name);
+            dst_name = (char*) MFU_MALLOC(strlen_dest + strlen(key) + 1);
+            memcpy(dst_name, dest_path->path, strlen_dest);
+            strcpy(dst_name + strlen_dest, key);
+        }
+
+        /* compare each chunk in this element */
+        uint64_t chunks = dsync_delta_chunks(p);
+        uint64_t k;
+        for (k = 0; k < chunks; k++, i++) {
+            uint64_t offset = p->offset + k * options.chunk_size;
+            uint64_t length = p->offset + p->length - offset;
+            if (length > options.chunk_size) {
+                length = options.chunk_size;
+            }
+
+            /* the only chunk of an empty file is empty too,
+             * and a length of 0 would compare to the end of the file */
+            if (length == 0) {
+                continue;
+            }
+
+            int tmp_rc;
+            if (valid[i]) {
+                tmp_rc = dsync_delta_chunk(src_name, dst_name, (off_t)offset,
+                    (off_t)length, crcs[i], buf, options.block_size,
+                    &count_bytes_read, &count_bytes_written);
+            } else {
+                tmp_rc = mfu_compare_contents(src_name, dst_name, (off_t)offset,
+                    (off_t)length, options.block_size, 1,
+                    &count_bytes_read, &count_bytes_written, delta_prog);
+            }
+            if (tmp_rc < 0) {
+                failed[elem] = 1;
+            }
+
+            count_bytes[0] = count_bytes_read;
+            count_bytes[1] = count_bytes_written;
+            mfu_progress_update(count_bytes, delta_prog);
+        }
+    }
+
+    /* flush and close files and free buffers */
+    mfu_fd_cache_close_all();
+    mfu_compare_contents_free();
+    mfu_free(&dst_name);
+    mfu_free(&buf);
+
+    count_bytes[0] = count_bytes_read;
+    count_bytes[1] = count_bytes_written;
+    mfu_progress_complete(count_bytes, &delta_prog);
+
+    /* a file fails if any of its chunks did, replace those instead */
+    uint64_t patch_size = mfu_flist_size(patch_list);
+    int* results = (int*) MFU_MALLOC(patch_size * sizeof(int));
+    mfu_file_chunk_list_lor(patch_list, head, failed, results);
+    uint64_t updated = 0;
+    for (idx = 0; idx < patch_size; idx++) {
+        if (results[idx]) {
+            uint64_t delta_idx = patch_index[idx];
+            MFU_LOG(MFU_LOG_WARN, "Failed to update `%s' in place, replacing it",
+                mfu_flist_file_get_name(dst_delta_list, delta_idx));
+            mfu_flist_file_copy(src_delta_list, delta_idx, src_cp_list);
+            mfu_flist_file_copy(dst_delta_list, delta_idx, dst_remove_list);
+        } else {
+            updated++;
+        }
+    }
+
+    /* writing to a file changes its mtime, and the metadata refresh
+     * only sets times that differed when the destination was walked,
+     * so set times on every patched file once all ranks have written */
+    MPI_Barrier(MPI_COMM_WORLD);
+    for (idx = 0; idx < patch_size; idx++) {
+        if (results[idx]) {
+            continue;
+        }
+        const char* key = mfu_flist_file_get_name(patch_list, idx) + strlen_prefix;
+        char* dst_path = (char*) MFU_MALLOC(strlen_dest + strlen(key) + 1);
+        memcpy(dst_path, dest_path->path, strlen_dest);
+        strcpy(dst_path + strlen_dest, key);
+        if (mfu_flist_file_copy_timestamps(patch_list, idx, dst_path) < 0) {
+            rc = -1;
+        }
+        mfu_free(&dst_path);
+    }
+
+    /* report bytes read and written */
+    uint64_t all_updated;
+    uint64_t all_bytes[2];
+    MPI_Allreduce(&updated, &all_updated, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(count_bytes, all_bytes, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    double end_delta = MPI_Wtime();
+    if (rank == 0) {
+        double read_val, write_val;
+        const char* read_units;
+        const char* write_units;
+        mfu_format_bytes(all_bytes[0], &read_val, &read_units);
+        mfu_format_bytes(all_bytes[1], &write_val, &write_units);
+        MFU_LOG(MFU_LOG_INFO, "Updated %" PRIu64 " items in %.3lf secs, read %.3lf %s, wrote %.3lf %s",
+            all_updated, end_delta - start_delta,
+            read_val, read_units, write_val, write_units);
+    }
+
+    mfu_free(&results);
+    mfu_free(&failed);
+    mfu_free(&crcs);
+    mfu_free(&valid);
+    mfu_file_chunk_list_free(&head);
+    mfu_free(&patch_index);
+    mfu_free(&dst_mtimes);
+    mfu_free(&dst_sizes);
+    mfu_flist_free(&patch_list);
+
+    /* determine whether any process hit an error,
+     * input is either 0 or -1, so MIN will return -1 if any */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    rc = all_rc;
+
+    return rc;
+}
+
+/* return 1 if mfu_flist_file_sync_meta would change any metadata
+ * of the destination item, 0 otherwise */
+static int dsync_meta_differ(
+    mfu_flist src_list,
+    uint64_t src_index,
+    mfu_flist dst_list,
+    uint64_t dst_index)
+{
+    if (mfu_flist_file_get_uid(src_list, src_index)        != mfu_flist_file_get_uid(dst_list, dst_index)        ||
+        mfu_flist_file_get_gid(src_list, src_index)        != mfu_flist_file_get_gid(dst_list, dst_index)        ||
+        mfu_flist_file_get_mode(src_list, src_index)       != mfu_flist_file_get_mode(dst_list, dst_index)       ||
+        mfu_flist_file_get_atime(src_list, src_index)      != mfu_flist_file_get_atime(dst_list, dst_index)      ||
+        mfu_flist_file_get_atime_nsec(src_list, src_index) != mfu_flist_file_get_atime_nsec(dst_list, dst_index) ||
+        mfu_flist_file_get_mtime(src_list, src_index)      != mfu_flist_file_get_mtime(dst_list, dst_index)      ||
+        mfu_flist_file_get_mtime_nsec(src_list, src_index) != mfu_flist_file_get_mtime_nsec(dst_list, dst_index))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/* print the actions dsync_sync_files and the metadata refresh would
+ * take given the lists built by comparing source and destination,
+ * without touching the file system */
+static void dsync_report_plan(
+        cmpmap* src_map,
+        cmpmap* dst_map,
+        mfu_flist src_list,
+        mfu_flist dst_list,
+        mfu_flist dst_remove_list,
+        mfu_flist link_dst_list,
+        mfu_flist src_cp_list,
+        mfu_flist src_delta_list,
+        mfu_flist src_rename_list,
+        const int* moved,
+        const uint64_t* metadata_refresh,
+        uint64_t refresh_count,
+        size_t strlen_prefix)
+{
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* get files that are only in the destination directory */
+    if (options.delete) {
+        dsync_only_dst(src_map, dst_map, dst_list, dst_remove_list, moved);
+    }
+
+    /* count items that would be removed, copied, and linked */
+    mfu_flist_summarize(dst_remove_list);
+    mfu_flist_summarize(src_cp_list);
+    uint64_t remove_size = mfu_flist_global_size(dst_remove_list);
+    uint64_t copy_size   = mfu_flist_global_size(src_cp_list);
+    uint64_t link_size   = 0;
+    if (link_dst_list != MFU_FLIST_NULL) {
+        mfu_flist_summarize(link_dst_list);
+        link_size = mfu_flist_global_size(link_dst_list);
+    }
+
+    mfu_flist_summarize(src_delta_list);
+    uint64_t delta_size = mfu_flist_global_size(src_delta_list);
+
+    uint64_t rename_size = mfu_flist_global_size(src_rename_list);
+
+    /* sum up bytes of regular files that would be copied */
+    uint64_t idx;
+    uint64_t vals[2] = {0, 0};
+    uint64_t size = mfu_flist_size(src_cp_list);
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(src_cp_list, idx);
+        if (type == MFU_TYPE_FILE) {
+            vals[0] += mfu_flist_file_get_size(src_cp_list, idx);
+        }
+    }
+
+    /* count items in both trees whose metadata would be updated,
+     * leaving out those that would be replaced by a copy */
+    for (idx = 0; idx < refresh_count; idx++) {
+        uint64_t src_index = metadata_refresh[2 * idx + 0];
+        uint64_t dst_index = metadata_refresh[2 * idx + 1];
+
+        const char* key = mfu_flist_file_get_name(src_list, src_index) + strlen_prefix;
+        dsync_state type_state, content_state;
+        if (dsync_map_item_state(src_map, key, DCMPF_TYPE, &type_state) == 0 &&
+            dsync_map_item_state(src_map, key, DCMPF_CONTENT, &content_state) == 0 &&
+            (type_state == DCMPS_DIFFER || content_state == DCMPS_DIFFER))
+        {
+            continue;
+        }
+
+        vals[1] += dsync_meta_differ(src_list, src_index, dst_list, dst_index);
+    }
+
+    uint64_t all_vals[2];
+    MPI_Allreduce(vals, all_vals, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double copy_bytes_val;
+        const char* copy_bytes_units;
+        mfu_format_bytes(all_vals[0], &copy_bytes_val, &copy_bytes_units);
+
+        MFU_LOG(MFU_LOG_INFO, "Dry run, no changes made to destination");
+        MFU_LOG(MFU_LOG_INFO, "Would delete: %" PRIu64 " items", remove_size);
+        MFU_LOG(MFU_LOG_INFO, "Would copy  : %" PRIu64 " items (%.3lf %s)",
+            copy_size, copy_bytes_val, copy_bytes_units);
+        if (link_dst_list != MFU_FLIST_NULL) {
+            MFU_LOG(MFU_LOG_INFO, "Would link  : %" PRIu64 " items", link_size);
+        }
+        if (options.delta) {
+            MFU_LOG(MFU_LOG_INFO, "Would patch : %" PRIu64 " items in place", delta_size);
+        }
+        if (options.detect_renames) {
+            MFU_LOG(MFU_LOG_INFO, "Would rename: %" PRIu64 " items", rename_size);
+        }
+        MFU_LOG(MFU_LOG_INFO, "Would update: %" PRIu64 " items with different metadata", all_vals[1]);
+    }
+}
+
 /* compare entries from src to items in link-dest */
-static int dsync_strmap_compare_link_dest(
+static int dsync_map_compare_link_dest(
     mfu_flist src_list,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist link_list,
-    strmap* link_map,
+    cmpmap* link_map,
     mfu_flist link_same_list)
 {
     /* assume we'll succeed */
@@ -1367,19 +2515,22 @@ static int dsync_strmap_compare_link_dest(
     mfu_flist link_compare_list = mfu_flist_subset(link_list);
 
     /* iterate over each item in source map */
-    const strmap_node* node;
-    strmap_foreach(src_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t src_cursor = 0;
+    uint64_t link_cursor = 0;
+    cmpmap_foreach(src_map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
 
         /* get index of source file */
         uint64_t src_index;
-        tmp_rc = dsync_strmap_item_index(src_map, key, &src_index);
+        tmp_rc = dsync_map_item_match(src_map, key, &src_cursor, &src_index);
         assert(tmp_rc == 0);
 
         /* get index of destination file */
         uint64_t dst_index;
-        tmp_rc = dsync_strmap_item_index(link_map, key, &dst_index);
+        tmp_rc = dsync_map_item_match(link_map, key, &link_cursor, &dst_index);
         if (tmp_rc) {
             /* skip uncommon files, all other states are DCMPS_INIT */
             continue;
@@ -1420,7 +2571,7 @@ static int dsync_strmap_compare_link_dest(
 
         /* check whether the file sizes are the same */
         dsync_state state;
-        tmp_rc = dsync_strmap_item_state(src_map, key, DCMPF_SIZE, &state);
+        tmp_rc = dsync_map_item_state(src_map, key, DCMPF_SIZE, &state);
         assert(tmp_rc == 0);
         if (state == DCMPS_DIFFER) {
             continue;
@@ -1458,7 +2609,7 @@ static int dsync_strmap_compare_link_dest(
 
             /* compare file contents byte-by-byte, overwrites destination
              * file in place if found to be different during comparison */
-            dsync_strmap_compare_data_link_dest(src_compare_list,
+            dsync_map_compare_data_link_dest(src_compare_list,
                 link_compare_list, link_same_list,
                 &total_bytes_read, &total_bytes_written
             );
@@ -1470,7 +2621,7 @@ static int dsync_strmap_compare_link_dest(
 
             /* assume contents are different if size or mtime are different,
              * adds files to remove and copy lists if different */
-            dsync_strmap_compare_lite_link_dest(src_compare_list,
+            dsync_map_compare_lite_link_dest(src_compare_list,
                 link_compare_list, link_same_list
             );
         }
@@ -1492,13 +2643,13 @@ static int dsync_strmap_compare_link_dest(
 }
 
 /* compare entries from src into dst */
-static int dsync_strmap_compare(
+static int dsync_map_compare(
     mfu_flist src_list,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_list,
-    strmap* dst_map,
+    cmpmap* dst_map,
     mfu_flist link_list,
-    strmap* link_map,
+    cmpmap* link_map,
     size_t strlen_prefix,
     mfu_copy_opts_t* mfu_copy_opts,
     const mfu_param_path* src_path,
@@ -1532,6 +2683,20 @@ static int dsync_strmap_compare(
     /* list to track files to be deleted from destination */
     mfu_flist dst_remove_list = mfu_flist_subset(dst_list);
 
+    /* lists to track files to be updated in place, in matching order */
+    mfu_flist src_delta_list = mfu_flist_subset(src_list);
+    mfu_flist dst_delta_list = mfu_flist_subset(dst_list);
+
+    /* list to track regular files only in source, which may have been
+     * renamed in destination, and lists to track those that were,
+     * in matching order */
+    mfu_flist src_move_list   = mfu_flist_subset(src_list);
+    mfu_flist src_rename_list = mfu_flist_subset(src_list);
+    mfu_flist dst_rename_list = mfu_flist_subset(dst_list);
+
+    /* flag for each destination item that will be renamed */
+    int* moved = NULL;
+
     /* list to track files that are the same in destination and source directories */
     mfu_flist dst_same_list = MFU_FLIST_NULL;
 
@@ -1552,31 +2717,41 @@ static int dsync_strmap_compare(
         src_real_cp_list = mfu_flist_subset(src_list);
     }
 
-    /* use a map as a list to record source and destination indices
-     * for entries that need a refresh on metadata */
-    strmap* metadata_refresh = strmap_new();
+    /* record source and destination indices for entries
+     * that need a refresh on metadata */
+    uint64_t refresh_count = 0;
+    uint64_t* metadata_refresh = (uint64_t*) MFU_MALLOC(2 * cmpmap_size(src_map) * sizeof(uint64_t));
 
     /* iterate over each item in source map */
-    const strmap_node* node;
-    strmap_foreach(src_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t src_cursor = 0;
+    uint64_t dst_cursor = 0;
+    cmpmap_foreach(src_map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
 
         /* get index of source file */
         uint64_t src_index;
-        tmp_rc = dsync_strmap_item_index(src_map, key, &src_index);
+        tmp_rc = dsync_map_item_match(src_map, key, &src_cursor, &src_index);
         assert(tmp_rc == 0);
 
         /* get index of destination file */
         uint64_t dst_index;
-        tmp_rc = dsync_strmap_item_index(dst_map, key, &dst_index);
+        tmp_rc = dsync_map_item_match(dst_map, key, &dst_cursor, &dst_index);
         if (tmp_rc) {
             /* item only exists in the source */
-            dsync_strmap_item_update(src_map, key, DCMPF_EXIST, DCMPS_ONLY_SRC);
+            dsync_map_item_update(src_map, key, DCMPF_EXIST, DCMPS_ONLY_SRC);
 
             /* add items only in src directory into src copy list,
-             * will be later copied into dst dir */
-            if (!options.dry_run) {
+             * will be later copied into dst dir, unless they are
+             * regular files we can look for under other names */
+            if (options.detect_renames &&
+                mfu_flist_file_get_type(src_list, src_index) == MFU_TYPE_FILE &&
+                mfu_flist_file_get_size(src_list, src_index) > 0)
+            {
+                mfu_flist_file_copy(src_list, src_index, src_move_list);
+            } else {
                 mfu_flist_file_copy(src_list, src_index, src_cp_list);
             }
 
@@ -1586,12 +2761,14 @@ static int dsync_strmap_compare(
 
         /* add any item that is in both source and destination to meta
          * refresh list */
-        strmap_setf(metadata_refresh, "%llu=%llu", src_index, dst_index);
+        metadata_refresh[2 * refresh_count + 0] = src_index;
+        metadata_refresh[2 * refresh_count + 1] = dst_index;
+        refresh_count++;
 
         /* item exists in both source and destination,
          * so update our state to record that fact */
-        dsync_strmap_item_update(src_map, key, DCMPF_EXIST, DCMPS_COMMON);
-        dsync_strmap_item_update(dst_map, key, DCMPF_EXIST, DCMPS_COMMON);
+        dsync_map_item_update(src_map, key, DCMPF_EXIST, DCMPS_COMMON);
+        dsync_map_item_update(dst_map, key, DCMPF_EXIST, DCMPS_COMMON);
 
         tmp_rc = dsync_compare_metadata(src_list, src_map, src_index,
              dst_list, dst_map, dst_index,
@@ -1613,30 +2790,28 @@ static int dsync_strmap_compare(
         /* check whether files are of the same type */
         if ((src_mode & S_IFMT) != (dst_mode & S_IFMT)) {
             /* file type is different, no need to go any futher */
-            dsync_strmap_item_update(src_map, key, DCMPF_TYPE, DCMPS_DIFFER);
-            dsync_strmap_item_update(dst_map, key, DCMPF_TYPE, DCMPS_DIFFER);
+            dsync_map_item_update(src_map, key, DCMPF_TYPE, DCMPS_DIFFER);
+            dsync_map_item_update(dst_map, key, DCMPF_TYPE, DCMPS_DIFFER);
 
             /* if the types are different we need to make sure we delete the
              * file of the same name in the dst dir, and copy the type in
              * the src dir to the dst directory */
-            if (!options.dry_run) {
-                mfu_flist_file_copy(src_list, src_index, src_cp_list);
-                mfu_flist_file_copy(dst_list, dst_index, dst_remove_list);
-            }
+            mfu_flist_file_copy(src_list, src_index, src_cp_list);
+            mfu_flist_file_copy(dst_list, dst_index, dst_remove_list);
 
             if (!dsync_option_need_compare(DCMPF_CONTENT)) {
                 continue;
             }
 
             /* take them as differ content */
-            dsync_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
-            dsync_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
             continue;
         }
 
         /* record that items have same type in source and destination */
-        dsync_strmap_item_update(src_map, key, DCMPF_TYPE, DCMPS_COMMON);
-        dsync_strmap_item_update(dst_map, key, DCMPF_TYPE, DCMPS_COMMON);
+        dsync_map_item_update(src_map, key, DCMPF_TYPE, DCMPS_COMMON);
+        dsync_map_item_update(dst_map, key, DCMPF_TYPE, DCMPS_COMMON);
 
         /* Skip if no need to compare content. */
         if (!dsync_option_need_compare(DCMPF_CONTENT)) {
@@ -1647,23 +2822,27 @@ static int dsync_strmap_compare(
         /* TODO: add support for symlinks */
         if (! S_ISREG(dst_mode)) {
             /* not regular file, take them as common content */
-            dsync_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_COMMON);
-            dsync_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_COMMON);
+            dsync_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_COMMON);
+            dsync_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_COMMON);
             continue;
         }
 
         /* first check whether file sizes match */
         dsync_state state;
-        tmp_rc = dsync_strmap_item_state(src_map, key, DCMPF_SIZE, &state);
+        tmp_rc = dsync_map_item_state(src_map, key, DCMPF_SIZE, &state);
         assert(tmp_rc == 0);
         if (state == DCMPS_DIFFER) {
             /* file size is different, their contents should be different */
-            dsync_strmap_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
-            dsync_strmap_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(src_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
+            dsync_map_item_update(dst_map, key, DCMPF_CONTENT, DCMPS_DIFFER);
 
             /* if the file sizes are different then we need to remove the file in
-             * the dst directory, and replace it with the one in the src directory */
-            if (!options.dry_run) {
+             * the dst directory, and replace it with the one in the src directory,
+             * or update it in place to match the source */
+            if (options.delta) {
+                mfu_flist_file_copy(src_list, src_index, src_delta_list);
+                mfu_flist_file_copy(dst_list, dst_index, dst_delta_list);
+            } else {
                 mfu_flist_file_copy(src_list, src_index, src_cp_list);
                 mfu_flist_file_copy(dst_list, dst_index, dst_remove_list);
             }
@@ -1708,7 +2887,7 @@ static int dsync_strmap_compare(
             /* compare file contents byte-by-byte, overwrites destination
              * file in place if found to be different during comparison
              * and hardlinks are not enabled */
-            tmp_rc = dsync_strmap_compare_data(src_compare_list, src_map,
+            tmp_rc = dsync_map_compare_data(src_compare_list, src_map,
                 dst_compare_list, dst_map, src_list, src_cp_list, dst_same_list,
                 dst_remove_list, strlen_prefix,
                 &total_bytes_read, &total_bytes_written, use_hardlinks
@@ -1724,9 +2903,9 @@ static int dsync_strmap_compare(
 
             /* assume contents are different if size or mtime are different,
              * adds files to remove and copy lists if different */
-            tmp_rc = dsync_strmap_compare_lite(src_compare_list, src_cp_list, dst_same_list,
+            tmp_rc = dsync_map_compare_lite(src_compare_list, src_cp_list, dst_same_list,
                 src_map, dst_compare_list, dst_remove_list, dst_map,
-                strlen_prefix, use_hardlinks
+                src_delta_list, dst_delta_list, strlen_prefix, use_hardlinks
             );
             if (tmp_rc < 0) {
                 rc = -1;
@@ -1734,13 +2913,27 @@ static int dsync_strmap_compare(
         }
     }
 
+    /* look for source files that were renamed in the destination,
+     * those that were not are added to the copy list */
+    if (options.detect_renames) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Looking for renamed files");
+        }
+        mfu_flist_summarize(src_move_list);
+        uint64_t dst_size = mfu_flist_size(dst_list);
+        moved = (int*) MFU_MALLOC(dst_size * sizeof(int));
+        memset(moved, 0, dst_size * sizeof(int));
+        dsync_match_renames(src_move_list, src_map, dst_list, dst_map,
+            src_cp_list, src_rename_list, dst_rename_list, moved);
+    }
+
     /* wait for all procs to finish before stopping timer */
     MPI_Barrier(MPI_COMM_WORLD);
 
     if (link_path != NULL) {
         /* compare files in source and link-dest and create list of items
          * that are the same */
-        rc = dsync_strmap_compare_link_dest(src_list, src_map,
+        rc = dsync_map_compare_link_dest(src_list, src_map,
             link_list, link_map, link_same_list);
 
         /* of the items to be copied, some may be actual copies,
@@ -1773,18 +2966,39 @@ static int dsync_strmap_compare(
      * in the src list. Then, we copy the files that are only
      * in the src list into the destination list. */
 
-    if (!options.dry_run) {
-        /* pick the original copy list or the filtered one depending on
-         * whether files are to be hardlinked in destination */
-        mfu_flist cp_list = src_cp_list;
-        if (link_path != NULL) {
-            cp_list = src_real_cp_list;
+    /* pick the original copy list or the filtered one depending on
+     * whether files are to be hardlinked in destination */
+    mfu_flist cp_list = src_cp_list;
+    if (link_path != NULL) {
+        cp_list = src_real_cp_list;
+    }
+
+    if (options.dry_run) {
+        /* report what a sync would do without changing the destination */
+        dsync_report_plan(src_map, dst_map, src_list, dst_list, dst_remove_list,
+            link_dst_list, cp_list, src_delta_list, src_rename_list, moved,
+            metadata_refresh, refresh_count, strlen_prefix);
+    } else {
+        /* move renamed files to their new names, any that cannot be
+         * are added to the list to be copied */
+        tmp_rc = dsync_rename_files(src_rename_list, dst_rename_list,
+            cp_list, strlen_prefix, dest_path);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+
+        /* update changed files in place, any that cannot be
+         * are added to the lists to be replaced */
+        tmp_rc = dsync_delta_files(src_delta_list, dst_delta_list,
+            cp_list, dst_remove_list, strlen_prefix, dest_path);
+        if (tmp_rc < 0) {
+            rc = -1;
         }
 
         /* sync the files that are in the source and destination directories */
         tmp_rc = dsync_sync_files(src_map, dst_map,
             src_path, dest_path, link_path, dst_list, dst_remove_list,
-            link_dst_list, cp_list, mfu_copy_opts);
+            link_dst_list, cp_list, moved, mfu_copy_opts);
         if (tmp_rc < 0) {
             rc = -1;
         }
@@ -1798,15 +3012,11 @@ static int dsync_strmap_compare(
         }
 
         /* update metadata on files */
-        strmap_foreach(metadata_refresh, node) {
+        uint64_t i;
+        for (i = 0; i < refresh_count; i++) {
             /* extract source and destination indices */
-            unsigned long long src_i, dst_i;
-            const char* key = strmap_node_key(node);
-            const char* val = strmap_node_value(node);
-            sscanf(key, "%llu", &src_i);
-            sscanf(val, "%llu", &dst_i);
-            uint64_t src_index = (uint64_t) src_i;
-            uint64_t dst_index = (uint64_t) dst_i;
+            uint64_t src_index = metadata_refresh[2 * i + 0];
+            uint64_t dst_index = metadata_refresh[2 * i + 1];
 
             /* copy metadata values from source to destination, if needed */
             tmp_rc = mfu_flist_file_sync_meta(src_list, src_index, dst_list, dst_index);
@@ -1817,11 +3027,17 @@ static int dsync_strmap_compare(
     }
 
     /* done with our list of files for refreshing metadata */
-    strmap_delete(&metadata_refresh);
+    mfu_free(&metadata_refresh);
 
     /* free lists used for removing and copying files */
     mfu_flist_free(&dst_remove_list);
     mfu_flist_free(&src_cp_list);
+    mfu_flist_free(&src_delta_list);
+    mfu_flist_free(&dst_delta_list);
+    mfu_flist_free(&src_move_list);
+    mfu_flist_free(&src_rename_list);
+    mfu_flist_free(&dst_rename_list);
+    mfu_free(&moved);
 
     /* free the compare flists */
     mfu_flist_free(&dst_compare_list);
@@ -1845,37 +3061,40 @@ static int dsync_strmap_compare(
 }
 
 /* loop on the src map to check the results */
-static void dsync_strmap_check_src(strmap* src_map,
-                                  strmap* dst_map)
+static void dsync_map_check_src(cmpmap* src_map,
+                                  cmpmap* dst_map)
 {
     assert(dsync_option_need_compare(DCMPF_EXIST));
     /* iterate over each item in source map */
-    const strmap_node* node;
-    strmap_foreach(src_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t src_cursor = 0;
+    uint64_t dst_cursor = 0;
+    cmpmap_foreach(src_map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
         int only_src = 0;
 
         /* get index of source file */
         uint64_t src_index;
-        int ret = dsync_strmap_item_index(src_map, key, &src_index);
+        int ret = dsync_map_item_match(src_map, key, &src_cursor, &src_index);
         assert(ret == 0);
 
         /* get index of destination file */
         uint64_t dst_index;
-        ret = dsync_strmap_item_index(dst_map, key, &dst_index);
+        ret = dsync_map_item_match(dst_map, key, &dst_cursor, &dst_index);
         if (ret) {
             only_src = 1;
         }
 
         /* First check exist state */
         dsync_state src_exist_state;
-        ret = dsync_strmap_item_state(src_map, key, DCMPF_EXIST,
+        ret = dsync_map_item_state(src_map, key, DCMPF_EXIST,
             &src_exist_state);
         assert(ret == 0);
 
         dsync_state dst_exist_state;
-        ret = dsync_strmap_item_state(dst_map, key, DCMPF_EXIST,
+        ret = dsync_map_item_state(dst_map, key, DCMPF_EXIST,
             &dst_exist_state);
         if (only_src) {
             assert(ret);
@@ -1899,11 +3118,11 @@ static void dsync_strmap_check_src(strmap* src_map,
 
             /* get state of src and dest */
             dsync_state src_state;
-            ret = dsync_strmap_item_state(src_map, key, field, &src_state);
+            ret = dsync_map_item_state(src_map, key, field, &src_state);
             assert(ret == 0);
 
             dsync_state dst_state;
-            ret = dsync_strmap_item_state(dst_map, key, field, &dst_state);
+            ret = dsync_map_item_state(dst_map, key, field, &dst_state);
             if (only_src) {
                 assert(ret);
             } else {
@@ -1932,26 +3151,29 @@ static void dsync_strmap_check_src(strmap* src_map,
 }
 
 /* loop on the dest map to check the results */
-static void dsync_strmap_check_dst(strmap* src_map,
-    strmap* dst_map)
+static void dsync_map_check_dst(cmpmap* src_map,
+    cmpmap* dst_map)
 {
     assert(dsync_option_need_compare(DCMPF_EXIST));
 
     /* iterate over each item in dest map */
-    const strmap_node* node;
-    strmap_foreach(dst_map, node) {
+    const cmpmap_entry* node;
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t dst_cursor = 0;
+    uint64_t src_cursor = 0;
+    cmpmap_foreach(dst_map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
         int only_dest = 0;
 
         /* get index of destination file */
         uint64_t dst_index;
-        int ret = dsync_strmap_item_index(dst_map, key, &dst_index);
+        int ret = dsync_map_item_match(dst_map, key, &dst_cursor, &dst_index);
         assert(ret == 0);
 
         /* get index of source file */
         uint64_t src_index;
-        ret = dsync_strmap_item_index(src_map, key, &src_index);
+        ret = dsync_map_item_match(src_map, key, &src_cursor, &src_index);
         if (ret) {
             /* This file only exist in dest */
             only_dest = 1;
@@ -1959,7 +3181,7 @@ static void dsync_strmap_check_dst(strmap* src_map,
 
         /* First check exist state */
         dsync_state src_exist_state;
-        ret = dsync_strmap_item_state(src_map, key, DCMPF_EXIST,
+        ret = dsync_map_item_state(src_map, key, DCMPF_EXIST,
             &src_exist_state);
         if (only_dest) {
             assert(ret);
@@ -1968,7 +3190,7 @@ static void dsync_strmap_check_dst(strmap* src_map,
         }
 
         dsync_state dst_exist_state;
-        ret = dsync_strmap_item_state(dst_map, key, DCMPF_EXIST,
+        ret = dsync_map_item_state(dst_map, key, DCMPF_EXIST,
             &dst_exist_state);
         assert(ret == 0);
 
@@ -1989,7 +3211,7 @@ static void dsync_strmap_check_dst(strmap* src_map,
 
             /* get state of src and dest */
             dsync_state src_state;
-            ret = dsync_strmap_item_state(src_map, key, field,
+            ret = dsync_map_item_state(src_map, key, field,
                 &src_state);
             if (only_dest) {
                 assert(ret);
@@ -1998,7 +3220,7 @@ static void dsync_strmap_check_dst(strmap* src_map,
             }
 
             dsync_state dst_state;
-            ret = dsync_strmap_item_state(dst_map, key, field,
+            ret = dsync_map_item_state(dst_map, key, field,
                 &dst_state);
             assert(ret == 0);
 
@@ -2032,12 +3254,12 @@ static void dsync_strmap_check_dst(strmap* src_map,
 }
 
 /* check the result maps are valid */
-static void dsync_strmap_check(
-    strmap* src_map,
-    strmap* dst_map)
+static void dsync_map_check(
+    cmpmap* src_map,
+    cmpmap* dst_map)
 {
-    dsync_strmap_check_src(src_map, dst_map);
-    dsync_strmap_check_dst(src_map, dst_map);
+    dsync_map_check_src(src_map, dst_map);
+    dsync_map_check_dst(src_map, dst_map);
 }
 
 static int dsync_map_fn(
@@ -2128,14 +3350,14 @@ static void dsync_expression_print(
 
 static int dsync_expression_match(
     struct dsync_expression *expression,
-    strmap* map,
+    cmpmap* map,
     const char* key)
 {
     int ret;
     dsync_state state;
     dsync_state exist_state;
 
-    ret = dsync_strmap_item_state(map, key, DCMPF_EXIST, &exist_state);
+    ret = dsync_map_item_state(map, key, DCMPF_EXIST, &exist_state);
     assert(ret == 0);
     if (exist_state == DCMPS_ONLY_SRC) {
         /*
@@ -2175,7 +3397,7 @@ static int dsync_expression_match(
     assert(exist_state == DCMPS_COMMON);
     assert(expression->field != DCMPF_EXIST);
 
-    ret = dsync_strmap_item_state(map, key, expression->field, &state);
+    ret = dsync_map_item_state(map, key, expression->field, &state);
     assert(ret == 0);
     /* All fields should have been compared. */
     assert(state == DCMPS_COMMON || state == DCMPS_DIFFER);
@@ -2256,7 +3478,7 @@ static void dsync_conjunction_print(
 /* if matched return 1, else return 0 */
 static int dsync_conjunction_match(
     struct dsync_conjunction *conjunction,
-    strmap* map,
+    cmpmap* map,
     const char* key)
 {
     struct dsync_expression* expression;
@@ -2344,7 +3566,7 @@ static void dsync_disjunction_print(
 /* if matched return 1, else return 0 */
 static int dsync_disjunction_match(
     struct dsync_disjunction* disjunction,
-    strmap* map,
+    cmpmap* map,
     const char* key,
     int is_src)
 {
@@ -2412,6 +3634,7 @@ static void dsync_option_fini(void)
     assert(list_empty(&options.outputs));
 
     mfu_free(&options.link_dest);
+    mfu_free(&options.delta_manifest);
 }
 
 static void dsync_option_add_output(struct dsync_output *output, int add_at_head)
@@ -2437,23 +3660,25 @@ static void dsync_option_add_comparison(dsync_field field)
 
 static int dsync_output_flist_match(
     struct dsync_output *output,
-    strmap* map,
+    cmpmap* map,
     mfu_flist flist,
     mfu_flist new_flist,
     mfu_flist *matched_flist,
     int is_src)
 {
-    const strmap_node* node;
+    const cmpmap_entry* node;
     struct dsync_conjunction *conjunction;
 
     /* iterate over each item in map */
-    strmap_foreach(map, node) {
+    /* cursors turn lookups into a merge walk when maps are sorted */
+    uint64_t cursor = 0;
+    cmpmap_foreach(map, node) {
         /* get file name */
-        const char* key = strmap_node_key(node);
+        const char* key = node->key;
 
         /* get index of file */
         uint64_t idx;
-        int ret = dsync_strmap_item_index(map, key, &idx);
+        int ret = dsync_map_item_match(map, key, &cursor, &idx);
         assert(ret == 0);
 
         if (dsync_disjunction_match(output->disjunction, map, key, is_src)) {
@@ -2480,9 +3705,9 @@ static int dsync_output_flist_match(
 static int dsync_output_write(
     struct dsync_output *output,
     mfu_flist src_flist,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_flist,
-    strmap* dst_map)
+    cmpmap* dst_map)
 {
     int ret = 0;
     mfu_flist new_flist = mfu_flist_subset(src_flist);
@@ -2533,9 +3758,9 @@ static int dsync_output_write(
 
 static int dsync_outputs_write(
     mfu_flist src_list,
-    strmap* src_map,
+    cmpmap* src_map,
     mfu_flist dst_list,
-    strmap* dst_map)
+    cmpmap* dst_map)
 {
     struct dsync_output* output;
     int ret = 0;
@@ -2783,15 +4008,14 @@ int main(int argc, char **argv)
     /* pointer to mfu_copy opts */
     mfu_copy_opts_t* mfu_copy_opts = mfu_copy_opts_new();
 
-    /* TODO: allow user to specify file lists as input files */
-
     /* TODO: three levels of comparison:
      *   1) file names only
      *   2) stat info + items in #1
      *   3) file contents + items in #2 */
 
-    /* walk by default because there is no input file option */
-    int walk = 1;
+    /* walk by default rather than read cache files */
+    char* src_input_name = NULL;
+    char* dst_input_name = NULL;
 
     /* By default, show info log messages. */
     /* we back off a level on CIRCLE verbosity since its INFO is verbose */
@@ -2810,11 +4034,22 @@ int main(int argc, char **argv)
     static struct option long_options[] = {
         {"dryrun",        0, 0, 'n'},
         {"batch-files",   1, 0, 'b'},
+        {"bwlimit",       1, 0, 'W'},
         {"contents",      0, 0, 'c'},
         {"delete",        0, 0, 'D'},
+        {"delta",         0, 0, 'E'},
+        {"delta-manifest", 1, 0, 'F'},
+        {"detect-renames", 0, 0, 'R'},
+        {"drop-cache",    0, 0, 'C'},
+        {"input",         1, 0, 'i'},
+        {"dest-input",    1, 0, 'I'},
         {"output",        1, 0, 'o'}, // undocumented
         {"debug",         0, 0, 'd'}, // undocumented
         {"link-dest",     1, 0, 'l'},
+        {"merge-join",    0, 0, 'M'},
+        {"blocksize",     1, 0, 'B'},
+        {"chunksize",     1, 0, 'k'},
+        {"opslimit",      1, 0, 'O'},
         {"sparse",        0, 0, 'S'},
         {"progress",      1, 0, 'P'},
         {"verbose",       0, 0, 'v'},
@@ -2828,13 +4063,14 @@ int main(int argc, char **argv)
     /* read in command line options */
     int usage = 0;
     int help  = 0;
+    unsigned long long bytes = 0;
 
     /* Don't delete dst files by default */
     options.delete = 0;
 
     while (1) {
         int c = getopt_long(
-            argc, argv, "b:cDo:Svqh",
+            argc, argv, "b:cDi:o:Svqh",
             long_options, &option_index
         );
 
@@ -2855,9 +4091,54 @@ int main(int argc, char **argv)
         case 'D':
             options.delete = 1;
             break;
+        case 'E':
+            options.delta = 1;
+            break;
+        case 'F':
+            mfu_free(&options.delta_manifest);
+            options.delta_manifest = MFU_STRDUP(optarg);
+            options.delta = 1;
+            break;
+        case 'R':
+            options.detect_renames = 1;
+            break;
+        case 'C':
+            mfu_io_cache_window = MFU_IO_CACHE_WINDOW;
+            break;
+        case 'i':
+            mfu_free(&src_input_name);
+            src_input_name = MFU_STRDUP(optarg);
+            break;
+        case 'I':
+            mfu_free(&dst_input_name);
+            dst_input_name = MFU_STRDUP(optarg);
+            break;
         case 'l':
             options.link_dest = MFU_STRDUP(optarg);
             break;
+        case 'M':
+            options.merge_join = 1;
+            break;
+        case 'W':
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to parse bandwidth limit: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                mfu_copy_opts->bw_limit = (uint64_t)bytes;
+            }
+            break;
+        case 'O':
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to parse metadata operation limit: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                mfu_copy_opts->ops_limit = (uint64_t)bytes;
+            }
+            break;
         case 'o':
             ret = dsync_option_output_parse(optarg, 0);
             if (ret) {
@@ -2870,6 +4151,28 @@ int main(int argc, char **argv)
         case 'S':
             mfu_copy_opts->sparse = 1;
             break;
+        case 'B':
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to parse block size: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                options.block_size = (size_t)bytes;
+                mfu_copy_opts->block_size = (size_t)bytes;
+            }
+            break;
+        case 'k':
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to parse chunk size: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                options.chunk_size = (uint64_t)bytes;
+                mfu_copy_opts->chunk_size = (uint64_t)bytes;
+            }
+            break;
         case 'P':
             mfu_progress_timeout = atoi(optarg);
             break;
@@ -2903,6 +4206,49 @@ int main(int argc, char **argv)
         usage = 1;
     }
 
+    /* updating a hardlinked file in place would change it in link-dest too */
+    if (options.delta && options.link_dest != NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cannot use --delta with --link-dest");
+        }
+        usage = 1;
+    }
+
+    /* a renamed file no longer has the name it had in the destination,
+     * which is only removed with --delete, and with --link-dest new
+     * files are linked rather than copied from the source */
+    if (options.detect_renames) {
+        if (!options.delete) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Cannot use --detect-renames without --delete");
+            }
+            usage = 1;
+        }
+        if (options.link_dest != NULL) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Cannot use --detect-renames with --link-dest");
+            }
+            usage = 1;
+        }
+    }
+
+    /* a cache only records metadata, so it can plan a sync
+     * but not carry one out or compare file contents */
+    if (src_input_name != NULL || dst_input_name != NULL) {
+        if (!options.dry_run) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Cannot use --input or --dest-input without --dryrun");
+            }
+            usage = 1;
+        }
+        if (options.contents || options.link_dest != NULL) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Cannot use --contents or --link-dest with --input or --dest-input");
+            }
+            usage = 1;
+        }
+    }
+
     /* Generate default output */
     if (list_empty(&options.outputs)) {
         /*
@@ -2934,6 +4280,8 @@ int main(int argc, char **argv)
         if (rank == 0) {
             print_usage();
         }
+        mfu_free(&src_input_name);
+        mfu_free(&dst_input_name);
         dsync_option_fini();
         mfu_finalize();
         MPI_Finalize();
@@ -2985,18 +4333,48 @@ int main(int argc, char **argv)
         }
     }
 
-    /* walk source path */
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Walking source path");
+    /* walk source path or read it from a cache */
+    int input_rc = 0;
+    if (src_input_name != NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Reading source list from `%s'", src_input_name);
+        }
+        input_rc = mfu_flist_read_cache_under(src_input_name, srcpath->path, flist_tmp_src);
+    } else {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Walking source path");
+        }
+        mfu_flist_walk_param_paths(1, srcpath, walk_opts, flist_tmp_src);
     }
-    mfu_flist_walk_param_paths(1, srcpath, walk_opts, flist_tmp_src);
 
     /* check that we actually got something so that we don't delete
      * an entire target directory because of a typo on the source dir */
-    if (mfu_flist_global_size(flist_tmp_src) == 0) {
+    if (input_rc == 0 && mfu_flist_global_size(flist_tmp_src) == 0) {
         if (rank == 0) {
             MFU_LOG(MFU_LOG_ERR, "ERROR: No items found at source: `%s'", srcpath->orig);
         }
+        input_rc = -1;
+    }
+
+    /* walk destinaton path or read it from a cache */
+    if (input_rc == 0) {
+        if (dst_input_name != NULL) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "Reading destination list from `%s'", dst_input_name);
+            }
+            input_rc = mfu_flist_read_cache_under(dst_input_name, destpath->path, flist_tmp_dst);
+        } else {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "Walking destination path");
+            }
+            mfu_flist_walk_param_paths(1, destpath, walk_opts, flist_tmp_dst);
+        }
+    }
+
+    mfu_free(&src_input_name);
+    mfu_free(&dst_input_name);
+
+    if (input_rc != 0) {
         mfu_flist_free(&flist_tmp_src);
         mfu_flist_free(&flist_tmp_dst);
         if (options.link_dest != NULL) {
@@ -3012,12 +4390,6 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    /* walk destinaton path */
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Walking destination path");
-    }
-    mfu_flist_walk_param_paths(1, destpath, walk_opts, flist_tmp_dst);
-
     /* walk link-dest path if we have one */
     if (options.link_dest != NULL) {
         if (rank == 0) {
@@ -3052,25 +4424,25 @@ int main(int argc, char **argv)
     }
 
     /* map each file name to its index and its comparison state */
-    strmap* map_src = dsync_strmap_creat(flist_src, path_src);
-    strmap* map_dst = dsync_strmap_creat(flist_dst, path_dst);
-    strmap* map_link = NULL;
+    cmpmap* map_src = dsync_map_creat(flist_src, path_src);
+    cmpmap* map_dst = dsync_map_creat(flist_dst, path_dst);
+    cmpmap* map_link = NULL;
     if (options.link_dest != NULL) {
-        map_link = dsync_strmap_creat(flist_link, path_link);
+        map_link = dsync_map_creat(flist_link, path_link);
     }
 
     /* compare files in map_src with those in map_dst */
-    int tmp_rc = dsync_strmap_compare(flist_src, map_src, flist_dst, map_dst, flist_link, map_link,
+    int tmp_rc = dsync_map_compare(flist_src, map_src, flist_dst, map_dst, flist_link, map_link,
         strlen(path_src), mfu_copy_opts, srcpath, destpath, linkpath);
     if (tmp_rc < 0) {
         rc = 1;
     }
 
     /* free maps of file names to comparison state info */
-    strmap_delete(&map_src);
-    strmap_delete(&map_dst);
+    cmpmap_delete(&map_src);
+    cmpmap_delete(&map_dst);
     if (options.link_dest != NULL) {
-        strmap_delete(&map_link);
+        cmpmap_delete(&map_link);
     }
 
     /* free file lists */
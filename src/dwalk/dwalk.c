@@ -308,6 +308,8 @@ static void print_usage(void)
     printf("  -s, --sort <fields>     - sort output by comma-delimited fields\n");
     printf("  -d, --distribution <field>:<separators> \n                          - print distribution by field\n");
     printf("  -f, --file_histogram    - print default size distribution of items\n");
+    printf("      --top <field>:<N>   - print first N items as sorted by numeric field\n");
+    printf("      --percentiles <field> - print estimated percentiles of numeric field\n");
     printf("  -p, --print             - print files to screen\n");
     printf("      --progress <N>      - print progress every N seconds\n");
     printf("  -v, --verbose           - verbose output\n");
@@ -315,6 +317,7 @@ static void print_usage(void)
     printf("  -h, --help              - print usage\n");
     printf("\n");
     printf("Fields: name,user,group,uid,gid,atime,mtime,ctime,size\n");
+    printf("Numeric fields: uid,gid,atime,mtime,ctime,size\n");
     printf("For more information see https://mpifileutils.readthedocs.io. \n");
     printf("\n");
     fflush(stdout);
@@ -352,6 +355,9 @@ int main(int argc, char** argv)
     char* outputname     = NULL;
     char* sortfields     = NULL;
     char* distribution   = NULL;
+    char* topfield       = NULL;
+    char* pctfield       = NULL;
+    uint64_t topcount    = 0;
 
     int file_histogram       = 0;
     int walk                 = 0;
@@ -372,6 +378,8 @@ int main(int argc, char** argv)
         {"sort",           1, 0, 's'},
         {"distribution",   1, 0, 'd'},
         {"file_histogram", 0, 0, 'f'},
+        {"top",            1, 0, 'K'},
+        {"percentiles",    1, 0, 'Q'},
         {"print",          0, 0, 'p'},
         {"progress",       1, 0, 'P'},
         {"verbose",        0, 0, 'v'},
@@ -411,6 +419,12 @@ int main(int argc, char** argv)
             case 'f':
                 file_histogram = 1;
                 break;
+            case 'K':
+                topfield = MFU_STRDUP(optarg);
+                break;
+            case 'Q':
+                pctfield = MFU_STRDUP(optarg);
+                break;
             case 'p':
                 print = 1;
                 break;
@@ -540,6 +554,36 @@ int main(int argc, char** argv)
         mfu_free(&sortfields_copy);
     }
 
+    /* parse <field>:<N> for top items */
+    if (topfield != NULL) {
+        char* field;
+        if (mfu_flist_parse_topk(topfield, &field, &topcount) != MFU_SUCCESS) {
+            if (rank == 0) {
+                printf("Invalid top argument, expected <field>:<N> with a numeric field: %s\n", topfield);
+            }
+            usage = 1;
+        }
+        else {
+            mfu_free(&topfield);
+            topfield = field;
+        }
+    }
+
+    if (pctfield != NULL && ! mfu_flist_numeric_field_valid(pctfield)) {
+        if (rank == 0) {
+            printf("Invalid percentiles field: %s\n", pctfield);
+        }
+        usage = 1;
+    }
+
+    /* numeric fields all come from stat */
+    if ((topfield != NULL || pctfield != NULL) && ! walk_opts->use_stat) {
+        if (rank == 0) {
+            printf("Cannot use --top or --percentiles with --lite\n");
+        }
+        usage = 1;
+    }
+
     if (distribution != NULL) {
         if (distribution_parse(&option, distribution) != 0) {
             if (rank == 0) {
@@ -603,6 +647,16 @@ int main(int argc, char** argv)
         print_flist_distribution(file_histogram, &option, &flist, rank);
     }
 
+    /* print first items by numeric field if user asked for them */
+    if (topfield != NULL) {
+        mfu_flist_print_topk(flist, topfield, topcount);
+    }
+
+    /* print percentiles of numeric field */
+    if (pctfield != NULL) {
+        mfu_flist_print_quantiles(flist, pctfield);
+    }
+
     /* write data to cache file */
     if (outputname != NULL) {
         if (!text) {
@@ -616,6 +670,8 @@ int main(int argc, char** argv)
     mfu_flist_free(&flist);
 
     /* free memory allocated for options */
+    mfu_free(&pctfield);
+    mfu_free(&topfield);
     mfu_free(&distribution);
     mfu_free(&sortfields);
     mfu_free(&outputname);
@@ -0,0 +1,16 @@
+#!/usr/bin/env python2
+import subprocess 
+
+# change paths here for bash script as necessary
+mpifu_path      = "~/mpifileutils/test/tests/test_dcmp/test_manifest.sh" 
+
+# vars in bash script
+dcmp_test_bin   = "/root/mpifileutils/install/bin/dcmp"
+dcmp_mpirun_bin = "mpirun"
+dcmp_src_dir    = "/mnt/lustre"
+dcmp_dest_dir   = "/mnt/lustre2"
+dcmp_tmp_file   = "dir_test_manifest_XXX"
+
+def test_manifest():
+        p = subprocess.Popen(["%s %s %s %s %s %s" % (mpifu_path, dcmp_test_bin, dcmp_mpirun_bin, 
+          dcmp_src_dir, dcmp_dest_dir, dcmp_tmp_file)], shell=True, executable="/bin/bash").communicate()
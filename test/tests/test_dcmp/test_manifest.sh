@@ -0,0 +1,115 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check dcmp --write-manifest and dcmp --manifest, which
+#   compare a tree against checksums of files and their chunks written
+#   from another tree, as when the two trees are on different sites.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DCMP_TEST_BIN=${DCMP_TEST_BIN:-${1}}
+DCMP_MPIRUN_BIN=${DCMP_MPIRUN_BIN:-${2}}
+DCMP_SRC_DIR=${DCMP_SRC_DIR:-${3}}
+DCMP_DEST_DIR=${DCMP_DEST_DIR:-${4}}
+DCMP_TMP_FILE=${DCMP_TMP_FILE:-${5}}
+
+echo "Using dcmp binary at: $DCMP_TEST_BIN"
+echo "Using mpirun binary at: $DCMP_MPIRUN_BIN"
+echo "Using src directory at: $DCMP_SRC_DIR"
+echo "Using dest directory at: $DCMP_DEST_DIR"
+
+DCMP_MANIFEST=$DCMP_DEST_DIR/$DCMP_TMP_FILE.manifest
+DCMP_OUT=$DCMP_DEST_DIR/$DCMP_TMP_FILE.out
+DCMP_SRC=$DCMP_SRC_DIR/$DCMP_TMP_FILE
+DCMP_DEST=$DCMP_DEST_DIR/$DCMP_TMP_FILE
+
+function cleanup {
+	rm -rf $DCMP_SRC
+	rm -rf $DCMP_DEST
+	rm -f $DCMP_MANIFEST $DCMP_MANIFEST.*
+	rm -f $DCMP_OUT
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+function write_manifest {
+	$DCMP_MPIRUN_BIN -np $1 $DCMP_TEST_BIN --chunksize 64KB --write-manifest $2 $DCMP_SRC
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DCMP_MPIRUN_BIN -np $1 $DCMP_TEST_BIN --chunksize 64KB --write-manifest $2 $DCMP_SRC"
+	fi
+}
+
+function compare_manifest {
+	$DCMP_MPIRUN_BIN -np $1 $DCMP_TEST_BIN --manifest $DCMP_MANIFEST $DCMP_DEST > $DCMP_OUT
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DCMP_MPIRUN_BIN -np $1 $DCMP_TEST_BIN --manifest $DCMP_MANIFEST $DCMP_DEST"
+	fi
+}
+
+# check that a line of the dcmp summary has the expected value
+function check_count {
+	line=$(grep "^Number of files $1:" $DCMP_OUT)
+	if [[ "$line" != "Number of files $1: $2" ]]; then
+		fail "Expected \"Number of files $1: $2\", found \"$line\"."
+	fi
+}
+
+cleanup
+mkdir -p $DCMP_SRC/sub
+
+# files of one or more chunks, an empty file,
+# and a file whose name needs escaping in the manifest
+for i in 1 2 3 4 5; do
+	dd if=/dev/urandom of=$DCMP_SRC/sub/f$i bs=100k count=$i
+done
+touch $DCMP_SRC/empty
+echo src > "$DCMP_SRC/two words"
+
+echo "Subtest 1, write manifests with different numbers of processes."
+write_manifest 1 $DCMP_MANIFEST.1
+write_manifest 4 $DCMP_MANIFEST
+# files may be listed in any order
+diff <(sort $DCMP_MANIFEST.1) <(sort $DCMP_MANIFEST)
+if [[ $? -ne 0 ]]; then
+	fail "Manifests written with 1 and 4 processes differ."
+fi
+
+echo "Subtest 2, compare an identical tree against the manifest."
+mkdir -p $DCMP_DEST
+cp -a $DCMP_SRC/. $DCMP_DEST
+compare_manifest 3
+check_count "in manifest" 7
+check_count "only in manifest" 0
+check_count "only in tree" 0
+check_count "that have different type or size" 0
+check_count "that have different contents" "0 (0 chunks)"
+check_count "that have the same contents" 7
+
+echo "Subtest 3, compare a changed tree against the manifest."
+# two bytes that span the first two chunks of a file,
+# a file that grew, a removed file, and a new file
+printf 'XY' | dd of=$DCMP_DEST/sub/f5 bs=1 seek=65535 conv=notrunc
+echo more >> $DCMP_DEST/sub/f2
+rm -f $DCMP_DEST/sub/f1
+echo new > $DCMP_DEST/sub/new
+for np in 1 2; do
+	compare_manifest $np
+	check_count "in manifest" 7
+	check_count "only in manifest" 1
+	check_count "only in tree" 1
+	check_count "that have different type or size" 1
+	check_count "that have different contents" "1 (2 chunks)"
+	check_count "that have the same contents" 4
+done
+
+cleanup
+exit 0
@@ -0,0 +1,137 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dcmp --merge-join reports the same items as
+#   dcmp matching items by hashing their paths, both in its summary and
+#   in lists written with --output, for any number of processes.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DCMP_TEST_BIN=${DCMP_TEST_BIN:-${1}}
+DCMP_MPIRUN_BIN=${DCMP_MPIRUN_BIN:-${2}}
+DCMP_SRC_DIR=${DCMP_SRC_DIR:-${3}}
+DCMP_DEST_DIR=${DCMP_DEST_DIR:-${4}}
+DCMP_TMP_FILE=${DCMP_TMP_FILE:-${5}}
+
+echo "Using dcmp binary at: $DCMP_TEST_BIN"
+echo "Using mpirun binary at: $DCMP_MPIRUN_BIN"
+echo "Using src directory at: $DCMP_SRC_DIR"
+echo "Using dest directory at: $DCMP_DEST_DIR"
+
+DCMP_OUT=$DCMP_DEST_DIR/$DCMP_TMP_FILE.out
+DCMP_SRC=$DCMP_SRC_DIR/$DCMP_TMP_FILE
+DCMP_DEST=$DCMP_DEST_DIR/$DCMP_TMP_FILE
+
+DCMP_EXPRS="EXIST=ONLY_SRC EXIST=ONLY_DEST EXIST=COMMON@TYPE=DIFFER SIZE=DIFFER PERM=DIFFER CONTENT=DIFFER EXIST=COMMON@CONTENT=COMMON"
+
+function cleanup {
+	rm -rf $DCMP_SRC
+	rm -rf $DCMP_DEST
+	rm -rf $DCMP_OUT
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+# run dcmp with the given number of processes and options, writing
+# its summary and a sorted list for each expression to directory $2
+function run_dcmp {
+	np=$1
+	out=$2
+	shift 2
+
+	mkdir -p $out
+	outputs=""
+	n=0
+	for expr in $DCMP_EXPRS; do
+		outputs="$outputs -o $expr:$out/list.$n"
+		n=$((n + 1))
+	done
+
+	$DCMP_MPIRUN_BIN -np $np $DCMP_TEST_BIN $@ --chunksize 64KB --text $outputs \
+		$DCMP_SRC $DCMP_DEST > $out/stdout
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DCMP_MPIRUN_BIN -np $np $DCMP_TEST_BIN $@ --chunksize 64KB --text $outputs $DCMP_SRC $DCMP_DEST"
+	fi
+
+	# items may be listed in any order
+	grep "^Number of items" $out/stdout | sed 's/, dumped to .*//' > $out/summary
+	n=0
+	for expr in $DCMP_EXPRS; do
+		sort $out/list.$n > $out/sorted.$n
+		n=$((n + 1))
+	done
+}
+
+function check_same_output {
+	diff $1/summary $2/summary
+	if [[ $? -ne 0 ]]; then
+		fail "Summary differs between $1 and $2."
+	fi
+	n=0
+	for expr in $DCMP_EXPRS; do
+		diff $1/sorted.$n $2/sorted.$n
+		if [[ $? -ne 0 ]]; then
+			fail "Items matching $expr differ between $1 and $2."
+		fi
+		n=$((n + 1))
+	done
+}
+
+cleanup
+mkdir -p $DCMP_OUT
+
+# several directories of files, most of them the same in both trees
+for d in a b c b/d; do
+	mkdir -p $DCMP_SRC/$d $DCMP_DEST/$d
+	for i in $(seq 1 20); do
+		head -c $(( i * 10007 )) /dev/urandom > $DCMP_SRC/$d/f$i
+		cp $DCMP_SRC/$d/f$i $DCMP_DEST/$d/f$i
+	done
+done
+
+# items only in one tree, including a directory with files in it
+echo src > $DCMP_SRC/a/only_src
+echo dest > $DCMP_DEST/c/only_dest
+mkdir -p $DCMP_SRC/only_src_dir
+echo src > $DCMP_SRC/only_src_dir/f
+
+# a file in the source that is a directory in the destination
+echo src > $DCMP_SRC/b/type
+mkdir -p $DCMP_DEST/b/type
+
+# changed contents in a later chunk, changed size, changed permissions
+printf 'X' | dd of=$DCMP_DEST/a/f20 bs=1 seek=150000 conv=notrunc
+echo more >> $DCMP_DEST/b/f3
+chmod 600 $DCMP_DEST/c/f7
+
+# same mtimes on both sides so contents must be read to compare
+touch -d "1 hour ago" $DCMP_SRC/*/f* $DCMP_SRC/b/d/f* $DCMP_DEST/*/f* $DCMP_DEST/b/d/f*
+
+echo "Subtest 1, compare matching items by hashing paths."
+run_dcmp 2 $DCMP_OUT/hash
+if [[ ! -s $DCMP_OUT/hash/summary ]]; then
+	fail "No summary written by $DCMP_TEST_BIN."
+fi
+
+echo "Subtest 2, compare matching items with a merge join."
+for np in 1 2 4; do
+	run_dcmp $np $DCMP_OUT/merge$np --merge-join
+	check_same_output $DCMP_OUT/hash $DCMP_OUT/merge$np
+done
+
+echo "Subtest 3, compare with --lite."
+run_dcmp 3 $DCMP_OUT/hash_lite --lite
+run_dcmp 3 $DCMP_OUT/merge_lite --lite --merge-join
+check_same_output $DCMP_OUT/hash_lite $DCMP_OUT/merge_lite
+
+cleanup
+exit 0
@@ -0,0 +1,18 @@
+#!/usr/bin/env python2
+import subprocess 
+
+# change paths here for bash script as necessary
+mpifu_path     = "~/mpifileutils/test/tests/test_dcp/test_hardlinks.sh" 
+
+# vars in bash script
+dcp_test_bin   = "/root/mpifileutils/install/bin/dcp"
+dcp_mpirun_bin = "mpirun"
+dcp_cmp_bin    = "cmp"
+dcp_src_dir    = "/mnt/lustre"
+dcp_dest_dir   = "/mnt/lustre2"
+dcp_tmp_file   = "dir_test_hardlinks_XXX"
+dcp_walk_bin   = "/root/mpifileutils/install/bin/dwalk"
+
+def test_hardlinks():
+        p = subprocess.Popen(["%s %s %s %s %s %s %s %s" % (mpifu_path, dcp_test_bin, dcp_mpirun_bin, 
+          dcp_cmp_bin, dcp_src_dir, dcp_dest_dir, dcp_tmp_file, dcp_walk_bin)], shell=True, executable="/bin/bash").communicate()
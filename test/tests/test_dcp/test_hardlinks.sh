@@ -0,0 +1,112 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dcp -H copies the data of hard linked files once
+#   and links their other names to it, so that each destination file has
+#   the same link count as its source, both when dcp walks the source and
+#   when it reads a list of the source written by dwalk --output.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DCP_TEST_BIN=${DCP_TEST_BIN:-${1}}
+DCP_MPIRUN_BIN=${DCP_MPIRUN_BIN:-${2}}
+DCP_CMP_BIN=${DCP_CMP_BIN:-${3}}
+DCP_SRC_DIR=${DCP_SRC_DIR:-${4}}
+DCP_DEST_DIR=${DCP_DEST_DIR:-${5}}
+DCP_TMP_FILE=${DCP_TMP_FILE:-${6}}
+DCP_WALK_BIN=${DCP_WALK_BIN:-${7}}
+
+echo "Using dcp binary at: $DCP_TEST_BIN"
+echo "Using mpirun binary at: $DCP_MPIRUN_BIN"
+echo "Using cmp binary at: $DCP_CMP_BIN"
+echo "Using src directory at: $DCP_SRC_DIR"
+echo "Using dest directory at: $DCP_DEST_DIR"
+echo "Using dwalk binary at: $DCP_WALK_BIN"
+
+DCP_CACHE=$DCP_DEST_DIR/$DCP_TMP_FILE.cache
+DCP_SRC=$DCP_SRC_DIR/$DCP_TMP_FILE
+DCP_DEST=$DCP_DEST_DIR/$DCP_TMP_FILE
+
+function cleanup {
+	rm -rf $DCP_SRC
+	rm -rf $DCP_DEST
+	rm -f $DCP_CACHE
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+function check_same {
+	for f in $@; do
+		$DCP_CMP_BIN $DCP_SRC/$f $DCP_DEST/$f
+		if [[ $? -ne 0 ]]; then
+			fail "CMP mismatch: $DCP_SRC/$f $DCP_DEST/$f."
+		fi
+	done
+}
+
+# check that the named destination files have the given link count
+# and are all names of the same inode
+function check_linked {
+	count=$1
+	shift
+	inode=$(stat -c %i $DCP_DEST/$1)
+	for f in $@; do
+		links=$(stat -c %h $DCP_DEST/$f)
+		if [[ $links -ne $count ]]; then
+			fail "Expected $count links to $DCP_DEST/$f, found $links."
+		fi
+		if [[ $(stat -c %i $DCP_DEST/$f) -ne $inode ]]; then
+			fail "$DCP_DEST/$f is not linked to $DCP_DEST/$1."
+		fi
+	done
+}
+
+function check_tree {
+	check_same a b sub/c d sub/d2 f
+	check_linked 3 a b sub/c
+	check_linked 2 d sub/d2
+	check_linked 1 f
+}
+
+cleanup
+mkdir -p $DCP_SRC/sub
+
+# a file of several chunks with three names, one in a subdirectory,
+# a small file with two names, and a file with one name
+dd if=/dev/urandom of=$DCP_SRC/a bs=1M count=3
+ln $DCP_SRC/a $DCP_SRC/b
+ln $DCP_SRC/a $DCP_SRC/sub/c
+dd if=/dev/urandom of=$DCP_SRC/d bs=1k count=10
+ln $DCP_SRC/d $DCP_SRC/sub/d2
+dd if=/dev/urandom of=$DCP_SRC/f bs=1k count=10
+
+echo "Subtest 1, copy hard links with -H."
+$DCP_MPIRUN_BIN -np 3 $DCP_TEST_BIN -H --chunksize 1MB $DCP_SRC $DCP_DEST_DIR
+if [[ $? -ne 0 ]]; then
+	fail "Failed to run cmd: $DCP_MPIRUN_BIN -np 3 $DCP_TEST_BIN -H --chunksize 1MB $DCP_SRC $DCP_DEST_DIR"
+fi
+check_tree
+
+echo "Subtest 2, copy hard links with -H from a dwalk cache."
+rm -rf $DCP_DEST
+$DCP_MPIRUN_BIN -np 2 $DCP_WALK_BIN --output $DCP_CACHE $DCP_SRC
+if [[ $? -ne 0 ]]; then
+	fail "Failed to run cmd: $DCP_MPIRUN_BIN -np 2 $DCP_WALK_BIN --output $DCP_CACHE $DCP_SRC"
+fi
+$DCP_MPIRUN_BIN -np 2 $DCP_TEST_BIN -H --input $DCP_CACHE $DCP_SRC $DCP_DEST_DIR
+if [[ $? -ne 0 ]]; then
+	fail "Failed to run cmd: $DCP_MPIRUN_BIN -np 2 $DCP_TEST_BIN -H --input $DCP_CACHE $DCP_SRC $DCP_DEST_DIR"
+fi
+check_tree
+
+cleanup
+exit 0
@@ -0,0 +1,109 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dcp --verify accepts the files named in a
+#   manifest written by dcp --manifest, with any number of processes,
+#   and that it fails once a chunk of one of those files is changed.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DCP_TEST_BIN=${DCP_TEST_BIN:-${1}}
+DCP_MPIRUN_BIN=${DCP_MPIRUN_BIN:-${2}}
+DCP_CMP_BIN=${DCP_CMP_BIN:-${3}}
+DCP_SRC_DIR=${DCP_SRC_DIR:-${4}}
+DCP_DEST_DIR=${DCP_DEST_DIR:-${5}}
+DCP_TMP_FILE=${DCP_TMP_FILE:-${6}}
+
+echo "Using dcp binary at: $DCP_TEST_BIN"
+echo "Using mpirun binary at: $DCP_MPIRUN_BIN"
+echo "Using cmp binary at: $DCP_CMP_BIN"
+echo "Using src directory at: $DCP_SRC_DIR"
+echo "Using dest directory at: $DCP_DEST_DIR"
+
+DCP_MANIFEST=$DCP_DEST_DIR/$DCP_TMP_FILE.manifest
+DCP_SRC=$DCP_SRC_DIR/$DCP_TMP_FILE
+DCP_DEST=$DCP_DEST_DIR/$DCP_TMP_FILE
+
+function cleanup {
+	rm -rf $DCP_SRC
+	rm -rf $DCP_DEST
+	rm -f $DCP_MANIFEST
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+function run_verify {
+	$DCP_MPIRUN_BIN -np $1 $DCP_TEST_BIN --chunksize 1MB --verify $DCP_MANIFEST
+}
+
+function check_same {
+	for f in $@; do
+		$DCP_CMP_BIN $DCP_SRC/$f $DCP_DEST/$f
+		if [[ $? -ne 0 ]]; then
+			fail "CMP mismatch: $DCP_SRC/$f $DCP_DEST/$f."
+		fi
+	done
+}
+
+cleanup
+mkdir -p $DCP_SRC
+
+echo "Subtest 1, copy and write a manifest."
+# a file of several chunks, a small file, an empty file,
+# and a file whose name needs escaping in the manifest
+dd if=/dev/urandom of=$DCP_SRC/big bs=1M count=5
+dd if=/dev/urandom of=$DCP_SRC/small bs=1k count=100
+touch $DCP_SRC/empty
+dd if=/dev/urandom of="$DCP_SRC/two words" bs=1k count=10
+
+$DCP_MPIRUN_BIN -np 2 $DCP_TEST_BIN --chunksize 1MB --manifest $DCP_MANIFEST \
+	$DCP_SRC $DCP_DEST_DIR
+if [[ $? -ne 0 ]]; then
+	fail "Failed to run cmd: $DCP_MPIRUN_BIN -np 2 $DCP_TEST_BIN --chunksize 1MB --manifest $DCP_MANIFEST $DCP_SRC $DCP_DEST_DIR"
+fi
+check_same big small empty
+$DCP_CMP_BIN "$DCP_SRC/two words" "$DCP_DEST/two words"
+if [[ $? -ne 0 ]]; then
+	fail "CMP mismatch: $DCP_SRC/two words $DCP_DEST/two words."
+fi
+
+lines=$(grep -c "$DCP_DEST/" $DCP_MANIFEST)
+if [[ $lines -ne 4 ]]; then
+	fail "Expected 4 files in manifest, found $lines."
+fi
+
+echo "Subtest 2, verify the manifest with different numbers of processes."
+for np in 1 3; do
+	run_verify $np
+	if [[ $? -ne 0 ]]; then
+		fail "Verify failed with $np processes."
+	fi
+done
+
+echo "Subtest 3, verify after a chunk of a file changed."
+# flip a byte in the third chunk, leaving the size unchanged
+cp $DCP_DEST/big $DCP_DEST/big.orig
+printf 'X' | dd of=$DCP_DEST/big bs=1 seek=2500000 conv=notrunc
+run_verify 3
+if [[ $? -eq 0 ]]; then
+	fail "Verify passed with a changed chunk in $DCP_DEST/big."
+fi
+
+echo "Subtest 4, verify after the file is restored."
+mv $DCP_DEST/big.orig $DCP_DEST/big
+run_verify 2
+if [[ $? -ne 0 ]]; then
+	fail "Verify failed after $DCP_DEST/big was restored."
+fi
+
+cleanup
+exit 0
@@ -0,0 +1,99 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dcp --resume --sparse leaves the destination
+#   identical to the source, after the source changed since the journal
+#   was written and the destination holds data that is not in a journal.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DCP_TEST_BIN=${DCP_TEST_BIN:-${1}}
+DCP_MPIRUN_BIN=${DCP_MPIRUN_BIN:-${2}}
+DCP_CMP_BIN=${DCP_CMP_BIN:-${3}}
+DCP_SRC_DIR=${DCP_SRC_DIR:-${4}}
+DCP_DEST_DIR=${DCP_DEST_DIR:-${5}}
+DCP_TMP_FILE=${DCP_TMP_FILE:-${6}}
+
+echo "Using dcp binary at: $DCP_TEST_BIN"
+echo "Using mpirun binary at: $DCP_MPIRUN_BIN"
+echo "Using cmp binary at: $DCP_CMP_BIN"
+echo "Using src directory at: $DCP_SRC_DIR"
+echo "Using dest directory at: $DCP_DEST_DIR"
+
+DCP_JOURNAL_DIR=$DCP_DEST_DIR/$DCP_TMP_FILE.journal
+DCP_SRC=$DCP_SRC_DIR/$DCP_TMP_FILE
+DCP_DEST=$DCP_DEST_DIR/$DCP_TMP_FILE
+
+function cleanup {
+	rm -rf $DCP_SRC
+	rm -rf $DCP_DEST
+	rm -rf $DCP_JOURNAL_DIR
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+function run_dcp {
+	$DCP_MPIRUN_BIN -np $1 $DCP_TEST_BIN --journal $DCP_JOURNAL_DIR $2 --sparse \
+		--chunksize 1MB $DCP_SRC $DCP_DEST_DIR
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DCP_MPIRUN_BIN -np $1 $DCP_TEST_BIN --journal $DCP_JOURNAL_DIR $2 --sparse --chunksize 1MB $DCP_SRC $DCP_DEST_DIR"
+	fi
+}
+
+function check_same {
+	for f in $@; do
+		$DCP_CMP_BIN $DCP_SRC/$f $DCP_DEST/$f
+		if [[ $? -ne 0 ]]; then
+			fail "CMP mismatch: $DCP_SRC/$f $DCP_DEST/$f."
+		fi
+	done
+}
+
+cleanup
+mkdir -p $DCP_SRC
+
+echo "Subtest 1, copy with a journal."
+# dense file, file with holes at the front and end, and a small file
+dd if=/dev/urandom of=$DCP_SRC/dense bs=1M count=4
+dd if=/dev/urandom of=$DCP_SRC/holes bs=1M seek=2 count=1
+truncate -s 6M $DCP_SRC/holes
+dd if=/dev/urandom of=$DCP_SRC/small bs=1k count=100
+
+run_dcp 2 ""
+check_same dense holes small
+
+echo "Subtest 2, resume with nothing changed."
+run_dcp 3 --resume
+check_same dense holes small
+
+echo "Subtest 3, resume after the source changed."
+# same size, new data at both ends and a hole in the middle
+truncate -s 0 $DCP_SRC/dense
+dd if=/dev/urandom of=$DCP_SRC/dense bs=64k count=1
+dd if=/dev/urandom of=$DCP_SRC/dense bs=64k seek=63 count=1
+
+# new sparse file whose destination already holds other data,
+# which must not survive in its holes
+dd if=/dev/urandom of=$DCP_SRC/new bs=1k count=1
+dd if=/dev/urandom of=$DCP_SRC/new bs=1k seek=3000 count=1
+dd if=/dev/urandom of=$DCP_DEST/new bs=1k count=3001
+
+run_dcp 3 --resume
+check_same dense holes small new
+
+echo "Subtest 4, resume with a different number of processes."
+dd if=/dev/urandom of=$DCP_SRC/holes bs=1M seek=4 count=1 conv=notrunc
+run_dcp 1 --resume
+check_same dense holes small new
+
+cleanup
+exit 0
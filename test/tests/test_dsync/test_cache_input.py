@@ -0,0 +1,18 @@
+#!/usr/bin/env python2
+import subprocess 
+
+# change paths here for bash script as necessary
+mpifu_path       = "~/mpifileutils/test/tests/test_dsync/test_cache_input.sh" 
+
+# vars in bash script
+dsync_test_bin   = "/root/mpifileutils/install/bin/dsync"
+dsync_dcmp_bin   = "/root/mpifileutils/install/bin/dcmp"
+dsync_walk_bin   = "/root/mpifileutils/install/bin/dwalk"
+dsync_mpirun_bin = "mpirun"
+dsync_src_dir    = "/mnt/lustre"
+dsync_dest_dir   = "/mnt/lustre2"
+dsync_tmp_file   = "dir_test_cache_input_XXX"
+
+def test_cache_input():
+        p = subprocess.Popen(["%s %s %s %s %s %s %s %s" % (mpifu_path, dsync_test_bin, dsync_dcmp_bin, 
+          dsync_walk_bin, dsync_mpirun_bin, dsync_src_dir, dsync_dest_dir, dsync_tmp_file)], shell=True, executable="/bin/bash").communicate()
@@ -0,0 +1,131 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dcmp --lite and dsync --dryrun report the same
+#   differences when reading source and destination lists from caches
+#   written by dwalk --output as when walking the trees, and that they
+#   do not need the trees to exist when both lists come from caches.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DSYNC_TEST_BIN=${DSYNC_TEST_BIN:-${1}}
+DSYNC_DCMP_BIN=${DSYNC_DCMP_BIN:-${2}}
+DSYNC_WALK_BIN=${DSYNC_WALK_BIN:-${3}}
+DSYNC_MPIRUN_BIN=${DSYNC_MPIRUN_BIN:-${4}}
+DSYNC_SRC_DIR=${DSYNC_SRC_DIR:-${5}}
+DSYNC_DEST_DIR=${DSYNC_DEST_DIR:-${6}}
+DSYNC_TMP_FILE=${DSYNC_TMP_FILE:-${7}}
+
+echo "Using dsync binary at: $DSYNC_TEST_BIN"
+echo "Using dcmp binary at: $DSYNC_DCMP_BIN"
+echo "Using dwalk binary at: $DSYNC_WALK_BIN"
+echo "Using mpirun binary at: $DSYNC_MPIRUN_BIN"
+echo "Using src directory at: $DSYNC_SRC_DIR"
+echo "Using dest directory at: $DSYNC_DEST_DIR"
+
+DSYNC_SRC_CACHE=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE.src.cache
+DSYNC_DEST_CACHE=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE.dest.cache
+DSYNC_OUT=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE.out
+DSYNC_SRC=$DSYNC_SRC_DIR/$DSYNC_TMP_FILE
+DSYNC_DEST=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE
+
+function cleanup {
+	rm -rf $DSYNC_SRC $DSYNC_SRC.moved
+	rm -rf $DSYNC_DEST $DSYNC_DEST.moved
+	rm -f $DSYNC_SRC_CACHE $DSYNC_DEST_CACHE
+	rm -rf $DSYNC_OUT
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+function run_cmd {
+	$@
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $@"
+	fi
+}
+
+# write dcmp summary and sorted list of differing items to $1.dcmp,
+# followed by lines of the dsync plan, remaining args select inputs
+function plan {
+	out=$1
+	np=$2
+	shift 2
+
+	$DSYNC_MPIRUN_BIN -np $np $DSYNC_DCMP_BIN --lite $@ \
+		-o EXIST=ONLY_SRC,EXIST=ONLY_DEST,SIZE=DIFFER,MTIME=DIFFER,PERM=DIFFER:$out.list \
+		--text $DSYNC_SRC $DSYNC_DEST > $out.stdout
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DSYNC_MPIRUN_BIN -np $np $DSYNC_DCMP_BIN --lite $@ --text $DSYNC_SRC $DSYNC_DEST"
+	fi
+	grep "^Number of items" $out.stdout | sed 's/, dumped to .*//' > $out.dcmp
+	sort $out.list >> $out.dcmp
+
+	$DSYNC_MPIRUN_BIN -np $np $DSYNC_TEST_BIN --dryrun $@ \
+		$DSYNC_SRC $DSYNC_DEST > $out.stdout 2>&1
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DSYNC_MPIRUN_BIN -np $np $DSYNC_TEST_BIN --dryrun $@ $DSYNC_SRC $DSYNC_DEST"
+	fi
+	grep "Would " $out.stdout | sed 's/^\[[^]]*\] //' > $out.dsync
+}
+
+function check_plan {
+	for tool in dcmp dsync; do
+		diff $DSYNC_OUT/live.$tool $1.$tool
+		if [[ $? -ne 0 ]]; then
+			fail "$tool output differs between walking the trees and $2."
+		fi
+	done
+}
+
+cleanup
+mkdir -p $DSYNC_OUT
+
+# files that are the same, that differ in size, mtime, or permissions,
+# and items that exist in only one of the trees
+mkdir -p $DSYNC_SRC/sub $DSYNC_DEST/sub
+for i in $(seq 1 8); do
+	dd if=/dev/urandom of=$DSYNC_SRC/sub/f$i bs=10k count=$i
+	cp $DSYNC_SRC/sub/f$i $DSYNC_DEST/sub/f$i
+done
+touch -d "1 hour ago" $DSYNC_SRC/sub/f* $DSYNC_DEST/sub/f*
+echo more >> $DSYNC_DEST/sub/f2
+touch $DSYNC_DEST/sub/f3
+chmod 600 $DSYNC_DEST/sub/f4
+echo src > $DSYNC_SRC/only_src
+mkdir -p $DSYNC_SRC/only_src_dir
+echo dest > $DSYNC_DEST/only_dest
+
+echo "Subtest 1, plan by walking the trees and write caches."
+plan $DSYNC_OUT/live 2
+if [[ ! -s $DSYNC_OUT/live.dsync ]]; then
+	fail "No plan printed by $DSYNC_TEST_BIN --dryrun."
+fi
+run_cmd $DSYNC_MPIRUN_BIN -np 2 $DSYNC_WALK_BIN --output $DSYNC_SRC_CACHE $DSYNC_SRC
+run_cmd $DSYNC_MPIRUN_BIN -np 3 $DSYNC_WALK_BIN --output $DSYNC_DEST_CACHE $DSYNC_DEST
+
+echo "Subtest 2, plan from a cache of one of the trees."
+plan $DSYNC_OUT/src_cache 3 --input $DSYNC_SRC_CACHE
+check_plan $DSYNC_OUT/src_cache "reading the source from a cache"
+plan $DSYNC_OUT/dest_cache 1 --dest-input $DSYNC_DEST_CACHE
+check_plan $DSYNC_OUT/dest_cache "reading the destination from a cache"
+
+echo "Subtest 3, plan from caches of both trees after the trees are moved."
+mv $DSYNC_SRC $DSYNC_SRC.moved
+mv $DSYNC_DEST $DSYNC_DEST.moved
+for np in 1 4; do
+	plan $DSYNC_OUT/caches$np $np --input $DSYNC_SRC_CACHE --dest-input $DSYNC_DEST_CACHE
+	check_plan $DSYNC_OUT/caches$np "reading both trees from caches with $np processes"
+done
+
+cleanup
+exit 0
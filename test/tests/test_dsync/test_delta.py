@@ -0,0 +1,18 @@
+#!/usr/bin/env python2
+import subprocess 
+
+# change paths here for bash script as necessary
+mpifu_path       = "~/mpifileutils/test/tests/test_dsync/test_delta.sh" 
+
+# vars in bash script
+dsync_test_bin   = "/root/mpifileutils/install/bin/dsync"
+dsync_dcmp_bin   = "/root/mpifileutils/install/bin/dcmp"
+dsync_mpirun_bin = "mpirun"
+dsync_cmp_bin    = "cmp"
+dsync_src_dir    = "/mnt/lustre"
+dsync_dest_dir   = "/mnt/lustre2"
+dsync_tmp_file   = "dir_test_delta_XXX"
+
+def test_delta():
+        p = subprocess.Popen(["%s %s %s %s %s %s %s %s" % (mpifu_path, dsync_test_bin, dsync_dcmp_bin,
+          dsync_mpirun_bin, dsync_cmp_bin, dsync_src_dir, dsync_dest_dir, dsync_tmp_file)], shell=True, executable="/bin/bash").communicate()
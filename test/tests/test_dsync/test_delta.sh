@@ -0,0 +1,147 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dsync --delta and --delta-manifest leave the
+#   destination identical to the source, with the same mtime, after
+#   data is appended to the source and after it is edited in place,
+#   and that a destination file with another hard link is replaced
+#   rather than written in place.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DSYNC_TEST_BIN=${DSYNC_TEST_BIN:-${1}}
+DSYNC_DCMP_BIN=${DSYNC_DCMP_BIN:-${2}}
+DSYNC_MPIRUN_BIN=${DSYNC_MPIRUN_BIN:-${3}}
+DSYNC_CMP_BIN=${DSYNC_CMP_BIN:-${4}}
+DSYNC_SRC_DIR=${DSYNC_SRC_DIR:-${5}}
+DSYNC_DEST_DIR=${DSYNC_DEST_DIR:-${6}}
+DSYNC_TMP_FILE=${DSYNC_TMP_FILE:-${7}}
+
+echo "Using dsync binary at: $DSYNC_TEST_BIN"
+echo "Using dcmp binary at: $DSYNC_DCMP_BIN"
+echo "Using mpirun binary at: $DSYNC_MPIRUN_BIN"
+echo "Using cmp binary at: $DSYNC_CMP_BIN"
+echo "Using src directory at: $DSYNC_SRC_DIR"
+echo "Using dest directory at: $DSYNC_DEST_DIR"
+
+DSYNC_SRC=$DSYNC_SRC_DIR/$DSYNC_TMP_FILE
+DSYNC_DEST=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE
+DSYNC_MANIFEST=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE.sums
+DSYNC_LINK=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE.link
+
+function cleanup {
+	rm -rf $DSYNC_SRC
+	rm -rf $DSYNC_DEST
+	rm -f $DSYNC_MANIFEST
+	rm -f $DSYNC_LINK
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+function run_dsync {
+	$DSYNC_MPIRUN_BIN -np 3 $DSYNC_TEST_BIN $@ --chunksize 1MB $DSYNC_SRC $DSYNC_DEST
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DSYNC_MPIRUN_BIN -np 3 $DSYNC_TEST_BIN $@ --chunksize 1MB $DSYNC_SRC $DSYNC_DEST"
+	fi
+}
+
+function write_manifest {
+	$DSYNC_MPIRUN_BIN -np 3 $DSYNC_DCMP_BIN --chunksize 1MB --write-manifest $DSYNC_MANIFEST $DSYNC_DEST
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DSYNC_MPIRUN_BIN -np 3 $DSYNC_DCMP_BIN --chunksize 1MB --write-manifest $DSYNC_MANIFEST $DSYNC_DEST"
+	fi
+}
+
+function check_same {
+	for f in $@; do
+		$DSYNC_CMP_BIN $DSYNC_SRC/$f $DSYNC_DEST/$f
+		if [[ $? -ne 0 ]]; then
+			fail "CMP mismatch: $DSYNC_SRC/$f $DSYNC_DEST/$f."
+		fi
+		if [ "`stat -c %y $DSYNC_SRC/$f`" != "`stat -c %y $DSYNC_DEST/$f`" ]; then
+			fail "Mtime mismatch: $DSYNC_SRC/$f $DSYNC_DEST/$f."
+		fi
+	done
+}
+
+# change a 4k block at the given offset in KB of a file in place
+function edit_file {
+	dd if=/dev/urandom of=$1 bs=1k seek=$2 count=4 conv=notrunc
+}
+
+cleanup
+mkdir -p $DSYNC_SRC
+mkdir -p $DSYNC_DEST
+
+# files a little over 4 chunks long, so the last chunk is partial
+for f in append edit shrink; do
+	dd if=/dev/urandom of=$DSYNC_SRC/$f bs=1k count=4500
+done
+cp -p $DSYNC_SRC/* $DSYNC_DEST
+
+for opt in --delta --delta-manifest; do
+	OPTS=$opt
+	if [ $opt == --delta-manifest ]; then
+		OPTS="$opt $DSYNC_MANIFEST"
+	fi
+
+	echo "Subtest $opt 1, data appended to the source."
+	dd if=/dev/urandom of=$DSYNC_SRC/append bs=1k count=1500 oflag=append conv=notrunc
+	[ $opt == --delta-manifest ] && write_manifest
+	run_dsync $OPTS
+	check_same append edit shrink
+
+	echo "Subtest $opt 2, source edited in place and truncated."
+	edit_file $DSYNC_SRC/edit 10
+	edit_file $DSYNC_SRC/edit 2050
+	truncate -s 3000k $DSYNC_SRC/shrink
+	[ $opt == --delta-manifest ] && write_manifest
+	run_dsync $OPTS
+	check_same append edit shrink
+
+	echo "Subtest $opt 3, destination shorter with the same mtime."
+	truncate -s 2500k $DSYNC_DEST/append
+	touch -r $DSYNC_SRC/append $DSYNC_DEST/append
+	[ $opt == --delta-manifest ] && write_manifest
+	run_dsync $OPTS
+	check_same append edit shrink
+
+	echo "Subtest $opt 4, destination edited after its manifest was written."
+	edit_file $DSYNC_SRC/edit 3000
+	[ $opt == --delta-manifest ] && write_manifest
+	edit_file $DSYNC_DEST/edit 100
+	edit_file $DSYNC_DEST/edit 3000
+
+	# file times may be too coarse to tell these edits from the
+	# one above, so move the destination mtime out of the way
+	touch -d "1 hour ago" $DSYNC_DEST/edit
+	run_dsync $OPTS
+	check_same append edit shrink
+
+	echo "Subtest $opt 5, destination with another hard link."
+	rm -f $DSYNC_LINK
+	ln $DSYNC_DEST/edit $DSYNC_LINK
+	cp $DSYNC_LINK $DSYNC_LINK.orig
+	edit_file $DSYNC_SRC/edit 1000
+	[ $opt == --delta-manifest ] && write_manifest
+	run_dsync $OPTS
+	check_same append edit shrink
+	$DSYNC_CMP_BIN $DSYNC_LINK $DSYNC_LINK.orig
+	rc=$?
+	rm -f $DSYNC_LINK.orig
+	if [[ $rc -ne 0 ]]; then
+		fail "Other hard link changed: $DSYNC_LINK."
+	fi
+done
+
+cleanup
+exit 0
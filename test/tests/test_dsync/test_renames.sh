@@ -0,0 +1,130 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dsync --detect-renames only renames a file
+#   when its match is certain, and that files sharing a size and mtime
+#   end up with the right contents with and without --contents.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DSYNC_TEST_BIN=${DSYNC_TEST_BIN:-${1}}
+DSYNC_MPIRUN_BIN=${DSYNC_MPIRUN_BIN:-${2}}
+DSYNC_CMP_BIN=${DSYNC_CMP_BIN:-${3}}
+DSYNC_SRC_DIR=${DSYNC_SRC_DIR:-${4}}
+DSYNC_DEST_DIR=${DSYNC_DEST_DIR:-${5}}
+DSYNC_TMP_FILE=${DSYNC_TMP_FILE:-${6}}
+
+echo "Using dsync binary at: $DSYNC_TEST_BIN"
+echo "Using mpirun binary at: $DSYNC_MPIRUN_BIN"
+echo "Using cmp binary at: $DSYNC_CMP_BIN"
+echo "Using src directory at: $DSYNC_SRC_DIR"
+echo "Using dest directory at: $DSYNC_DEST_DIR"
+
+DSYNC_SRC=$DSYNC_SRC_DIR/$DSYNC_TMP_FILE
+DSYNC_DEST=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE
+DSYNC_KEEP=$DSYNC_DEST_DIR/$DSYNC_TMP_FILE.keep
+
+function cleanup {
+	rm -rf $DSYNC_SRC
+	rm -rf $DSYNC_DEST
+	rm -rf $DSYNC_KEEP
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+function run_dsync {
+	$DSYNC_MPIRUN_BIN -np 3 $DSYNC_TEST_BIN --delete --detect-renames $@ --chunksize 1MB $DSYNC_SRC $DSYNC_DEST
+	if [[ $? -ne 0 ]]; then
+		fail "Failed to run cmd: $DSYNC_MPIRUN_BIN -np 3 $DSYNC_TEST_BIN --delete --detect-renames $@ --chunksize 1MB $DSYNC_SRC $DSYNC_DEST"
+	fi
+}
+
+function check_same {
+	for f in $@; do
+		$DSYNC_CMP_BIN $DSYNC_SRC/$f $DSYNC_DEST/$f
+		if [[ $? -ne 0 ]]; then
+			fail "CMP mismatch: $DSYNC_SRC/$f $DSYNC_DEST/$f."
+		fi
+	done
+	if [ -e $DSYNC_DEST/old ]; then
+		fail "Old directory left in destination: $DSYNC_DEST/old."
+	fi
+}
+
+function inode {
+	stat -c %i $1
+}
+
+# record the inode of a destination file, holding a link to it
+# so that its inode is not reused by a file copied in its place
+function keep_inode {
+	ln $DSYNC_DEST/old/$1 $DSYNC_KEEP/$1
+	inode $DSYNC_DEST/old/$1
+}
+
+# set up a source directory of files that were moved since they were
+# copied to the destination, files a and b, and files c and d, have
+# the same size and mtime, and z has the same size and mtime as e,
+# but other contents
+function setup {
+	cleanup
+	mkdir -p $DSYNC_SRC/new
+	mkdir -p $DSYNC_DEST/old
+	mkdir -p $DSYNC_KEEP
+	for f in a b c d e u; do
+		dd if=/dev/urandom of=$DSYNC_SRC/new/$f bs=1k count=3000
+	done
+	dd if=/dev/urandom of=$DSYNC_SRC/new/u bs=1k count=100 oflag=append conv=notrunc
+	dd if=/dev/urandom of=$DSYNC_DEST/old/z bs=1k count=3000
+	touch -d "2020-01-01 00:00:00" $DSYNC_SRC/new/a $DSYNC_SRC/new/b
+	touch -d "2020-01-02 00:00:00" $DSYNC_SRC/new/c $DSYNC_SRC/new/d
+	touch -d "2020-01-03 00:00:00" $DSYNC_SRC/new/e $DSYNC_DEST/old/z
+	touch -d "2020-01-04 00:00:00" $DSYNC_SRC/new/u
+	for f in a b c d e u; do
+		cp -p $DSYNC_SRC/new/$f $DSYNC_DEST/old/$f
+	done
+
+	# swap contents of c and d in the destination, keeping their mtime
+	mv $DSYNC_DEST/old/c $DSYNC_DEST/old/tmp
+	mv $DSYNC_DEST/old/d $DSYNC_DEST/old/c
+	mv $DSYNC_DEST/old/tmp $DSYNC_DEST/old/d
+}
+
+echo "Subtest 1, rename without --contents."
+setup
+INODE_U=`keep_inode u`
+INODE_A=`keep_inode a`
+INODE_E=`keep_inode e`
+run_dsync
+check_same new/a new/b new/c new/d new/e new/u
+
+# u is the only file with its size and mtime, so it is renamed,
+# others share theirs with another file, so they are copied
+if [ "`inode $DSYNC_DEST/new/u`" != "$INODE_U" ]; then
+	fail "File with a single match was not renamed: $DSYNC_DEST/new/u."
+fi
+if [ "`inode $DSYNC_DEST/new/a`" == "$INODE_A" ] ||
+   [ "`inode $DSYNC_DEST/new/e`" == "$INODE_E" ]; then
+	fail "File with several matches was renamed without --contents."
+fi
+
+echo "Subtest 2, rename with --contents."
+setup
+INODE_U=`keep_inode u`
+run_dsync --contents
+check_same new/a new/b new/c new/d new/e new/u
+if [ "`inode $DSYNC_DEST/new/u`" != "$INODE_U" ]; then
+	fail "File with a single match was not renamed: $DSYNC_DEST/new/u."
+fi
+
+cleanup
+exit 0
@@ -0,0 +1,16 @@
+#!/usr/bin/env python2
+import subprocess 
+
+# change paths here for bash script as necessary
+mpifu_path       = "~/mpifileutils/test/tests/test_dwalk/test_topk.sh" 
+
+# vars in bash script
+dwalk_test_bin   = "/root/mpifileutils/install/bin/dwalk"
+dwalk_find_bin   = "/root/mpifileutils/install/bin/dfind"
+dwalk_mpirun_bin = "mpirun"
+dwalk_src_dir    = "/mnt/lustre"
+dwalk_tmp_file   = "dir_test_topk_XXX"
+
+def test_topk():
+        p = subprocess.Popen(["%s %s %s %s %s %s" % (mpifu_path, dwalk_test_bin, dwalk_find_bin, 
+          dwalk_mpirun_bin, dwalk_src_dir, dwalk_tmp_file)], shell=True, executable="/bin/bash").communicate()
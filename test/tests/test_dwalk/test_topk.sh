@@ -0,0 +1,97 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dwalk --top and dfind --top list the same items
+#   in the same order as the first lines of dwalk --sort --print, for
+#   both ascending and descending order and any number of processes.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DWALK_TEST_BIN=${DWALK_TEST_BIN:-${1}}
+DWALK_FIND_BIN=${DWALK_FIND_BIN:-${2}}
+DWALK_MPIRUN_BIN=${DWALK_MPIRUN_BIN:-${3}}
+DWALK_SRC_DIR=${DWALK_SRC_DIR:-${4}}
+DWALK_TMP_FILE=${DWALK_TMP_FILE:-${5}}
+
+echo "Using dwalk binary at: $DWALK_TEST_BIN"
+echo "Using dfind binary at: $DWALK_FIND_BIN"
+echo "Using mpirun binary at: $DWALK_MPIRUN_BIN"
+echo "Using src directory at: $DWALK_SRC_DIR"
+
+DWALK_SRC=$DWALK_SRC_DIR/$DWALK_TMP_FILE
+
+function cleanup {
+	rm -rf $DWALK_SRC
+}
+
+function fail {
+	echo "$@"
+	cleanup
+	exit 1
+}
+
+# print names of the first N regular files listed by dwalk --sort --print
+function sorted_names {
+	$DWALK_MPIRUN_BIN -np 2 $DWALK_TEST_BIN --sort $1 --print $DWALK_SRC | \
+		grep '^-' | head -n $2 | awk '{print $NF}'
+}
+
+# print names listed after the "First N items" line of --top output
+function top_names {
+	sed -n '/^First [0-9]* items by/,/^$/p' | sed '1d;/^$/d' | awk '{print $NF}'
+}
+
+function check_names {
+	if [[ "$1" != "$2" ]]; then
+		echo "Expected:"
+		echo "$1"
+		echo "Found:"
+		echo "$2"
+		fail "$3"
+	fi
+}
+
+cleanup
+mkdir -p $DWALK_SRC/sub
+
+# files of distinct sizes, all larger than the directories,
+# with names that do not follow their sizes
+for i in $(seq 1 30); do
+	size=$(( 65536 + (i * 7919 % 30) * 1000 + i ))
+	head -c $size /dev/urandom > $DWALK_SRC/f$i
+done
+for i in $(seq 1 10); do
+	size=$(( 65536 + (i * 13 % 10) * 3001 + 500 ))
+	head -c $size /dev/urandom > $DWALK_SRC/sub/g$i
+done
+
+echo "Subtest 1, dwalk largest items."
+expected=$(sorted_names -size 10)
+for np in 1 3; do
+	found=$($DWALK_MPIRUN_BIN -np $np $DWALK_TEST_BIN --top -size:10 $DWALK_SRC | top_names)
+	check_names "$expected" "$found" "dwalk --top -size:10 with $np processes does not match --sort -size."
+done
+
+echo "Subtest 2, dfind smallest and largest files."
+for field in size -size; do
+	expected=$(sorted_names $field 7)
+	for np in 1 4; do
+		found=$($DWALK_MPIRUN_BIN -np $np $DWALK_FIND_BIN --top $field:7 $DWALK_SRC --type f | top_names)
+		check_names "$expected" "$found" "dfind --top $field:7 with $np processes does not match --sort $field."
+	done
+done
+
+echo "Subtest 3, dwalk with more items asked for than exist."
+expected=$(find $DWALK_SRC | wc -l)
+found=$($DWALK_MPIRUN_BIN -np 3 $DWALK_TEST_BIN --top -size:1000 $DWALK_SRC | top_names | wc -l)
+if [[ $found -ne $expected ]]; then
+	fail "Expected $expected items from dwalk --top -size:1000, found $found."
+fi
+
+cleanup
+exit 0